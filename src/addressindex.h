@@ -35,16 +35,16 @@ struct CMempoolAddressDeltaKey
 {
     int type;
     uint160 addressBytes;
-    std::string asset;
+    uint32_t asset;
     uint256 txhash;
     unsigned int index;
     int spending;
 
-    CMempoolAddressDeltaKey(int addressType, uint160 addressHash, std::string assetName,
+    CMempoolAddressDeltaKey(int addressType, uint160 addressHash, uint32_t assetId,
                             uint256 hash, unsigned int i, int s) {
         type = addressType;
         addressBytes = addressHash;
-        asset = assetName;
+        asset = assetId;
         txhash = hash;
         index = i;
         spending = s;
@@ -53,16 +53,16 @@ struct CMempoolAddressDeltaKey
     CMempoolAddressDeltaKey(int addressType, uint160 addressHash, uint256 hash, unsigned int i, int s) {
         type = addressType;
         addressBytes = addressHash;
-        asset = "";
+        asset = 0;
         txhash = hash;
         index = i;
         spending = s;
     }
 
-    CMempoolAddressDeltaKey(int addressType, uint160 addressHash, std::string assetName) {
+    CMempoolAddressDeltaKey(int addressType, uint160 addressHash, uint32_t assetId) {
         type = addressType;
         addressBytes = addressHash;
-        asset = assetName;
+        asset = assetId;
         txhash.SetNull();
         index = 0;
         spending = 0;
@@ -71,7 +71,7 @@ struct CMempoolAddressDeltaKey
     CMempoolAddressDeltaKey(int addressType, uint160 addressHash) {
         type = addressType;
         addressBytes = addressHash;
-        asset = "";
+        asset = 0;
         txhash.SetNull();
         index = 0;
         spending = 0;
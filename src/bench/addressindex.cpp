@@ -0,0 +1,273 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <addressindex.h>
+#include <clientversion.h>
+#include <random.h>
+#include <script/script.h>
+#include <spentindex.h>
+#include <streams.h>
+#include <txdb.h>
+
+#include <cassert>
+#include <map>
+#include <memory>
+#include <vector>
+
+static const int ADDRESSES = 100;
+static const int ENTRIES = 10000;
+
+static const int INDEX_ADDRESSES = 200;
+static const int INDEX_ENTRIES_PER_ADDRESS = 250;
+static const char* const INDEX_ASSETS[] = {"", "RAIN", "TESTTOKEN", "SOMELONGERASSETNAME"};
+
+// Encode and decode the address index keys of a block's worth of outputs
+static void AddressIndexKeySerialize(benchmark::State& state)
+{
+    FastRandomContext rand(true);
+    std::vector<CAddressIndexKey> keys;
+    for (int i = 0; i < 1000; i++) {
+        keys.emplace_back(1, uint160(rand.randbytes(20)), rand.randrange(16), i, i, rand.rand256(), 0, false);
+    }
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    while (state.KeepRunning()) {
+        ss.clear();
+        for (const CAddressIndexKey& key : keys)
+            ss << key;
+        CAddressIndexKey key;
+        for (size_t i = 0; i < keys.size(); i++)
+            ss >> key;
+    }
+}
+
+// Sum the mempool deltas of every address, the range scan behind getaddressmempool
+static void MempoolAddressDeltaScan(benchmark::State& state)
+{
+    FastRandomContext rand(true);
+    std::vector<uint160> addresses;
+    for (int i = 0; i < ADDRESSES; i++) {
+        addresses.emplace_back(rand.randbytes(20));
+    }
+
+    std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> mapAddress;
+    for (int i = 0; i < ENTRIES; i++) {
+        CMempoolAddressDeltaKey key(1, addresses[rand.randrange(ADDRESSES)], rand.randrange(16), rand.rand256(), 0, 0);
+        mapAddress.emplace(key, CMempoolAddressDelta(0, 1));
+    }
+
+    while (state.KeepRunning()) {
+        CAmount nTotal = 0;
+        for (const uint160& address : addresses) {
+            auto it = mapAddress.lower_bound(CMempoolAddressDeltaKey(1, address));
+            for (; it != mapAddress.end() && it->first.type == 1 && it->first.addressBytes == address; ++it)
+                nTotal += it->second.amount;
+        }
+        assert(nTotal == ENTRIES);
+    }
+}
+
+// Address index keys with the asset name, as they were written before asset ids
+struct LegacyAddressIndexKey {
+    CAddressIndexKey key;
+    std::string asset;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, key.type);
+        key.hashBytes.Serialize(s);
+        ::Serialize(s, asset);
+        ser_writedata32be(s, key.blockHeight);
+        ser_writedata32be(s, key.txindex);
+        key.txhash.Serialize(s);
+        ser_writedata32(s, key.index);
+        ser_writedata8(s, key.spending);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        key.type = ser_readdata8(s);
+        key.hashBytes.Unserialize(s);
+        ::Unserialize(s, asset);
+        key.blockHeight = ser_readdata32be(s);
+        key.txindex = ser_readdata32be(s);
+        key.txhash.Unserialize(s);
+        key.index = ser_readdata32(s);
+        key.spending = ser_readdata8(s);
+    }
+};
+
+struct LegacyAddressUnspentKey {
+    CAddressUnspentKey key;
+    std::string asset;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, key.type);
+        key.hashBytes.Serialize(s);
+        ::Serialize(s, asset);
+        key.txhash.Serialize(s);
+        ser_writedata32(s, key.index);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        key.type = ser_readdata8(s);
+        key.hashBytes.Unserialize(s);
+        ::Unserialize(s, asset);
+        key.txhash.Unserialize(s);
+        key.index = ser_readdata32(s);
+    }
+};
+
+/**
+ * An in-memory block tree DB with the same address index and unspent index entries in both key
+ * formats: the current ones written by WriteAddressIndex and UpdateAddressUnspentIndex, and the
+ * old ones with the asset name under separate prefixes.
+ */
+struct AddressIndexDB
+{
+    CBlockTreeDB db;
+    std::vector<uint160> addresses;
+
+    AddressIndexDB() : db(1 << 20, true, true)
+    {
+        FastRandomContext rand(true);
+        CScript script = CScript() << OP_TRUE;
+        for (int i = 0; i < INDEX_ADDRESSES; i++) {
+            uint160 hash(rand.randbytes(20));
+            addresses.emplace_back(hash);
+
+            std::vector<std::pair<CAddressIndexKey, CAmount> > entries;
+            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspents;
+            CDBBatch batch(db);
+            for (int j = 0; j < INDEX_ENTRIES_PER_ADDRESS; j++) {
+                const char* asset = INDEX_ASSETS[rand.randrange(4)];
+                uint32_t assetId = db.GetAddressIndexAssetId(asset);
+                int height = 1 + j * 10;
+                uint256 txid = rand.rand256();
+
+                CAddressIndexKey key(1, hash, assetId, height, 1, txid, 0, false);
+                CAddressUnspentKey unspentKey(1, hash, assetId, txid, 0);
+                CAddressUnspentValue unspent(COIN, script, height);
+                entries.emplace_back(key, COIN);
+                unspents.emplace_back(unspentKey, unspent);
+                batch.Write(std::make_pair(DB_ADDRESSINDEX_LEGACY, LegacyAddressIndexKey{key, asset}), CAmount(COIN));
+                batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX_LEGACY, LegacyAddressUnspentKey{unspentKey, asset}), unspent);
+            }
+            bool fOk = db.WriteAddressIndex(entries) && db.UpdateAddressUnspentIndex(unspents) && db.WriteBatch(batch);
+            assert(fOk);
+        }
+        db.CompactFull();
+    }
+
+    // The prefix scan ReadAddressIndex did before asset ids
+    size_t ReadLegacyAddressIndex(const uint160& hash)
+    {
+        std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX_LEGACY, CAddressIndexIteratorKey(1, hash)));
+        size_t nRead = 0;
+        while (pcursor->Valid()) {
+            std::pair<char, LegacyAddressIndexKey> key;
+            CAmount nValue;
+            if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX_LEGACY || key.second.key.hashBytes != hash || !pcursor->GetValue(nValue))
+                break;
+            nRead++;
+            pcursor->Next();
+        }
+        return nRead;
+    }
+
+    size_t ReadLegacyAddressUnspentIndex(const uint160& hash)
+    {
+        std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+        pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX_LEGACY, CAddressIndexIteratorKey(1, hash)));
+        size_t nRead = 0;
+        while (pcursor->Valid()) {
+            std::pair<char, LegacyAddressUnspentKey> key;
+            CAddressUnspentValue value;
+            if (!pcursor->GetKey(key) || key.first != DB_ADDRESSUNSPENTINDEX_LEGACY || key.second.key.hashBytes != hash || !pcursor->GetValue(value))
+                break;
+            nRead++;
+            pcursor->Next();
+        }
+        return nRead;
+    }
+};
+
+static AddressIndexDB& GetAddressIndexDB()
+{
+    static std::unique_ptr<AddressIndexDB> db;
+    if (!db) {
+        db.reset(new AddressIndexDB());
+    }
+    return *db;
+}
+
+// Read all entries of every address, each call is one prefix range scan
+static void AddressIndexRead_AssetIds(benchmark::State& state)
+{
+    AddressIndexDB& index = GetAddressIndexDB();
+    while (state.KeepRunning()) {
+        for (const uint160& hash : index.addresses) {
+            std::vector<std::pair<CAddressIndexKey, CAmount> > entries;
+            index.db.ReadAddressIndex(hash, 1, "", entries);
+            assert(entries.size() == INDEX_ENTRIES_PER_ADDRESS);
+        }
+    }
+}
+
+static void AddressIndexRead_AssetNames(benchmark::State& state)
+{
+    AddressIndexDB& index = GetAddressIndexDB();
+    while (state.KeepRunning()) {
+        for (const uint160& hash : index.addresses) {
+            size_t nRead = index.ReadLegacyAddressIndex(hash);
+            assert(nRead == INDEX_ENTRIES_PER_ADDRESS);
+        }
+    }
+}
+
+// Read the entries of every address in a narrow height range, which only seeks within each asset
+static void AddressIndexReadRange_AssetIds(benchmark::State& state)
+{
+    AddressIndexDB& index = GetAddressIndexDB();
+    while (state.KeepRunning()) {
+        for (const uint160& hash : index.addresses) {
+            std::vector<std::pair<CAddressIndexKey, CAmount> > entries;
+            index.db.ReadAddressIndex(hash, 1, "", entries, 1001, 1100);
+            assert(entries.size() == 10);
+        }
+    }
+}
+
+static void AddressUnspentIndexRead_AssetIds(benchmark::State& state)
+{
+    AddressIndexDB& index = GetAddressIndexDB();
+    while (state.KeepRunning()) {
+        for (const uint160& hash : index.addresses) {
+            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspents;
+            index.db.ReadAddressUnspentIndex(hash, 1, "", unspents);
+            assert(unspents.size() == INDEX_ENTRIES_PER_ADDRESS);
+        }
+    }
+}
+
+static void AddressUnspentIndexRead_AssetNames(benchmark::State& state)
+{
+    AddressIndexDB& index = GetAddressIndexDB();
+    while (state.KeepRunning()) {
+        for (const uint160& hash : index.addresses) {
+            size_t nRead = index.ReadLegacyAddressUnspentIndex(hash);
+            assert(nRead == INDEX_ENTRIES_PER_ADDRESS);
+        }
+    }
+}
+
+BENCHMARK(AddressIndexKeySerialize, 2000);
+BENCHMARK(MempoolAddressDeltaScan, 500);
+BENCHMARK(AddressIndexRead_AssetIds, 5);
+BENCHMARK(AddressIndexRead_AssetNames, 5);
+BENCHMARK(AddressIndexReadRange_AssetIds, 50);
+BENCHMARK(AddressUnspentIndexRead_AssetIds, 5);
+BENCHMARK(AddressUnspentIndexRead_AssetNames, 5);
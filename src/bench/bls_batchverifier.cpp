@@ -0,0 +1,102 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bls/bls_batchverifier.h>
+#include <bls/bls_worker.h>
+#include <random.h>
+
+#include <cassert>
+#include <vector>
+
+static const int QUORUMS = 4;
+static const int PEERS = 8;
+
+// ISLOCK-like messages, each signed by one of a few quorum keys and received from one of a few peers
+struct ISLockBatch {
+    std::vector<CBLSPublicKey> quorumPubKeys;
+    std::vector<uint256> hashes;
+    std::vector<uint256> signHashes;
+    std::vector<CBLSSignature> sigs;
+    std::vector<int> quorumIdxs;
+
+    ISLockBatch(size_t count, size_t invalidCount)
+    {
+        std::vector<CBLSSecretKey> quorumSecKeys(QUORUMS);
+        for (auto& sk : quorumSecKeys) {
+            sk.MakeNewKey();
+            quorumPubKeys.emplace_back(sk.GetPublicKey());
+        }
+
+        FastRandomContext rand(true);
+        for (size_t i = 0; i < count; i++) {
+            int quorumIdx = rand.randrange(QUORUMS);
+            hashes.emplace_back(rand.rand256());
+            signHashes.emplace_back(rand.rand256());
+            sigs.emplace_back(quorumSecKeys[quorumIdx].Sign(signHashes.back()));
+            quorumIdxs.emplace_back(quorumIdx);
+        }
+        for (size_t i = 0; i < invalidCount; i++) {
+            sigs[rand.randrange(count)] = quorumSecKeys[0].Sign(rand.rand256());
+        }
+    }
+};
+
+static CBLSWorker& GetBenchWorker()
+{
+    static CBLSWorker* worker = nullptr;
+    if (!worker) {
+        worker = new CBLSWorker();
+        worker->Start();
+    }
+    return *worker;
+}
+
+static void BatchVerifyISLocks(benchmark::State& state, size_t count, size_t invalidCount, bool parallel)
+{
+    ISLockBatch batch(count, invalidCount);
+    CBLSWorker* worker = parallel ? &GetBenchWorker() : nullptr;
+
+    while (state.KeepRunning()) {
+        CBLSBatchVerifier<int, uint256> batchVerifier(false, true, 0, worker);
+        for (size_t i = 0; i < count; i++) {
+            batchVerifier.PushMessage(i % PEERS, batch.hashes[i], batch.signHashes[i], batch.sigs[i], batch.quorumPubKeys[batch.quorumIdxs[i]]);
+        }
+        batchVerifier.Verify();
+        assert(batchVerifier.badMessages.size() <= invalidCount);
+        assert(invalidCount != 0 || batchVerifier.badSources.empty());
+    }
+}
+
+static void BLSBatchVerify_ISLocks1000(benchmark::State& state)
+{
+    BatchVerifyISLocks(state, 1000, 0, false);
+}
+
+static void BLSBatchVerify_ISLocks1000Parallel(benchmark::State& state)
+{
+    BatchVerifyISLocks(state, 1000, 0, true);
+}
+
+static void BLSBatchVerify_ISLocks5000(benchmark::State& state)
+{
+    BatchVerifyISLocks(state, 5000, 0, false);
+}
+
+static void BLSBatchVerify_ISLocks5000Parallel(benchmark::State& state)
+{
+    BatchVerifyISLocks(state, 5000, 0, true);
+}
+
+// A few bad locks, the peers which sent them are found by bisection
+static void BLSBatchVerify_ISLocks5000Parallel3Invalid(benchmark::State& state)
+{
+    BatchVerifyISLocks(state, 5000, 3, true);
+}
+
+BENCHMARK(BLSBatchVerify_ISLocks1000, 5);
+BENCHMARK(BLSBatchVerify_ISLocks1000Parallel, 5);
+BENCHMARK(BLSBatchVerify_ISLocks5000, 1);
+BENCHMARK(BLSBatchVerify_ISLocks5000Parallel, 1);
+BENCHMARK(BLSBatchVerify_ISLocks5000Parallel3Invalid, 1);
@@ -2,11 +2,25 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
-#include "bench.h"
-#include "random.h"
-#include "bls/bls_worker.h"
+#include <bench/bench.h>
+#include <bls/bls_worker.h>
+#include <random.h>
 
-extern CBLSWorker blsWorker;
+#include <cassert>
+#include <future>
+#include <list>
+#include <memory>
+#include <set>
+
+static CBLSWorker& GetBenchWorker()
+{
+    static CBLSWorker* worker = nullptr;
+    if (!worker) {
+        worker = new CBLSWorker();
+        worker->Start();
+    }
+    return *worker;
+}
 
 struct Member {
     CBLSId id;
@@ -25,7 +39,10 @@ struct DKG
 
     BLSVerificationVectorPtr quorumVvec;
 
-    DKG(int quorumSize)
+    CBLSWorker& blsWorker;
+
+    DKG(int quorumSize) :
+        blsWorker(GetBenchWorker())
     {
         members.resize(quorumSize);
         ids.resize(quorumSize);
@@ -39,7 +56,6 @@ struct DKG
             blsWorker.GenerateContributions(quorumSize / 2 + 1, ids, members[i].vvec, members[i].skShares);
         }
 
-        //printf("initialized quorum %d\n", quorumSize);
     }
 
     void ReceiveVvecs()
@@ -86,6 +102,17 @@ struct DKG
         }
     }
 
+    std::set<size_t> ReceiveInvalidShares(int invalidCount)
+    {
+        std::set<size_t> invalidIndexes;
+        for (int i = 0; i < invalidCount; i++) {
+            int shareIdx = GetRandInt(receivedSkShares.size());
+            receivedSkShares[shareIdx].MakeNewKey();
+            invalidIndexes.emplace(shareIdx);
+        }
+        return invalidIndexes;
+    }
+
     void Bench_VerifyContributionShares(benchmark::State& state, int invalidCount, bool parallel, bool aggregated)
     {
         ReceiveVvecs();
@@ -93,29 +120,84 @@ struct DKG
         // Benchmark.
         size_t memberIdx = 0;
         while (state.KeepRunning()) {
-            auto& m = members[memberIdx];
-
             ReceiveShares(memberIdx);
-
-            std::set<size_t> invalidIndexes;
-            for (int i = 0; i < invalidCount; i++) {
-                int shareIdx = GetRandInt(receivedSkShares.size());
-                receivedSkShares[shareIdx].MakeNewKey();
-                invalidIndexes.emplace(shareIdx);
-            }
+            auto invalidIndexes = ReceiveInvalidShares(invalidCount);
 
             VerifyContributionShares(memberIdx, invalidIndexes, parallel, aggregated);
 
             memberIdx = (memberIdx + 1) % members.size();
         }
     }
+
+    struct StreamingBatch {
+        std::vector<size_t> indexes;
+        std::vector<BLSVerificationVectorPtr> vvecs;
+        BLSSecretKeyVector skShares;
+        std::future<std::vector<bool> > result;
+    };
+
+    // Same as CDKGSession: contributions arrive one after another and verification starts right away, contributions
+    // which arrive while a batch is running are verified together in the next batch
+    void Bench_VerifyContributionSharesStreaming(benchmark::State& state, int invalidCount, size_t batchSize)
+    {
+        ReceiveVvecs();
+
+        size_t memberIdx = 0;
+        while (state.KeepRunning()) {
+            ReceiveShares(memberIdx);
+            auto invalidIndexes = ReceiveInvalidShares(invalidCount);
+
+            std::list<std::unique_ptr<StreamingBatch> > running;
+            std::vector<size_t> pending;
+            auto startBatch = [&]() {
+                std::unique_ptr<StreamingBatch> batch(new StreamingBatch());
+                for (auto idx : pending) {
+                    batch->indexes.emplace_back(idx);
+                    batch->vvecs.emplace_back(receivedVvecs[idx]);
+                    batch->skShares.emplace_back(receivedSkShares[idx]);
+                }
+                pending.clear();
+                batch->result = blsWorker.AsyncVerifyContributionShares(members[memberIdx].id, batch->vvecs, batch->skShares, true, true);
+                running.emplace_back(std::move(batch));
+            };
+            auto finishBatch = [&](StreamingBatch& batch) {
+                auto result = batch.result.get();
+                for (size_t i = 0; i < batch.indexes.size(); i++) {
+                    assert(result[i] == !invalidIndexes.count(batch.indexes[i]));
+                }
+            };
+
+            for (size_t i = 0; i < receivedVvecs.size(); i++) {
+                pending.emplace_back(i);
+                for (auto it = running.begin(); it != running.end(); ) {
+                    if ((*it)->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                        ++it;
+                        continue;
+                    }
+                    finishBatch(**it);
+                    it = running.erase(it);
+                }
+                if (running.empty() || pending.size() >= batchSize) {
+                    startBatch();
+                }
+            }
+            if (!pending.empty()) {
+                startBatch();
+            }
+            for (auto& batch : running) {
+                finishBatch(*batch);
+            }
+
+            memberIdx = (memberIdx + 1) % members.size();
+        }
+    }
 };
 
-std::shared_ptr<DKG> dkg10;
-std::shared_ptr<DKG> dkg100;
-std::shared_ptr<DKG> dkg400;
+static std::shared_ptr<DKG> dkg10;
+static std::shared_ptr<DKG> dkg100;
+static std::shared_ptr<DKG> dkg400;
 
-void InitIfNeeded()
+static void InitIfNeeded()
 {
     if (dkg10 == nullptr) {
         dkg10 = std::make_shared<DKG>(10);
@@ -137,45 +219,57 @@ void CleanupBLSDkgTests()
 
 
 
-#define BENCH_BuildQuorumVerificationVectors(name, quorumSize, parallel) \
+#define BENCH_BuildQuorumVerificationVectors(name, quorumSize, parallel, iters) \
     static void BLSDKG_BuildQuorumVerificationVectors_##name##_##quorumSize(benchmark::State& state) \
     { \
         InitIfNeeded(); \
         dkg##quorumSize->Bench_BuildQuorumVerificationVectors(state, parallel); \
     } \
-    BENCHMARK(BLSDKG_BuildQuorumVerificationVectors_##name##_##quorumSize)
+    BENCHMARK(BLSDKG_BuildQuorumVerificationVectors_##name##_##quorumSize, iters)
 
-BENCH_BuildQuorumVerificationVectors(simple, 10, false)
-BENCH_BuildQuorumVerificationVectors(simple, 100, false)
-BENCH_BuildQuorumVerificationVectors(simple, 400, false)
-BENCH_BuildQuorumVerificationVectors(parallel, 10, true)
-BENCH_BuildQuorumVerificationVectors(parallel, 100, true)
-BENCH_BuildQuorumVerificationVectors(parallel, 400, true)
+BENCH_BuildQuorumVerificationVectors(simple, 10, false, 20)
+BENCH_BuildQuorumVerificationVectors(simple, 100, false, 5)
+BENCH_BuildQuorumVerificationVectors(simple, 400, false, 1)
+BENCH_BuildQuorumVerificationVectors(parallel, 10, true, 20)
+BENCH_BuildQuorumVerificationVectors(parallel, 100, true, 5)
+BENCH_BuildQuorumVerificationVectors(parallel, 400, true, 1)
 
 ///////////////////////////////
 
 
 
-#define BENCH_VerifyContributionShares(name, quorumSize, invalidCount, parallel, aggregated) \
+#define BENCH_VerifyContributionShares(name, quorumSize, invalidCount, parallel, aggregated, iters) \
     static void BLSDKG_VerifyContributionShares_##name##_##quorumSize(benchmark::State& state) \
     { \
         InitIfNeeded(); \
         dkg##quorumSize->Bench_VerifyContributionShares(state, invalidCount, parallel, aggregated); \
     } \
-    BENCHMARK(BLSDKG_VerifyContributionShares_##name##_##quorumSize)
+    BENCHMARK(BLSDKG_VerifyContributionShares_##name##_##quorumSize, iters)
+
+BENCH_VerifyContributionShares(simple, 10, 5, false, false, 20)
+BENCH_VerifyContributionShares(simple, 100, 5, false, false, 5)
+BENCH_VerifyContributionShares(simple, 400, 5, false, false, 1)
+
+BENCH_VerifyContributionShares(aggregated, 10, 5, false, true, 20)
+BENCH_VerifyContributionShares(aggregated, 100, 5, false, true, 5)
+BENCH_VerifyContributionShares(aggregated, 400, 5, false, true, 1)
+
+BENCH_VerifyContributionShares(parallel, 10, 5, true, false, 20)
+BENCH_VerifyContributionShares(parallel, 100, 5, true, false, 5)
+BENCH_VerifyContributionShares(parallel, 400, 5, true, false, 1)
 
-BENCH_VerifyContributionShares(simple, 10, 5, false, false)
-BENCH_VerifyContributionShares(simple, 100, 5, false, false)
-BENCH_VerifyContributionShares(simple, 400, 5, false, false)
+BENCH_VerifyContributionShares(parallel_aggregated, 10, 5, true, true, 20)
+BENCH_VerifyContributionShares(parallel_aggregated, 100, 5, true, true, 5)
+BENCH_VerifyContributionShares(parallel_aggregated, 400, 5, true, true, 1)
 
-BENCH_VerifyContributionShares(aggregated, 10, 5, false, true)
-BENCH_VerifyContributionShares(aggregated, 100, 5, false, true)
-BENCH_VerifyContributionShares(aggregated, 400, 5, false, true)
+///////////////////////////////
 
-BENCH_VerifyContributionShares(parallel, 10, 5, true, false)
-BENCH_VerifyContributionShares(parallel, 100, 5, true, false)
-BENCH_VerifyContributionShares(parallel, 400, 5, true, false)
+#define BENCH_VerifyContributionSharesStreaming(name, quorumSize, invalidCount, batchSize, iters) \
+    static void BLSDKG_VerifyContributionSharesStreaming_##name##_##quorumSize(benchmark::State& state) \
+    { \
+        InitIfNeeded(); \
+        dkg##quorumSize->Bench_VerifyContributionSharesStreaming(state, invalidCount, batchSize); \
+    } \
+    BENCHMARK(BLSDKG_VerifyContributionSharesStreaming_##name##_##quorumSize, iters)
 
-BENCH_VerifyContributionShares(parallel_aggregated, 10, 5, true, true)
-BENCH_VerifyContributionShares(parallel_aggregated, 100, 5, true, true)
-BENCH_VerifyContributionShares(parallel_aggregated, 400, 5, true, true)
+BENCH_VerifyContributionSharesStreaming(batch8, 400, 5, 8, 1)
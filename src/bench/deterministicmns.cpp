@@ -0,0 +1,146 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <evo/deterministicmns.h>
+#include <random.h>
+
+#include <cassert>
+#include <vector>
+
+static const size_t MASTERNODES = 5000;
+static const int CHAIN_LENGTH = 1500;
+
+static CDeterministicMNList BuildMNList(FastRandomContext& rand)
+{
+    CDeterministicMNList mnList(uint256(), 1, 0);
+    for (size_t i = 0; i < MASTERNODES; i++) {
+        auto dmn = std::make_shared<CDeterministicMN>(i);
+        dmn->proTxHash = rand.rand256();
+        dmn->collateralOutpoint = COutPoint(rand.rand256(), 0);
+        dmn->nOperatorReward = 0;
+        auto dmnState = std::make_shared<CDeterministicMNState>();
+        dmnState->nRegisteredHeight = 1;
+        dmnState->keyIDOwner = CKeyID(uint160(rand.randbytes(20)));
+        dmnState->UpdateConfirmedHash(dmn->proTxHash, rand.rand256());
+        dmn->pdmnState = dmnState;
+        mnList.AddMN(dmn);
+    }
+    return mnList;
+}
+
+// The scores of every masternode, computed for every LLMQ type at each DKG interval
+static void DeterministicMNListCalculateScores(benchmark::State& state)
+{
+    FastRandomContext rand(true);
+    CDeterministicMNList mnList = BuildMNList(rand);
+
+    while (state.KeepRunning()) {
+        auto scores = mnList.CalculateScores(rand.rand256());
+        assert(scores.size() == MASTERNODES);
+    }
+}
+
+// Members of a 50 masternode quorum, as in CLLMQUtils::GetAllQuorumMembers
+static void DeterministicMNListCalculateQuorum50(benchmark::State& state)
+{
+    FastRandomContext rand(true);
+    CDeterministicMNList mnList = BuildMNList(rand);
+
+    while (state.KeepRunning()) {
+        auto members = mnList.CalculateQuorum(50, rand.rand256());
+        assert(members.size() == 50);
+    }
+}
+
+static void DeterministicMNListCalculateQuorum400(benchmark::State& state)
+{
+    FastRandomContext rand(true);
+    CDeterministicMNList mnList = BuildMNList(rand);
+
+    while (state.KeepRunning()) {
+        auto members = mnList.CalculateQuorum(400, rand.rand256());
+        assert(members.size() == 400);
+    }
+}
+
+// A chain where every block pays one masternode and changes the PoSe penalty of a few others,
+// with the diffs and snapshots written to an in-memory evoDB like ProcessBlock does
+struct MNListChain
+{
+    CEvoDB evoDb;
+    std::vector<uint256> vHashes;
+    std::vector<CBlockIndex> vBlocks;
+
+    MNListChain(FastRandomContext& rand, int nSnapshotPeriod) :
+        evoDb(1 << 20, true, true), vHashes(CHAIN_LENGTH), vBlocks(CHAIN_LENGTH)
+    {
+        CDeterministicMNList mnList = BuildMNList(rand);
+        for (int i = 0; i < CHAIN_LENGTH; i++) {
+            int nHeight = i + 1;
+            vHashes[i] = rand.rand256();
+            vBlocks[i].phashBlock = &vHashes[i];
+            vBlocks[i].nHeight = nHeight;
+            vBlocks[i].pprev = i > 0 ? &vBlocks[i - 1] : nullptr;
+
+            CDeterministicMNList newList = mnList;
+            for (int j = 0; j < 4 && i > 0; j++) {
+                auto dmn = newList.GetMNByInternalId(rand.randrange(MASTERNODES));
+                auto newState = std::make_shared<CDeterministicMNState>(*dmn->pdmnState);
+                if (j == 0) {
+                    newState->nLastPaidHeight = nHeight;
+                } else {
+                    newState->nPoSePenalty = rand.randrange(100);
+                }
+                newList.UpdateMN(dmn, newState);
+            }
+            newList.SetBlockHash(vHashes[i]);
+            newList.SetHeight(nHeight);
+
+            evoDb.Write(std::make_pair(DB_LIST_DIFF, vHashes[i]), mnList.BuildDiff(newList));
+            if (i == 0 || (nHeight % nSnapshotPeriod) == 0) {
+                evoDb.Write(std::make_pair(DB_LIST_SNAPSHOT, vHashes[i]), newList);
+            }
+            mnList = newList;
+        }
+    }
+};
+
+static void MNListLookup(benchmark::State& state, int nSnapshotPeriod, size_t nMaxCacheUsage)
+{
+    FastRandomContext rand(true);
+    MNListChain chain(rand, nSnapshotPeriod);
+    CDeterministicMNManager manager(chain.evoDb, nSnapshotPeriod, nMaxCacheUsage);
+
+    while (state.KeepRunning()) {
+        const CBlockIndex* pindex = &chain.vBlocks[rand.randrange(CHAIN_LENGTH)];
+        auto mnList = manager.GetListForBlock(pindex);
+        assert(mnList.GetHeight() == pindex->nHeight);
+    }
+}
+
+// GetListForBlock of random heights, as done by protx diff and quorum verification of old blocks
+static void DeterministicMNManagerRandomLookup(benchmark::State& state)
+{
+    MNListLookup(state, DEFAULT_MNLIST_SNAPSHOT_PERIOD, DEFAULT_MNLIST_CACHE_SIZE << 20);
+}
+
+// Every lookup replays the diffs since the last snapshot
+static void DeterministicMNManagerRandomLookupNoCache(benchmark::State& state)
+{
+    MNListLookup(state, DEFAULT_MNLIST_SNAPSHOT_PERIOD, 0);
+}
+
+static void DeterministicMNManagerRandomLookupNoCacheSnapshot48(benchmark::State& state)
+{
+    MNListLookup(state, 48, 0);
+}
+
+BENCHMARK(DeterministicMNListCalculateScores, 50);
+BENCHMARK(DeterministicMNListCalculateQuorum50, 50);
+BENCHMARK(DeterministicMNListCalculateQuorum400, 50);
+BENCHMARK(DeterministicMNManagerRandomLookup, 200);
+BENCHMARK(DeterministicMNManagerRandomLookupNoCache, 20);
+BENCHMARK(DeterministicMNManagerRandomLookupNoCacheSnapshot48, 200);
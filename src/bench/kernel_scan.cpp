@@ -0,0 +1,82 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <kernelscanner.h>
+#include <pos.h>
+#include <random.h>
+#include <util/system.h>
+
+#include <vector>
+
+// 10k synthetic stake candidates scanned over a 16 second window with a target that
+// can't be met, so every (candidate, timestamp) pair is hashed
+static const size_t KERNEL_SCAN_INPUTS = 10000;
+static const uint32_t KERNEL_SCAN_WINDOW = 16;
+static const unsigned int KERNEL_SCAN_BITS = 0x03000001;
+
+static void BuildKernelScanInputs(std::vector<CKernelScanner::Input>& vInputs, CBlockIndex& index, uint32_t& nTimeEnd)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    FastRandomContext rand(true);
+
+    nTimeEnd = 1600000000;
+    index.nStakeModifier = rand.rand256();
+
+    vInputs.resize(KERNEL_SCAN_INPUTS);
+    for (auto& input : vInputs) {
+        input.first = COutPoint(rand.rand256(), rand.randrange(4));
+        input.second.nTimeTxPrev = nTimeEnd - 30 * 24 * 60 * 60 - rand.randrange(24 * 60 * 60);
+        input.second.nBlockTime = input.second.nTimeTxPrev + 60;
+        input.second.nValue = (1 + rand.randrange(1000)) * COIN;
+    }
+}
+
+static void KernelScan_Legacy(benchmark::State& state)
+{
+    std::vector<CKernelScanner::Input> vInputs;
+    CBlockIndex index;
+    uint32_t nTimeEnd;
+    BuildKernelScanInputs(vInputs, index, nTimeEnd);
+
+    while (state.KeepRunning()) {
+        for (const auto& input : vInputs) {
+            for (uint32_t nTime = nTimeEnd; nTime > nTimeEnd - KERNEL_SCAN_WINDOW; nTime--) {
+                uint256 hashProof;
+                bool found = CheckStakeKernelHash(&index, KERNEL_SCAN_BITS, input.second.nTimeTxPrev, input.second.nValue, input.first, nTime, hashProof, false);
+                assert(!found);
+            }
+        }
+    }
+}
+
+static void KernelScan(benchmark::State& state, int nThreads)
+{
+    std::vector<CKernelScanner::Input> vInputs;
+    CBlockIndex index;
+    uint32_t nTimeEnd;
+    BuildKernelScanInputs(vInputs, index, nTimeEnd);
+
+    CKernelScanner scanner;
+    scanner.Start(nThreads);
+
+    while (state.KeepRunning()) {
+        size_t nIndex;
+        uint32_t nTime;
+        uint256 hashProof;
+        bool found = scanner.Scan(&index, KERNEL_SCAN_BITS, vInputs, nTimeEnd - KERNEL_SCAN_WINDOW + 1, nTimeEnd, nIndex, nTime, hashProof);
+        assert(!found);
+    }
+}
+
+static void KernelScan_1Thread(benchmark::State& state) { KernelScan(state, 0); }
+static void KernelScan_4Threads(benchmark::State& state) { KernelScan(state, 4); }
+static void KernelScan_8Threads(benchmark::State& state) { KernelScan(state, 8); }
+
+BENCHMARK(KernelScan_Legacy, 1);
+BENCHMARK(KernelScan_1Thread, 1);
+BENCHMARK(KernelScan_4Threads, 1);
+BENCHMARK(KernelScan_8Threads, 1);
@@ -0,0 +1,56 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <crypto/sha256.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <uint256.h>
+
+#include <vector>
+
+/* Number of nonces to hash per iteration, hashes/s is NONCES / time per iteration */
+static const uint32_t NONCES = 1024;
+
+static CBlockHeader MiningHeader()
+{
+    FastRandomContext rng(true);
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.hashPrevBlock = rng.rand256();
+    header.hashMerkleRoot = rng.rand256();
+    header.nTime = 1600000000;
+    header.nHeight = 100000;
+    header.nBits = 0x1d00ffff;
+    header.nNonce = 0;
+    return header;
+}
+
+static void MiningHash_GetHash(benchmark::State& state)
+{
+    CBlockHeader header = MiningHeader();
+    uint256 hash;
+    while (state.KeepRunning()) {
+        for (uint32_t i = 0; i < NONCES; i++) {
+            header.nNonce++;
+            hash = header.GetHash();
+        }
+    }
+}
+
+static void MiningHash_Midstate(benchmark::State& state)
+{
+    CBlockHeader header = MiningHeader();
+    CSHA256DNonce hasher = header.GetNonceHasher();
+    std::vector<unsigned char> hashes(16 * CSHA256DNonce::OUTPUT_SIZE);
+    while (state.KeepRunning()) {
+        for (uint32_t i = 0; i < NONCES; i += 16) {
+            hasher.Hash(hashes.data(), header.nNonce + 1, 16);
+            header.nNonce += 16;
+        }
+    }
+}
+
+BENCHMARK(MiningHash_GetHash, 500);
+BENCHMARK(MiningHash_Midstate, 1500);
@@ -0,0 +1,114 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <clientversion.h>
+#include <coins.h>
+#include <fs.h>
+#include <pos.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <streams.h>
+
+#include <vector>
+
+// Kernel input lookup and kernel hash of the proof-of-stake check as done for every
+// block during IBD: reading txPrev back from a block file (the txindex path) vs
+// reading the coin from the UTXO set (coins view path).
+// The block file is in the OS page cache here, so the difference on a cold disk is larger.
+static const size_t POS_CHECK_KERNELS = 2000;
+static const unsigned int POS_CHECK_BITS = 0x03000001;
+
+struct PosCheckData {
+    CBlockIndex index;
+    CCoinsView coinsDummy;
+    CCoinsViewCache coins{&coinsDummy};
+    std::vector<COutPoint> vPrevouts;
+    std::vector<std::pair<long, unsigned int>> vTxPos; // block position, tx offset after the header
+    uint32_t nTimeTx{1600000000};
+    fs::path path;
+
+    PosCheckData()
+    {
+        SelectParams(CBaseChainParams::MAIN);
+        FastRandomContext rand(true);
+        index.nStakeModifier = rand.rand256();
+        path = fs::temp_directory_path() / fs::unique_path("pos_check_%%%%%%%%.dat");
+
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        for (size_t i = 0; i < POS_CHECK_KERNELS; i++) {
+            CMutableTransaction txPrev;
+            txPrev.nTime = nTimeTx - 30 * 24 * 60 * 60 - rand.randrange(24 * 60 * 60);
+            txPrev.vin.resize(1);
+            txPrev.vin[0].prevout = COutPoint(rand.rand256(), 0);
+            txPrev.vout.resize(2);
+            for (auto& out : txPrev.vout) {
+                out.nValue = (1 + rand.randrange(1000)) * COIN;
+                out.scriptPubKey = CScript() << OP_DUP << OP_HASH160 << ToByteVector(rand.randbytes(20)) << OP_EQUALVERIFY << OP_CHECKSIG;
+            }
+            CTransaction tx(txPrev);
+            AddCoins(coins, tx, 1 + i);
+
+            CBlockHeader header;
+            header.nTime = tx.nTime;
+            long nPos = ftell(file.Get());
+            file << header;
+            vTxPos.emplace_back(nPos, 0);
+            file << MakeTransactionRef(tx);
+            vPrevouts.emplace_back(tx.GetHash(), rand.randrange(2));
+        }
+    }
+
+    ~PosCheckData()
+    {
+        fs::remove(path);
+    }
+};
+
+static void PosCheckKernel_BlockFile(benchmark::State& state)
+{
+    PosCheckData data;
+
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < data.vPrevouts.size(); i++) {
+            const COutPoint& prevout = data.vPrevouts[i];
+            CBlockHeader header;
+            CTransactionRef txPrev;
+            {
+                // Same access pattern as OpenBlockFile() + deserialize in the txindex path
+                FILE* f = fsbridge::fopen(data.path, "rb");
+                fseek(f, data.vTxPos[i].first, SEEK_SET);
+                CAutoFile file(f, SER_DISK, CLIENT_VERSION);
+                file >> header;
+                fseek(file.Get(), data.vTxPos[i].second, SEEK_CUR);
+                file >> txPrev;
+            }
+            assert(txPrev->GetHash() == prevout.hash);
+            uint256 hashProof;
+            bool found = CheckStakeKernelHash(&data.index, POS_CHECK_BITS, txPrev, prevout, data.nTimeTx, hashProof, false);
+            assert(!found);
+        }
+    }
+}
+
+static void PosCheckKernel_CoinsView(benchmark::State& state)
+{
+    PosCheckData data;
+
+    while (state.KeepRunning()) {
+        for (const COutPoint& prevout : data.vPrevouts) {
+            Coin coin;
+            bool have = data.coins.GetCoin(prevout, coin);
+            assert(have);
+            uint256 hashProof;
+            bool found = CheckStakeKernelHash(&data.index, POS_CHECK_BITS, coin.nTime, coin.out.nValue.GetAmount(), prevout, data.nTimeTx, hashProof, false);
+            assert(!found);
+        }
+    }
+}
+
+BENCHMARK(PosCheckKernel_BlockFile, 10);
+BENCHMARK(PosCheckKernel_CoinsView, 10);
@@ -0,0 +1,157 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <checkqueue.h>
+#include <coins.h>
+#include <kernelscanner.h>
+#include <key.h>
+#include <pos.h>
+#include <random.h>
+#include <script/sign.h>
+#include <script/signingprovider.h>
+#include <script/standard.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <boost/thread/thread.hpp>
+
+#include <vector>
+
+// Proof-of-stake part of connecting a chain of PoS blocks with one coinstake each.
+// The time per run is for POS_CONNECT_BLOCKS blocks, so blocks/sec = POS_CONNECT_BLOCKS / time.
+//
+// Serial: CheckProofOfStake() verifies the kernel and the coinstake signature inline, and the
+// coinstake input script is verified again by the script checks of ConnectBlock().
+// CheckQueue: only the kernel hash is checked inline, the coinstake input script is verified once
+// on the script check workers.
+static const size_t POS_CONNECT_BLOCKS = 500;
+static const unsigned int POS_CONNECT_BITS = 0x1f00ffff;
+
+struct PosConnectData {
+    CBlockIndex index;
+    CCoinsView coinsDummy;
+    CCoinsViewCache coins{&coinsDummy};
+    std::vector<CTransactionRef> vCoinStakes;
+
+    PosConnectData()
+    {
+        SelectParams(CBaseChainParams::MAIN);
+        FastRandomContext rand(true);
+        index.nStakeModifier = rand.rand256();
+
+        CKey key;
+        key.MakeNewKey(true);
+        FillableSigningProvider keystore;
+        keystore.AddKey(key);
+        CScript scriptPubKey = GetScriptForDestination(PKHash(key.GetPubKey()));
+
+        CKernelScanner scanner;
+        const uint32_t nTimeEnd = 1600000000;
+        while (vCoinStakes.size() < POS_CONNECT_BLOCKS) {
+            CMutableTransaction txPrev;
+            txPrev.nTime = nTimeEnd - 30 * 24 * 60 * 60 - rand.randrange(24 * 60 * 60);
+            txPrev.vin.resize(1);
+            txPrev.vin[0].prevout = COutPoint(rand.rand256(), 0);
+            txPrev.vout.resize(1);
+            txPrev.vout[0].nValue = (1000 + rand.randrange(1000)) * COIN;
+            txPrev.vout[0].scriptPubKey = scriptPubKey;
+            CTransaction tx(txPrev);
+
+            // Find a valid kernel the same way the stake miner does
+            CStakeCandidate candidate;
+            candidate.nTimeTxPrev = tx.nTime;
+            candidate.nBlockTime = tx.nTime;
+            candidate.nValue = tx.vout[0].nValue.GetAmount();
+            size_t nIndex;
+            uint32_t nTimeTx;
+            uint256 hashProof;
+            if (!scanner.Scan(&index, POS_CONNECT_BITS, {{COutPoint(tx.GetHash(), 0), candidate}}, nTimeEnd - 600, nTimeEnd, nIndex, nTimeTx, hashProof))
+                continue;
+
+            AddCoins(coins, tx, 1);
+
+            CMutableTransaction txStake;
+            txStake.nTime = nTimeTx;
+            txStake.vin.emplace_back(COutPoint(tx.GetHash(), 0));
+            txStake.vout.resize(2);
+            txStake.vout[0].SetEmpty();
+            txStake.vout[1].nValue = tx.vout[0].nValue;
+            txStake.vout[1].scriptPubKey = scriptPubKey;
+            bool signed_ok = SignSignature(keystore, tx, txStake, 0, SIGHASH_ALL);
+            assert(signed_ok);
+            vCoinStakes.push_back(MakeTransactionRef(std::move(txStake)));
+        }
+    }
+};
+
+static void PosConnect_Serial(benchmark::State& state)
+{
+    ECC_Start();
+    {
+        PosConnectData data;
+        unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_DERSIG;
+
+        while (state.KeepRunning()) {
+            for (const auto& tx : data.vCoinStakes) {
+                uint256 hashProof;
+                bool valid = CheckProofOfStake(&data.index, tx, POS_CONNECT_BITS, hashProof, data.coins);
+                assert(valid);
+
+                PrecomputedTransactionData txdata(*tx);
+                CScriptCheck check(data.coins.AccessCoin(tx->vin[0].prevout).out, *tx, 0, flags, false, &txdata);
+                valid = check();
+                assert(valid);
+            }
+        }
+    }
+    ECC_Stop();
+}
+
+static void PosConnect_CheckQueue(benchmark::State& state)
+{
+    ECC_Start();
+    {
+        PosConnectData data;
+        unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_DERSIG;
+
+        CCheckQueue<CScriptCheck> queue(128);
+        boost::thread_group tg;
+        for (int i = 0; i < 3; i++) {
+            tg.create_thread([&]{ queue.Thread(); });
+        }
+
+        std::vector<PrecomputedTransactionData> txdata;
+        txdata.reserve(data.vCoinStakes.size());
+        for (const auto& tx : data.vCoinStakes) {
+            txdata.emplace_back(*tx);
+        }
+
+        while (state.KeepRunning()) {
+            for (size_t i = 0; i < data.vCoinStakes.size(); i++) {
+                // One control per block, as in ConnectBlock()
+                CCheckQueueControl<CScriptCheck> control(&queue);
+                const CTransactionRef& tx = data.vCoinStakes[i];
+                uint256 hashProof;
+                bool valid = CheckProofOfStake(&data.index, tx, POS_CONNECT_BITS, hashProof, data.coins, false);
+                assert(valid);
+
+                std::vector<CScriptCheck> vChecks;
+                vChecks.emplace_back(data.coins.AccessCoin(tx->vin[0].prevout).out, *tx, 0, flags, false, &txdata[i]);
+                control.Add(vChecks);
+                valid = control.Wait();
+                assert(valid);
+            }
+        }
+
+        tg.interrupt_all();
+        tg.join_all();
+    }
+    ECC_Stop();
+}
+
+BENCHMARK(PosConnect_Serial, 1);
+BENCHMARK(PosConnect_CheckQueue, 1);
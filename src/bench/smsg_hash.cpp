@@ -0,0 +1,63 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <random.h>
+#include <smessage/smessage.h>
+
+#include <ctpl.h>
+
+#include <future>
+#include <vector>
+
+// SecureMsgSetHash over SMSG_SEND_BATCH payloads of the largest size, so hashes/sec =
+// SMSG_SEND_BATCH / time. This is only the hash every scan of a queued message starts with,
+// not the send queue itself, which needs the smsg db and a wallet for the trial decryption.
+// The pool variant dispatches the hashes the way the send queue dispatches its scans.
+struct SmsgHashData {
+    std::vector<SecureMessage> vMessages;
+
+    SmsgHashData()
+    {
+        FastRandomContext rand(true);
+        vMessages.resize(SMSG_SEND_BATCH);
+        for (auto& smsg : vMessages) {
+            smsg.nVersion = SMSG_VERSION_TAGGED;
+            smsg.timestamp = 1600000000;
+            smsg.vchPayload = rand.randbytes(SMSG_MAX_MSG_WORST);
+            smsg.nPayload = smsg.vchPayload.size();
+        }
+    }
+};
+
+static void SmsgPayloadHash_Serial(benchmark::State& state)
+{
+    SmsgHashData data;
+
+    while (state.KeepRunning()) {
+        for (auto& smsg : data.vMessages) {
+            SecureMsgSetHash(smsg, smsg.vchPayload.data());
+        }
+    }
+}
+
+static void SmsgPayloadHash_Pool(benchmark::State& state)
+{
+    SmsgHashData data;
+    ctpl::thread_pool pool(4);
+
+    while (state.KeepRunning()) {
+        std::vector<std::future<void>> vFutures;
+        for (auto& smsg : data.vMessages) {
+            SecureMessage* pMsg = &smsg;
+            vFutures.emplace_back(pool.push([pMsg](int) { SecureMsgSetHash(*pMsg, pMsg->vchPayload.data()); }));
+        }
+        for (auto& f : vFutures) {
+            f.wait();
+        }
+    }
+}
+
+BENCHMARK(SmsgPayloadHash_Serial, 50);
+BENCHMARK(SmsgPayloadHash_Pool, 50);
@@ -0,0 +1,96 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <compat.h>
+
+#ifdef USE_EPOLL
+
+#include <cassert>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Idle connections, nothing to read or write. This is the per loop cost of waiting for
+// socket events, CConnman waits SELECT_TIMEOUT_MILLISECONDS on top of it.
+static const int CONNECTIONS = 500;
+
+static std::vector<int> OpenConnections()
+{
+    std::vector<int> fds;
+    for (int i = 0; i < CONNECTIONS; i++) {
+        int pair[2];
+        assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+        fds.push_back(pair[0]);
+        fds.push_back(pair[1]);
+    }
+    return fds;
+}
+
+static void CloseConnections(const std::vector<int>& fds)
+{
+    for (int fd : fds) {
+        close(fd);
+    }
+}
+
+// What SocketEventsPoll does every loop: rebuild the interest set and poll all of it
+static void SocketEventsPollIdle(benchmark::State& state)
+{
+    std::vector<int> fds = OpenConnections();
+
+    while (state.KeepRunning()) {
+        std::set<int> recv_select_set(fds.begin(), fds.end());
+        std::unordered_map<int, struct pollfd> pollfds;
+        for (int fd : recv_select_set) {
+            pollfds[fd].fd = fd;
+            pollfds[fd].events |= POLLIN;
+        }
+        std::vector<struct pollfd> vpollfds;
+        vpollfds.reserve(pollfds.size());
+        for (auto it : pollfds) {
+            vpollfds.push_back(std::move(it.second));
+        }
+        int nEvents = poll(vpollfds.data(), vpollfds.size(), 0);
+        assert(nEvents == 0);
+    }
+
+    CloseConnections(fds);
+}
+
+// What SocketEventsEpoll does every loop: the sockets were registered once
+static void SocketEventsEpollIdle(benchmark::State& state)
+{
+    std::vector<int> fds = OpenConnections();
+    int epollfd = epoll_create1(EPOLL_CLOEXEC);
+    assert(epollfd != -1);
+    for (int fd : fds) {
+        struct epoll_event e;
+        e.events = EPOLLIN | EPOLLOUT | EPOLLET;
+        e.data.fd = fd;
+        assert(epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &e) == 0);
+    }
+
+    // Every socket is writable once after registering
+    struct epoll_event events[64];
+    while (epoll_wait(epollfd, events, 64, 0) > 0) {}
+
+    while (state.KeepRunning()) {
+        int nEvents = epoll_wait(epollfd, events, 64, 0);
+        assert(nEvents == 0);
+    }
+
+    close(epollfd);
+    CloseConnections(fds);
+}
+
+BENCHMARK(SocketEventsPollIdle, 500);
+BENCHMARK(SocketEventsEpollIdle, 500);
+
+#endif // USE_EPOLL
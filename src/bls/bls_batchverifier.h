@@ -6,8 +6,12 @@
 #define RAIN_CRYPTO_BLS_BATCHVERIFIER_H
 
 #include <bls/bls.h>
+#include <bls/bls_worker.h>
 
+#include <algorithm>
+#include <future>
 #include <map>
+#include <set>
 #include <vector>
 
 template<typename SourceId, typename MessageId>
@@ -25,9 +29,13 @@ private:
     typedef typename MessageMap::iterator MessageMapIterator;
     typedef std::map<SourceId, std::vector<MessageMapIterator>> MessagesBySourceMap;
 
+    // Batches smaller than two of these are verified on the calling thread
+    static const size_t MIN_PARALLEL_CHUNK_SIZE = 64;
+
     bool secureVerification;
     bool perMessageFallback;
     size_t subBatchSize;
+    CBLSWorker* worker;
 
     MessageMap messages;
     MessagesBySourceMap messagesBySource;
@@ -37,10 +45,12 @@ public:
     std::set<MessageId> badMessages;
 
 public:
-    CBLSBatchVerifier(bool _secureVerification, bool _perMessageFallback, size_t _subBatchSize = 0) :
+    // If a worker is passed, large batches are split into chunks which are verified in parallel on its thread pool
+    CBLSBatchVerifier(bool _secureVerification, bool _perMessageFallback, size_t _subBatchSize = 0, CBLSWorker* _worker = nullptr) :
             secureVerification(_secureVerification),
             perMessageFallback(_perMessageFallback),
-            subBatchSize(_subBatchSize)
+            subBatchSize(_subBatchSize),
+            worker(_worker)
     {
     }
 
@@ -70,60 +80,129 @@ public:
 
     void Verify()
     {
-        std::map<uint256, std::vector<MessageMapIterator>> byMessageHash;
-
-        for (auto it = messages.begin(); it != messages.end(); ++it) {
-            byMessageHash[it->second.msgHash].emplace_back(it);
+        size_t chunkCount = 1;
+        if (worker && worker->GetWorkerCount() > 0) {
+            chunkCount = std::min<size_t>(worker->GetWorkerCount(), messages.size() / MIN_PARALLEL_CHUNK_SIZE);
         }
 
-        if (VerifyBatch(byMessageHash)) {
-            // full batch is valid
+        if (chunkCount <= 1) {
+            VerifyChunk(messagesBySource, badSources, badMessages);
             return;
         }
 
-        // revert to per-source verification
+        // Split the batch into chunks of about the same number of messages. A source might end up in multiple chunks,
+        // as most of the messages often come from a single peer
+        size_t chunkSize = (messages.size() + chunkCount - 1) / chunkCount;
+        std::vector<MessagesBySourceMap> chunks(1);
+        size_t curSize = 0;
         for (const auto& p : messagesBySource) {
-            bool batchValid = false;
-
-            // no need to verify it again if there was just one source
-            if (messagesBySource.size() != 1) {
-                byMessageHash.clear();
-                for (auto it = p.second.begin(); it != p.second.end(); ++it) {
-                    byMessageHash[(*it)->second.msgHash].emplace_back(*it);
-                }
-                batchValid = VerifyBatch(byMessageHash);
-            }
-            if (!batchValid) {
-                badSources.emplace(p.first);
-
-                if (perMessageFallback) {
-                    // revert to per-message verification
-                    if (p.second.size() == 1) {
-                        // no need to re-verify a single message
-                        badMessages.emplace(p.second[0]->second.msgId);
-                    } else {
-                        for (const auto& msgIt : p.second) {
-                            if (badMessages.count(msgIt->first)) {
-                                // same message might be invalid from different source, so no need to re-verify it
-                                continue;
-                            }
-
-                            const auto& msg = msgIt->second;
-                            if (!msg.sig.VerifyInsecure(msg.pubKey, msg.msgHash)) {
-                                badMessages.emplace(msg.msgId);
-                            }
-                        }
-                    }
+            for (const auto& msgIt : p.second) {
+                if (curSize == chunkSize) {
+                    chunks.emplace_back();
+                    curSize = 0;
                 }
+                chunks.back()[p.first].emplace_back(msgIt);
+                curSize++;
             }
         }
+
+        std::vector<std::set<SourceId>> chunkBadSources(chunks.size());
+        std::vector<std::set<MessageId>> chunkBadMessages(chunks.size());
+        std::vector<std::future<void>> futures;
+        futures.reserve(chunks.size());
+        for (size_t i = 0; i < chunks.size(); i++) {
+            futures.emplace_back(worker->AsyncRunJob([this, &chunks, &chunkBadSources, &chunkBadMessages, i]() {
+                VerifyChunk(chunks[i], chunkBadSources[i], chunkBadMessages[i]);
+            }));
+        }
+        for (size_t i = 0; i < chunks.size(); i++) {
+            futures[i].get();
+            badSources.insert(chunkBadSources[i].begin(), chunkBadSources[i].end());
+            badMessages.insert(chunkBadMessages[i].begin(), chunkBadMessages[i].end());
+        }
     }
 
 private:
-    // All Verify methods take ownership of the passed byMessageHash map and thus might modify the map. This is to avoid
-    // unnecessary copies
+    typedef typename MessagesBySourceMap::const_iterator SourceIterator;
+
+    // Verify the chunk with a single aggregated verification and only if that fails find the bad sources
+    void VerifyChunk(const MessagesBySourceMap& chunk, std::set<SourceId>& retBadSources, std::set<MessageId>& retBadMessages) const
+    {
+        std::vector<SourceIterator> sources;
+        sources.reserve(chunk.size());
+        for (auto it = chunk.begin(); it != chunk.end(); ++it) {
+            sources.emplace_back(it);
+        }
+
+        if (VerifySources(sources)) {
+            // full chunk is valid
+            return;
+        }
+        BisectSources(sources, retBadSources, retBadMessages);
+    }
+
+    bool VerifySources(const std::vector<SourceIterator>& sources) const
+    {
+        std::map<uint256, std::vector<MessageMapIterator>> byMessageHash;
+        for (const auto& sourceIt : sources) {
+            for (const auto& msgIt : sourceIt->second) {
+                byMessageHash[msgIt->second.msgHash].emplace_back(msgIt);
+            }
+        }
+        return VerifyBatch(byMessageHash);
+    }
+
+    // The sources are known to include at least one bad message. Split them in halves and only verify the halves
+    // again, so that a few bad sources in a large batch only cost a few extra verifications each
+    void BisectSources(const std::vector<SourceIterator>& sources, std::set<SourceId>& retBadSources, std::set<MessageId>& retBadMessages) const
+    {
+        if (sources.size() == 1) {
+            MarkSourceBad(sources[0], retBadSources, retBadMessages);
+            return;
+        }
+
+        std::vector<SourceIterator> left(sources.begin(), sources.begin() + sources.size() / 2);
+        std::vector<SourceIterator> right(sources.begin() + sources.size() / 2, sources.end());
+
+        bool leftValid = VerifySources(left);
+        if (!leftValid) {
+            BisectSources(left, retBadSources, retBadMessages);
+        }
+        // if the left half is valid, the bad message must be in the right half
+        if (leftValid || !VerifySources(right)) {
+            BisectSources(right, retBadSources, retBadMessages);
+        }
+    }
+
+    void MarkSourceBad(const SourceIterator& sourceIt, std::set<SourceId>& retBadSources, std::set<MessageId>& retBadMessages) const
+    {
+        retBadSources.emplace(sourceIt->first);
+
+        if (!perMessageFallback) {
+            return;
+        }
+
+        // revert to per-message verification
+        const auto& sourceMessages = sourceIt->second;
+        if (sourceMessages.size() == 1) {
+            // no need to re-verify a single message
+            retBadMessages.emplace(sourceMessages[0]->second.msgId);
+            return;
+        }
+        for (const auto& msgIt : sourceMessages) {
+            if (retBadMessages.count(msgIt->first)) {
+                // same message might be invalid from different source, so no need to re-verify it
+                continue;
+            }
+
+            const auto& msg = msgIt->second;
+            if (!msg.sig.VerifyInsecure(msg.pubKey, msg.msgHash)) {
+                retBadMessages.emplace(msg.msgId);
+            }
+        }
+    }
 
-    bool VerifyBatch(std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash)
+    bool VerifyBatch(std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash) const
     {
         if (secureVerification) {
             return VerifyBatchSecure(byMessageHash);
@@ -132,15 +211,15 @@ private:
         }
     }
 
-    bool VerifyBatchInsecure(const std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash)
+    bool VerifyBatchInsecure(const std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash) const
     {
         CBLSSignature aggSig;
         std::vector<uint256> msgHashes;
         std::vector<CBLSPublicKey> pubKeys;
         std::set<MessageId> dups;
 
-        msgHashes.reserve(messages.size());
-        pubKeys.reserve(messages.size());
+        msgHashes.reserve(byMessageHash.size());
+        pubKeys.reserve(byMessageHash.size());
 
         for (const auto& p : byMessageHash) {
             const auto& msgHash = p.first;
@@ -183,7 +262,7 @@ private:
         return aggSig.VerifyInsecureAggregated(pubKeys, msgHashes);
     }
 
-    bool VerifyBatchSecure(std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash)
+    bool VerifyBatchSecure(std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash) const
     {
         // Loop until the byMessageHash map is empty, which means that all messages were verified
         // The secure form of verification will only aggregate one message for the same message hash, even if multiple
@@ -197,15 +276,15 @@ private:
         return true;
     }
 
-    bool VerifyBatchSecureStep(std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash)
+    bool VerifyBatchSecureStep(std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash) const
     {
         CBLSSignature aggSig;
         std::vector<uint256> msgHashes;
         std::vector<CBLSPublicKey> pubKeys;
         std::set<MessageId> dups;
 
-        msgHashes.reserve(messages.size());
-        pubKeys.reserve(messages.size());
+        msgHashes.reserve(byMessageHash.size());
+        pubKeys.reserve(byMessageHash.size());
 
         for (auto it = byMessageHash.begin(); it != byMessageHash.end(); ) {
             const auto& msgHash = it->first;
@@ -139,6 +139,10 @@ public:
     std::future<bool> AsyncVerifySig(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& msgHash, CancelCond cancelCond = [] { return false; });
     bool IsAsyncVerifyInProgress();
 
+    // Run a job on the worker pool, used by CBLSBatchVerifier to verify chunks of a large batch in parallel
+    std::future<void> AsyncRunJob(std::function<void()> job);
+    int GetWorkerCount() { return workerPool.size(); }
+
 private:
     void PushSigVerifyBatch();
 };
@@ -105,6 +105,7 @@ typedef char* sockopt_arg_type;
 #ifndef OS_ANDROID
 #if defined(__linux__)
 #define USE_POLL
+#define USE_EPOLL
 #endif
 #endif
 
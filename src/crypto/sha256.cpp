@@ -24,11 +24,21 @@ namespace sha256d64_sse41
 void Transform_4way(unsigned char* out, const unsigned char* in);
 }
 
+namespace sha256_sse41
+{
+void Transform_4way(uint32_t* s, const unsigned char* in);
+}
+
 namespace sha256d64_avx2
 {
 void Transform_8way(unsigned char* out, const unsigned char* in);
 }
 
+namespace sha256_avx2
+{
+void Transform_8way(uint32_t* s, const unsigned char* in);
+}
+
 namespace sha256d64_shani
 {
 void Transform_2way(unsigned char* out, const unsigned char* in);
@@ -416,6 +426,7 @@ void TransformD64(unsigned char* out, const unsigned char* in)
 
 typedef void (*TransformType)(uint32_t*, const unsigned char*, size_t);
 typedef void (*TransformD64Type)(unsigned char*, const unsigned char*);
+typedef void (*TransformMultiType)(uint32_t*, const unsigned char*);
 
 template<TransformType tr>
 void TransformD64Wrapper(unsigned char* out, const unsigned char* in)
@@ -461,6 +472,8 @@ TransformD64Type TransformD64 = sha256::TransformD64;
 TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
+TransformMultiType Transform_4way = nullptr;
+TransformMultiType Transform_8way = nullptr;
 
 bool SelfTest() {
     // Input state (equal to the initial SHA256 state)
@@ -544,6 +557,17 @@ bool SelfTest() {
         if (!std::equal(out, out + 256, result_d64)) return false;
     }
 
+    // Test Transform_4way and Transform_8way, if available. Lane i continues from the
+    // state after i blocks and should end up at the state after i + 1 blocks.
+    for (size_t ways : {4, 8}) {
+        TransformMultiType tr = ways == 4 ? Transform_4way : Transform_8way;
+        if (!tr) continue;
+        uint32_t state[64];
+        std::copy(&result[0][0], &result[ways][0], state);
+        tr(state, data + 1);
+        if (!std::equal(state, state + 8 * ways, &result[1][0])) return false;
+    }
+
     return true;
 }
 
@@ -611,6 +635,7 @@ std::string SHA256AutoDetect()
 #endif
 #if defined(ENABLE_SSE41) && !defined(BUILD_RAIN_INTERNAL)
         TransformD64_4way = sha256d64_sse41::Transform_4way;
+        Transform_4way = sha256_sse41::Transform_4way;
         ret += ",sse41(4way)";
 #endif
     }
@@ -618,6 +643,7 @@ std::string SHA256AutoDetect()
 #if defined(ENABLE_AVX2) && !defined(BUILD_RAIN_INTERNAL)
     if (have_avx2 && have_avx && enabled_avx) {
         TransformD64_8way = sha256d64_avx2::Transform_8way;
+        Transform_8way = sha256_avx2::Transform_8way;
         ret += ",avx2(8way)";
     }
 #endif
@@ -728,3 +754,138 @@ void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
         --blocks;
     }
 }
+
+void SHA256_64(unsigned char* out, const unsigned char* in, size_t blocks)
+{
+    // Padding of a 64-byte message, the second block of every hash
+    static const unsigned char padding[64] = {
+        0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0
+    };
+    uint32_t s[8 * 8];
+    unsigned char paddings[8 * 64];
+    for (size_t i = 0; i < 8; ++i) {
+        memcpy(paddings + 64 * i, padding, 64);
+    }
+
+    while (blocks) {
+        size_t ways = 1;
+        if (Transform_8way && blocks >= 8) {
+            ways = 8;
+        } else if (Transform_4way && blocks >= 4) {
+            ways = 4;
+        }
+
+        for (size_t i = 0; i < ways; ++i) {
+            sha256::Initialize(s + 8 * i);
+        }
+        if (ways == 8) {
+            Transform_8way(s, in);
+            Transform_8way(s, paddings);
+        } else if (ways == 4) {
+            Transform_4way(s, in);
+            Transform_4way(s, paddings);
+        } else {
+            Transform(s, in, 1);
+            Transform(s, padding, 1);
+        }
+
+        for (size_t i = 0; i < ways; ++i) {
+            for (size_t k = 0; k < 8; ++k) {
+                WriteBE32(out + 32 * i + 4 * k, s[8 * i + k]);
+            }
+        }
+        out += 32 * ways;
+        in += 64 * ways;
+        blocks -= ways;
+    }
+}
+
+CSHA256DNonce::CSHA256DNonce(const unsigned char* data, size_t len, size_t pos)
+{
+    assert(pos + 4 <= len);
+    size_t prefix = pos - pos % 64;
+    sha256::Initialize(midstate);
+    Transform(midstate, data, prefix / 64);
+
+    // The padding only depends on the length, it is the same for every nonce
+    unsigned char sizedesc[8];
+    WriteBE64(sizedesc, (uint64_t)len << 3);
+    tail.assign(data + prefix, data + len);
+    tail.push_back(0x80);
+    tail.resize(tail.size() + (64 - (tail.size() + 8) % 64) % 64, 0);
+    tail.insert(tail.end(), sizedesc, sizedesc + 8);
+    nonce_pos = pos - prefix;
+}
+
+void CSHA256DNonce::HashWays(unsigned char* out, uint32_t nonce, size_t ways) const
+{
+    uint32_t s[8 * 8];
+    unsigned char blocks[8 * 64];
+
+    auto transform = [&]() {
+        if (ways == 8) {
+            Transform_8way(s, blocks);
+        } else if (ways == 4) {
+            Transform_4way(s, blocks);
+        } else {
+            for (size_t i = 0; i < ways; ++i) {
+                Transform(s + 8 * i, blocks + 64 * i, 1);
+            }
+        }
+    };
+
+    // First hash, continuing from the midstate
+    for (size_t i = 0; i < ways; ++i) {
+        std::copy(midstate, midstate + 8, s + 8 * i);
+    }
+    for (size_t b = 0; b < tail.size(); b += 64) {
+        for (size_t i = 0; i < ways; ++i) {
+            unsigned char* block = blocks + 64 * i;
+            memcpy(block, tail.data() + b, 64);
+            for (size_t k = 0; k < 4; ++k) {
+                if (nonce_pos + k >= b && nonce_pos + k < b + 64) {
+                    block[nonce_pos + k - b] = (nonce + i) >> (8 * k);
+                }
+            }
+        }
+        transform();
+    }
+
+    // Second hash, over the 32-byte digest
+    for (size_t i = 0; i < ways; ++i) {
+        unsigned char* block = blocks + 64 * i;
+        for (size_t k = 0; k < 8; ++k) {
+            WriteBE32(block + 4 * k, s[8 * i + k]);
+        }
+        memset(block + 32, 0, 32);
+        block[32] = 0x80;
+        block[62] = 1;
+        sha256::Initialize(s + 8 * i);
+    }
+    transform();
+
+    for (size_t i = 0; i < ways; ++i) {
+        for (size_t k = 0; k < 8; ++k) {
+            WriteBE32(out + 32 * i + 4 * k, s[8 * i + k]);
+        }
+    }
+}
+
+void CSHA256DNonce::Hash(unsigned char* out, uint32_t nonce, size_t count) const
+{
+    while (count) {
+        size_t ways = 1;
+        if (Transform_8way && count >= 8) {
+            ways = 8;
+        } else if (Transform_4way && count >= 4) {
+            ways = 4;
+        }
+        HashWays(out, nonce, ways);
+        out += 32 * ways;
+        nonce += ways;
+        count -= ways;
+    }
+}
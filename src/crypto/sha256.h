@@ -8,6 +8,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string>
+#include <vector>
 
 /** A hasher class for SHA-256. */
 class CSHA256
@@ -41,4 +42,38 @@ std::string SHA256AutoDetect();
  */
 void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
 
+/** Compute multiple single-SHA256's of 64-byte blobs, 4 or 8 at a time when the
+ *  multi-way transforms are available.
+ *  output:  pointer to a blocks*32 byte output buffer
+ *  input:   pointer to a blocks*64 byte input buffer
+ *  blocks:  the number of hashes to compute.
+ */
+void SHA256_64(unsigned char* output, const unsigned char* input, size_t blocks);
+
+/** Double-SHA256 of a message for a range of values of a 4-byte little endian nonce in it.
+ *  The blocks before the one with the nonce are hashed once, when the hasher is created.
+ *  Every call only hashes the rest, for several nonces at a time when the multi-way
+ *  transforms are available.
+ */
+class CSHA256DNonce
+{
+private:
+    uint32_t midstate[8];
+    std::vector<unsigned char> tail; // message from the block with the nonce on, padded
+    size_t nonce_pos;                // offset of the nonce in tail
+
+    void HashWays(unsigned char* out, uint32_t nonce, size_t ways) const;
+
+public:
+    static const size_t OUTPUT_SIZE = CSHA256::OUTPUT_SIZE;
+
+    /** data: the message, len bytes. pos: offset of the nonce in it. */
+    CSHA256DNonce(const unsigned char* data, size_t len, size_t pos);
+
+    /** Hash the message with nonces nonce through nonce + count - 1.
+     *  output: pointer to a count*32 byte output buffer
+     */
+    void Hash(unsigned char* output, uint32_t nonce, size_t count) const;
+};
+
 #endif // RAIN_CRYPTO_SHA256_H
@@ -313,4 +313,81 @@ void Transform_4way(unsigned char* out, const unsigned char* in)
 
 }
 
+namespace sha256_sse41 {
+namespace {
+
+const uint32_t K256[64] = {
+    0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+    0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+    0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+    0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+    0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+    0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+    0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+    0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul
+};
+
+__m128i inline LoadState(const uint32_t* s, int i) {
+    return _mm_set_epi32(s[0 + i], s[8 + i], s[16 + i], s[24 + i]);
+}
+
+void inline SaveState(uint32_t* s, int i, __m128i v) {
+    s[0 + i] = _mm_extract_epi32(v, 3);
+    s[8 + i] = _mm_extract_epi32(v, 2);
+    s[16 + i] = _mm_extract_epi32(v, 1);
+    s[24 + i] = _mm_extract_epi32(v, 0);
+}
+
+}
+
+/** SHA-256 transform of 4 independent states, each over its own 64-byte block.
+ *  s:  4 states of 8 words, lane i at s + 8 * i
+ *  in: 4 blocks of 64 bytes, lane i at in + 64 * i
+ */
+void Transform_4way(uint32_t* s, const unsigned char* in)
+{
+    using namespace sha256d64_sse41;
+
+    __m128i a = LoadState(s, 0);
+    __m128i b = LoadState(s, 1);
+    __m128i c = LoadState(s, 2);
+    __m128i d = LoadState(s, 3);
+    __m128i e = LoadState(s, 4);
+    __m128i f = LoadState(s, 5);
+    __m128i g = LoadState(s, 6);
+    __m128i h = LoadState(s, 7);
+
+    __m128i w[16];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = Read4(in, 4 * i);
+    }
+
+    for (int i = 0; i < 64; i += 8) {
+        if (i >= 16) {
+            for (int j = i; j < i + 8; ++j) {
+                Inc(w[j & 15], sigma1(w[(j + 14) & 15]), w[(j + 9) & 15], sigma0(w[(j + 1) & 15]));
+            }
+        }
+        Round(a, b, c, d, e, f, g, h, Add(K(K256[i + 0]), w[(i + 0) & 15]));
+        Round(h, a, b, c, d, e, f, g, Add(K(K256[i + 1]), w[(i + 1) & 15]));
+        Round(g, h, a, b, c, d, e, f, Add(K(K256[i + 2]), w[(i + 2) & 15]));
+        Round(f, g, h, a, b, c, d, e, Add(K(K256[i + 3]), w[(i + 3) & 15]));
+        Round(e, f, g, h, a, b, c, d, Add(K(K256[i + 4]), w[(i + 4) & 15]));
+        Round(d, e, f, g, h, a, b, c, Add(K(K256[i + 5]), w[(i + 5) & 15]));
+        Round(c, d, e, f, g, h, a, b, Add(K(K256[i + 6]), w[(i + 6) & 15]));
+        Round(b, c, d, e, f, g, h, a, Add(K(K256[i + 7]), w[(i + 7) & 15]));
+    }
+
+    SaveState(s, 0, Add(a, LoadState(s, 0)));
+    SaveState(s, 1, Add(b, LoadState(s, 1)));
+    SaveState(s, 2, Add(c, LoadState(s, 2)));
+    SaveState(s, 3, Add(d, LoadState(s, 3)));
+    SaveState(s, 4, Add(e, LoadState(s, 4)));
+    SaveState(s, 5, Add(f, LoadState(s, 5)));
+    SaveState(s, 6, Add(g, LoadState(s, 6)));
+    SaveState(s, 7, Add(h, LoadState(s, 7)));
+}
+
+}
+
 #endif
@@ -0,0 +1,182 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RAIN_CUCKOOFILTER_H
+#define RAIN_CUCKOOFILTER_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Approximate set membership with 16 bit fingerprints, 4 per bucket.
+ *
+ * Unlike CuckooCache::cache, nothing is ever evicted. contains() never returns false for an element which was
+ * inserted and not erased, and returns true for other elements with a probability of about 1/8000. When insert()
+ * returns false the filter is full and has to be rebuilt with a bigger capacity. Until then, contains() returns
+ * true for everything, so that callers fall back to whatever the filter is in front of.
+ *
+ * Only erase elements which were inserted before, as erasing anything else can remove the fingerprint of another
+ * element.
+ */
+template<typename Key, typename Hasher>
+class cuckoo_filter
+{
+private:
+    static const size_t BUCKET_SIZE = 4;
+    static const int MAX_KICKS = 500;
+
+    typedef std::array<uint16_t, BUCKET_SIZE> Bucket;
+
+    std::vector<Bucket> buckets;
+    size_t mask;
+    size_t count{0};
+    // fingerprint which could not be placed after MAX_KICKS, the filter is full while this is set
+    uint16_t victimFingerprint{0};
+    size_t victimIndex{0};
+    // an element was dropped because the filter was already full
+    bool overflowed{false};
+    Hasher hasher;
+
+public:
+    explicit cuckoo_filter(size_t capacity)
+    {
+        size_t n = 1;
+        while (n * BUCKET_SIZE < capacity) {
+            n <<= 1;
+        }
+        buckets.resize(n);
+        mask = n - 1;
+    }
+
+    bool insert(const Key& key)
+    {
+        size_t i;
+        uint16_t fp;
+        Index(key, i, fp);
+        count++;
+
+        if (victimFingerprint != 0) {
+            overflowed = true;
+            return false;
+        }
+        if (Add(i, fp) || Add(AltIndex(i, fp), fp)) {
+            return true;
+        }
+
+        for (int n = 0; n < MAX_KICKS; n++) {
+            // kick out a different slot every time, depending on the fingerprint to not run into cycles
+            uint16_t& slot = buckets[i][(fp + n) % BUCKET_SIZE];
+            std::swap(fp, slot);
+            i = AltIndex(i, fp);
+            if (Add(i, fp)) {
+                return true;
+            }
+        }
+        victimFingerprint = fp;
+        victimIndex = i;
+        return false;
+    }
+
+    bool contains(const Key& key) const
+    {
+        size_t i;
+        uint16_t fp;
+        Index(key, i, fp);
+        if (overflowed) {
+            return true;
+        }
+        if (victimFingerprint == fp && (victimIndex == i || victimIndex == AltIndex(i, fp))) {
+            return true;
+        }
+        return Has(i, fp) || Has(AltIndex(i, fp), fp);
+    }
+
+    void erase(const Key& key)
+    {
+        size_t i;
+        uint16_t fp;
+        Index(key, i, fp);
+        if (victimFingerprint == fp && (victimIndex == i || victimIndex == AltIndex(i, fp))) {
+            victimFingerprint = 0;
+        } else if (!Remove(i, fp) && !Remove(AltIndex(i, fp), fp)) {
+            return;
+        }
+        count--;
+
+        if (victimFingerprint != 0) {
+            // there is room now
+            uint16_t fp2 = victimFingerprint;
+            victimFingerprint = 0;
+            if (!Add(victimIndex, fp2) && !Add(AltIndex(victimIndex, fp2), fp2)) {
+                victimFingerprint = fp2;
+            }
+        }
+    }
+
+    void clear()
+    {
+        std::fill(buckets.begin(), buckets.end(), Bucket{});
+        count = 0;
+        victimFingerprint = 0;
+        overflowed = false;
+    }
+
+    bool full() const { return victimFingerprint != 0 || overflowed; }
+    size_t size() const { return count; }
+    size_t capacity() const { return buckets.size() * BUCKET_SIZE; }
+
+private:
+    void Index(const Key& key, size_t& i, uint16_t& fp) const
+    {
+        uint64_t h = hasher(key);
+        fp = (uint16_t)(h >> 48);
+        if (fp == 0) {
+            // 0 marks empty slots
+            fp = 1;
+        }
+        i = h & mask;
+    }
+
+    size_t AltIndex(size_t i, uint16_t fp) const
+    {
+        // MurmurHash2 constant, the alternate index of the alternate index is the original index again
+        return (i ^ ((size_t)fp * 0x5bd1e995)) & mask;
+    }
+
+    bool Add(size_t i, uint16_t fp)
+    {
+        for (auto& slot : buckets[i]) {
+            if (slot == 0) {
+                slot = fp;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool Has(size_t i, uint16_t fp) const
+    {
+        for (auto& slot : buckets[i]) {
+            if (slot == fp) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool Remove(size_t i, uint16_t fp)
+    {
+        for (auto& slot : buckets[i]) {
+            if (slot == fp) {
+                slot = 0;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+#endif // RAIN_CUCKOOFILTER_H
@@ -77,11 +77,6 @@ void CDSNotificationInterface::BlockConnected(const std::shared_ptr<const CBlock
     llmq::chainLocksHandler->BlockConnected(pblock, pindex, vtxConflicted);
 }
 
-void CDSNotificationInterface::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected)
-{
-    llmq::chainLocksHandler->BlockDisconnected(pblock, pindexDisconnected);
-}
-
 void CDSNotificationInterface::NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff)
 {
     CMNAuth::NotifyMasternodeListChanged(undo, oldMNList, diff);
@@ -8,6 +8,8 @@
 #include <base58.h>
 #include <chainparams.h>
 #include <core_io.h>
+#include <crypto/sha256.h>
+#include <memusage.h>
 #include <script/standard.h>
 #include <ui_interface.h>
 #include <validation.h>
@@ -18,8 +20,10 @@
 
 #include <univalue.h>
 
-static const std::string DB_LIST_SNAPSHOT = "dmn_S";
-static const std::string DB_LIST_DIFF = "dmn_D";
+#include <tuple>
+
+// Map, internal id, unique property and payee queue entries of one masternode
+static const size_t MN_LIST_ENTRY_USAGE = 256;
 
 std::unique_ptr<CDeterministicMNManager> deterministicMNManager;
 
@@ -149,14 +153,13 @@ CDeterministicMNCPtr CDeterministicMNList::GetValidMN(const uint256& proTxHash)
     return dmn;
 }
 
-CDeterministicMNCPtr CDeterministicMNList::GetMNByOperatorKey(const CBLSPublicKey& pubKey)
+CDeterministicMNCPtr CDeterministicMNList::GetMNByOperatorKey(const CBLSPublicKey& pubKey) const
 {
-    for (const auto& p : mnMap) {
-        if (p.second->pdmnState->pubKeyOperator.Get() == pubKey) {
-            return p.second;
-        }
+    if (!pubKey.IsValid()) {
+        return nullptr;
     }
-    return nullptr;
+    // operator keys are unique properties, CBLSPublicKey and CBLSLazyPublicKey serialize to the same bytes
+    return GetUniquePropertyMN(pubKey);
 }
 
 CDeterministicMNCPtr CDeterministicMNList::GetMNByCollateral(const COutPoint& collateralOutpoint) const
@@ -187,7 +190,7 @@ CDeterministicMNCPtr CDeterministicMNList::GetMNByInternalId(uint64_t internalId
     return GetMN(*proTxHash);
 }
 
-static int CompareByLastPaid_GetHeight(const CDeterministicMN& dmn)
+static int GetPayeeQueueHeight(const CDeterministicMN& dmn)
 {
     int height = dmn.pdmnState->nLastPaidHeight;
     if (dmn.pdmnState->nPoSeRevivedHeight != -1 && dmn.pdmnState->nPoSeRevivedHeight > height) {
@@ -198,54 +201,29 @@ static int CompareByLastPaid_GetHeight(const CDeterministicMN& dmn)
     return height;
 }
 
-static bool CompareByLastPaid(const CDeterministicMN& _a, const CDeterministicMN& _b)
+static std::pair<int, uint256> GetPayeeQueueKey(const CDeterministicMN& dmn)
 {
-    int ah = CompareByLastPaid_GetHeight(_a);
-    int bh = CompareByLastPaid_GetHeight(_b);
-    if (ah == bh) {
-        return _a.proTxHash < _b.proTxHash;
-    } else {
-        return ah < bh;
-    }
-}
-static bool CompareByLastPaid(const CDeterministicMNCPtr& _a, const CDeterministicMNCPtr& _b)
-{
-    return CompareByLastPaid(*_a, *_b);
+    return std::make_pair(GetPayeeQueueHeight(dmn), dmn.proTxHash);
 }
 
 CDeterministicMNCPtr CDeterministicMNList::GetMNPayee() const
 {
-    if (mnMap.size() == 0) {
+    if (mnPayeeQueue.empty()) {
         return nullptr;
     }
-
-    CDeterministicMNCPtr best;
-    ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
-        if (!best || CompareByLastPaid(dmn, best)) {
-            best = dmn;
-        }
-    });
-
-    return best;
+    return GetMN(mnPayeeQueue.front().second);
 }
 
 std::vector<CDeterministicMNCPtr> CDeterministicMNList::GetProjectedMNPayees(int nCount) const
 {
-    if (nCount > GetValidMNsCount()) {
-        nCount = GetValidMNsCount();
-    }
+    nCount = std::max(0, std::min(nCount, (int)mnPayeeQueue.size()));
 
     std::vector<CDeterministicMNCPtr> result;
     result.reserve(nCount);
 
-    ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
-        result.emplace_back(dmn);
-    });
-    std::sort(result.begin(), result.end(), [&](const CDeterministicMNCPtr& a, const CDeterministicMNCPtr& b) {
-        return CompareByLastPaid(a, b);
-    });
-
-    result.resize(nCount);
+    for (auto it = mnPayeeQueue.begin(); it != mnPayeeQueue.begin() + nCount; ++it) {
+        result.emplace_back(GetMN(it->second));
+    }
 
     return result;
 }
@@ -253,19 +231,20 @@ std::vector<CDeterministicMNCPtr> CDeterministicMNList::GetProjectedMNPayees(int
 std::vector<CDeterministicMNCPtr> CDeterministicMNList::CalculateQuorum(size_t maxSize, const uint256& modifier) const
 {
     auto scores = CalculateScores(modifier);
+    size_t nSize = std::min(maxSize, scores.size());
 
-    // sort is descending order
-    std::sort(scores.rbegin(), scores.rend(), [](const std::pair<arith_uint256, CDeterministicMNCPtr>& a, std::pair<arith_uint256, CDeterministicMNCPtr>& b) {
+    // only the top maxSize entries need to be sorted, in descending order
+    std::partial_sort(scores.begin(), scores.begin() + nSize, scores.end(), [](const std::pair<arith_uint256, CDeterministicMNCPtr>& a, const std::pair<arith_uint256, CDeterministicMNCPtr>& b) {
         if (a.first == b.first) {
             // this should actually never happen, but we should stay compatible with how the non deterministic MNs did the sorting
-            return a.second->collateralOutpoint < b.second->collateralOutpoint;
+            return b.second->collateralOutpoint < a.second->collateralOutpoint;
         }
-        return a.first < b.first;
+        return b.first < a.first;
     });
 
     // take top maxSize entries and return it
     std::vector<CDeterministicMNCPtr> result;
-    result.resize(std::min(maxSize, scores.size()));
+    result.resize(nSize);
     for (size_t i = 0; i < result.size(); i++) {
         result[i] = std::move(scores[i].second);
     }
@@ -274,27 +253,38 @@ std::vector<CDeterministicMNCPtr> CDeterministicMNList::CalculateQuorum(size_t m
 
 std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> CDeterministicMNList::CalculateScores(const uint256& modifier) const
 {
-    std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> scores;
-    scores.reserve(GetAllMNsCount());
+    std::vector<CDeterministicMNCPtr> dmns;
+    dmns.reserve(GetAllMNsCount());
     ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
         if (dmn->pdmnState->confirmedHash.IsNull()) {
             // we only take confirmed MNs into account to avoid hash grinding on the ProRegTxHash to sneak MNs into a
             // future quorums
             return;
         }
-        // calculate sha256(sha256(proTxHash, confirmedHash), modifier) per MN
-        // Please note that this is not a double-sha256 but a single-sha256
-        // The first part is already precalculated (confirmedHashWithProRegTxHash)
-        // TODO When https://github.com/bitcoin/bitcoin/pull/13191 gets backported, implement something that is similar but for single-sha256
-        uint256 h;
-        CSHA256 sha256;
-        sha256.Write(dmn->pdmnState->confirmedHashWithProRegTxHash.begin(), dmn->pdmnState->confirmedHashWithProRegTxHash.size());
-        sha256.Write(modifier.begin(), modifier.size());
-        sha256.Finalize(h.begin());
-
-        scores.emplace_back(UintToArith256(h), dmn);
+        dmns.emplace_back(dmn);
     });
 
+    // calculate sha256(sha256(proTxHash, confirmedHash), modifier) per MN
+    // Please note that this is not a double-sha256 but a single-sha256
+    // The first part is already precalculated (confirmedHashWithProRegTxHash)
+    // Every message is 64 bytes, they are hashed in batches by the multi-way transforms
+    std::vector<unsigned char> vInput(dmns.size() * 64);
+    std::vector<unsigned char> vOutput(dmns.size() * 32);
+    for (size_t i = 0; i < dmns.size(); i++) {
+        const uint256& h = dmns[i]->pdmnState->confirmedHashWithProRegTxHash;
+        memcpy(vInput.data() + i * 64, h.begin(), 32);
+        memcpy(vInput.data() + i * 64 + 32, modifier.begin(), 32);
+    }
+    SHA256_64(vOutput.data(), vInput.data(), dmns.size());
+
+    std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> scores;
+    scores.reserve(dmns.size());
+    for (size_t i = 0; i < dmns.size(); i++) {
+        uint256 h;
+        memcpy(h.begin(), vOutput.data() + i * 32, 32);
+        scores.emplace_back(UintToArith256(h), std::move(dmns[i]));
+    }
+
     return scores;
 }
 
@@ -438,6 +428,28 @@ CDeterministicMNList CDeterministicMNList::ApplyDiff(const CBlockIndex* pindex,
     return result;
 }
 
+void CDeterministicMNList::AddToPayeeQueue(const CDeterministicMNCPtr& dmn)
+{
+    if (!IsMNValid(dmn)) {
+        return;
+    }
+    auto key = GetPayeeQueueKey(*dmn);
+    auto it = std::lower_bound(mnPayeeQueue.begin(), mnPayeeQueue.end(), key);
+    assert(it == mnPayeeQueue.end() || *it != key);
+    mnPayeeQueue = mnPayeeQueue.insert(it - mnPayeeQueue.begin(), key);
+}
+
+void CDeterministicMNList::RemoveFromPayeeQueue(const CDeterministicMNCPtr& dmn)
+{
+    if (!IsMNValid(dmn)) {
+        return;
+    }
+    auto key = GetPayeeQueueKey(*dmn);
+    auto it = std::lower_bound(mnPayeeQueue.begin(), mnPayeeQueue.end(), key);
+    assert(it != mnPayeeQueue.end() && *it == key);
+    mnPayeeQueue = mnPayeeQueue.erase(it - mnPayeeQueue.begin());
+}
+
 void CDeterministicMNList::AddMN(const CDeterministicMNCPtr& dmn, bool fBumpTotalCount)
 {
     assert(dmn != nullptr);
@@ -465,6 +477,7 @@ void CDeterministicMNList::AddMN(const CDeterministicMNCPtr& dmn, bool fBumpTota
     if (dmn->pdmnState->pubKeyOperator.Get().IsValid()) {
         AddUniqueProperty(dmn, dmn->pdmnState->pubKeyOperator);
     }
+    AddToPayeeQueue(dmn);
     if (fBumpTotalCount) {
         // nTotalRegisteredCount acts more like a checkpoint, not as a limit,
         nTotalRegisteredCount = std::max(dmn->GetInternalId() + 1, (uint64_t)nTotalRegisteredCount);
@@ -484,6 +497,11 @@ void CDeterministicMNList::UpdateMN(const CDeterministicMNCPtr& oldDmn, const CD
     dmn->pdmnState = pdmnState;
     mnMap = mnMap.set(oldDmn->proTxHash, dmn);
 
+    if (IsMNValid(oldDmn) != IsMNValid(dmn) || GetPayeeQueueKey(*oldDmn) != GetPayeeQueueKey(*dmn)) {
+        RemoveFromPayeeQueue(oldDmn);
+        AddToPayeeQueue(dmn);
+    }
+
     UpdateUniqueProperty(dmn, oldState->addr, pdmnState->addr);
     UpdateUniqueProperty(dmn, oldState->keyIDOwner, pdmnState->keyIDOwner);
     UpdateUniqueProperty(dmn, oldState->pubKeyOperator, pdmnState->pubKeyOperator);
@@ -521,12 +539,31 @@ void CDeterministicMNList::RemoveMN(const uint256& proTxHash)
     if (dmn->pdmnState->pubKeyOperator.Get().IsValid()) {
         DeleteUniqueProperty(dmn, dmn->pdmnState->pubKeyOperator);
     }
+    RemoveFromPayeeQueue(dmn);
     mnMap = mnMap.erase(proTxHash);
     mnInternalIdMap = mnInternalIdMap.erase(dmn->GetInternalId());
 }
 
-CDeterministicMNManager::CDeterministicMNManager(CEvoDB& _evoDb) :
-    evoDb(_evoDb)
+// Rough memory usage of cache entries. Masternodes are shared by all lists and diffs that contain them,
+// a list is only charged for its map entries and a diff for the masternodes and states it adds.
+static size_t GetListUsage(const CDeterministicMNList& mnList)
+{
+    return sizeof(CDeterministicMNList) + mnList.GetAllMNsCount() * MN_LIST_ENTRY_USAGE;
+}
+
+static size_t GetDiffUsage(const CDeterministicMNListDiff& diff)
+{
+    return sizeof(CDeterministicMNListDiff) +
+           diff.addedMNs.size() * (sizeof(CDeterministicMN) + sizeof(CDeterministicMNState) + MN_LIST_ENTRY_USAGE) +
+           memusage::DynamicUsage(diff.updatedMNs) + memusage::DynamicUsage(diff.removedMns);
+}
+
+CDeterministicMNManager::CDeterministicMNManager(CEvoDB& _evoDb, int _nSnapshotPeriod, size_t _nMaxCacheUsage) :
+    evoDb(_evoDb),
+    nSnapshotPeriod(_nSnapshotPeriod),
+    // don't go below the default, the lists of alive quorums must stay in the cache
+    nDiffsCacheHeight(std::max(_nSnapshotPeriod, DEFAULT_MNLIST_SNAPSHOT_PERIOD) * DISK_SNAPSHOTS),
+    nMaxCacheUsage(_nMaxCacheUsage)
 {
 }
 
@@ -563,15 +600,15 @@ bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockInde
         diff = oldList.BuildDiff(newList);
 
         evoDb.Write(std::make_pair(DB_LIST_DIFF, newList.GetBlockHash()), diff);
-        if ((nHeight % DISK_SNAPSHOT_PERIOD) == 0 || oldList.GetHeight() == -1) {
+        if ((nHeight % nSnapshotPeriod) == 0 || oldList.GetHeight() == -1) {
             evoDb.Write(std::make_pair(DB_LIST_SNAPSHOT, newList.GetBlockHash()), newList);
-            mnListsCache.emplace(newList.GetBlockHash(), newList);
+            CacheList(newList);
             LogPrintf("CDeterministicMNManager::%s -- Wrote snapshot. nHeight=%d, mapCurMNs.allMNsCount=%d\n",
                 __func__, nHeight, newList.GetAllMNsCount());
         }
 
         diff.nHeight = pindex->nHeight;
-        mnListDiffsCache.emplace(pindex->GetBlockHash(), diff);
+        CacheDiff(pindex->GetBlockHash(), diff);
     } catch (const std::exception& e) {
         LogPrintf("CDeterministicMNManager::%s -- internal error: %s\n", __func__, e.what());
         return _state.Invalid(ValidationInvalidReason::BADPROTX, false, REJECT_INVALID, "failed-dmn-block");
@@ -608,8 +645,8 @@ bool CDeterministicMNManager::UndoBlock(const CBlock& block, const CBlockIndex*
             prevList = GetListForBlock(pindex->pprev);
         }
 
-        mnListsCache.erase(blockHash);
-        mnListDiffsCache.erase(blockHash);
+        UncacheList(blockHash);
+        UncacheDiff(blockHash);
     }
 
     if (diff.HasChanges()) {
@@ -908,25 +945,36 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
 {
     LOCK(cs);
 
+    auto itLists = mnListsCache.find(pindex->GetBlockHash());
+    if (itLists != mnListsCache.end()) {
+        itLists->second.nLastAccess = ++nCacheAccess;
+        cacheStats.nListHits++;
+        return itLists->second.value;
+    }
+    cacheStats.nListMisses++;
+
     CDeterministicMNList snapshot;
     std::list<const CBlockIndex*> listDiffIndexes;
 
     while (true) {
         // try using cache before reading from disk
-        auto itLists = mnListsCache.find(pindex->GetBlockHash());
+        itLists = mnListsCache.find(pindex->GetBlockHash());
         if (itLists != mnListsCache.end()) {
-            snapshot = itLists->second;
+            itLists->second.nLastAccess = ++nCacheAccess;
+            snapshot = itLists->second.value;
             break;
         }
 
         if (evoDb.Read(std::make_pair(DB_LIST_SNAPSHOT, pindex->GetBlockHash()), snapshot)) {
-            mnListsCache.emplace(pindex->GetBlockHash(), snapshot);
+            CacheList(snapshot);
             break;
         }
 
         // no snapshot found yet, check diffs
         auto itDiffs = mnListDiffsCache.find(pindex->GetBlockHash());
         if (itDiffs != mnListDiffsCache.end()) {
+            itDiffs->second.nLastAccess = ++nCacheAccess;
+            cacheStats.nDiffHits++;
             listDiffIndexes.emplace_front(pindex);
             pindex = pindex->pprev;
             continue;
@@ -936,18 +984,19 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
         if (!evoDb.Read(std::make_pair(DB_LIST_DIFF, pindex->GetBlockHash()), diff)) {
             // no snapshot and no diff on disk means that it's the initial snapshot
             snapshot = CDeterministicMNList(pindex->GetBlockHash(), -1, 0);
-            mnListsCache.emplace(pindex->GetBlockHash(), snapshot);
+            CacheList(snapshot);
             break;
         }
 
+        cacheStats.nDiffMisses++;
         diff.nHeight = pindex->nHeight;
-        mnListDiffsCache.emplace(pindex->GetBlockHash(), std::move(diff));
+        CacheDiff(pindex->GetBlockHash(), std::move(diff));
         listDiffIndexes.emplace_front(pindex);
         pindex = pindex->pprev;
     }
 
     for (const auto& diffIndex : listDiffIndexes) {
-        const auto& diff = mnListDiffsCache.at(diffIndex->GetBlockHash());
+        const auto& diff = mnListDiffsCache.at(diffIndex->GetBlockHash()).value;
         if (diff.HasChanges()) {
             snapshot = snapshot.ApplyDiff(diffIndex, diff);
         } else {
@@ -955,21 +1004,14 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
             snapshot.SetHeight(diffIndex->nHeight);
         }
     }
+    cacheStats.nDiffsApplied += listDiffIndexes.size();
 
-    if (tipIndex) {
-        // always keep a snapshot for the tip
-        if (snapshot.GetBlockHash() == tipIndex->GetBlockHash()) {
-            mnListsCache.emplace(snapshot.GetBlockHash(), snapshot);
-        } else {
-            // keep snapshots for yet alive quorums
-            for (auto& p_llmq : Params().GetConsensus().llmqs) {
-                if ((snapshot.GetHeight() % p_llmq.second.dkgInterval == 0) && (snapshot.GetHeight() + p_llmq.second.dkgInterval * (p_llmq.second.keepOldConnections + 1) >= tipIndex->nHeight)) {
-                    mnListsCache.emplace(snapshot.GetBlockHash(), snapshot);
-                    break;
-                }
-            }
-        }
+    // lookups of this block and of the blocks after it don't need to replay these diffs again,
+    // the tip and quorum lists stay until CleanupCache drops them, the others until they are evicted
+    if (!listDiffIndexes.empty()) {
+        CacheList(snapshot);
     }
+    TrimCache();
 
     return snapshot;
 }
@@ -1018,6 +1060,111 @@ bool CDeterministicMNManager::IsDIP3Enforced(int nHeight)
     return nHeight > 0;
 }
 
+CDeterministicMNCacheStats CDeterministicMNManager::GetCacheStats()
+{
+    LOCK(cs);
+
+    CDeterministicMNCacheStats stats = cacheStats;
+    stats.nLists = mnListsCache.size();
+    stats.nDiffs = mnListDiffsCache.size();
+    stats.nMaxUsage = nMaxCacheUsage;
+    return stats;
+}
+
+bool CDeterministicMNManager::IsQuorumList(int nListHeight, int nTipHeight) const
+{
+    for (auto& p_llmq : Params().GetConsensus().llmqs) {
+        if ((nListHeight % p_llmq.second.dkgInterval == 0) && (nListHeight + p_llmq.second.dkgInterval * (p_llmq.second.keepOldConnections + 1) >= nTipHeight)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CDeterministicMNManager::CacheList(const CDeterministicMNList& mnList)
+{
+    AssertLockHeld(cs);
+
+    auto p = mnListsCache.emplace(mnList.GetBlockHash(), CacheEntry<CDeterministicMNList>{mnList, 0, 0});
+    if (p.second) {
+        p.first->second.nUsage = GetListUsage(mnList);
+        cacheStats.nUsage += p.first->second.nUsage;
+    }
+    p.first->second.nLastAccess = ++nCacheAccess;
+}
+
+void CDeterministicMNManager::CacheDiff(const uint256& blockHash, CDeterministicMNListDiff diff)
+{
+    AssertLockHeld(cs);
+
+    size_t nUsage = GetDiffUsage(diff);
+    auto p = mnListDiffsCache.emplace(blockHash, CacheEntry<CDeterministicMNListDiff>{std::move(diff), nUsage, 0});
+    if (p.second) {
+        cacheStats.nUsage += nUsage;
+    }
+    p.first->second.nLastAccess = ++nCacheAccess;
+}
+
+void CDeterministicMNManager::UncacheList(const uint256& blockHash)
+{
+    AssertLockHeld(cs);
+
+    auto it = mnListsCache.find(blockHash);
+    if (it != mnListsCache.end()) {
+        cacheStats.nUsage -= it->second.nUsage;
+        mnListsCache.erase(it);
+    }
+}
+
+void CDeterministicMNManager::UncacheDiff(const uint256& blockHash)
+{
+    AssertLockHeld(cs);
+
+    auto it = mnListDiffsCache.find(blockHash);
+    if (it != mnListDiffsCache.end()) {
+        cacheStats.nUsage -= it->second.nUsage;
+        mnListDiffsCache.erase(it);
+    }
+}
+
+void CDeterministicMNManager::TrimCache()
+{
+    AssertLockHeld(cs);
+
+    if (cacheStats.nUsage <= nMaxCacheUsage) {
+        return;
+    }
+
+    // go a bit below the budget, so that the next few entries don't sort the caches again
+    size_t nTargetUsage = nMaxCacheUsage / 10 * 9;
+
+    // last access, is a list, block hash
+    std::vector<std::tuple<uint64_t, bool, uint256> > vEntries;
+    vEntries.reserve(mnListsCache.size() + mnListDiffsCache.size());
+    for (const auto& p : mnListsCache) {
+        if (tipIndex && (p.first == tipIndex->GetBlockHash() || IsQuorumList(p.second.value.GetHeight(), tipIndex->nHeight))) {
+            continue;
+        }
+        vEntries.emplace_back(p.second.nLastAccess, true, p.first);
+    }
+    for (const auto& p : mnListDiffsCache) {
+        vEntries.emplace_back(p.second.nLastAccess, false, p.first);
+    }
+    std::sort(vEntries.begin(), vEntries.end());
+
+    for (const auto& e : vEntries) {
+        if (cacheStats.nUsage <= nTargetUsage) {
+            break;
+        }
+        if (std::get<1>(e)) {
+            UncacheList(std::get<2>(e));
+        } else {
+            UncacheDiff(std::get<2>(e));
+        }
+        cacheStats.nEvictions++;
+    }
+}
+
 void CDeterministicMNManager::CleanupCache(int nHeight)
 {
     AssertLockHeld(cs);
@@ -1025,18 +1172,12 @@ void CDeterministicMNManager::CleanupCache(int nHeight)
     std::vector<uint256> toDeleteLists;
     std::vector<uint256> toDeleteDiffs;
     for (const auto& p : mnListsCache) {
-        if (p.second.GetHeight() + LIST_DIFFS_CACHE_SIZE < nHeight) {
+        const auto& mnList = p.second.value;
+        if (mnList.GetHeight() + nDiffsCacheHeight < nHeight) {
             toDeleteLists.emplace_back(p.first);
             continue;
         }
-        bool fQuorumCache{false};
-        for (auto& p_llmq : Params().GetConsensus().llmqs) {
-            if ((p.second.GetHeight() % p_llmq.second.dkgInterval == 0) && (p.second.GetHeight() + p_llmq.second.dkgInterval * (p_llmq.second.keepOldConnections + 1) >= nHeight)) {
-                fQuorumCache = true;
-                break;
-            }
-        }
-        if (fQuorumCache) {
+        if (IsQuorumList(mnList.GetHeight(), nHeight)) {
             // at least one quorum could be using it, keep it
             continue;
         }
@@ -1045,7 +1186,7 @@ void CDeterministicMNManager::CleanupCache(int nHeight)
             toDeleteLists.emplace_back(p.first);
         } else {
             for (auto& p_llmq : Params().GetConsensus().llmqs) {
-                if (p.second.GetHeight() % p_llmq.second.dkgInterval == 0) {
+                if (mnList.GetHeight() % p_llmq.second.dkgInterval == 0) {
                     toDeleteLists.emplace_back(p.first);
                     break;
                 }
@@ -1053,16 +1194,18 @@ void CDeterministicMNManager::CleanupCache(int nHeight)
         }
     }
     for (const auto& h : toDeleteLists) {
-        mnListsCache.erase(h);
+        UncacheList(h);
     }
     for (const auto& p : mnListDiffsCache) {
-        if (p.second.nHeight + LIST_DIFFS_CACHE_SIZE < nHeight) {
+        if (p.second.value.nHeight + nDiffsCacheHeight < nHeight) {
             toDeleteDiffs.emplace_back(p.first);
         }
     }
     for (const auto& h : toDeleteDiffs) {
-        mnListDiffsCache.erase(h);
+        UncacheDiff(h);
     }
+
+    TrimCache();
 }
 
 void CDeterministicMNManager::UpgradeDiff(CDBBatch& batch, const CBlockIndex* pindexNext, const CDeterministicMNList& curMNList, CDeterministicMNList& newMNList)
@@ -1159,7 +1302,7 @@ bool CDeterministicMNManager::UpgradeDBIfNeeded()
         CDeterministicMNList newMNList;
         UpgradeDiff(batch, pindex, curMNList, newMNList);
 
-        if ((nHeight % DISK_SNAPSHOT_PERIOD) == 0) {
+        if ((nHeight % nSnapshotPeriod) == 0) {
             batch.Write(std::make_pair(DB_LIST_SNAPSHOT, pindex->GetBlockHash()), newMNList);
             evoDb.GetRawDB().WriteBatch(batch);
             batch.Clear();
@@ -14,6 +14,7 @@
 #include <saltedhasher.h>
 #include <sync.h>
 
+#include <immer/flex_vector.hpp>
 #include <immer/map.hpp>
 #include <immer/map_transient.hpp>
 
@@ -291,6 +292,7 @@ public:
     typedef immer::map<uint256, CDeterministicMNCPtr> MnMap;
     typedef immer::map<uint64_t, uint256> MnInternalIdMap;
     typedef immer::map<uint256, std::pair<uint256, uint32_t> > MnUniquePropertyMap;
+    typedef immer::flex_vector<std::pair<int, uint256> > MnPayeeQueue;
 
 private:
     uint256 blockHash;
@@ -303,6 +305,10 @@ private:
     // we keep track of this as checking for duplicates would otherwise be painfully slow
     MnUniquePropertyMap mnUniquePropertyMap;
 
+    // valid masternodes in payment order, (last paid/revived/registered height, proTxHash), sorted
+    // kept up to date by AddMN/UpdateMN/RemoveMN so picking payees doesn't need to sort the list
+    MnPayeeQueue mnPayeeQueue;
+
 public:
     CDeterministicMNList() {}
     explicit CDeterministicMNList(const uint256& _blockHash, int _height, uint32_t _totalRegisteredCount) :
@@ -336,6 +342,7 @@ public:
         mnMap = MnMap();
         mnUniquePropertyMap = MnUniquePropertyMap();
         mnInternalIdMap = MnInternalIdMap();
+        mnPayeeQueue = MnPayeeQueue();
 
         SerializationOpBase(s, CSerActionUnserialize());
 
@@ -413,7 +420,7 @@ public:
     }
     CDeterministicMNCPtr GetMN(const uint256& proTxHash) const;
     CDeterministicMNCPtr GetValidMN(const uint256& proTxHash) const;
-    CDeterministicMNCPtr GetMNByOperatorKey(const CBLSPublicKey& pubKey);
+    CDeterministicMNCPtr GetMNByOperatorKey(const CBLSPublicKey& pubKey) const;
     CDeterministicMNCPtr GetMNByCollateral(const COutPoint& collateralOutpoint) const;
     CDeterministicMNCPtr GetValidMNByCollateral(const COutPoint& collateralOutpoint) const;
     CDeterministicMNCPtr GetMNByService(const CService& service) const;
@@ -496,6 +503,9 @@ public:
     }
 
 private:
+    void AddToPayeeQueue(const CDeterministicMNCPtr& dmn);
+    void RemoveFromPayeeQueue(const CDeterministicMNCPtr& dmn);
+
     template <typename T>
     void AddUniqueProperty(const CDeterministicMNCPtr& dmn, const T& v)
     {
@@ -634,11 +644,30 @@ public:
     }
 };
 
+// evoDB keys of the list snapshots and diffs, followed by the block hash
+static const std::string DB_LIST_SNAPSHOT = "dmn_S";
+static const std::string DB_LIST_DIFF = "dmn_D";
+
+static const int DEFAULT_MNLIST_SNAPSHOT_PERIOD = 576; // once per day
+static const int64_t DEFAULT_MNLIST_CACHE_SIZE = 64; // MiB
+
+struct CDeterministicMNCacheStats
+{
+    size_t nLists{0};
+    size_t nDiffs{0};
+    size_t nUsage{0};
+    size_t nMaxUsage{0};
+    uint64_t nListHits{0};      // lists found in the cache
+    uint64_t nListMisses{0};    // lists built from a snapshot and diffs
+    uint64_t nDiffHits{0};
+    uint64_t nDiffMisses{0};    // diffs read from evoDB
+    uint64_t nDiffsApplied{0};
+    uint64_t nEvictions{0};
+};
+
 class CDeterministicMNManager
 {
-    static const int DISK_SNAPSHOT_PERIOD = 576; // once per day
     static const int DISK_SNAPSHOTS = 3; // keep cache for 3 disk snapshots to have 2 full days covered
-    static const int LIST_DIFFS_CACHE_SIZE = DISK_SNAPSHOT_PERIOD * DISK_SNAPSHOTS;
 
 public:
     RecursiveMutex cs;
@@ -646,12 +675,29 @@ public:
 private:
     CEvoDB& evoDb;
 
-    std::unordered_map<uint256, CDeterministicMNList, StaticSaltedHasher> mnListsCache;
-    std::unordered_map<uint256, CDeterministicMNListDiff, StaticSaltedHasher> mnListDiffsCache;
+    // a snapshot is written to evoDB every nSnapshotPeriod blocks, lookups replay at most that many diffs
+    const int nSnapshotPeriod;
+    const int nDiffsCacheHeight;
+    const size_t nMaxCacheUsage;
+
+    template <typename T>
+    struct CacheEntry
+    {
+        T value;
+        size_t nUsage;
+        uint64_t nLastAccess;
+    };
+
+    // Both caches share a memory budget, the least recently used entries are evicted when it is exceeded.
+    // Lists of the tip and of alive quorums are never evicted, CleanupCache drops them by height.
+    std::unordered_map<uint256, CacheEntry<CDeterministicMNList>, StaticSaltedHasher> mnListsCache;
+    std::unordered_map<uint256, CacheEntry<CDeterministicMNListDiff>, StaticSaltedHasher> mnListDiffsCache;
+    uint64_t nCacheAccess{0};
+    CDeterministicMNCacheStats cacheStats; // counters and usage, the rest is filled in by GetCacheStats
     const CBlockIndex* tipIndex{nullptr};
 
 public:
-    explicit CDeterministicMNManager(CEvoDB& _evoDb);
+    explicit CDeterministicMNManager(CEvoDB& _evoDb, int _nSnapshotPeriod = DEFAULT_MNLIST_SNAPSHOT_PERIOD, size_t _nMaxCacheUsage = DEFAULT_MNLIST_CACHE_SIZE << 20);
 
     bool ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck);
     bool UndoBlock(const CBlock& block, const CBlockIndex* pindex);
@@ -671,12 +717,20 @@ public:
 
     bool IsDIP3Enforced(int nHeight = -1);
 
+    CDeterministicMNCacheStats GetCacheStats();
+
 public:
     // TODO these can all be removed in a future version
     void UpgradeDiff(CDBBatch& batch, const CBlockIndex* pindexNext, const CDeterministicMNList& curMNList, CDeterministicMNList& newMNList);
     bool UpgradeDBIfNeeded();
 
 private:
+    bool IsQuorumList(int nListHeight, int nTipHeight) const;
+    void CacheList(const CDeterministicMNList& mnList);
+    void CacheDiff(const uint256& blockHash, CDeterministicMNListDiff diff);
+    void UncacheList(const uint256& blockHash);
+    void UncacheDiff(const uint256& blockHash);
+    void TrimCache();
     void CleanupCache(int nHeight);
 };
 
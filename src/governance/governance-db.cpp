@@ -0,0 +1,264 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <governance/governance-db.h>
+
+#include <clientversion.h>
+#include <hash.h>
+#include <streams.h>
+#include <util/system.h>
+
+#include <tuple>
+
+std::unique_ptr<CGovernanceDb> governanceDb;
+
+static const std::string DB_OBJECT = "gov_o";
+static const std::string DB_OBJECT_STATE = "gov_s";
+static const std::string DB_VOTE = "gov_v";
+static const std::string DB_VOTE_PARENT = "gov_p";
+static const std::string DB_ERASED = "gov_e";
+static const std::string DB_VOTING_KEYS_BLOCK = "gov_k";
+
+CGovernanceDb::CGovernanceDb(size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(fMemory ? "" : (GetDataDir() / "governance"), nCacheSize, fMemory, fWipe)
+{
+}
+
+void CGovernanceDb::WriteObject(const CGovernanceObject& govobj)
+{
+    // objects are stored in their network format, the votes and the local state have their own records
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << govobj;
+    db.Write(std::make_tuple(std::string(DB_OBJECT), govobj.GetHash()), std::vector<unsigned char>(ss.begin(), ss.end()));
+
+    WriteObjectState(govobj);
+}
+
+void CGovernanceDb::WriteObjectState(const CGovernanceObject& govobj)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    govobj.SerializeState(ss);
+    uint256 hashState = Hash(ss.begin(), ss.end());
+    uint256 nHash = govobj.GetHash();
+
+    LOCK(cs);
+    uint256& hashPrev = mapStateHashes[nHash];
+    if (hashPrev == hashState) {
+        return;
+    }
+    hashPrev = hashState;
+
+    db.Write(std::make_tuple(std::string(DB_OBJECT_STATE), nHash), std::vector<unsigned char>(ss.begin(), ss.end()));
+}
+
+void CGovernanceDb::EraseObject(const uint256& nHash)
+{
+    CDBBatch batch(db);
+    batch.Erase(std::make_tuple(std::string(DB_OBJECT), nHash));
+    batch.Erase(std::make_tuple(std::string(DB_OBJECT_STATE), nHash));
+
+    auto it = std::unique_ptr<CDBIterator>(db.NewIterator());
+    auto firstKey = std::make_tuple(std::string(DB_VOTE), nHash, uint256());
+    it->Seek(firstKey);
+    while (it->Valid()) {
+        decltype(firstKey) curKey;
+        if (!it->GetKey(curKey) || std::get<0>(curKey) != DB_VOTE || std::get<1>(curKey) != nHash) {
+            break;
+        }
+        batch.Erase(std::make_tuple(std::string(DB_VOTE_PARENT), std::get<2>(curKey)));
+        batch.Erase(curKey);
+        it->Next();
+    }
+
+    db.WriteBatch(batch);
+
+    LOCK(cs);
+    mapStateHashes.erase(nHash);
+}
+
+void CGovernanceDb::ReadObjects(std::map<uint256, CGovernanceObject>& mapObjects)
+{
+    auto it = std::unique_ptr<CDBIterator>(db.NewIterator());
+    auto firstKey = std::make_tuple(std::string(DB_OBJECT), uint256());
+    it->Seek(firstKey);
+
+    LOCK(cs);
+    while (it->Valid()) {
+        decltype(firstKey) curKey;
+        if (!it->GetKey(curKey) || std::get<0>(curKey) != DB_OBJECT) {
+            break;
+        }
+        const uint256& nHash = std::get<1>(curKey);
+
+        std::vector<unsigned char> vchObject, vchState;
+        if (!it->GetValue(vchObject) || !db.Read(std::make_tuple(std::string(DB_OBJECT_STATE), nHash), vchState)) {
+            LogPrintf("CGovernanceDb::%s -- failed to read object %s, skipping\n", __func__, nHash.ToString());
+            it->Next();
+            continue;
+        }
+
+        try {
+            CGovernanceObject govobj;
+            CDataStream ssObject(vchObject, SER_NETWORK, PROTOCOL_VERSION);
+            ssObject >> govobj;
+            govobj.LoadData();
+            CDataStream ssState(vchState, SER_DISK, CLIENT_VERSION);
+            govobj.UnserializeState(ssState);
+            mapObjects.emplace(nHash, govobj);
+            mapStateHashes[nHash] = Hash(vchState.begin(), vchState.end());
+        } catch (const std::exception& e) {
+            LogPrintf("CGovernanceDb::%s -- failed to deserialize object %s: %s\n", __func__, nHash.ToString(), e.what());
+        }
+
+        it->Next();
+    }
+}
+
+void CGovernanceDb::WriteVote(const CGovernanceVote& vote, int64_t nTime, const std::set<uint256>& setReplaced)
+{
+    const uint256& nParentHash = vote.GetParentHash();
+    uint256 nVoteHash = vote.GetHash();
+
+    CDBBatch batch(db);
+    batch.Write(std::make_tuple(std::string(DB_VOTE), nParentHash, nVoteHash), std::make_pair(vote, nTime));
+    batch.Write(std::make_tuple(std::string(DB_VOTE_PARENT), nVoteHash), nParentHash);
+    for (const uint256& nHash : setReplaced) {
+        batch.Erase(std::make_tuple(std::string(DB_VOTE), nParentHash, nHash));
+        batch.Erase(std::make_tuple(std::string(DB_VOTE_PARENT), nHash));
+    }
+    db.WriteBatch(batch);
+}
+
+void CGovernanceDb::WriteObjectVotes(const CGovernanceObject& govobj)
+{
+    uint256 nParentHash = govobj.GetHash();
+
+    CDBBatch batch(db);
+    for (const auto& vote : govobj.GetVoteFile().GetVotes()) {
+        // the time the vote was accepted at is only known for the current vote of each masternode and signal
+        int64_t nTime = 0;
+        vote_rec_t voteRecord;
+        if (govobj.GetCurrentMNVotes(vote.GetMasternodeOutpoint(), voteRecord)) {
+            auto it = voteRecord.mapInstances.find(int(vote.GetSignal()));
+            if (it != voteRecord.mapInstances.end() && it->second.nCreationTime == vote.GetTimestamp()) {
+                nTime = it->second.nTime;
+            }
+        }
+
+        uint256 nVoteHash = vote.GetHash();
+        batch.Write(std::make_tuple(std::string(DB_VOTE), nParentHash, nVoteHash), std::make_pair(vote, nTime));
+        batch.Write(std::make_tuple(std::string(DB_VOTE_PARENT), nVoteHash), nParentHash);
+
+        if (batch.SizeEstimate() >= (1 << 24)) {
+            db.WriteBatch(batch);
+            batch.Clear();
+        }
+    }
+    db.WriteBatch(batch);
+}
+
+void CGovernanceDb::EraseVotes(const uint256& nParentHash, const std::set<uint256>& setVoteHashes)
+{
+    if (setVoteHashes.empty()) {
+        return;
+    }
+
+    CDBBatch batch(db);
+    for (const uint256& nHash : setVoteHashes) {
+        batch.Erase(std::make_tuple(std::string(DB_VOTE), nParentHash, nHash));
+        batch.Erase(std::make_tuple(std::string(DB_VOTE_PARENT), nHash));
+    }
+    db.WriteBatch(batch);
+}
+
+bool CGovernanceDb::HasVote(const uint256& nVoteHash)
+{
+    return db.Exists(std::make_tuple(std::string(DB_VOTE_PARENT), nVoteHash));
+}
+
+bool CGovernanceDb::ReadVote(const uint256& nVoteHash, CGovernanceVote& vote)
+{
+    uint256 nParentHash;
+    if (!db.Read(std::make_tuple(std::string(DB_VOTE_PARENT), nVoteHash), nParentHash)) {
+        return false;
+    }
+    vote_time_pair_t pairVote;
+    if (!db.Read(std::make_tuple(std::string(DB_VOTE), nParentHash, nVoteHash), pairVote)) {
+        return false;
+    }
+    vote = pairVote.first;
+    return true;
+}
+
+void CGovernanceDb::ReadObjectVotes(const uint256& nParentHash, std::vector<vote_time_pair_t>& vecVotes)
+{
+    auto it = std::unique_ptr<CDBIterator>(db.NewIterator());
+    auto firstKey = std::make_tuple(std::string(DB_VOTE), nParentHash, uint256());
+    it->Seek(firstKey);
+
+    while (it->Valid()) {
+        decltype(firstKey) curKey;
+        if (!it->GetKey(curKey) || std::get<0>(curKey) != DB_VOTE || std::get<1>(curKey) != nParentHash) {
+            break;
+        }
+        vote_time_pair_t pairVote;
+        if (it->GetValue(pairVote)) {
+            vecVotes.emplace_back(pairVote);
+        }
+        it->Next();
+    }
+}
+
+void CGovernanceDb::ReadObjectVoteHashes(const uint256& nParentHash, std::vector<uint256>& vecVoteHashes)
+{
+    auto it = std::unique_ptr<CDBIterator>(db.NewIterator());
+    auto firstKey = std::make_tuple(std::string(DB_VOTE), nParentHash, uint256());
+    it->Seek(firstKey);
+
+    while (it->Valid()) {
+        decltype(firstKey) curKey;
+        if (!it->GetKey(curKey) || std::get<0>(curKey) != DB_VOTE || std::get<1>(curKey) != nParentHash) {
+            break;
+        }
+        vecVoteHashes.emplace_back(std::get<2>(curKey));
+        it->Next();
+    }
+}
+
+void CGovernanceDb::WriteErasedObject(const uint256& nHash, int64_t nExpirationTime)
+{
+    db.Write(std::make_tuple(std::string(DB_ERASED), nHash), nExpirationTime);
+}
+
+void CGovernanceDb::EraseErasedObject(const uint256& nHash)
+{
+    db.Erase(std::make_tuple(std::string(DB_ERASED), nHash));
+}
+
+void CGovernanceDb::ReadErasedObjects(std::map<uint256, int64_t>& mapErased)
+{
+    auto it = std::unique_ptr<CDBIterator>(db.NewIterator());
+    auto firstKey = std::make_tuple(std::string(DB_ERASED), uint256());
+    it->Seek(firstKey);
+
+    while (it->Valid()) {
+        decltype(firstKey) curKey;
+        int64_t nExpirationTime;
+        if (!it->GetKey(curKey) || std::get<0>(curKey) != DB_ERASED || !it->GetValue(nExpirationTime)) {
+            break;
+        }
+        mapErased.emplace(std::get<1>(curKey), nExpirationTime);
+        it->Next();
+    }
+}
+
+void CGovernanceDb::WriteVotingKeysBlock(const uint256& blockHash)
+{
+    db.Write(DB_VOTING_KEYS_BLOCK, blockHash);
+}
+
+bool CGovernanceDb::ReadVotingKeysBlock(uint256& blockHash)
+{
+    return db.Read(DB_VOTING_KEYS_BLOCK, blockHash);
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef GOVERNANCE_DB_H
+#define GOVERNANCE_DB_H
+
+#include <dbwrapper.h>
+#include <governance/governance-object.h>
+#include <governance/governance-vote.h>
+#include <saltedhasher.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * LevelDB store of the governance objects and their votes, in the "governance" dir.
+ *
+ * Objects and votes are written as they are accepted and erased when they are dropped,
+ * so nothing has to be dumped on shutdown and a crash loses nothing. Startup only reads
+ * the objects and their local state, the votes of an object are read the first time they
+ * are needed (see CGovernanceObject::LoadVotes).
+ */
+class CGovernanceDb
+{
+private:
+    CDBWrapper db;
+
+    RecursiveMutex cs;
+    // hash of the last written state of every object, unchanged states are not written again
+    std::unordered_map<uint256, uint256, StaticSaltedHasher> mapStateHashes;
+
+public:
+    CGovernanceDb(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    bool IsEmpty() { return db.IsEmpty(); }
+
+    void WriteObject(const CGovernanceObject& govobj);
+    void WriteObjectState(const CGovernanceObject& govobj);
+    // Erase the object together with all of its votes
+    void EraseObject(const uint256& nHash);
+    void ReadObjects(std::map<uint256, CGovernanceObject>& mapObjects);
+
+    // Write a vote with the time it was accepted at, and erase the votes it replaced
+    void WriteVote(const CGovernanceVote& vote, int64_t nTime, const std::set<uint256>& setReplaced);
+    void WriteObjectVotes(const CGovernanceObject& govobj);
+    void EraseVotes(const uint256& nParentHash, const std::set<uint256>& setVoteHashes);
+    bool HasVote(const uint256& nVoteHash);
+    bool ReadVote(const uint256& nVoteHash, CGovernanceVote& vote);
+    void ReadObjectVotes(const uint256& nParentHash, std::vector<vote_time_pair_t>& vecVotes);
+    // Only the hashes of the votes, without reading the votes themselves
+    void ReadObjectVoteHashes(const uint256& nParentHash, std::vector<uint256>& vecVoteHashes);
+
+    void WriteErasedObject(const uint256& nHash, int64_t nExpirationTime);
+    void EraseErasedObject(const uint256& nHash);
+    void ReadErasedObjects(std::map<uint256, int64_t>& mapErased);
+
+    // Block of the masternode list the voting keys were last checked against
+    void WriteVotingKeysBlock(const uint256& blockHash);
+    bool ReadVotingKeysBlock(uint256& blockHash);
+};
+
+extern std::unique_ptr<CGovernanceDb> governanceDb;
+
+#endif
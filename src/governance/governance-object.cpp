@@ -5,6 +5,7 @@
 #include <governance/governance-object.h>
 #include <core_io.h>
 #include <governance/governance-classes.h>
+#include <governance/governance-db.h>
 #include <governance/governance-validators.h>
 #include <governance/governance-vote.h>
 #include <governance/governance.h>
@@ -15,6 +16,7 @@
 #include <util/system.h>
 #include <validation.h>
 
+#include <algorithm>
 #include <string>
 #include <univalue.h>
 
@@ -38,6 +40,7 @@ CGovernanceObject::CGovernanceObject() :
     fDirtyCache(true),
     fExpired(false),
     fUnparsable(false),
+    fVotesLoaded(true),
     mapCurrentMNVotes(),
     fileVotes()
 {
@@ -65,6 +68,7 @@ CGovernanceObject::CGovernanceObject(const uint256& nHashParentIn, int nRevision
     fDirtyCache(true),
     fExpired(false),
     fUnparsable(false),
+    fVotesLoaded(true),
     mapCurrentMNVotes(),
     fileVotes()
 {
@@ -92,6 +96,7 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other) :
     fDirtyCache(other.fDirtyCache),
     fExpired(other.fExpired),
     fUnparsable(other.fUnparsable),
+    fVotesLoaded(other.fVotesLoaded),
     mapCurrentMNVotes(other.mapCurrentMNVotes),
     fileVotes(other.fileVotes)
 {
@@ -103,6 +108,7 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
     CConnman& connman)
 {
     LOCK(cs);
+    LoadVotes();
 
     // do not process already known valid votes twice
     if (fileVotes.HasVote(vote.GetHash())) {
@@ -211,21 +217,58 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
     }
 
     voteInstanceRef = vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp());
-    fileVotes.AddVote(vote);
+    auto replacedVotes = fileVotes.AddVote(vote);
+    if (governanceDb) {
+        governanceDb->WriteVote(vote, nVoteTimeUpdate, replacedVotes);
+    }
     fDirtyCache = true;
     return true;
 }
 
+void CGovernanceObject::LoadVotes() const
+{
+    LOCK(cs);
+
+    if (fVotesLoaded) {
+        return;
+    }
+    fVotesLoaded = true;
+
+    if (!governanceDb) {
+        return;
+    }
+
+    std::vector<vote_time_pair_t> vecVotes;
+    governanceDb->ReadObjectVotes(GetHash(), vecVotes);
+
+    // replay the votes in the order they were cast, the same way ProcessVote recorded them
+    std::sort(vecVotes.begin(), vecVotes.end(), [](const vote_time_pair_t& a, const vote_time_pair_t& b) {
+        return a.first.GetTimestamp() < b.first.GetTimestamp();
+    });
+    for (const auto& pairVote : vecVotes) {
+        const CGovernanceVote& vote = pairVote.first;
+        vote_rec_t& voteRecord = mapCurrentMNVotes[vote.GetMasternodeOutpoint()];
+        voteRecord.mapInstances[int(vote.GetSignal())] = vote_instance_t(vote.GetOutcome(), pairVote.second, vote.GetTimestamp());
+        fileVotes.AddVote(vote);
+    }
+
+    LogPrint(BCLog::GOBJECT, "CGovernanceObject::%s -- loaded %d votes for %s\n", __func__, vecVotes.size(), GetHash().ToString());
+}
+
 void CGovernanceObject::ClearMasternodeVotes()
 {
     LOCK(cs);
+    LoadVotes();
 
     auto mnList = deterministicMNManager->GetListAtChainTip();
 
     vote_m_it it = mapCurrentMNVotes.begin();
     while (it != mapCurrentMNVotes.end()) {
         if (!mnList.HasMNByCollateral(it->first)) {
-            fileVotes.RemoveVotesFromMasternode(it->first);
+            auto removedVotes = fileVotes.RemoveVotesFromMasternode(it->first);
+            if (governanceDb) {
+                governanceDb->EraseVotes(GetHash(), removedVotes);
+            }
             mapCurrentMNVotes.erase(it++);
             fDirtyCache = true;
         } else {
@@ -237,6 +280,7 @@ void CGovernanceObject::ClearMasternodeVotes()
 std::set<uint256> CGovernanceObject::RemoveInvalidVotes(const COutPoint& mnOutpoint)
 {
     LOCK(cs);
+    LoadVotes();
 
     auto it = mapCurrentMNVotes.find(mnOutpoint);
     if (it == mapCurrentMNVotes.end()) {
@@ -262,6 +306,9 @@ std::set<uint256> CGovernanceObject::RemoveInvalidVotes(const COutPoint& mnOutpo
     if (it->second.mapInstances.empty()) {
         mapCurrentMNVotes.erase(it);
     }
+    if (governanceDb) {
+        governanceDb->EraseVotes(nParentHash, removedVotes);
+    }
 
     if (!removedVotes.empty()) {
         std::string removedStr;
@@ -594,6 +641,7 @@ bool CGovernanceObject::IsCollateralValid(std::string& strError, bool& fMissingC
 int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const
 {
     LOCK(cs);
+    LoadVotes();
 
     int nCount = 0;
     for (const auto& votepair : mapCurrentMNVotes) {
@@ -638,6 +686,7 @@ int CGovernanceObject::GetAbstainCount(vote_signal_enum_t eVoteSignalIn) const
 bool CGovernanceObject::GetCurrentMNVotes(const COutPoint& mnCollateralOutpoint, vote_rec_t& voteRecord) const
 {
     LOCK(cs);
+    LoadVotes();
 
     vote_m_cit it = mapCurrentMNVotes.find(mnCollateralOutpoint);
     if (it == mapCurrentMNVotes.end()) {
@@ -169,9 +169,14 @@ private:
     /// Failed to parse object data
     bool fUnparsable;
 
-    vote_m_t mapCurrentMNVotes;
+    /// Votes are read from the governance db the first time they are needed (see LoadVotes)
+    mutable bool fVotesLoaded;
 
-    CGovernanceObjectVoteFile fileVotes;
+    mutable vote_m_t mapCurrentMNVotes;
+
+    mutable CGovernanceObjectVoteFile fileVotes;
+
+    void LoadVotes() const;
 
 public:
     CGovernanceObject();
@@ -242,8 +247,15 @@ public:
         fExpired = true;
     }
 
+    bool AreVotesLoaded() const
+    {
+        LOCK(cs);
+        return fVotesLoaded;
+    }
+
     const CGovernanceObjectVoteFile& GetVoteFile() const
     {
+        LoadVotes();
         return fileVotes;
     }
 
@@ -332,6 +344,21 @@ public:
         // AFTER DESERIALIZATION OCCURS, CACHED VARIABLES MUST BE CALCULATED MANUALLY
     }
 
+    // Local state of the object, stored next to it in the governance db
+    template <typename Stream>
+    void SerializeState(Stream& s) const
+    {
+        s << nDeletionTime << fExpired << fCachedFunding << fCachedValid << fCachedDelete << fCachedEndorsed << fDirtyCache;
+    }
+
+    template <typename Stream>
+    void UnserializeState(Stream& s)
+    {
+        s >> nDeletionTime >> fExpired >> fCachedFunding >> fCachedValid >> fCachedDelete >> fCachedEndorsed >> fDirtyCache;
+        // the votes of an object read from the db stay there until they are needed
+        fVotesLoaded = false;
+    }
+
     // FUNCTIONS FOR DEALING WITH DATA STRING
     void LoadData();
     void GetData(UniValue& objResult);
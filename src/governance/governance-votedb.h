@@ -7,6 +7,7 @@
 
 #include <list>
 #include <map>
+#include <set>
 
 #include <governance/governance-vote.h>
 #include <serialize.h>
@@ -19,7 +20,7 @@
  * which older votes a flushed to a disk file.
  *
  * Note: This is a stub implementation that doesn't limit the number of votes held
- * in memory and doesn't flush to disk.
+ * in memory. The votes are persisted by CGovernanceDb as they are added and removed.
  */
 class CGovernanceObjectVoteFile
 {
@@ -49,9 +50,9 @@ public:
     CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other);
 
     /**
-     * Add a vote to the file
+     * Add a vote to the file, returns the hashes of the older votes it replaced
      */
-    void AddVote(const CGovernanceVote& vote);
+    std::set<uint256> AddVote(const CGovernanceVote& vote);
 
     /**
      * Return true if the vote with this hash is currently cached in memory
@@ -70,7 +71,7 @@ public:
 
     std::vector<CGovernanceVote> GetVotes() const;
 
-    void RemoveVotesFromMasternode(const COutPoint& outpointMasternode);
+    std::set<uint256> RemoveVotesFromMasternode(const COutPoint& outpointMasternode);
     std::set<uint256> RemoveInvalidVotes(const COutPoint& outpointMasternode, bool fProposal);
 
     ADD_SERIALIZE_METHODS;
@@ -87,7 +88,7 @@ public:
 
 private:
     // Drop older votes for the same gobject from the same masternode
-    void RemoveOldVotes(const CGovernanceVote& vote);
+    std::set<uint256> RemoveOldVotes(const CGovernanceVote& vote);
 
     void RebuildIndex();
 };
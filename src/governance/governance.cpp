@@ -5,6 +5,7 @@
 #include <governance/governance.h>
 #include <consensus/validation.h>
 #include <governance/governance-classes.h>
+#include <governance/governance-db.h>
 #include <governance/governance-object.h>
 #include <governance/governance-validators.h>
 #include <governance/governance-vote.h>
@@ -21,6 +22,8 @@
 #include <validation.h>
 #include <validationinterface.h>
 
+#include <algorithm>
+
 CGovernanceManager governance;
 
 int nSubmittedFinalBudget;
@@ -69,7 +72,11 @@ bool CGovernanceManager::HaveVoteForHash(const uint256& nHash) const
     LOCK(cs);
 
     CGovernanceObject* pGovobj = nullptr;
-    return cmapVoteToObject.Get(nHash, pGovobj) && pGovobj->GetVoteFile().HasVote(nHash);
+    if (cmapVoteToObject.Get(nHash, pGovobj)) {
+        return pGovobj->GetVoteFile().HasVote(nHash);
+    }
+    // the vote index is a limited cache, older votes may only be in the db
+    return governanceDb && governanceDb->HasVote(nHash);
 }
 
 int CGovernanceManager::GetVoteCount() const
@@ -83,7 +90,15 @@ bool CGovernanceManager::SerializeVoteForHash(const uint256& nHash, CDataStream&
     LOCK(cs);
 
     CGovernanceObject* pGovobj = nullptr;
-    return cmapVoteToObject.Get(nHash, pGovobj) && pGovobj->GetVoteFile().SerializeVoteToStream(nHash, ss);
+    if (cmapVoteToObject.Get(nHash, pGovobj)) {
+        return pGovobj->GetVoteFile().SerializeVoteToStream(nHash, ss);
+    }
+    CGovernanceVote vote;
+    if (!governanceDb || !governanceDb->ReadVote(nHash, vote)) {
+        return false;
+    }
+    ss << vote;
+    return true;
 }
 
 void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)
@@ -275,6 +290,10 @@ void CGovernanceManager::CheckOrphanVotes(CGovernanceObject& govobj, CGovernance
             cmmapOrphanVotes.Erase(nHash, pairVote);
         }
     }
+
+    if (governanceDb) {
+        governanceDb->WriteObjectState(govobj);
+    }
 }
 
 void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman& connman, CNode* pfrom)
@@ -307,6 +326,10 @@ void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman
         return;
     }
 
+    if (governanceDb) {
+        governanceDb->WriteObject(govobj);
+    }
+
     // SHOULD WE ADD THIS OBJECT TO ANY OTHER MANANGERS?
 
     LogPrint(BCLog::GOBJECT, "CGovernanceManager::AddGovernanceObject -- Before trigger block, GetDataAsPlainString = %s, nObjectType = %d\n",
@@ -316,6 +339,9 @@ void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman
         if (!triggerman.AddNewTrigger(nHash)) {
             LogPrint(BCLog::GOBJECT, "CGovernanceManager::AddGovernanceObject -- undo adding invalid trigger object: hash = %s\n", nHash.ToString());
             objpair.first->second.PrepareDeletion(GetAdjustedTime());
+            if (governanceDb) {
+                governanceDb->WriteObjectState(objpair.first->second);
+            }
             return;
         }
     }
@@ -331,7 +357,7 @@ void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman
     // WE MIGHT HAVE PENDING/ORPHAN VOTES FOR THIS OBJECT
 
     CGovernanceException exception;
-    CheckOrphanVotes(govobj, exception, connman);
+    CheckOrphanVotes(objpair.first->second, exception, connman);
 
     // SEND NOTIFICATION TO SCRIPT/ZMQ
     GetMainSignals().NotifyGovernanceObject(govobj);
@@ -422,6 +448,10 @@ void CGovernanceManager::UpdateCachesAndClean()
             }
 
             mapErasedGovernanceObjects.insert(std::make_pair(nHash, nTimeExpired));
+            if (governanceDb) {
+                governanceDb->EraseObject(nHash);
+                governanceDb->WriteErasedObject(nHash, nTimeExpired);
+            }
             mapObjects.erase(it++);
         } else {
             // NOTE: triggers are handled via triggerman
@@ -432,6 +462,9 @@ void CGovernanceManager::UpdateCachesAndClean()
                     pObj->PrepareDeletion(nNow);
                 }
             }
+            if (governanceDb) {
+                governanceDb->WriteObjectState(*pObj);
+            }
             ++it;
         }
     }
@@ -440,6 +473,9 @@ void CGovernanceManager::UpdateCachesAndClean()
     hash_time_m_it s_it = mapErasedGovernanceObjects.begin();
     while (s_it != mapErasedGovernanceObjects.end()) {
         if (s_it->second < nNow) {
+            if (governanceDb) {
+                governanceDb->EraseErasedObject(s_it->first);
+            }
             mapErasedGovernanceObjects.erase(s_it++);
         } else {
             ++s_it;
@@ -567,7 +603,7 @@ bool CGovernanceManager::ConfirmInventoryRequest(const CInv& inv)
         break;
     } 
     case MSG_GOVERNANCE_OBJECT_VOTE: {
-        if (cmapVoteToObject.HasKey(inv.hash)) {
+        if (cmapVoteToObject.HasKey(inv.hash) || (governanceDb && governanceDb->HasVote(inv.hash))) {
             LogPrint(BCLog::GOBJECT, "CGovernanceManager::ConfirmInventoryRequest already have governance vote, returning false\n");
             return false;
         }
@@ -839,6 +875,9 @@ bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote,
     }
 
     bool fOk = govobj.ProcessVote(pfrom, vote, exception, connman) && cmapVoteToObject.Insert(nHashVote, &govobj);
+    if (fOk && governanceDb) {
+        governanceDb->WriteObjectState(govobj);
+    }
     LEAVE_CRITICAL_SECTION(cs);
     return fOk;
 }
@@ -1090,6 +1129,17 @@ void CGovernanceManager::RebuildIndexes()
     cmapVoteToObject.Clear();
     for (auto& objPair : mapObjects) {
         CGovernanceObject& govobj = objPair.second;
+        // don't pull every vote from the db just to index it, the vote hashes are in the keys
+        if (!govobj.AreVotesLoaded()) {
+            if (governanceDb) {
+                std::vector<uint256> vecVoteHashes;
+                governanceDb->ReadObjectVoteHashes(objPair.first, vecVoteHashes);
+                for (const uint256& nVoteHash : vecVoteHashes) {
+                    cmapVoteToObject.Insert(nVoteHash, &govobj);
+                }
+            }
+            continue;
+        }
         std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
         for (size_t i = 0; i < vecVotes.size(); ++i) {
             cmapVoteToObject.Insert(vecVotes[i].GetHash(), &govobj);
@@ -1292,9 +1342,62 @@ void CGovernanceManager::RemoveInvalidVotes()
                 cmmapOrphanVotes.Erase(voteHash);
                 setRequestedVotes.erase(voteHash);
             }
+            if (governanceDb) {
+                governanceDb->WriteObjectState(p.second);
+            }
         }
     }
 
     // store current MN list for the next run so that we can determine which keys changed
     lastMNListForVotingKeys = curMNList;
+    if (governanceDb) {
+        governanceDb->WriteVotingKeysBlock(curMNList.GetBlockHash());
+    }
+}
+
+void CGovernanceManager::LoadFromDb()
+{
+    LOCK2(cs_main, cs);
+
+    Clear();
+    governanceDb->ReadObjects(mapObjects);
+    governanceDb->ReadErasedObjects(mapErasedGovernanceObjects);
+
+    // rebuild the trigger rate buffers in the order the triggers were created
+    std::vector<const CGovernanceObject*> vecTriggers;
+    for (const auto& objpair : mapObjects) {
+        if (objpair.second.GetObjectType() == GOVERNANCE_OBJECT_TRIGGER) {
+            vecTriggers.emplace_back(&objpair.second);
+        }
+    }
+    std::sort(vecTriggers.begin(), vecTriggers.end(), [](const CGovernanceObject* a, const CGovernanceObject* b) {
+        return a->GetCreationTime() < b->GetCreationTime();
+    });
+    for (const auto pObj : vecTriggers) {
+        MasternodeRateUpdate(*pObj);
+    }
+
+    uint256 blockHash;
+    if (governanceDb->ReadVotingKeysBlock(blockHash)) {
+        const CBlockIndex* pindex = LookupBlockIndex(blockHash);
+        if (pindex) {
+            lastMNListForVotingKeys = deterministicMNManager->GetListForBlock(pindex);
+        }
+    }
+}
+
+void CGovernanceManager::WriteToDb() const
+{
+    LOCK(cs);
+
+    for (const auto& objpair : mapObjects) {
+        governanceDb->WriteObject(objpair.second);
+        governanceDb->WriteObjectVotes(objpair.second);
+    }
+    for (const auto& p : mapErasedGovernanceObjects) {
+        governanceDb->WriteErasedObject(p.first, p.second);
+    }
+    if (!lastMNListForVotingKeys.GetBlockHash().IsNull()) {
+        governanceDb->WriteVotingKeysBlock(lastMNListForVotingKeys.GetBlockHash());
+    }
 }
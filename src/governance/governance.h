@@ -397,6 +397,11 @@ public:
 
     void InitOnLoad();
 
+    // Read the objects and erased hashes from the governance db, votes are read per object when needed
+    void LoadFromDb();
+    // Write everything to the governance db, used to import an old governance.dat
+    void WriteToDb() const;
+
     int RequestGovernanceObjectVotes(CNode* pnode, CConnman& connman);
     int RequestGovernanceObjectVotes(const std::vector<CNode*>& vNodesCopy, CConnman& connman);
 
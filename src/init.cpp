@@ -24,6 +24,7 @@
 #include <index/blockfilterindex.h>
 #include <index/txindex.h>
 #include <interfaces/chain.h>
+#include <kernelscanner.h>
 #include <key.h>
 #include <miner.h>
 #include <net.h>
@@ -66,6 +67,7 @@
 #include <masternode/activemasternode.h>
 #include <dsnotificationinterface.h>
 #include "flat-database.h"
+#include <governance/governance-db.h>
 #include <governance/governance.h>
 
 #include <masternode/masternode-meta.h>
@@ -266,10 +268,6 @@ void Shutdown(InitInterfaces& interfaces)
         flatdb4.Dump(netfulfilledman);
         CFlatDB<CSporkManager> flatdb6("sporks.dat", "magicSporkCache");
         flatdb6.Dump(sporkManager);
-        if (!fDisableGovernance) {
-            CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
-            flatdb3.Dump(governance);
-        }
     }
 
     peerLogic.reset();
@@ -324,10 +322,13 @@ void Shutdown(InitInterfaces& interfaces)
         llmq::DestroyLLMQSystem();
         deterministicMNManager.reset();
         evoDb.reset();
+        governanceDb.reset();
     }
     for (const auto& client : interfaces.chain_clients) {
         client->stop();
     }
+    // Stake threads are gone together with the wallets
+    g_kernel_scanner.reset();
 
 #if ENABLE_ZMQ
     if (g_zmq_notification_interface) {
@@ -457,6 +458,8 @@ void SetupServerArgs()
     gArgs.AddArg("-maxorphantx=<n>", strprintf("Keep at most <n> unconnectable transactions in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-mempoolexpiry=<n>", strprintf("Do not keep transactions in the mempool longer than <n> hours (default: %u)", DEFAULT_MEMPOOL_EXPIRY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-mnlistcache=<n>", strprintf("Keep the cache of masternode lists and list diffs below <n> MiB, the lists of the tip and of alive quorums are always kept (default: %u)", DEFAULT_MNLIST_CACHE_SIZE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-mnlistsnapshotinterval=<n>", strprintf("Write a masternode list snapshot to disk every <n> blocks, looking up an old list applies at most that many diffs (default: %u)", DEFAULT_MNLIST_SNAPSHOT_PERIOD), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -466,6 +469,7 @@ void SetupServerArgs()
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >=%u = automatically prune block files to stay under the specified target size in MiB)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex", "Rebuild chain state and block index from the blk*.dat files on disk", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks. When in pruning mode or if blocks on disk might be corrupted, use full -reindex instead.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-smsgsendthreads=<n>", strprintf("Set the number of threads used to process the secure message send queue (up to %d, 0 = auto, <0 = leave that many cores free, default: %d)", MAX_SMSG_SEND_THREADS, DEFAULT_SMSG_SEND_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #ifndef WIN32
     gArgs.AddArg("-sysperms", "Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #else
@@ -496,6 +500,7 @@ void SetupServerArgs()
     gArgs.AddArg("-maxsendbuffer=<n>", strprintf("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXSENDBUFFER), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxtimeadjustment", strprintf("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by peers forward or backward by this amount. (default: %u seconds)", DEFAULT_MAX_TIME_ADJUSTMENT), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxuploadtarget=<n>", strprintf("Tries to keep outbound traffic under the given target (in MiB per 24h), 0 = no limit (default: %d)", DEFAULT_MAX_UPLOAD_TARGET), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-msghandthreads=<n>", strprintf("Number of threads to process peer messages on, peers are split between them (1 to %d, default: %d)", MAX_MSGHAND_THREADS, DEFAULT_MSGHAND_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onion=<ip:port>", "Use separate SOCKS5 proxy to reach peers via Tor hidden services, set -noonion to disable (default: -proxy)", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onlynet=<net>", "Make outgoing connections only through network <net> (ipv4, ipv6 or onion). Incoming connections are not affected by this option. This option can be specified multiple times to allow multiple networks.", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peerbloomfilters", strprintf("Support filtering of blocks and transaction with bloom filters (default: %u)", DEFAULT_PEERBLOOMFILTERS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
@@ -504,6 +509,13 @@ void SetupServerArgs()
     gArgs.AddArg("-proxy=<ip:port>", "Connect through SOCKS5 proxy, set -noproxy to disable (default: disabled)", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-proxyrandomize", strprintf("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)", DEFAULT_PROXYRANDOMIZE), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-seednode=<ip>", "Connect to a node to retrieve peer addresses, and disconnect. This option can be specified multiple times to connect to multiple nodes.", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+#ifdef USE_EPOLL
+    gArgs.AddArg("-socketevents=<mode>", strprintf("Socket events mode, which must be one of 'poll' or 'epoll' (default: %s)", DEFAULT_SOCKETEVENTS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+#elif defined(USE_POLL)
+    gArgs.AddArg("-socketevents=<mode>", strprintf("Socket events mode, which must be 'poll' (default: %s)", DEFAULT_SOCKETEVENTS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+#else
+    gArgs.AddArg("-socketevents=<mode>", strprintf("Socket events mode, which must be 'select' (default: %s)", DEFAULT_SOCKETEVENTS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+#endif
     gArgs.AddArg("-timeout=<n>", strprintf("Specify connection timeout in milliseconds (minimum: 1, default: %d)", DEFAULT_CONNECT_TIMEOUT), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peertimeout=<n>", strprintf("Specify p2p connection timeout in seconds. This option determines the amount of time a peer may be inactive before the connection to it is dropped. (minimum: 1, default: %d)", DEFAULT_PEER_CONNECT_TIMEOUT), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-torcontrol=<ip>:<port>", strprintf("Tor control port to use if onion listening enabled (default: %s)", DEFAULT_TOR_CONTROL), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
@@ -604,6 +616,7 @@ void SetupServerArgs()
     gArgs.AddArg("-staking", "enable stake", ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     gArgs.AddArg("-emergencystaking", "enable emergencystaking", ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     gArgs.AddArg("-stake", "enable stake", ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
+    gArgs.AddArg("-stakingthreads=<n>", strprintf("Set the number of threads used to search stake kernels (up to %d, 0 = auto, <0 = leave that many cores free, default: %d)", MAX_STAKING_THREADS, DEFAULT_STAKING_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     gArgs.AddArg("-assetkey", "signassets", ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
 
     gArgs.AddArg("-litemode", strprintf("Disable all Rain specific functionality (Masternodes, PrivateSend, InstantSend, Governance) (0-1, default: %u)", 0), ArgsManager::ALLOW_ANY, OptionsCategory::MASTERNODE);
@@ -1418,6 +1431,16 @@ bool AppInitMain(InitInterfaces& interfaces)
             threadGroup.create_thread([i]() { return ThreadScriptCheck(i); });
     }
 
+    // -stakingthreads=0 means autodetect, a single thread scans on the staking thread itself
+    int nStakingThreads = gArgs.GetArg("-stakingthreads", DEFAULT_STAKING_THREADS);
+    if (nStakingThreads <= 0)
+        nStakingThreads += GetNumCores();
+    if (nStakingThreads <= 1)
+        nStakingThreads = 0;
+    g_kernel_scanner = MakeUnique<CKernelScanner>();
+    g_kernel_scanner->Start(nStakingThreads);
+    LogPrintf("Using %u threads for stake kernel search\n", std::min(nStakingThreads, MAX_STAKING_THREADS));
+
     std::vector<std::string> vSporkAddresses;
     if (gArgs.IsArgSet("-sporkaddr")) {
         vSporkAddresses = gArgs.GetArgs("-sporkaddr");
@@ -1648,6 +1671,8 @@ bool AppInitMain(InitInterfaces& interfaces)
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
     int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     int64_t nEvoDbCache = 1024 * 1024 * 16; // TODO
+    int nMNListSnapshotPeriod = std::max(1, (int)gArgs.GetArg("-mnlistsnapshotinterval", DEFAULT_MNLIST_SNAPSHOT_PERIOD));
+    int64_t nMNListCache = std::max((int64_t)0, gArgs.GetArg("-mnlistcache", DEFAULT_MNLIST_CACHE_SIZE)) << 20;
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1f MiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
@@ -1659,6 +1684,7 @@ bool AppInitMain(InitInterfaces& interfaces)
     }
     LogPrintf("* Using %.1f MiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1f MiB for in-memory UTXO set (plus up to %.1f MiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1f MiB for masternode list cache\n", nMNListCache * (1.0 / 1024 / 1024));
 
     bool fLoaded = false;
     while (!fLoaded && !ShutdownRequested()) {
@@ -1701,10 +1727,22 @@ bool AppInitMain(InitInterfaces& interfaces)
                 evoDb.reset();
                 evoDb.reset(new CEvoDB(nEvoDbCache, false, fReset || fReindexChainState));
                 deterministicMNManager.reset();
-                deterministicMNManager.reset(new CDeterministicMNManager(*evoDb));
+                deterministicMNManager.reset(new CDeterministicMNManager(*evoDb, nMNListSnapshotPeriod, nMNListCache));
 
                 llmq::InitLLMQSystem(*evoDb, false, fReset || fReindexChainState);
 
+                // Move an address index with asset names in the keys to asset ids
+                if (!pblocktree->UpgradeAddressIndex()) {
+                    strLoadError = _("Error upgrading address index").translated;
+                    break;
+                }
+
+                // The address balance index is newer than the address index, fill it in once
+                if (!pblocktree->BuildAddressBalanceIndex()) {
+                    strLoadError = _("Error building address balance index").translated;
+                    break;
+                }
+
                 if (fReset) {
                     pblocktree->WriteReindexing(true);
                     //If we're reindexing in prune mode, wipe away unusable block files and all undo data files
@@ -1975,16 +2013,23 @@ bool AppInitMain(InitInterfaces& interfaces)
 
     strDBName = "governance.dat";
     uiInterface.InitMessage(_("Loading governance cache...").translated);
-    CFlatDB<CGovernanceManager> flatdb3(strDBName, "magicGovernanceCache");
-    if (fLoadCacheFiles && !fDisableGovernance) {
-        if(!flatdb3.Load(governance)) {
-            return InitError(("Failed to load governance cache from") + (pathDB / strDBName).string());
-        }
-        governance.InitOnLoad();
-    } else {
-        CGovernanceManager governanceTmp;
-        if(!flatdb3.Dump(governanceTmp)) {
-            return InitError(("Failed to clear governance cache at") + (pathDB / strDBName).string());
+    if (!fLiteMode && !fDisableGovernance) {
+        // objects and votes are written to the governance db as they are accepted,
+        // governance.dat is only read once to import it
+        governanceDb.reset(new CGovernanceDb(1 << 20, false, !fLoadCacheFiles));
+        if (fLoadCacheFiles && governanceDb->IsEmpty() && fs::exists(pathDB / strDBName)) {
+            CFlatDB<CGovernanceManager> flatdb3(strDBName, "magicGovernanceCache");
+            if(!flatdb3.Load(governance)) {
+                return InitError(("Failed to load governance cache from") + (pathDB / strDBName).string());
+            }
+            governance.WriteToDb();
+            governance.InitOnLoad();
+            if (!fs::remove(pathDB / strDBName)) {
+                return InitError(("Failed to remove old governance cache at ") + (pathDB / strDBName).string());
+            }
+        } else if (fLoadCacheFiles) {
+            governance.LoadFromDb();
+            governance.InitOnLoad();
         }
     }
 
@@ -2101,6 +2146,7 @@ bool AppInitMain(InitInterfaces& interfaces)
     connOptions.m_max_outbound_block_relay = std::min(MAX_BLOCKS_ONLY_CONNECTIONS, connOptions.nMaxConnections-connOptions.m_max_outbound_full_relay);
     connOptions.nMaxAddnode = MAX_ADDNODE_CONNECTIONS;
     connOptions.nMaxFeeler = 1;
+    connOptions.nMessageHandlerThreads = std::max(1, std::min((int)gArgs.GetArg("-msghandthreads", DEFAULT_MSGHAND_THREADS), MAX_MSGHAND_THREADS));
     connOptions.nBestHeight = chain_active_height;
     connOptions.uiInterface = &uiInterface;
     connOptions.m_banman = g_banman.get();
@@ -2113,6 +2159,22 @@ bool AppInitMain(InitInterfaces& interfaces)
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
     connOptions.m_peer_connect_timeout = peer_connect_timeout;
 
+    std::string strSocketEventsMode = gArgs.GetArg("-socketevents", DEFAULT_SOCKETEVENTS);
+#ifdef USE_POLL
+    if (strSocketEventsMode == "poll") {
+        connOptions.socketEventsMode = CConnman::SOCKETEVENTS_POLL;
+#else
+    if (strSocketEventsMode == "select") {
+        connOptions.socketEventsMode = CConnman::SOCKETEVENTS_SELECT;
+#endif
+#ifdef USE_EPOLL
+    } else if (strSocketEventsMode == "epoll") {
+        connOptions.socketEventsMode = CConnman::SOCKETEVENTS_EPOLL;
+#endif
+    } else {
+        return InitError(strprintf(_("Invalid -socketevents ('%s') specified.").translated, strSocketEventsMode));
+    }
+
     for (const std::string& strBind : gArgs.GetArgs("-bind")) {
         CService addrBind;
         if (!Lookup(strBind.c_str(), addrBind, GetListenPort(), false)) {
@@ -10,6 +10,7 @@
 #include <consensus/tx_verify.h>
 #include <interfaces/handler.h>
 #include <interfaces/wallet.h>
+#include <kernelscanner.h>
 #include <miner.h>
 #include <net.h>
 #include <net_processing.h>
@@ -356,6 +357,13 @@ public:
         // LockImpl to Lock pointer
         return std::move(result);
     }
+    bool findKernel(const CBlockIndex* pindexPrev, unsigned int nBits, const std::vector<std::pair<COutPoint, CStakeCandidate>>& inputs, uint32_t nTimeBegin, uint32_t nTimeEnd, size_t& index, uint32_t& time) override
+    {
+        CKernelScanner serialScanner;
+        CKernelScanner* scanner = g_kernel_scanner ? g_kernel_scanner.get() : &serialScanner;
+        uint256 hashProof;
+        return scanner->Scan(pindexPrev, nBits, inputs, nTimeBegin, nTimeEnd, index, time, hashProof);
+    }
     bool findBlock(const uint256& hash, CBlock* block, int64_t* time, int64_t* time_max) override
     {
         CBlockIndex* index = nullptr;
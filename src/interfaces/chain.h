@@ -15,6 +15,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <ui_interface.h>
@@ -36,6 +37,7 @@ class CWallet;
 class CBlockIndex;
 class CBlockHeader;
 struct CDiskTxPos;
+struct CStakeCandidate;
 class CGovernanceVote;
 class CGovernanceObject;
 class CDeterministicMNList;
@@ -174,6 +176,11 @@ public:
     //! unlocked when the returned interface is freed.
     virtual std::unique_ptr<Lock> lock(bool try_lock = false) = 0;
 
+    //! Search all inputs and all coinstake times in [nTimeBegin, nTimeEnd]
+    //! for a stake kernel on top of pindexPrev. Returns the index of the kernel
+    //! input and its time. Doesn't need the chain lock, the inputs are copies.
+    virtual bool findKernel(const CBlockIndex* pindexPrev, unsigned int nBits, const std::vector<std::pair<COutPoint, CStakeCandidate>>& inputs, uint32_t nTimeBegin, uint32_t nTimeEnd, size_t& index, uint32_t& time) = 0;
+
     //! Return whether node has the block and optionally return block metadata
     //! or contents.
     //!
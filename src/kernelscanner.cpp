@@ -0,0 +1,196 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kernelscanner.h>
+
+#include <arith_uint256.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <crypto/common.h>
+#include <crypto/sha256.h>
+#include <logging.h>
+#include <util/system.h>
+#include <util/time.h>
+
+#include <cstring>
+#include <future>
+
+std::unique_ptr<CKernelScanner> g_kernel_scanner;
+
+namespace {
+
+// Timestamps hashed at once, the 8-way transform is used when available
+const int HASH_WAYS = 8;
+
+struct BatchResult {
+    bool fFound{false};
+    size_t nIndex{0};
+    uint32_t nTime{0};
+    uint256 hashProof;
+    uint64_t nHashes{0};
+};
+
+// Scan the inputs [nBegin, nEnd). Gives up as soon as an input with a lower index has a kernel.
+void ScanBatch(const uint256& nStakeModifier, const arith_uint256& bnTarget, const std::vector<CKernelScanner::Input>& vInputs,
+               size_t nBegin, size_t nEnd, uint32_t nTimeBegin, uint32_t nTimeEnd,
+               std::atomic<size_t>& nFoundIndex, BatchResult& result)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    // nStakeModifier | txPrev.nTime | prevout.hash | prevout.n | nTimeTx
+    unsigned char preimage[76];
+    unsigned char hashes[HASH_WAYS * CSHA256DNonce::OUTPUT_SIZE];
+
+    for (size_t i = nBegin; i < nEnd; i++) {
+        if (nFoundIndex < i)
+            return;
+
+        const COutPoint& prevout = vInputs[i].first;
+        const CStakeCandidate& candidate = vInputs[i].second;
+
+        // Both the txPrev time and the block time have to meet the min age, see CheckKernel()
+        int64_t nTimeFirst = std::max<int64_t>(candidate.nTimeTxPrev, candidate.nBlockTime) + params.nStakeMinAge;
+        nTimeFirst = std::max<int64_t>(nTimeFirst, nTimeBegin);
+        if (nTimeFirst > nTimeEnd)
+            continue;
+
+        // The coin weight only grows with nTimeTx, so the target at the end of the window is the highest one
+        arith_uint256 bnWeightMax = arith_uint256(candidate.nValue) * GetWeight((int64_t)candidate.nTimeTxPrev, (int64_t)nTimeEnd) / COIN / (24 * 60 * 60);
+        arith_uint256 bnTargetMax = bnWeightMax * bnTarget;
+
+        // The SHA256 state after the first 64 bytes is shared by all timestamps, the rest is hashed
+        // for HASH_WAYS timestamps at a time
+        memcpy(preimage, nStakeModifier.begin(), 32);
+        WriteLE32(preimage + 32, candidate.nTimeTxPrev);
+        memcpy(preimage + 36, prevout.hash.begin(), 32);
+        WriteLE32(preimage + 68, prevout.n);
+        WriteLE32(preimage + 72, 0);
+        const CSHA256DNonce hasher(preimage, sizeof(preimage), 72);
+
+        for (int64_t nTimeLast = nTimeEnd; nTimeLast >= nTimeFirst; nTimeLast -= HASH_WAYS) {
+            int64_t nTimeLow = std::max<int64_t>(nTimeFirst, nTimeLast - HASH_WAYS + 1);
+            size_t nCount = nTimeLast - nTimeLow + 1;
+            hasher.Hash(hashes, (uint32_t)nTimeLow, nCount);
+            result.nHashes += nCount;
+
+            // Latest timestamp first
+            for (size_t j = nCount; j-- > 0; ) {
+                uint256 hashProof;
+                memcpy(hashProof.begin(), hashes + j * CSHA256DNonce::OUTPUT_SIZE, CSHA256DNonce::OUTPUT_SIZE);
+
+                arith_uint256 bnHash = UintToArith256(hashProof);
+                if (bnHash > bnTargetMax)
+                    continue;
+
+                int64_t nTime = nTimeLow + j;
+                arith_uint256 bnWeight = arith_uint256(candidate.nValue) * GetWeight((int64_t)candidate.nTimeTxPrev, nTime) / COIN / (24 * 60 * 60);
+                if (bnHash > bnWeight * bnTarget)
+                    continue;
+
+                result.fFound = true;
+                result.nIndex = i;
+                result.nTime = (uint32_t)nTime;
+                result.hashProof = hashProof;
+
+                size_t nPrev = nFoundIndex;
+                while (i < nPrev && !nFoundIndex.compare_exchange_weak(nPrev, i)) {
+                }
+                return;
+            }
+        }
+    }
+}
+
+} // namespace
+
+CKernelScanner::CKernelScanner()
+{
+}
+
+CKernelScanner::~CKernelScanner()
+{
+    Stop();
+}
+
+void CKernelScanner::Start(int nThreads)
+{
+    if (nThreads <= 0) {
+        return;
+    }
+    workerPool.resize(std::min(nThreads, MAX_STAKING_THREADS));
+    RenameThreadPool(workerPool, "rain-stake-scan");
+}
+
+void CKernelScanner::Stop()
+{
+    workerPool.clear_queue();
+    workerPool.stop(true);
+}
+
+bool CKernelScanner::Scan(const CBlockIndex* pindexPrev, unsigned int nBits, const std::vector<Input>& vInputs,
+                          uint32_t nTimeBegin, uint32_t nTimeEnd,
+                          size_t& nIndexRet, uint32_t& nTimeRet, uint256& hashProofRet)
+{
+    if (!pindexPrev || vInputs.empty() || nTimeBegin > nTimeEnd) {
+        return false;
+    }
+
+    int64_t nStart = GetTimeMicros();
+    arith_uint256 bnTarget = arith_uint256().SetCompact(nBits);
+    std::atomic<size_t> nFoundIndex{vInputs.size()};
+
+    size_t nBatches = (vInputs.size() + BATCH_SIZE - 1) / BATCH_SIZE;
+    std::vector<BatchResult> vResults(nBatches);
+
+    if (workerPool.size() == 0 || nBatches == 1) {
+        for (size_t i = 0; i < nBatches; i++) {
+            ScanBatch(pindexPrev->nStakeModifier, bnTarget, vInputs, i * BATCH_SIZE, std::min(vInputs.size(), (i + 1) * BATCH_SIZE),
+                      nTimeBegin, nTimeEnd, nFoundIndex, vResults[i]);
+            if (vResults[i].fFound) {
+                break;
+            }
+        }
+    } else {
+        std::vector<std::future<void>> vFutures;
+        vFutures.reserve(nBatches);
+        for (size_t i = 0; i < nBatches; i++) {
+            vFutures.emplace_back(workerPool.push([&, i](int threadId) {
+                ScanBatch(pindexPrev->nStakeModifier, bnTarget, vInputs, i * BATCH_SIZE, std::min(vInputs.size(), (i + 1) * BATCH_SIZE),
+                          nTimeBegin, nTimeEnd, nFoundIndex, vResults[i]);
+            }));
+        }
+        for (auto& f : vFutures) {
+            f.get();
+        }
+    }
+
+    uint64_t nHashes = 0;
+    bool fFound = false;
+    for (const auto& r : vResults) {
+        nHashes += r.nHashes;
+        if (r.fFound && r.nIndex == nFoundIndex) {
+            nIndexRet = r.nIndex;
+            nTimeRet = r.nTime;
+            hashProofRet = r.hashProof;
+            fFound = true;
+        }
+    }
+
+    nTotalHashes += nHashes;
+    nLastHashes = nHashes;
+    nLastScanMicros = GetTimeMicros() - nStart;
+
+    LogPrint(BCLog::COINSTAKE, "%s: scanned %u inputs x %u timestamps, %u hashes in %.2fms, found=%d\n", __func__,
+             vInputs.size(), nTimeEnd - nTimeBegin + 1, nHashes, nLastScanMicros * 0.001, fFound);
+
+    return fFound;
+}
+
+double CKernelScanner::GetHashesPerSecond() const
+{
+    int64_t nMicros = nLastScanMicros;
+    if (nMicros <= 0) {
+        return 0;
+    }
+    return (double)nLastHashes * 1000000 / nMicros;
+}
@@ -0,0 +1,72 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RAIN_KERNELSCANNER_H
+#define RAIN_KERNELSCANNER_H
+
+#include <pos.h>
+#include <uint256.h>
+
+#include <ctpl.h>
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class CBlockIndex;
+
+static const int DEFAULT_STAKING_THREADS = 0;
+static const int MAX_STAKING_THREADS = 16;
+
+/**
+ * Searches proof-of-stake kernels for many candidate outputs and many coinstake
+ * timestamps at once.
+ *
+ * The kernel hash is SHA256d(nStakeModifier | txPrev.nTime | prevout | nTimeTx). The
+ * first 64 bytes do not depend on nTimeTx, so the SHA256 state after them is computed
+ * once per candidate and only the last block and the outer hash are evaluated for each
+ * timestamp, 8 or 4 timestamps at a time when the multi-way SHA256 transforms are
+ * available (see CSHA256DNonce). A hash above the target for the end of the window (where
+ * the coin weight is highest) is rejected before the exact bnWeight * bnTarget is computed.
+ *
+ * Candidates are split into batches which are scanned in parallel on the worker pool.
+ * With no worker threads the scan runs on the calling thread.
+ */
+class CKernelScanner
+{
+public:
+    typedef std::pair<COutPoint, CStakeCandidate> Input;
+
+private:
+    ctpl::thread_pool workerPool;
+
+    static const size_t BATCH_SIZE = 64;
+
+    std::atomic<uint64_t> nTotalHashes{0};
+    std::atomic<uint64_t> nLastHashes{0};
+    std::atomic<int64_t> nLastScanMicros{0};
+
+public:
+    CKernelScanner();
+    ~CKernelScanner();
+
+    void Start(int nThreads);
+    void Stop();
+
+    // Scan all timestamps in [nTimeBegin, nTimeEnd], latest first, for every input.
+    // On success returns the index of the input with a valid kernel, the coinstake time and the kernel hash.
+    // If multiple inputs have a kernel, the one with the lowest index is returned.
+    bool Scan(const CBlockIndex* pindexPrev, unsigned int nBits, const std::vector<Input>& vInputs,
+              uint32_t nTimeBegin, uint32_t nTimeEnd,
+              size_t& nIndexRet, uint32_t& nTimeRet, uint256& hashProofRet);
+
+    // Kernel hashes per second of the last scan
+    double GetHashesPerSecond() const;
+    uint64_t GetTotalHashes() const { return nTotalHashes; }
+};
+
+extern std::unique_ptr<CKernelScanner> g_kernel_scanner;
+
+#endif // RAIN_KERNELSCANNER_H
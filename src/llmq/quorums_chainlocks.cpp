@@ -8,6 +8,7 @@
 #include <llmq/quorums_utils.h>
 
 #include <chain.h>
+#include <dbwrapper.h>
 #include <masternode/masternode-sync.h>
 #include <net_processing.h>
 #include <scheduler.h>
@@ -22,6 +23,8 @@ namespace llmq
 
 static const std::string CLSIG_REQUESTID_PREFIX = "clsig";
 
+static const std::string DB_TX_FIRST_SEEN = "cl_t";
+
 CChainLocksHandler* chainLocksHandler;
 
 bool CChainLockSig::IsNull() const
@@ -34,7 +37,8 @@ std::string CChainLockSig::ToString() const
     return strprintf("CChainLockSig(nHeight=%d, blockHash=%s)", nHeight, blockHash.ToString());
 }
 
-CChainLocksHandler::CChainLocksHandler()
+CChainLocksHandler::CChainLocksHandler(CDBWrapper& _llmqDb) :
+    db(_llmqDb)
 {
     scheduler = new CScheduler();
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, scheduler);
@@ -328,7 +332,11 @@ void CChainLocksHandler::TransactionAddedToMempool(const CTransactionRef& tx, in
     }
 
     LOCK(cs);
-    txFirstSeenTime.emplace(tx->GetHash(), nAcceptTime);
+    int64_t nFirstSeenTime;
+    if (!GetTxFirstSeenTime(tx->GetHash(), nFirstSeenTime)) {
+        db.Write(std::make_tuple(std::string(DB_TX_FIRST_SEEN), tx->GetHash()), nAcceptTime);
+        txFirstSeenTimeCache.insert(tx->GetHash(), nAcceptTime);
+    }
 }
 
 void CChainLocksHandler::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& vtxConflicted)
@@ -337,86 +345,37 @@ void CChainLocksHandler::BlockConnected(const std::shared_ptr<const CBlock>& pbl
         return;
     }
 
-    // We listen for BlockConnected so that we can collect all TX ids of all included TXs of newly received blocks
-    // We need this information later when we try to sign a new tip, so that we can determine if all included TXs are
-    // safe.
+    // TXs which were never in our mempool are first seen with the block, IsTxSafeForMining needs their age in case the
+    // block gets disconnected again
 
     LOCK(cs);
-
-    auto it = blockTxs.find(pindex->GetBlockHash());
-    if (it == blockTxs.end()) {
-        // we must create this entry even if there are no lockable transactions in the block, so that TrySignChainTip
-        // later knows about this block
-        it = blockTxs.emplace(pindex->GetBlockHash(), std::make_shared<std::unordered_set<uint256, StaticSaltedHasher>>()).first;
-    }
-    auto& txids = *it->second;
-
+    CDBBatch batch(db);
     int64_t curTime = GetAdjustedTime();
-
     for (const auto& tx : pblock->vtx) {
         if (tx->IsCoinBase() || tx->vin.empty()) {
             continue;
         }
-
-        txids.emplace(tx->GetHash());
-        txFirstSeenTime.emplace(tx->GetHash(), curTime);
+        int64_t nFirstSeenTime;
+        if (!GetTxFirstSeenTime(tx->GetHash(), nFirstSeenTime)) {
+            batch.Write(std::make_tuple(std::string(DB_TX_FIRST_SEEN), tx->GetHash()), curTime);
+            txFirstSeenTimeCache.insert(tx->GetHash(), curTime);
+        }
     }
-
+    db.WriteBatch(batch);
 }
 
-void CChainLocksHandler::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected)
+bool CChainLocksHandler::GetTxFirstSeenTime(const uint256& txid, int64_t& ret)
 {
-    LOCK(cs);
-    blockTxs.erase(pindexDisconnected->GetBlockHash());
-}
-
-CChainLocksHandler::BlockTxs::mapped_type CChainLocksHandler::GetBlockTxs(const uint256& blockHash)
-{
-    AssertLockNotHeld(cs);
-    AssertLockNotHeld(cs_main);
-
-    CChainLocksHandler::BlockTxs::mapped_type ret;
+    AssertLockHeld(cs);
 
-    {
-        LOCK(cs);
-        auto it = blockTxs.find(blockHash);
-        if (it != blockTxs.end()) {
-            ret = it->second;
-        }
+    if (txFirstSeenTimeCache.get(txid, ret)) {
+        return true;
     }
-    if (!ret) {
-        // This should only happen when freshly started.
-        // If running for some time, SyncTransaction should have been called before which fills blockTxs.
-        LogPrint(BCLog::CHAINLOCKS, "CChainLocksHandler::%s -- blockTxs for %s not found. Trying ReadBlockFromDisk\n", __func__,
-                 blockHash.ToString());
-
-        uint32_t blockTime;
-        {
-            LOCK(cs_main);
-            auto pindex = mapBlockIndex.at(blockHash);
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
-                return nullptr;
-            }
-
-            ret = std::make_shared<std::unordered_set<uint256, StaticSaltedHasher>>();
-            for (auto& tx : block.vtx) {
-                if (tx->IsCoinBase() || tx->vin.empty()) {
-                    continue;
-                }
-                ret->emplace(tx->GetHash());
-            }
-
-            blockTime = block.nTime;
-        }
-
-        LOCK(cs);
-        blockTxs.emplace(blockHash, ret);
-        for (auto& txid : *ret) {
-            txFirstSeenTime.emplace(txid, blockTime);
-        }
+    if (!db.Read(std::make_tuple(std::string(DB_TX_FIRST_SEEN), txid), ret)) {
+        return false;
     }
-    return ret;
+    txFirstSeenTimeCache.insert(txid, ret);
+    return true;
 }
 
 bool CChainLocksHandler::IsTxSafeForMining(const uint256& txid)
@@ -431,9 +390,9 @@ bool CChainLocksHandler::IsTxSafeForMining(const uint256& txid)
         if (!isSporkActive) {
             return true;
         }
-        auto it = txFirstSeenTime.find(txid);
-        if (it != txFirstSeenTime.end()) {
-            txAge = GetAdjustedTime() - it->second;
+        int64_t nFirstSeenTime;
+        if (GetTxFirstSeenTime(txid, nFirstSeenTime)) {
+            txAge = GetAdjustedTime() - nFirstSeenTime;
         }
     }
 
@@ -648,37 +607,37 @@ void CChainLocksHandler::Cleanup()
         }
     }
 
-    for (auto it = blockTxs.begin(); it != blockTxs.end(); ) {
-        auto pindex = mapBlockIndex.at(it->first);
-        if (InternalHasChainLock(pindex->nHeight, pindex->GetBlockHash())) {
-            for (auto& txid : *it->second) {
-                txFirstSeenTime.erase(txid);
+    CDBBatch batch(db);
+    {
+        auto it = std::unique_ptr<CDBIterator>(db.NewIterator());
+        auto firstKey = std::make_tuple(std::string(DB_TX_FIRST_SEEN), uint256());
+        it->Seek(firstKey);
+        while (it->Valid()) {
+            decltype(firstKey) curKey;
+            if (!it->GetKey(curKey) || std::get<0>(curKey) != DB_TX_FIRST_SEEN) {
+                break;
             }
-            it = blockTxs.erase(it);
-        } else if (InternalHasConflictingChainLock(pindex->nHeight, pindex->GetBlockHash())) {
-            it = blockTxs.erase(it);
-        } else {
-            ++it;
-        }
-    }
-    for (auto it = txFirstSeenTime.begin(); it != txFirstSeenTime.end(); ) {
-        CTransactionRef tx;
-        uint256 hashBlock;
-        if (!GetTransaction(it->first, tx, Params().GetConsensus(), hashBlock)) {
-            // tx has vanished, probably due to conflicts
-            it = txFirstSeenTime.erase(it);
-        } else if (!hashBlock.IsNull()) {
-            auto pindex = mapBlockIndex.at(hashBlock);
-            if (::ChainActive().Tip()->GetAncestor(pindex->nHeight) == pindex && ::ChainActive().Height() - pindex->nHeight >= 6) {
-                // tx got confirmed >= 6 times, so we can stop keeping track of it
-                it = txFirstSeenTime.erase(it);
-            } else {
-                ++it;
+            const uint256& txid = std::get<1>(curKey);
+            CTransactionRef tx;
+            uint256 hashBlock;
+            bool fErase = false;
+            if (!GetTransaction(txid, tx, Params().GetConsensus(), hashBlock)) {
+                // tx has vanished, probably due to conflicts
+                fErase = true;
+            } else if (!hashBlock.IsNull()) {
+                auto pindex = LookupBlockIndex(hashBlock);
+                // tx got ChainLocked or confirmed >= 6 times, so we can stop keeping track of it
+                fErase = pindex && ::ChainActive().Tip()->GetAncestor(pindex->nHeight) == pindex &&
+                         (InternalHasChainLock(pindex->nHeight, hashBlock) || ::ChainActive().Height() - pindex->nHeight >= CLEANUP_DEPTH);
             }
-        } else {
-            ++it;
+            if (fErase) {
+                batch.Erase(curKey);
+                txFirstSeenTimeCache.erase(txid);
+            }
+            it->Next();
         }
     }
+    db.WriteBatch(batch);
 
     lastCleanupTime = GetTimeMillis();
 }
@@ -10,6 +10,7 @@
 
 #include <net.h>
 #include <chainparams.h>
+#include <unordered_lru_cache.h>
 
 #include <atomic>
 #include <unordered_set>
@@ -17,6 +18,7 @@
 #include <boost/thread.hpp>
 
 class CBlockIndex;
+class CDBWrapper;
 class CScheduler;
 
 namespace llmq
@@ -48,11 +50,14 @@ class CChainLocksHandler : public CRecoveredSigsListener
 {
     static const int64_t CLEANUP_INTERVAL = 1000 * 30;
     static const int64_t CLEANUP_SEEN_TIMEOUT = 24 * 60 * 60 * 1000;
+    // TXs this deep below the tip are not needed anymore, even when they never got ChainLocked
+    static const int CLEANUP_DEPTH = 6;
 
     // how long to wait for ixlocks until we consider a block with non-ixlocked TXs to be safe to sign
     static const int64_t WAIT_FOR_ISLOCK_TIMEOUT = 10 * 60;
 
 private:
+    CDBWrapper& db;
     CScheduler* scheduler;
     boost::thread* scheduler_thread;
     RecursiveMutex cs;
@@ -71,17 +76,16 @@ private:
     uint256 lastSignedRequestId;
     uint256 lastSignedMsgHash;
 
-    // We keep track of txids from recently received blocks so that we can check if all TXs got ixlocked
-    typedef std::unordered_map<uint256, std::shared_ptr<std::unordered_set<uint256, StaticSaltedHasher>>> BlockTxs;
-    BlockTxs blockTxs;
-    std::unordered_map<uint256, int64_t> txFirstSeenTime;
+    // The time a TX was first seen is kept in the LLMQ DB, so that IsTxSafeForMining still knows it after a restart.
+    // Only the recently used entries are cached in memory
+    unordered_lru_cache<uint256, int64_t, StaticSaltedHasher, 100000> txFirstSeenTimeCache;
 
     std::map<uint256, int64_t> seenChainLocks;
 
     int64_t lastCleanupTime{0};
 
 public:
-    explicit CChainLocksHandler();
+    explicit CChainLocksHandler(CDBWrapper& _llmqDb);
     ~CChainLocksHandler();
 
     void Start();
@@ -97,7 +101,6 @@ public:
     void UpdatedBlockTip(const CBlockIndex* pindexNew);
     void TransactionAddedToMempool(const CTransactionRef& tx, int64_t nAcceptTime);
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& vtxConflicted);
-    void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected);
     void CheckActiveState();
     void TrySignChainTip();
     void EnforceBestChainLock();
@@ -115,7 +118,8 @@ private:
 
     void DoInvalidateBlock(const CBlockIndex* pindex);
 
-    BlockTxs::mapped_type GetBlockTxs(const uint256& blockHash);
+    // requires cs to be held already
+    bool GetTxFirstSeenTime(const uint256& txid, int64_t& ret);
 
     void Cleanup();
 };
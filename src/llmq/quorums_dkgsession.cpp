@@ -89,6 +89,12 @@ CDKGMember::CDKGMember(CDeterministicMNCPtr _dmn, size_t _idx) :
 
 }
 
+CDKGSession::~CDKGSession()
+{
+    // running verifications reference the session
+    WaitForContributionVerifications();
+}
+
 bool CDKGSession::Init(const CBlockIndex* _pindexQuorum, const std::vector<CDeterministicMNCPtr>& mns, const uint256& _myProTxHash)
 {
     pindexQuorum = _pindexQuorum;
@@ -342,59 +348,107 @@ void CDKGSession::ReceiveMessage(const uint256& hash, const CDKGContribution& qc
 
     logger.Batch("decrypted our contribution share. time=%d", t2.count());
 
-    bool verifyPending = false;
     receivedSkContributions[member->idx] = skContribution;
     pendingContributionVerifications.emplace_back(member->idx);
-    if (pendingContributionVerifications.size() >= 32) {
-        verifyPending = true;
+
+    VerifyPendingContributions(false);
+}
+
+// Starts verification of the pending secret key contributions and handles the results of verifications which are done.
+// When wait is true, this returns only after all contributions received so far are verified.
+// Pending contributions are verified on the worker pool as soon as no other batch is running or enough of them have
+// been collected. Invalid contributions are complained about as soon as their batch is done.
+void CDKGSession::VerifyPendingContributions(bool wait)
+{
+    LOCK(cs_pending);
+
+    if (!pendingContributionVerifications.empty() &&
+        (wait || runningContributionVerifications.empty() || pendingContributionVerifications.size() >= CONTRIBUTION_VERIFICATION_BATCH_SIZE)) {
+        StartContributionVerification();
+    }
+    auto isDone = [&](const std::unique_ptr<ContributionVerification>& verification) {
+        return wait || verification->result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    };
+    if (std::none_of(runningContributionVerifications.begin(), runningContributionVerifications.end(), isDone)) {
+        return;
+    }
+
+    CDKGLogger logger(*this, __func__);
+
+    cxxtimer::Timer t1(true);
+
+    size_t verifiedCount = 0;
+    for (auto it = runningContributionVerifications.begin(); it != runningContributionVerifications.end(); ) {
+        if (!isDone(*it)) {
+            ++it;
+            continue;
+        }
+        FinishContributionVerification(logger, **it);
+        verifiedCount += (*it)->memberIndexes.size();
+        it = runningContributionVerifications.erase(it);
     }
 
-    if (verifyPending) {
-        VerifyPendingContributions();
+    if (verifiedCount != 0) {
+        logger.Batch("verified %d pending contributions. running=%d, time=%d", verifiedCount, runningContributionVerifications.size(), t1.count());
     }
 }
 
-// Verifies all pending secret key contributions in one batch
-// This is done by aggregating the verification vectors belonging to the secret key contributions
+// Verifies a batch of secret key contributions by aggregating the verification vectors belonging to them
 // The resulting aggregated vvec is then used to recover a public key share
 // The public key share must match the public key belonging to the aggregated secret key contributions
 // See CBLSWorker::VerifyContributionShares for more details.
-void CDKGSession::VerifyPendingContributions()
+// A single contribution is verified directly, so that its public key share ends up in the cache.
+void CDKGSession::StartContributionVerification()
 {
     AssertLockHeld(cs_pending);
 
-    CDKGLogger logger(*this, __func__);
-
-    cxxtimer::Timer t1(true);
-
     std::vector<size_t> pend = std::move(pendingContributionVerifications);
-    if (pend.empty()) {
-        return;
-    }
-
-    std::vector<size_t> memberIndexes;
-    std::vector<BLSVerificationVectorPtr> vvecs;
-    BLSSecretKeyVector skContributions;
 
+    auto verification = std::make_unique<ContributionVerification>();
     for (const auto& idx : pend) {
         auto& m = members[idx];
         if (m->bad || m->weComplain) {
             continue;
         }
-        memberIndexes.emplace_back(idx);
-        vvecs.emplace_back(receivedVvecs[idx]);
-        skContributions.emplace_back(receivedSkContributions[idx]);
+        verification->memberIndexes.emplace_back(idx);
+        verification->vvecs.emplace_back(receivedVvecs[idx]);
+        verification->skContributions.emplace_back(receivedSkContributions[idx]);
     }
+    if (verification->memberIndexes.empty()) {
+        return;
+    }
+
+    if (verification->memberIndexes.size() == 1) {
+        auto p = std::make_shared<std::promise<std::vector<bool>>>();
+        verification->result = p->get_future();
+        // the session waits for all running verifications before it is destroyed
+        blsWorker.AsyncRunJob([this, p, idx = verification->memberIndexes[0], vvec = verification->vvecs[0], sk = verification->skContributions[0]]() {
+            p->set_value({VerifyContributionShare(idx, vvec, myId, sk)});
+        });
+    } else {
+        // the worker keeps references to the vectors, which live as long as the verification is in the list
+        verification->result = blsWorker.AsyncVerifyContributionShares(myId, verification->vvecs, verification->skContributions, true, true);
+    }
+    runningContributionVerifications.emplace_back(std::move(verification));
+}
 
-    auto result = blsWorker.VerifyContributionShares(myId, vvecs, skContributions);
-    if (result.size() != memberIndexes.size()) {
-        logger.Batch("VerifyContributionShares returned result of size %d but size %d was expected, something is wrong", result.size(), memberIndexes.size());
+void CDKGSession::FinishContributionVerification(CDKGLogger& logger, ContributionVerification& verification)
+{
+    AssertLockHeld(cs_pending);
+
+    auto result = verification.result.get();
+    if (result.size() != verification.memberIndexes.size()) {
+        logger.Batch("VerifyContributionShares returned result of size %d but size %d was expected, something is wrong", result.size(), verification.memberIndexes.size());
         return;
     }
 
-    for (size_t i = 0; i < memberIndexes.size(); i++) {
+    for (size_t i = 0; i < verification.memberIndexes.size(); i++) {
+        auto& m = members[verification.memberIndexes[i]];
+        if (m->bad) {
+            // marked bad while the verification was running
+            continue;
+        }
         if (!result[i]) {
-            auto& m = members[memberIndexes[i]];
             logger.Batch("invalid contribution from %s. will complain later", m->dmn->proTxHash.ToString());
             m->weComplain = true;
             quorumDKGDebugManager->UpdateLocalMemberStatus(params.type, m->idx, [&](CDKGDebugMemberStatus& status) {
@@ -402,12 +456,41 @@ void CDKGSession::VerifyPendingContributions()
                 return true;
             });
         } else {
-            size_t memberIdx = memberIndexes[i];
-            dkgManager.WriteVerifiedSkContribution(params.type, pindexQuorum, members[memberIdx]->dmn->proTxHash, skContributions[i]);
+            dkgManager.WriteVerifiedSkContribution(params.type, pindexQuorum, m->dmn->proTxHash, verification.skContributions[i]);
         }
     }
+}
+
+// Waits for the verifications which are still running on the worker pool, without handling their results
+void CDKGSession::WaitForContributionVerifications()
+{
+    LOCK(cs_pending);
+    for (auto& verification : runningContributionVerifications) {
+        verification->result.wait();
+    }
+    runningContributionVerifications.clear();
+}
+
+// The vvec of the contributor was already verified when its contribution was received, so only the public key share
+// has to be built. It only depends on the vvec and the id, so it is cached for the rest of the session and reused in
+// later phases, e.g. when the contributor sends a justification for a share we complained about.
+bool CDKGSession::VerifyContributionShare(size_t contributorIdx, const BLSVerificationVectorPtr& vvec, const CBLSId& forId, const CBLSSecretKey& skContribution)
+{
+    if (!vvec || !forId.IsValid()) {
+        return false;
+    }
+    CBLSPublicKey pkShare = cache.BuildPubKeyShare(::SerializeHash(std::make_tuple(std::string("contrib"), contributorIdx, forId)), vvec, forId);
+    return pkShare.IsValid() && pkShare == skContribution.GetPublicKey();
+}
 
-    logger.Batch("verified %d pending contributions. time=%d", pend.size(), t1.count());
+std::future<bool> CDKGSession::AsyncVerifyContributionShare(size_t contributorIdx, const CBLSId& forId, const CBLSSecretKey& skContribution)
+{
+    auto p = std::make_shared<std::promise<bool>>();
+    auto f = p->get_future();
+    blsWorker.AsyncRunJob([this, p, contributorIdx, vvec = receivedVvecs[contributorIdx], forId, skContribution]() {
+        p->set_value(VerifyContributionShare(contributorIdx, vvec, forId, skContribution));
+    });
+    return f;
 }
 
 void CDKGSession::VerifyAndComplain(CDKGPendingMessages& pendingMessages)
@@ -416,10 +499,8 @@ void CDKGSession::VerifyAndComplain(CDKGPendingMessages& pendingMessages)
         return;
     }
 
-    {
-        LOCK(cs_pending);
-        VerifyPendingContributions();
-    }
+    // most contributions were already verified while they were received, only wait for the last ones
+    VerifyPendingContributions(true);
 
     CDKGLogger logger(*this, __func__);
 
@@ -852,8 +933,7 @@ void CDKGSession::ReceiveMessage(const uint256& hash, const CDKGJustification& q
         auto& member2 = members[p.first];
         auto& skContribution = p.second;
 
-        // watch out to not bail out before these async calls finish (they rely on valid references)
-        futures.emplace_back(blsWorker.AsyncVerifyContributionShare(member2->id, receivedVvecs[member->idx], skContribution));
+        futures.emplace_back(AsyncVerifyContributionShare(member->idx, member2->id, skContribution));
     }
     auto resultIt = futures.begin();
     for (const auto& p : qj.contributions) {
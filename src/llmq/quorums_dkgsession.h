@@ -16,6 +16,9 @@
 
 #include <llmq/quorums_utils.h>
 
+#include <future>
+#include <list>
+
 class UniValue;
 
 namespace llmq
@@ -277,8 +280,22 @@ private:
     std::map<uint256, CDKGJustification> justifications;
     std::map<uint256, CDKGPrematureCommitment> prematureCommitments;
 
+    // a new batch is started before the running ones are done when this many contributions are pending
+    static const size_t CONTRIBUTION_VERIFICATION_BATCH_SIZE = 8;
+
+    // a batch of secret key contributions which is being verified on the worker pool
+    struct ContributionVerification {
+        std::vector<size_t> memberIndexes;
+        std::vector<BLSVerificationVectorPtr> vvecs;
+        BLSSecretKeyVector skContributions;
+        std::future<std::vector<bool>> result;
+    };
+
+    // verification of received contributions is started right away, new contributions which arrive while a batch is
+    // still running are collected in pendingContributionVerifications and verified together in the next batch
     mutable RecursiveMutex cs_pending;
     std::vector<size_t> pendingContributionVerifications;
+    std::list<std::unique_ptr<ContributionVerification>> runningContributionVerifications;
 
     // filled by ReceivePrematureCommitment and used by FinalizeCommitments
     std::set<uint256> validCommitments;
@@ -286,6 +303,7 @@ private:
 public:
     CDKGSession(const Consensus::LLMQParams& _params, CBLSWorker& _blsWorker, CDKGSessionManager& _dkgManager) :
         params(_params), blsWorker(_blsWorker), cache(_blsWorker), dkgManager(_dkgManager) {}
+    ~CDKGSession();
 
     bool Init(const CBlockIndex* pindexQuorum, const std::vector<CDeterministicMNCPtr>& mns, const uint256& _myProTxHash);
 
@@ -309,7 +327,8 @@ public:
     void SendContributions(CDKGPendingMessages& pendingMessages);
     bool PreVerifyMessage(const uint256& hash, const CDKGContribution& qc, bool& retBan) const;
     void ReceiveMessage(const uint256& hash, const CDKGContribution& qc, bool& retBan);
-    void VerifyPendingContributions();
+    void VerifyPendingContributions(bool wait);
+    void WaitForContributionVerifications();
 
     // Phase 2: complaint
     void VerifyAndComplain(CDKGPendingMessages& pendingMessages);
@@ -338,6 +357,12 @@ public:
 
     void RelayInvToParticipants(const CInv& inv) const;
 
+private:
+    void StartContributionVerification();
+    void FinishContributionVerification(CDKGLogger& logger, ContributionVerification& verification);
+    bool VerifyContributionShare(size_t contributorIdx, const BLSVerificationVectorPtr& vvec, const CBLSId& forId, const CBLSSecretKey& skContribution);
+    std::future<bool> AsyncVerifyContributionShare(size_t contributorIdx, const CBLSId& forId, const CBLSSecretKey& skContribution);
+
 public:
     CDKGMember* GetMember(const uint256& proTxHash) const;
 };
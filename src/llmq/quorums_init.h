@@ -5,12 +5,16 @@
 #ifndef RAIN_QUORUMS_INIT_H
 #define RAIN_QUORUMS_INIT_H
 
+class CBLSWorker;
 class CDBWrapper;
 class CEvoDB;
 
 namespace llmq
 {
 
+// Shared BLS worker pool, also used to verify large batches of signatures in parallel
+extern CBLSWorker* blsWorker;
+
 // If true, we will connect to all new quorums and watch their communication
 static const bool DEFAULT_WATCH_QUORUMS = false;
 
@@ -2,6 +2,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <llmq/quorums_init.h>
 #include <llmq/quorums_signing.h>
 #include <llmq/quorums_utils.h>
 #include <llmq/quorums_signing_shares.h>
@@ -24,6 +25,25 @@ namespace llmq
 
 CSigningManager* quorumSigningManager;
 
+static const std::string DB_BUCKET = "rs_b";
+
+// The entries of a bucket, keyed by ("rs_b", bucket, kind, key)
+static const uint8_t RS_ID = 'i';       // llmqType+id -> recovered sig
+static const uint8_t RS_MSG = 'm';      // llmqType+id+msgHash -> 1
+static const uint8_t RS_HASH = 'h';     // recovered sig hash -> llmqType+id
+static const uint8_t RS_SESSION = 's';  // signHash -> 1
+static const uint8_t RS_VOTE = 'v';     // llmqType+id -> msgHash
+
+static uint256 BuildIdKey(uint8_t kind, Consensus::LLMQType llmqType, const uint256& id)
+{
+    return ::SerializeHash(std::make_tuple(kind, llmqType, id));
+}
+
+static uint256 BuildMsgKey(Consensus::LLMQType llmqType, const uint256& id, const uint256& msgHash)
+{
+    return ::SerializeHash(std::make_tuple(RS_MSG, llmqType, id, msgHash));
+}
+
 UniValue CRecoveredSig::ToJson() const
 {
     UniValue ret(UniValue::VOBJ);
@@ -39,17 +59,20 @@ UniValue CRecoveredSig::ToJson() const
 CRecoveredSigsDb::CRecoveredSigsDb(CDBWrapper& _db) :
     db(_db)
 {
-    if (Params().NetworkIDString() == CBaseChainParams::TESTNET) {
-        // TODO this can be completely removed after some time (when we're pretty sure the conversion has been run on most testnet MNs)
-        if (db.Exists(std::string("rs_upgraded"))) {
-            return;
-        }
-
+    // TODO this can be completely removed after some time (when we're pretty sure the conversion has been run on most testnet MNs)
+    if (Params().NetworkIDString() == CBaseChainParams::TESTNET && !db.Exists(std::string("rs_upgraded"))) {
         ConvertInvalidTimeKeys();
         AddVoteTimeKeys();
 
         db.Write(std::string("rs_upgraded"), (uint8_t)1);
     }
+
+    if (!db.Exists(std::string("rs_bucketed"))) {
+        ConvertToBuckets();
+        db.Write(std::string("rs_bucketed"), (uint8_t)1);
+    }
+
+    LoadFilters();
 }
 
 // This converts time values in "rs_t" from host endiannes to big endiannes, which is required to have proper ordering of the keys
@@ -125,320 +148,451 @@ void CRecoveredSigsDb::AddVoteTimeKeys()
     LogPrintf("CRecoveredSigsDb::%s -- added %d rs_vt entries\n", __func__, cnt);
 }
 
-bool CRecoveredSigsDb::HasRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, const uint256& msgHash)
+// Moves recovered sigs and votes from the old layout ("rs_r", "rs_h", "rs_s", "rs_t", "rs_v" and "rs_vt" keys) into
+// time buckets. The time keys tell into which bucket an entry goes.
+void CRecoveredSigsDb::ConvertToBuckets()
 {
-    auto k = std::make_tuple(std::string("rs_r"), llmqType, id, msgHash);
-    return db.Exists(k);
-}
+    LogPrintf("CRecoveredSigsDb::%s -- moving recovered sigs and votes into time buckets\n", __func__);
+
+    CDBBatch batch(db);
+    size_t cnt = 0;
+
+    auto flushBatch = [&](bool force) {
+        if (force || batch.SizeEstimate() >= (1 << 24)) {
+            db.WriteBatch(batch);
+            batch.Clear();
+        }
+    };
 
-bool CRecoveredSigsDb::HasRecoveredSigForId(Consensus::LLMQType llmqType, const uint256& id)
-{
-    auto cacheKey = std::make_pair(llmqType, id);
-    bool ret;
     {
-        LOCK(cs);
-        if (hasSigForIdCache.get(cacheKey, ret)) {
-            return ret;
+        std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+        auto start = std::make_tuple(std::string("rs_t"), (uint32_t)0, (Consensus::LLMQType)0, uint256());
+        pcursor->Seek(start);
+        while (pcursor->Valid()) {
+            decltype(start) k;
+            if (!pcursor->GetKey(k) || std::get<0>(k) != "rs_t") {
+                break;
+            }
+
+            CDataStream ds(SER_DISK, CLIENT_VERSION);
+            if (db.ReadDataStream(std::make_tuple(std::string("rs_r"), std::get<2>(k), std::get<3>(k)), ds)) {
+                try {
+                    CRecoveredSig recSig;
+                    recSig.Unserialize(ds);
+                    WriteRecoveredSig(batch, recSig, GetBucket(be32toh(std::get<1>(k))));
+                    cnt++;
+                } catch (std::exception&) {
+                }
+            }
+            flushBatch(false);
+
+            pcursor->Next();
+        }
+    }
+
+    {
+        // truncated recovered sigs only left their hash key behind, which must survive so that AlreadyHave keeps
+        // returning true. Their time is unknown, so they go into the current bucket
+        uint32_t curBucket = GetBucket(GetAdjustedTime());
+        std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+        auto start = std::make_tuple(std::string("rs_h"), uint256());
+        pcursor->Seek(start);
+        while (pcursor->Valid()) {
+            decltype(start) k;
+            std::pair<Consensus::LLMQType, uint256> v;
+            if (!pcursor->GetKey(k) || std::get<0>(k) != "rs_h") {
+                break;
+            }
+            if (pcursor->GetValue(v) && !db.Exists(std::make_tuple(std::string("rs_r"), v.first, v.second))) {
+                batch.Write(std::make_tuple(DB_BUCKET, (uint32_t)htobe32(curBucket), RS_HASH, std::get<1>(k)), v);
+            }
+            flushBatch(false);
+
+            pcursor->Next();
         }
     }
 
+    {
+        std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+        auto start = std::make_tuple(std::string("rs_vt"), (uint32_t)0, (Consensus::LLMQType)0, uint256());
+        pcursor->Seek(start);
+        while (pcursor->Valid()) {
+            decltype(start) k;
+            if (!pcursor->GetKey(k) || std::get<0>(k) != "rs_vt") {
+                break;
+            }
 
-    auto k = std::make_tuple(std::string("rs_r"), llmqType, id);
-    ret = db.Exists(k);
+            uint256 msgHash;
+            if (db.Read(std::make_tuple(std::string("rs_v"), std::get<2>(k), std::get<3>(k)), msgHash)) {
+                auto key = BuildIdKey(RS_VOTE, std::get<2>(k), std::get<3>(k));
+                batch.Write(std::make_tuple(DB_BUCKET, (uint32_t)htobe32(GetBucket(be32toh(std::get<1>(k)))), RS_VOTE, key), msgHash);
+            }
+            flushBatch(false);
 
-    LOCK(cs);
-    hasSigForIdCache.insert(cacheKey, ret);
-    return ret;
+            pcursor->Next();
+        }
+    }
+    flushBatch(true);
+
+    // now drop everything in the old layout
+    for (const char* prefix : {"rs_r", "rs_h", "rs_s", "rs_t", "rs_v", "rs_vt"}) {
+        std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+        pcursor->Seek(std::make_tuple(std::string(prefix)));
+        while (pcursor->Valid()) {
+            std::tuple<std::string> k;
+            if (!pcursor->GetKey(k) || std::get<0>(k) != prefix) {
+                break;
+            }
+            batch.Erase(pcursor->GetKey());
+            flushBatch(false);
+
+            pcursor->Next();
+        }
+    }
+    flushBatch(true);
+
+    LogPrintf("CRecoveredSigsDb::%s -- moved %d recovered sigs\n", __func__, cnt);
 }
 
-bool CRecoveredSigsDb::HasRecoveredSigForSession(const uint256& signHash)
+uint32_t CRecoveredSigsDb::GetBucket(int64_t time)
 {
-    bool ret;
-    {
-        LOCK(cs);
-        if (hasSigForSessionCache.get(signHash, ret)) {
-            return ret;
+    return (uint32_t)(time / BUCKET_TIME);
+}
+
+CRecoveredSigsDb::Filter CRecoveredSigsDb::BuildFilter(const std::vector<uint256>& keys, size_t capacity)
+{
+    while (true) {
+        Filter filter(capacity);
+        for (const auto& key : keys) {
+            filter.insert(key);
+        }
+        if (!filter.full()) {
+            return filter;
         }
+        capacity *= 2;
     }
+}
 
-    auto k = std::make_tuple(std::string("rs_s"), signHash);
-    ret = db.Exists(k);
+void CRecoveredSigsDb::LoadFilters()
+{
+    std::map<uint32_t, std::vector<uint256>> bucketKeys;
+
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    auto start = std::make_tuple(DB_BUCKET, (uint32_t)0, (uint8_t)0, uint256());
+    pcursor->Seek(start);
+    while (pcursor->Valid()) {
+        decltype(start) k;
+        if (!pcursor->GetKey(k) || std::get<0>(k) != DB_BUCKET) {
+            break;
+        }
+        bucketKeys[be32toh(std::get<1>(k))].emplace_back(std::get<3>(k));
+        pcursor->Next();
+    }
+    pcursor.reset();
 
     LOCK(cs);
-    hasSigForSessionCache.insert(signHash, ret);
-    return ret;
+    size_t cnt = 0;
+    for (const auto& p : bucketKeys) {
+        size_t capacity = MIN_FILTER_CAPACITY;
+        bucketFilters.emplace(p.first, BuildFilter(p.second, std::max(capacity, p.second.size() * 5 / 4)));
+        cnt += p.second.size();
+    }
+
+    LogPrintf("CRecoveredSigsDb::%s -- loaded %d entries in %d buckets\n", __func__, cnt, bucketKeys.size());
 }
 
-bool CRecoveredSigsDb::HasRecoveredSigForHash(const uint256& hash)
+void CRecoveredSigsDb::AddToFilter(uint32_t bucket, const std::vector<uint256>& keys)
 {
-    bool ret;
-    {
-        LOCK(cs);
-        if (hasSigForHashCache.get(hash, ret)) {
-            return ret;
+    AssertLockHeld(cs);
+
+    auto it = bucketFilters.find(bucket);
+    if (it == bucketFilters.end()) {
+        // start with room for twice as many entries as the newest bucket has, this is usually enough to never grow
+        size_t capacity = MIN_FILTER_CAPACITY;
+        if (!bucketFilters.empty()) {
+            capacity = std::max(capacity, bucketFilters.rbegin()->second.size() * 2);
         }
+        it = bucketFilters.emplace(bucket, Filter(capacity)).first;
     }
 
-    auto k = std::make_tuple(std::string("rs_h"), hash);
-    ret = db.Exists(k);
+    for (const auto& key : keys) {
+        if (!it->second.insert(key)) {
+            // the keys are not written yet, so the rebuild has to add them on top of the ones in the DB
+            RebuildFilter(bucket, keys);
+            return;
+        }
+    }
+}
+
+void CRecoveredSigsDb::RebuildFilter(uint32_t bucket, const std::vector<uint256>& pendingKeys)
+{
+    AssertLockHeld(cs);
+
+    std::vector<uint256> keys(pendingKeys);
+
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    auto start = std::make_tuple(DB_BUCKET, (uint32_t)htobe32(bucket), (uint8_t)0, uint256());
+    pcursor->Seek(start);
+    while (pcursor->Valid()) {
+        decltype(start) k;
+        if (!pcursor->GetKey(k) || std::get<0>(k) != DB_BUCKET || std::get<1>(k) != std::get<1>(start)) {
+            break;
+        }
+        keys.emplace_back(std::get<3>(k));
+        pcursor->Next();
+    }
+    pcursor.reset();
+
+    auto it = bucketFilters.find(bucket);
+    size_t capacity = it != bucketFilters.end() ? it->second.capacity() * 2 : MIN_FILTER_CAPACITY;
+    if (it != bucketFilters.end()) {
+        bucketFilters.erase(it);
+    }
+    bucketFilters.emplace(bucket, BuildFilter(keys, capacity));
+
+    LogPrint(BCLog::LLMQ, "CRecoveredSigsDb::%s -- rebuilt filter for bucket %d with %d entries\n", __func__, bucket, keys.size());
+}
+
+// Returns the buckets which might have the key, newest first
+std::vector<uint32_t> CRecoveredSigsDb::FindBuckets(const uint256& key)
+{
+    std::vector<uint32_t> ret;
 
     LOCK(cs);
-    hasSigForHashCache.insert(hash, ret);
+    for (auto it = bucketFilters.rbegin(); it != bucketFilters.rend(); ++it) {
+        if (it->second.contains(key)) {
+            ret.emplace_back(it->first);
+        }
+    }
     return ret;
 }
 
-bool CRecoveredSigsDb::ReadRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, CRecoveredSig& ret)
+bool CRecoveredSigsDb::HasBucketEntry(uint8_t kind, const uint256& key)
 {
-    auto k = std::make_tuple(std::string("rs_r"), llmqType, id);
+    for (uint32_t bucket : FindBuckets(key)) {
+        if (db.Exists(std::make_tuple(DB_BUCKET, (uint32_t)htobe32(bucket), kind, key))) {
+            return true;
+        }
+    }
+    return false;
+}
 
-    CDataStream ds(SER_DISK, CLIENT_VERSION);
-    if (!db.ReadDataStream(k, ds)) {
-        return false;
+template<typename V>
+bool CRecoveredSigsDb::ReadBucketEntry(uint8_t kind, const uint256& key, V& value)
+{
+    for (uint32_t bucket : FindBuckets(key)) {
+        if (db.Read(std::make_tuple(DB_BUCKET, (uint32_t)htobe32(bucket), kind, key), value)) {
+            return true;
+        }
     }
+    return false;
+}
 
-    try {
-        ret.Unserialize(ds);
-        return true;
-    } catch (std::exception&) {
-        return false;
+bool CRecoveredSigsDb::HasRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, const uint256& msgHash)
+{
+    return HasBucketEntry(RS_MSG, BuildMsgKey(llmqType, id, msgHash));
+}
+
+bool CRecoveredSigsDb::HasRecoveredSigForId(Consensus::LLMQType llmqType, const uint256& id)
+{
+    return HasBucketEntry(RS_ID, BuildIdKey(RS_ID, llmqType, id));
+}
+
+bool CRecoveredSigsDb::HasRecoveredSigForSession(const uint256& signHash)
+{
+    return HasBucketEntry(RS_SESSION, signHash);
+}
+
+bool CRecoveredSigsDb::HasRecoveredSigForHash(const uint256& hash)
+{
+    return HasBucketEntry(RS_HASH, hash);
+}
+
+bool CRecoveredSigsDb::ReadRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, CRecoveredSig& ret, uint32_t& bucketRet)
+{
+    auto key = BuildIdKey(RS_ID, llmqType, id);
+
+    for (uint32_t bucket : FindBuckets(key)) {
+        CDataStream ds(SER_DISK, CLIENT_VERSION);
+        if (!db.ReadDataStream(std::make_tuple(DB_BUCKET, (uint32_t)htobe32(bucket), RS_ID, key), ds)) {
+            continue;
+        }
+
+        try {
+            ret.Unserialize(ds);
+            bucketRet = bucket;
+            return true;
+        } catch (std::exception&) {
+            return false;
+        }
     }
+    return false;
 }
 
 bool CRecoveredSigsDb::GetRecoveredSigByHash(const uint256& hash, CRecoveredSig& ret)
 {
-    auto k1 = std::make_tuple(std::string("rs_h"), hash);
-    std::pair<Consensus::LLMQType, uint256> k2;
-    if (!db.Read(k1, k2)) {
+    std::pair<Consensus::LLMQType, uint256> k;
+    if (!ReadBucketEntry(RS_HASH, hash, k)) {
         return false;
     }
 
-    return ReadRecoveredSig(k2.first, k2.second, ret);
+    uint32_t bucket;
+    return ReadRecoveredSig(k.first, k.second, ret, bucket);
 }
 
 bool CRecoveredSigsDb::GetRecoveredSigById(Consensus::LLMQType llmqType, const uint256& id, CRecoveredSig& ret)
 {
-    return ReadRecoveredSig(llmqType, id, ret);
+    uint32_t bucket;
+    return ReadRecoveredSig(llmqType, id, ret, bucket);
 }
 
-void CRecoveredSigsDb::WriteRecoveredSig(const llmq::CRecoveredSig& recSig)
+void CRecoveredSigsDb::WriteRecoveredSig(CDBBatch& batch, const CRecoveredSig& recSig, uint32_t bucket)
 {
-    CDBBatch batch(db);
-
-    uint32_t curTime = GetAdjustedTime();
-
-    // we put these close to each other to leverage leveldb's key compaction
-    // this way, the second key can be used for fast HasRecoveredSig checks while the first key stores the recSig
-    auto k1 = std::make_tuple(std::string("rs_r"), recSig.llmqType, recSig.id);
-    auto k2 = std::make_tuple(std::string("rs_r"), recSig.llmqType, recSig.id, recSig.msgHash);
-    batch.Write(k1, recSig);
-    // this key is also used to store the current time, so that we can easily get to the "rs_t" key when we have the id
-    batch.Write(k2, curTime);
-
-    // store by object hash
-    auto k3 = std::make_tuple(std::string("rs_h"), recSig.GetHash());
-    batch.Write(k3, std::make_pair(recSig.llmqType, recSig.id));
+    // all keys of a recovered sig go into the same bucket, so that they expire together
+    auto bucketBE = (uint32_t)htobe32(bucket);
+    batch.Write(std::make_tuple(DB_BUCKET, bucketBE, RS_ID, BuildIdKey(RS_ID, recSig.llmqType, recSig.id)), recSig);
+    batch.Write(std::make_tuple(DB_BUCKET, bucketBE, RS_MSG, BuildMsgKey(recSig.llmqType, recSig.id, recSig.msgHash)), (uint8_t)1);
+    batch.Write(std::make_tuple(DB_BUCKET, bucketBE, RS_HASH, recSig.GetHash()), std::make_pair(recSig.llmqType, recSig.id));
+    batch.Write(std::make_tuple(DB_BUCKET, bucketBE, RS_SESSION, CLLMQUtils::BuildSignHash(recSig)), (uint8_t)1);
+}
 
-    // store by signHash
-    auto signHash = CLLMQUtils::BuildSignHash(recSig);
-    auto k4 = std::make_tuple(std::string("rs_s"), signHash);
-    batch.Write(k4, (uint8_t)1);
+void CRecoveredSigsDb::WriteRecoveredSig(const llmq::CRecoveredSig& recSig)
+{
+    uint32_t bucket = GetBucket(GetAdjustedTime());
 
-    // store by current time. Allows fast cleanup of old recSigs
-    auto k5 = std::make_tuple(std::string("rs_t"), (uint32_t)htobe32(curTime), recSig.llmqType, recSig.id);
-    batch.Write(k5, (uint8_t)1);
+    CDBBatch batch(db);
+    WriteRecoveredSig(batch, recSig, bucket);
 
+    // the filter must know the keys before they are in the DB, otherwise a concurrent lookup could miss a sig that
+    // was already written. cs is held until the write is done, so a filter rebuild can't miss them either
+    LOCK(cs);
+    AddToFilter(bucket, {
+        BuildIdKey(RS_ID, recSig.llmqType, recSig.id),
+        BuildMsgKey(recSig.llmqType, recSig.id, recSig.msgHash),
+        recSig.GetHash(),
+        CLLMQUtils::BuildSignHash(recSig),
+    });
     db.WriteBatch(batch);
-
-    {
-        int64_t t = GetTimeMillis();
-
-        LOCK(cs);
-        hasSigForIdCache.insert(std::make_pair((Consensus::LLMQType)recSig.llmqType, recSig.id), true);
-        hasSigForSessionCache.insert(signHash, true);
-        hasSigForHashCache.insert(recSig.GetHash(), true);
-    }
 }
 
-void CRecoveredSigsDb::RemoveRecoveredSig(CDBBatch& batch, Consensus::LLMQType llmqType, const uint256& id, bool deleteHashKey, bool deleteTimeKey)
+void CRecoveredSigsDb::RemoveRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, bool deleteHashKey)
 {
-    AssertLockHeld(cs);
+    // cs is held for the whole time so that the keys are not erased from the filter twice
+    LOCK(cs);
 
     CRecoveredSig recSig;
-    if (!ReadRecoveredSig(llmqType, id, recSig)) {
+    uint32_t bucket;
+    if (!ReadRecoveredSig(llmqType, id, recSig, bucket)) {
         return;
     }
 
-    auto signHash = CLLMQUtils::BuildSignHash(recSig);
-
-    auto k1 = std::make_tuple(std::string("rs_r"), recSig.llmqType, recSig.id);
-    auto k2 = std::make_tuple(std::string("rs_r"), recSig.llmqType, recSig.id, recSig.msgHash);
-    auto k3 = std::make_tuple(std::string("rs_h"), recSig.GetHash());
-    auto k4 = std::make_tuple(std::string("rs_s"), signHash);
-    batch.Erase(k1);
-    batch.Erase(k2);
+    std::vector<std::pair<uint8_t, uint256>> keys = {
+        {RS_ID, BuildIdKey(RS_ID, recSig.llmqType, recSig.id)},
+        {RS_MSG, BuildMsgKey(recSig.llmqType, recSig.id, recSig.msgHash)},
+        {RS_SESSION, CLLMQUtils::BuildSignHash(recSig)},
+    };
     if (deleteHashKey) {
-        batch.Erase(k3);
+        keys.emplace_back(RS_HASH, recSig.GetHash());
     }
-    batch.Erase(k4);
 
-    if (deleteTimeKey) {
-        CDataStream writeTimeDs(SER_DISK, CLIENT_VERSION);
-        // TODO remove the size() == sizeof(uint32_t) in a future version (when we stop supporting upgrades from < 0.14.1)
-        if (db.ReadDataStream(k2, writeTimeDs) && writeTimeDs.size() == sizeof(uint32_t)) {
-            uint32_t writeTime;
-            writeTimeDs >> writeTime;
-            auto k5 = std::make_tuple(std::string("rs_t"), (uint32_t) htobe32(writeTime), recSig.llmqType, recSig.id);
-            batch.Erase(k5);
-        }
+    CDBBatch batch(db);
+    for (const auto& p : keys) {
+        batch.Erase(std::make_tuple(DB_BUCKET, (uint32_t)htobe32(bucket), p.first, p.second));
     }
+    db.WriteBatch(batch);
 
-    hasSigForIdCache.erase(std::make_pair((Consensus::LLMQType)recSig.llmqType, recSig.id));
-    hasSigForSessionCache.erase(signHash);
-    if (deleteHashKey) {
-        hasSigForHashCache.erase(recSig.GetHash());
+    auto it = bucketFilters.find(bucket);
+    if (it != bucketFilters.end()) {
+        for (const auto& p : keys) {
+            it->second.erase(p.second);
+        }
     }
 }
 
 // Completely remove any traces of the recovered sig
 void CRecoveredSigsDb::RemoveRecoveredSig(Consensus::LLMQType llmqType, const uint256& id)
 {
-    LOCK(cs);
-    CDBBatch batch(db);
-    RemoveRecoveredSig(batch, llmqType, id, true, true);
-    db.WriteBatch(batch);
+    RemoveRecoveredSig(llmqType, id, true);
 }
 
 // Remove the recovered sig itself and all keys required to get from id -> recSig
 // This will leave the byHash key in-place so that HasRecoveredSigForHash still returns true
 void CRecoveredSigsDb::TruncateRecoveredSig(Consensus::LLMQType llmqType, const uint256& id)
 {
-    LOCK(cs);
-    CDBBatch batch(db);
-    RemoveRecoveredSig(batch, llmqType, id, false, false);
-    db.WriteBatch(batch);
+    RemoveRecoveredSig(llmqType, id, false);
 }
 
 void CRecoveredSigsDb::CleanupOldRecoveredSigs(int64_t maxAge)
 {
-    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
-
-    auto start = std::make_tuple(std::string("rs_t"), (uint32_t)0, (Consensus::LLMQType)0, uint256());
-    uint32_t endTime = (uint32_t)(GetAdjustedTime() - maxAge);
-    pcursor->Seek(start);
+    // only buckets which are completely older than maxAge are dropped
+    uint32_t endBucket = GetBucket(GetAdjustedTime() - maxAge);
 
-    std::vector<std::pair<Consensus::LLMQType, uint256>> toDelete;
-    std::vector<decltype(start)> toDelete2;
-
-    while (pcursor->Valid()) {
-        decltype(start) k;
-
-        if (!pcursor->GetKey(k) || std::get<0>(k) != "rs_t") {
-            break;
-        }
-        if (be32toh(std::get<1>(k)) >= endTime) {
-            break;
+    std::vector<uint32_t> toDelete;
+    {
+        LOCK(cs);
+        for (auto it = bucketFilters.begin(); it != bucketFilters.end() && it->first < endBucket; ) {
+            toDelete.emplace_back(it->first);
+            it = bucketFilters.erase(it);
         }
-
-        toDelete.emplace_back(std::get<2>(k), std::get<3>(k));
-        toDelete2.emplace_back(k);
-
-        pcursor->Next();
     }
-    pcursor.reset();
 
     if (toDelete.empty()) {
         return;
     }
 
     CDBBatch batch(db);
-    {
-        LOCK(cs);
-        for (auto& e : toDelete) {
-            RemoveRecoveredSig(batch, e.first, e.second, true, false);
+    size_t cnt = 0;
 
-            if (batch.SizeEstimate() >= (1 << 24)) {
-                db.WriteBatch(batch);
-                batch.Clear();
-            }
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    auto start = std::make_tuple(DB_BUCKET, (uint32_t)htobe32(toDelete.front()), (uint8_t)0, uint256());
+    pcursor->Seek(start);
+    while (pcursor->Valid()) {
+        decltype(start) k;
+        if (!pcursor->GetKey(k) || std::get<0>(k) != DB_BUCKET || be32toh(std::get<1>(k)) > toDelete.back()) {
+            break;
         }
-    }
 
-    for (auto& e : toDelete2) {
-        batch.Erase(e);
+        batch.Erase(k);
+        cnt++;
+
+        if (batch.SizeEstimate() >= (1 << 24)) {
+            db.WriteBatch(batch);
+            batch.Clear();
+        }
+
+        pcursor->Next();
     }
+    pcursor.reset();
 
     db.WriteBatch(batch);
 
-    LogPrint(BCLog::LLMQ, "CRecoveredSigsDb::%d -- deleted %d entries\n", __func__, toDelete.size());
+    // get rid of the deleted keys now, instead of leaving them to LevelDB's background compaction
+    auto end = std::make_tuple(DB_BUCKET, (uint32_t)htobe32(toDelete.back() + 1), (uint8_t)0, uint256());
+    db.CompactRange(start, end);
+
+    LogPrint(BCLog::LLMQ, "CRecoveredSigsDb::%s -- deleted %d entries in %d buckets\n", __func__, cnt, toDelete.size());
 }
 
 bool CRecoveredSigsDb::HasVotedOnId(Consensus::LLMQType llmqType, const uint256& id)
 {
-    auto k = std::make_tuple(std::string("rs_v"), llmqType, id);
-    return db.Exists(k);
+    return HasBucketEntry(RS_VOTE, BuildIdKey(RS_VOTE, llmqType, id));
 }
 
 bool CRecoveredSigsDb::GetVoteForId(Consensus::LLMQType llmqType, const uint256& id, uint256& msgHashRet)
 {
-    auto k = std::make_tuple(std::string("rs_v"), llmqType, id);
-    return db.Read(k, msgHashRet);
+    return ReadBucketEntry(RS_VOTE, BuildIdKey(RS_VOTE, llmqType, id), msgHashRet);
 }
 
 void CRecoveredSigsDb::WriteVoteForId(Consensus::LLMQType llmqType, const uint256& id, const uint256& msgHash)
 {
-    auto k1 = std::make_tuple(std::string("rs_v"), llmqType, id);
-    auto k2 = std::make_tuple(std::string("rs_vt"), (uint32_t)htobe32(GetAdjustedTime()), llmqType, id);
-
-    CDBBatch batch(db);
-    batch.Write(k1, msgHash);
-    batch.Write(k2, (uint8_t)1);
+    uint32_t bucket = GetBucket(GetAdjustedTime());
+    auto key = BuildIdKey(RS_VOTE, llmqType, id);
 
-    db.WriteBatch(batch);
-}
-
-void CRecoveredSigsDb::CleanupOldVotes(int64_t maxAge)
-{
-    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
-
-    auto start = std::make_tuple(std::string("rs_vt"), (uint32_t)0, (Consensus::LLMQType)0, uint256());
-    uint32_t endTime = (uint32_t)(GetAdjustedTime() - maxAge);
-    pcursor->Seek(start);
-
-    CDBBatch batch(db);
-    size_t cnt = 0;
-    while (pcursor->Valid()) {
-        decltype(start) k;
-
-        if (!pcursor->GetKey(k) || std::get<0>(k) != "rs_vt") {
-            break;
-        }
-        if (be32toh(std::get<1>(k)) >= endTime) {
-            break;
-        }
-
-        Consensus::LLMQType llmqType = std::get<2>(k);
-        const uint256& id = std::get<3>(k);
-
-        batch.Erase(k);
-        batch.Erase(std::make_tuple(std::string("rs_v"), llmqType, id));
-
-        cnt++;
-
-        pcursor->Next();
-    }
-    pcursor.reset();
-
-    if (cnt == 0) {
-        return;
-    }
-
-    db.WriteBatch(batch);
-
-    LogPrint(BCLog::LLMQ, "CRecoveredSigsDb::%d -- deleted %d entries\n", __func__, cnt);
+    LOCK(cs);
+    AddToFilter(bucket, {key});
+    db.Write(std::make_tuple(DB_BUCKET, (uint32_t)htobe32(bucket), RS_VOTE, key), msgHash);
 }
 
-//////////////////
-
 CSigningManager::CSigningManager(CDBWrapper& llmqDb, bool fMemory) :
     db(llmqDb)
 {
@@ -631,7 +785,7 @@ bool CSigningManager::ProcessPendingRecoveredSigs(CConnman& connman)
 
     // It's ok to perform insecure batched verification here as we verify against the quorum public keys, which are not
     // craftable by individual entities, making the rogue public key attack impossible
-    CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, false);
+    CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, false, 0, blsWorker);
 
     size_t verifyCount = 0;
     for (auto& p : recSigsByNode) {
@@ -763,7 +917,6 @@ void CSigningManager::Cleanup()
     int64_t maxAge = gArgs.GetArg("-recsigsmaxage", DEFAULT_MAX_RECOVERED_SIGS_AGE);
 
     db.CleanupOldRecoveredSigs(maxAge);
-    db.CleanupOldVotes(maxAge);
 
     lastCleanupTime = GetTimeMillis();
 }
@@ -9,10 +9,12 @@
 
 #include <net.h>
 #include <chainparams.h>
+#include <cuckoofilter.h>
 #include <saltedhasher.h>
 #include <univalue.h>
 #include <unordered_lru_cache.h>
 
+#include <map>
 #include <unordered_map>
 
 namespace llmq
@@ -61,21 +63,29 @@ public:
     UniValue ToJson() const;
 };
 
+// Recovered sigs and votes are stored in buckets by the time they were written, all entries of a bucket are next
+// to each other in the DB. Old entries are removed by dropping whole buckets, without reading anything first.
+// Every bucket has a cuckoo filter of its keys, so that lookups only touch the buckets which might have the key
+// and negative lookups usually don't touch the DB at all.
 class CRecoveredSigsDb
 {
 private:
+    static const int64_t BUCKET_TIME = 60 * 60;
+    static const size_t MIN_FILTER_CAPACITY = 4096;
+
+    typedef cuckoo_filter<uint256, StaticSaltedHasher> Filter;
+
     CDBWrapper& db;
 
     RecursiveMutex cs;
-    unordered_lru_cache<std::pair<Consensus::LLMQType, uint256>, bool, StaticSaltedHasher, 30000> hasSigForIdCache;
-    unordered_lru_cache<uint256, bool, StaticSaltedHasher, 30000> hasSigForSessionCache;
-    unordered_lru_cache<uint256, bool, StaticSaltedHasher, 30000> hasSigForHashCache;
+    std::map<uint32_t, Filter> bucketFilters;
 
 public:
     explicit CRecoveredSigsDb(CDBWrapper& _db);
 
     void ConvertInvalidTimeKeys();
     void AddVoteTimeKeys();
+    void ConvertToBuckets();
 
     bool HasRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, const uint256& msgHash);
     bool HasRecoveredSigForId(Consensus::LLMQType llmqType, const uint256& id);
@@ -87,18 +97,28 @@ public:
     void RemoveRecoveredSig(Consensus::LLMQType llmqType, const uint256& id);
     void TruncateRecoveredSig(Consensus::LLMQType llmqType, const uint256& id);
 
+    // this also removes the votes, as they are in the same buckets
     void CleanupOldRecoveredSigs(int64_t maxAge);
 
-    // votes are removed when the recovered sig is written to the db
     bool HasVotedOnId(Consensus::LLMQType llmqType, const uint256& id);
     bool GetVoteForId(Consensus::LLMQType llmqType, const uint256& id, uint256& msgHashRet);
     void WriteVoteForId(Consensus::LLMQType llmqType, const uint256& id, const uint256& msgHash);
 
-    void CleanupOldVotes(int64_t maxAge);
-
 private:
-    bool ReadRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, CRecoveredSig& ret);
-    void RemoveRecoveredSig(CDBBatch& batch, Consensus::LLMQType llmqType, const uint256& id, bool deleteHashKey, bool deleteTimeKey);
+    static uint32_t GetBucket(int64_t time);
+    static Filter BuildFilter(const std::vector<uint256>& keys, size_t capacity);
+
+    void LoadFilters();
+    void AddToFilter(uint32_t bucket, const std::vector<uint256>& keys);
+    void RebuildFilter(uint32_t bucket, const std::vector<uint256>& pendingKeys = {});
+    std::vector<uint32_t> FindBuckets(const uint256& key);
+
+    bool HasBucketEntry(uint8_t kind, const uint256& key);
+    template<typename V>
+    bool ReadBucketEntry(uint8_t kind, const uint256& key, V& value);
+    bool ReadRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, CRecoveredSig& ret, uint32_t& bucketRet);
+    void WriteRecoveredSig(CDBBatch& batch, const CRecoveredSig& recSig, uint32_t bucket);
+    void RemoveRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, bool deleteHashKey);
 };
 
 class CRecoveredSigsListener
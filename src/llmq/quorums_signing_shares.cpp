@@ -2,12 +2,14 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <llmq/quorums_init.h>
 #include <llmq/quorums_signing.h>
 #include <llmq/quorums_signing_shares.h>
 #include <llmq/quorums_utils.h>
 
 #include <masternode/activemasternode.h>
 #include <bls/bls_batchverifier.h>
+#include <bls/bls_worker.h>
 #include <init.h>
 #include <net_processing.h>
 #include <netmessagemaker.h>
@@ -650,7 +652,8 @@ bool CSigSharesManager::ProcessPendingSigShares(CConnman& connman)
 
     // It's ok to perform insecure batched verification here as we verify against the quorum public key shares,
     // which are not craftable by individual entities, making the rogue public key attack impossible
-    CBLSBatchVerifier<NodeId, SigShareKey> batchVerifier(false, true);
+    // Large batches are split up and verified on the BLS worker pool
+    CBLSBatchVerifier<NodeId, SigShareKey> batchVerifier(false, true, 0, blsWorker);
 
     cxxtimer::Timer prepareTimer(true);
     size_t verifyCount = 0;
@@ -761,6 +764,7 @@ void CSigSharesManager::ProcessSigShare(NodeId nodeId, const CSigShare& sigShare
 
         // Update the time we've seen the last sigShare
         timeSeenForSessions[sigShare.GetSignHash()] = GetAdjustedTime();
+        timeFirstSeenForSessions.emplace(sigShare.GetSignHash(), GetTimeMillis());
 
         if (!quorumNodes.empty()) {
             // don't announce and wait for other nodes to request this share and directly send it to them
@@ -781,24 +785,30 @@ void CSigSharesManager::ProcessSigShare(NodeId nodeId, const CSigShare& sigShare
     }
 
     if (canTryRecovery) {
-        TryRecoverSig(quorum, sigShare.id, sigShare.msgHash, connman);
+        TryRecoverSig(quorum, sigShare.id, sigShare.msgHash);
     }
 }
 
-void CSigSharesManager::TryRecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash, CConnman& connman)
+// Collects the sig shares for recovery and hands the recovery itself to the BLS worker pool, so that the work thread
+// can continue with verifying and storing the next sig shares in the meantime
+void CSigSharesManager::TryRecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash)
 {
     if (quorumSigningManager->HasRecoveredSigForId(quorum->params.type, id)) {
         return;
     }
 
+    auto signHash = CLLMQUtils::BuildSignHash(quorum->params.type, quorum->qc.quorumHash, id, msgHash);
+
     std::vector<CBLSSignature> sigSharesForRecovery;
     std::vector<CBLSId> idsForRecovery;
+    int64_t firstSeenTime;
     {
         LOCK(cs);
 
-        auto k = std::make_pair(quorum->params.type, id);
+        if (pendingRecoveries.count(signHash) || recoveredSessions.count(signHash)) {
+            return;
+        }
 
-        auto signHash = CLLMQUtils::BuildSignHash(quorum->params.type, quorum->qc.quorumHash, id, msgHash);
         auto sigShares = this->sigShares.GetAllForSignHash(signHash);
         if (!sigShares) {
             return;
@@ -816,43 +826,98 @@ void CSigSharesManager::TryRecoverSig(const CQuorumCPtr& quorum, const uint256&
         if (sigSharesForRecovery.size() < quorum->params.threshold) {
             return;
         }
+
+        auto it = timeFirstSeenForSessions.find(signHash);
+        firstSeenTime = it != timeFirstSeenForSessions.end() ? it->second : GetTimeMillis();
+        pendingRecoveries.emplace(signHash);
+    }
+
+    if (!blsWorker) {
+        RecoverSig(quorum, id, msgHash, sigSharesForRecovery, idsForRecovery, firstSeenTime);
+        return;
     }
+    blsWorker->AsyncRunJob([this, quorum, id, msgHash, sigSharesForRecovery = std::move(sigSharesForRecovery),
+                            idsForRecovery = std::move(idsForRecovery), firstSeenTime]() {
+        RecoverSig(quorum, id, msgHash, sigSharesForRecovery, idsForRecovery, firstSeenTime);
+    });
+}
+
+void CSigSharesManager::RecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash,
+        const std::vector<CBLSSignature>& sigSharesForRecovery, const std::vector<CBLSId>& idsForRecovery,
+        int64_t firstSeenTime)
+{
+    auto signHash = CLLMQUtils::BuildSignHash(quorum->params.type, quorum->qc.quorumHash, id, msgHash);
 
     // now recover it
     cxxtimer::Timer t(true);
     CBLSSignature recoveredSig;
-    if (!recoveredSig.Recover(sigSharesForRecovery, idsForRecovery)) {
+    bool recovered = recoveredSig.Recover(sigSharesForRecovery, idsForRecovery);
+    t.stop();
+
+    if (!recovered) {
         LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- failed to recover signature. id=%s, msgHash=%s, time=%d\n", __func__,
                   id.ToString(), msgHash.ToString(), t.count());
-        return;
-    }
+    } else {
+        LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- recovered signature. id=%s, msgHash=%s, time=%d\n", __func__,
+                  id.ToString(), msgHash.ToString(), t.count());
 
-    LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- recovered signature. id=%s, msgHash=%s, time=%d\n", __func__,
-              id.ToString(), msgHash.ToString(), t.count());
-
-    CRecoveredSig rs;
-    rs.llmqType = quorum->params.type;
-    rs.quorumHash = quorum->qc.quorumHash;
-    rs.id = id;
-    rs.msgHash = msgHash;
-    rs.sig.Set(recoveredSig);
-    rs.UpdateHash();
-
-    // There should actually be no need to verify the self-recovered signatures as it should always succeed. Let's
-    // however still verify it from time to time, so that we have a chance to catch bugs. We do only this sporadic
-    // verification because this is unbatched and thus slow verification that happens here.
-    if (((recoveredSigsCounter++) % 100) == 0) {
-        auto signHash = CLLMQUtils::BuildSignHash(rs);
-        bool valid = recoveredSig.VerifyInsecure(quorum->qc.quorumPublicKey, signHash);
-        if (!valid) {
+        CRecoveredSig rs;
+        rs.llmqType = quorum->params.type;
+        rs.quorumHash = quorum->qc.quorumHash;
+        rs.id = id;
+        rs.msgHash = msgHash;
+        rs.sig.Set(recoveredSig);
+        rs.UpdateHash();
+
+        // There should actually be no need to verify the self-recovered signatures as it should always succeed. Let's
+        // however still verify it from time to time, so that we have a chance to catch bugs. We do only this sporadic
+        // verification because this is unbatched and thus slow verification that happens here.
+        if (((recoveredSigsCounter++) % 100) == 0 && !recoveredSig.VerifyInsecure(quorum->qc.quorumPublicKey, signHash)) {
             // this should really not happen as we have verified all signature shares before
             LogPrintf("CSigSharesManager::%s -- own recovered signature is invalid. id=%s, msgHash=%s\n", __func__,
                       id.ToString(), msgHash.ToString());
-            return;
+            recovered = false;
+        } else {
+            // this might run on the BLS worker pool, so let the work thread process it like the recovered sigs which
+            // are reconstructed from ISLOCKs and CLSIGs
+            quorumSigningManager->PushReconstructedRecoveredSig(rs, quorum);
         }
     }
 
-    quorumSigningManager->ProcessRecoveredSig(-1, rs, quorum, connman);
+    LOCK(cs);
+    pendingRecoveries.erase(signHash);
+    hasFinishedRecoveries = true;
+    if (recovered) {
+        // the recovered sig still waits in quorumSigningManager, don't recover it again from the next sig share. Only
+        // while the session exists, Cleanup() removes it through RemoveSigSharesForSession at the latest on timeout
+        if (timeSeenForSessions.count(signHash)) {
+            recoveredSessions.emplace(signHash);
+        }
+        recoveryTimes.emplace_back(GetTimeMillis() - firstSeenTime);
+        if (recoveryTimes.size() > RECOVERY_TIMES_WINDOW) {
+            recoveryTimes.pop_front();
+        }
+    }
+}
+
+void CSigSharesManager::LogRecoveryTimes()
+{
+    AssertLockHeld(cs);
+
+    int64_t now = GetAdjustedTime();
+    if (now - lastRecoveryTimesLogTime < RECOVERY_TIMES_LOG_INTERVAL || recoveryTimes.empty()) {
+        return;
+    }
+    lastRecoveryTimesLogTime = now;
+
+    std::vector<int64_t> v(recoveryTimes.begin(), recoveryTimes.end());
+    std::sort(v.begin(), v.end());
+    auto percentile = [&](size_t p) {
+        return v[std::min(v.size() - 1, v.size() * p / 100)];
+    };
+
+    LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- time to recovered sig of the last %d sessions: p50=%d, p90=%d, p99=%d, max=%d\n", __func__,
+             v.size(), percentile(50), percentile(90), percentile(99), v.back());
 }
 
 CDeterministicMNCPtr CSigSharesManager::SelectMemberForRecovery(const CQuorumCPtr& quorum, const uint256 &id, int attempt)
@@ -1397,7 +1462,7 @@ void CSigSharesManager::Cleanup()
                     if (quorumIt != quorums.end()) {
                         auto& quorum = quorumIt->second;
                         for (size_t i = 0; i < quorum->members.size(); i++) {
-                            if (!m->count((uint16_t)i)) {
+                            if (!m->Has((uint16_t)i)) {
                                 auto& dmn = quorum->members[i];
                                 strMissingMembers += strprintf("\n  %s", dmn->proTxHash.ToString());
                             }
@@ -1435,6 +1500,8 @@ void CSigSharesManager::Cleanup()
         nodeStates.erase(nodeId);
     }
 
+    LogRecoveryTimes();
+
     lastCleanupTime = GetAdjustedTime();
 }
 
@@ -1450,6 +1517,8 @@ void CSigSharesManager::RemoveSigSharesForSession(const uint256& signHash)
     sigShares.EraseAllForSignHash(signHash);
     signedSessions.erase(signHash);
     timeSeenForSessions.erase(signHash);
+    timeFirstSeenForSessions.erase(signHash);
+    recoveredSessions.erase(signHash);
 }
 
 void CSigSharesManager::RemoveBannedNodeStates()
@@ -1527,7 +1596,14 @@ void CSigSharesManager::WorkThreadMain()
 
         // TODO Wakeup when pending signing is needed?
         if (!didWork) {
-            if (!workInterrupt.sleep_for(std::chrono::milliseconds(100))) {
+            // recovered sigs from the BLS worker pool are waiting in quorumSigningManager, don't let them wait long
+            bool recovering;
+            {
+                LOCK(cs);
+                recovering = !pendingRecoveries.empty() || hasFinishedRecoveries;
+                hasFinishedRecoveries = false;
+            }
+            if (!workInterrupt.sleep_for(std::chrono::milliseconds(recovering ? 1 : 100))) {
                 return;
             }
         }
@@ -17,10 +17,12 @@
 
 #include <llmq/quorums.h>
 
+#include <deque>
 #include <thread>
 #include <mutex>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 class CEvoDB;
 class CScheduler;
@@ -147,17 +149,94 @@ public:
     std::string ToInvString() const;
 };
 
+// The entries of a single signHash. They are kept in a flat array and found through a second array indexed by the
+// quorum member, so that lookups don't need any hashing and iterating them is cheap
+template<typename T>
+class SigShareSession
+{
+public:
+    typedef std::pair<uint16_t, T> Entry;
+
+private:
+    // quorumMember -> index into entries + 1, 0 means not set
+    std::vector<uint16_t> memberIndexes;
+    std::vector<Entry> entries;
+
+public:
+    typename std::vector<Entry>::iterator begin() { return entries.begin(); }
+    typename std::vector<Entry>::iterator end() { return entries.end(); }
+    typename std::vector<Entry>::const_iterator begin() const { return entries.begin(); }
+    typename std::vector<Entry>::const_iterator end() const { return entries.end(); }
+
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+
+    bool Add(uint16_t quorumMember, const T& v)
+    {
+        if (quorumMember >= memberIndexes.size()) {
+            memberIndexes.resize((size_t)quorumMember + 1, 0);
+        } else if (memberIndexes[quorumMember] != 0) {
+            return false;
+        }
+        entries.emplace_back(quorumMember, v);
+        memberIndexes[quorumMember] = (uint16_t)entries.size();
+        return true;
+    }
+
+    bool Has(uint16_t quorumMember) const
+    {
+        return quorumMember < memberIndexes.size() && memberIndexes[quorumMember] != 0;
+    }
+
+    T* Get(uint16_t quorumMember)
+    {
+        if (!Has(quorumMember)) {
+            return nullptr;
+        }
+        return &entries[memberIndexes[quorumMember] - 1].second;
+    }
+
+    // Moves the last entry into the erased slot, which invalidates iterators and pointers to the last entry
+    void Erase(uint16_t quorumMember)
+    {
+        if (!Has(quorumMember)) {
+            return;
+        }
+        size_t idx = memberIndexes[quorumMember] - 1;
+        memberIndexes[quorumMember] = 0;
+        if (idx != entries.size() - 1) {
+            entries[idx] = std::move(entries.back());
+            memberIndexes[entries[idx].first] = (uint16_t)(idx + 1);
+        }
+        entries.pop_back();
+    }
+
+    template<typename F>
+    void EraseIf(F&& f, SigShareKey& k)
+    {
+        for (size_t i = 0; i < entries.size(); ) {
+            k.second = entries[i].first;
+            if (f(k, entries[i].second)) {
+                // the last entry is moved into slot i, so don't advance
+                Erase(entries[i].first);
+            } else {
+                i++;
+            }
+        }
+    }
+};
+
 template<typename T>
 class SigShareMap
 {
 private:
-    std::unordered_map<uint256, std::unordered_map<uint16_t, T>, StaticSaltedHasher> internalMap;
+    std::unordered_map<uint256, SigShareSession<T>, StaticSaltedHasher> internalMap;
 
 public:
     bool Add(const SigShareKey& k, const T& v)
     {
         auto& m = internalMap[k.first];
-        return m.emplace(k.second, v).second;
+        return m.Add(k.second, v);
     }
 
     void Erase(const SigShareKey& k)
@@ -166,7 +245,7 @@ public:
         if (it == internalMap.end()) {
             return;
         }
-        it->second.erase(k.second);
+        it->second.Erase(k.second);
         if (it->second.empty()) {
             internalMap.erase(it);
         }
@@ -183,7 +262,7 @@ public:
         if (it == internalMap.end()) {
             return false;
         }
-        return it->second.count(k.second) != 0;
+        return it->second.Has(k.second);
     }
 
     T* Get(const SigShareKey& k)
@@ -192,13 +271,7 @@ public:
         if (it == internalMap.end()) {
             return nullptr;
         }
-
-        auto jt = it->second.find(k.second);
-        if (jt == it->second.end()) {
-            return nullptr;
-        }
-
-        return &jt->second;
+        return it->second.Get(k.second);
     }
 
     T& GetOrAdd(const SigShareKey& k)
@@ -242,7 +315,7 @@ public:
         return internalMap.empty();
     }
 
-    const std::unordered_map<uint16_t, T>* GetAllForSignHash(const uint256& signHash)
+    const SigShareSession<T>* GetAllForSignHash(const uint256& signHash)
     {
         auto it = internalMap.find(signHash);
         if (it == internalMap.end()) {
@@ -262,14 +335,7 @@ public:
         for (auto it = internalMap.begin(); it != internalMap.end(); ) {
             SigShareKey k;
             k.first = it->first;
-            for (auto jt = it->second.begin(); jt != it->second.end(); ) {
-                k.second = jt->first;
-                if (f(k, jt->second)) {
-                    jt = it->second.erase(jt);
-                } else {
-                    ++jt;
-                }
-            }
+            it->second.EraseIf(f, k);
             if (it->second.empty()) {
                 it = internalMap.erase(it);
             } else {
@@ -369,6 +435,9 @@ class CSigSharesManager : public CRecoveredSigsListener
     const int64_t MAX_SEND_FOR_RECOVERY_TIMEOUT = 10000;
     const size_t MAX_MSGS_SIG_SHARES = 32;
 
+    const size_t RECOVERY_TIMES_WINDOW = 1000;
+    const int64_t RECOVERY_TIMES_LOG_INTERVAL = 60;
+
 private:
     RecursiveMutex cs;
 
@@ -380,6 +449,17 @@ private:
 
     // stores time of last receivedSigShare. Used to detect timeouts
     std::unordered_map<uint256, int64_t, StaticSaltedHasher> timeSeenForSessions;
+    // stores time (in ms) of the first receivedSigShare. Used to measure how long recovery takes
+    std::unordered_map<uint256, int64_t, StaticSaltedHasher> timeFirstSeenForSessions;
+
+    // sessions for which the recovery currently runs on the BLS worker pool
+    std::unordered_set<uint256, StaticSaltedHasher> pendingRecoveries;
+    // sessions which were recovered, until the recovered sig is processed or the session is removed
+    std::unordered_set<uint256, StaticSaltedHasher> recoveredSessions;
+    bool hasFinishedRecoveries{false};
+    // time (in ms) from the first sig share to the recovered sig of the latest RECOVERY_TIMES_WINDOW sessions
+    std::deque<int64_t> recoveryTimes;
+    int64_t lastRecoveryTimesLogTime{0};
 
     std::unordered_map<NodeId, CSigSharesNodeState> nodeStates;
     SigShareMap<std::pair<NodeId, int64_t>> sigSharesRequested;
@@ -436,7 +516,11 @@ private:
             CConnman& connman);
 
     void ProcessSigShare(NodeId nodeId, const CSigShare& sigShare, CConnman& connman, const CQuorumCPtr& quorum);
-    void TryRecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash, CConnman& connman);
+    void TryRecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash);
+    void RecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash,
+            const std::vector<CBLSSignature>& sigSharesForRecovery, const std::vector<CBLSId>& idsForRecovery,
+            int64_t firstSeenTime);
+    void LogRecoveryTimes();
 
 private:
     bool GetSessionInfoByRecvId(NodeId nodeId, uint32_t sessionId, CSigSharesNodeState::SessionInfo& retInfo);
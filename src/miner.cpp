@@ -30,6 +30,7 @@
 #include <util/threadnames.h>
 #include <util/validation.h>
 #include <validation.h>
+#include <validationinterface.h>
 
 #include <wallet/wallet.h>
 
@@ -45,6 +46,8 @@
 #include "llmq/quorums_chainlocks.h"
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <queue>
 #include <utility>
 #include <key_io.h>
@@ -714,9 +717,123 @@ void Stake(bool fStake, CWallet *pwallet, boost::thread_group*& stakeThread)
 // Proof of Work miner
 //
 
-double dHashesPerMin = 0.0;
-int64_t nHPSTimerStart = 0;
+// Nonces hashed per call, per range a hashing thread takes from a work unit, and the last nonce
+// handed out before a work unit needs a new extranonce
+static const unsigned int MINER_HASH_WAYS = 16;
+static const uint64_t MINER_NONCE_RANGE = 0x4000;
+static const uint64_t MINER_MAX_NONCE = 0xffff0000;
+// Milliseconds between checks of the template thread, between nTime updates and between hashmeter updates
+static const int64_t MINER_POLL_MS = 100;
+static const int64_t MINER_UPDATE_TIME_MS = 5 * 1000;
+static const int64_t MINER_HASHMETER_MS = 10 * 1000;
+
+namespace {
+
+/**
+ * A block header to scan, published by the template thread. Nothing in it changes after it is
+ * published except nNextNonce, hashing threads take disjoint nonce ranges from it.
+ */
+struct CMinerWork
+{
+    const uint64_t nId;
+    const std::shared_ptr<const CBlock> pblock;
+    const CSHA256DNonce hasher;
+    const arith_uint256 hashTarget;
+    std::atomic<uint64_t> nNextNonce;
+
+    CMinerWork(uint64_t nIdIn, std::shared_ptr<const CBlock> pblockIn) :
+        nId(nIdIn), pblock(pblockIn), hasher(pblockIn->GetNonceHasher()),
+        hashTarget(arith_uint256().SetCompact(pblockIn->nBits)), nNextNonce(0) {}
+};
+
+// -- the current work, only accessed with std::atomic_load / std::atomic_store
+std::shared_ptr<const CMinerWork> g_miner_work;
+// -- id of the current work, bumped to make the hashing threads drop stale work
+std::atomic<uint64_t> g_miner_work_id{0};
+// -- the nonce space of the current work is used up
+std::atomic<bool> g_miner_need_work{false};
+
+std::atomic<uint64_t> g_miner_hashes{0};
+std::atomic<uint64_t> g_miner_hashes_per_sec{0};
+std::atomic<int> g_miner_threads{0};
+
+Mutex cs_miner_solutions;
+std::deque<std::shared_ptr<const CBlock> > g_miner_solutions GUARDED_BY(cs_miner_solutions);
+
+/** Cancels the current work as soon as the tip changes, without waiting for the template thread */
+class CMinerNotifications : public CValidationInterface
+{
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override
+    {
+        g_miner_work_id++;
+    }
+};
+
+} // namespace
+
+double GetMinerHashesPerSec()
+{
+    return g_miner_hashes_per_sec.load();
+}
+
+int GetMinerThreads()
+{
+    return g_miner_threads.load();
+}
+
+static uint64_t PublishMinerWork(const CBlock& block)
+{
+    uint64_t nId = ++g_miner_work_id;
+    std::shared_ptr<const CMinerWork> work = std::make_shared<const CMinerWork>(nId, std::make_shared<const CBlock>(block));
+    std::atomic_store(&g_miner_work, work);
+    g_miner_need_work = false;
+    return nId;
+}
+
+static void ProcessMinerSolutions(const CChainParams& chainparams)
+{
+    std::deque<std::shared_ptr<const CBlock> > vSolutions;
+    {
+        LOCK(cs_miner_solutions);
+        vSolutions.swap(g_miner_solutions);
+    }
+
+    for (const auto& pblock : vSolutions) {
+        LogPrintf("Found Hash %s\n", pblock->GetHash().ToString().c_str());
+        if (!ProcessNewBlock(chainparams, pblock, true, nullptr))
+            throw std::runtime_error(strprintf("%s: ProcessNewBlock, block not accepted:", __func__));
+        LogPrintf("Found Hash %s\n", pblock->ToString().c_str());
+    }
+}
+
+static void UpdateMinerHashMeter()
+{
+    static int64_t nHashMeterStart = 0;
+    static uint64_t nHashMeterCount = 0;
+    static int64_t nLogTime = 0;
+
+    int64_t nNow = GetTimeMillis();
+    if (nHashMeterStart == 0) {
+        nHashMeterStart = nNow;
+        nHashMeterCount = g_miner_hashes.load();
+        return;
+    }
+    if (nNow - nHashMeterStart < MINER_HASHMETER_MS)
+        return;
+
+    uint64_t nHashes = g_miner_hashes.load();
+    g_miner_hashes_per_sec = (nHashes - nHashMeterCount) * 1000 / (nNow - nHashMeterStart);
+    nHashMeterStart = nNow;
+    nHashMeterCount = nHashes;
+
+    if (GetTime() - nLogTime > 30 * 60) {
+        nLogTime = GetTime();
+        LogPrintf("hashmeter %6.0f khash/s\n", g_miner_hashes_per_sec.load() / 1000.0);
+    }
+}
 
+/** Builds block templates and publishes work for the hashing threads, submits the solutions they find */
 void static RainMiner(std::shared_ptr<CTxDestination> coinbase_script)
 {
     const CChainParams& chainparams = Params();
@@ -726,118 +843,72 @@ void static RainMiner(std::shared_ptr<CTxDestination> coinbase_script)
     unsigned int nExtraNonce = 0;
 
     try {
-        // Throw an error if no script was provided.  This can happen
-        // due to some internal error but also if the keypool is empty.
-        // In the latter case, already the pointer is nullptr.
-
         while (true) {
-                // Busy-wait for the network to come online so we don't waste time mining
-                // on an obsolete chain. In regtest mode we expect to fly solo.
-                do {
-                    if(!g_connman)
-                        break;
+            // Busy-wait for the network to come online so we don't waste time mining
+            // on an obsolete chain. In regtest mode we expect to fly solo.
+            do {
+                if (!g_connman)
+                    break;
 
-                    if (g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL) == 0)
-                        break;
+                if (g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL) == 0)
+                    break;
 
-                    if (::ChainstateActive().IsInitialBlockDownload())
-                        break;
-                     UninterruptibleSleep(std::chrono::milliseconds{1000});
-                } while (true);
+                if (::ChainstateActive().IsInitialBlockDownload())
+                    break;
+                boost::this_thread::sleep_for(boost::chrono::milliseconds(1000));
+            } while (true);
 
             //
             // Create new block
             //
             unsigned int nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
-            CBlockIndex* pindexPrev = ::ChainActive().Tip();
-            static std::unique_ptr<CBlockTemplate> pblocktemplate;
+            CBlockIndex* pindexPrev;
+            {
+                LOCK(cs_main);
+                pindexPrev = ::ChainActive().Tip();
+            }
 
-            pblocktemplate = BlockAssembler(Params()).CreateNewBlock(GetScriptForDestination(*coinbase_script));
+            std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(GetScriptForDestination(*coinbase_script));
             if (!pblocktemplate.get())
                 throw std::runtime_error(strprintf("%s: Couldn't create new block", __func__));
 
             CBlock *pblock = &pblocktemplate->block;
-            {
-                LOCK(cs_main);
-                IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
-            }
-
             LogPrintf("Running RainMiner with %u transactions in block \n", pblock->vtx.size());
 
             //
-            // Search
+            // Publish work from the template until it is stale, each work unit has its own
+            // extranonce and the full nonce range
             //
             int64_t nStart = GetTime();
-            arith_uint256 hashTarget = arith_uint256().SetCompact(pblock->nBits);
-            uint256 testHash;
-            for (;;)
-            {
-                unsigned int nHashesDone = 0;
-                unsigned int nNonceFound = (unsigned int) -1;
-
-                for(int i=0;i<1;i++){
-                    pblock->nNonce=pblock->nNonce+1;
-                    testHash=pblock->GetHash();
-                    nHashesDone++;
-                    //LogPrintf("testHash %s\n", testHash.ToString().c_str());
-                    //LogPrintf("Hash Target %s\n", hashTarget.ToString().c_str());
-
-                    if(UintToArith256(testHash)<hashTarget){
-                        nNonceFound=pblock->nNonce;
-                        LogPrintf("Found Hash %s\n", testHash.ToString().c_str());
-                        // Found a solution
-                        assert(testHash == pblock->GetHash());
-
-                        std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(*pblock);
-                        if (!ProcessNewBlock(Params(), shared_pblock, true, nullptr))
-                            throw std::runtime_error(strprintf("%s: ProcessNewBlock, block not accepted:", __func__));
-                        LogPrintf("Found Hash %s\n", shared_pblock->ToString().c_str());
-                        break;
-                    }
-                }
-
-                // Meter hashes/sec
-                static int64_t nHashCounter;
-                if (nHPSTimerStart == 0)
-                {
-                    nHPSTimerStart = GetTimeMillis();
-                    nHashCounter = 0;
-                }
-                else
-                    nHashCounter += nHashesDone;
-                if (GetTimeMillis() - nHPSTimerStart > 4000*60)
+            bool fNewTemplate = false;
+            while (!fNewTemplate) {
                 {
-                    static RecursiveMutex cs;
-                    {
-                        LOCK(cs);
-                        if (GetTimeMillis() - nHPSTimerStart > 4000*60)
-                        {
-                            dHashesPerMin = 1000.0 * nHashCounter *60 / (GetTimeMillis() - nHPSTimerStart);
-                            nHPSTimerStart = GetTimeMillis();
-                            nHashCounter = 0;
-                            static int64_t nLogTime;
-                            if (GetTime() - nLogTime > 30 * 60)
-                            {
-                                nLogTime = GetTime();
-                                LogPrintf("hashmeter %6.0f khash/s\n", dHashesPerMin/1000.0);
-                            }
-                        }
-                    }
+                    LOCK(cs_main);
+                    IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
                 }
+                UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev);
+                uint64_t nWorkId = PublishMinerWork(*pblock);
+                int64_t nPublished = GetTimeMillis();
 
-                // Check for stop or if block needs to be rebuilt
-                boost::this_thread::interruption_point();
-                // Regtest mode doesn't require peers
+                while (true) {
+                    boost::this_thread::sleep_for(boost::chrono::milliseconds(MINER_POLL_MS));
 
-                if (nNonceFound >= 0xffff0000)
-                    break;
-                if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 60)
-                    break;
-                if (pindexPrev != ::ChainActive().Tip())
-                    break;
+                    ProcessMinerSolutions(chainparams);
+                    UpdateMinerHashMeter();
 
-                // Update nTime every few seconds
-                UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev);
+                    // A new tip or a solution cancels the work
+                    if (g_miner_work_id != nWorkId || pindexPrev != ::ChainActive().Tip()) {
+                        fNewTemplate = true;
+                        break;
+                    }
+                    if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 60) {
+                        fNewTemplate = true;
+                        break;
+                    }
+                    // Next extranonce, or update nTime every few seconds
+                    if (g_miner_need_work || GetTimeMillis() - nPublished > MINER_UPDATE_TIME_MS)
+                        break;
+                }
             }
         }
     }
@@ -849,13 +920,76 @@ void static RainMiner(std::shared_ptr<CTxDestination> coinbase_script)
     catch (const std::runtime_error &e)
     {
         LogPrintf("RainMiner runtime error: %s\n", e.what());
+        // -- nothing publishes work anymore, stop the hashing threads
+        std::atomic_store(&g_miner_work, std::shared_ptr<const CMinerWork>());
+        g_miner_threads = 0;
+        g_miner_hashes_per_sec = 0;
+        g_miner_work_id++;
         return;
     }
 }
 
+/** Scans nonce ranges of the current work, never takes a lock unless it finds a solution */
+void static RainMinerWorker(int nThread)
+{
+    util::ThreadRename(strprintf("miner.%d", nThread));
+
+    unsigned char vchHashes[MINER_HASH_WAYS * CSHA256DNonce::OUTPUT_SIZE];
+    uint256 testHash;
+
+    while (true) {
+        boost::this_thread::interruption_point();
+
+        // -- the template thread stopped on an error
+        if (g_miner_threads == 0)
+            return;
+
+        std::shared_ptr<const CMinerWork> work = std::atomic_load(&g_miner_work);
+        if (!work || work->nId != g_miner_work_id) {
+            boost::this_thread::sleep_for(boost::chrono::milliseconds(MINER_POLL_MS / 10));
+            continue;
+        }
+
+        uint64_t nStart = work->nNextNonce.fetch_add(MINER_NONCE_RANGE);
+        if (nStart + MINER_NONCE_RANGE > MINER_MAX_NONCE) {
+            g_miner_need_work = true;
+            boost::this_thread::sleep_for(boost::chrono::milliseconds(MINER_POLL_MS / 10));
+            continue;
+        }
+
+        uint64_t nHashesDone = 0;
+        for (uint64_t nNonce = nStart; nNonce < nStart + MINER_NONCE_RANGE; nNonce += MINER_HASH_WAYS) {
+            work->hasher.Hash(vchHashes, nNonce, MINER_HASH_WAYS);
+            nHashesDone += MINER_HASH_WAYS;
+
+            for (unsigned int j = 0; j < MINER_HASH_WAYS; j++) {
+                memcpy(testHash.begin(), vchHashes + j * CSHA256DNonce::OUTPUT_SIZE, CSHA256DNonce::OUTPUT_SIZE);
+                if (UintToArith256(testHash) >= work->hashTarget)
+                    continue;
+
+                // Found a solution
+                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>(*work->pblock);
+                pblock->nNonce = nNonce + j;
+                assert(testHash == pblock->GetHash());
+                {
+                    LOCK(cs_miner_solutions);
+                    g_miner_solutions.push_back(pblock);
+                }
+                g_miner_work_id++;
+                break;
+            }
+
+            if (work->nId != g_miner_work_id)
+                break;
+        }
+        g_miner_hashes += nHashesDone;
+    }
+}
+
 void GenerateRains(bool fGenerate, int nThreads, std::shared_ptr<CTxDestination> coinbase_script)
 {
     static boost::thread_group* minerThreads = nullptr;
+    static std::unique_ptr<CMinerNotifications> minerNotifications;
 
     if (nThreads < 0)
         nThreads = GetNumCores();
@@ -863,14 +997,36 @@ void GenerateRains(bool fGenerate, int nThreads, std::shared_ptr<CTxDestination>
     if (minerThreads != nullptr)
     {
         minerThreads->interrupt_all();
+        minerThreads->join_all();
         delete minerThreads;
         minerThreads = nullptr;
     }
+    if (minerNotifications) {
+        UnregisterValidationInterface(minerNotifications.get());
+        minerNotifications.reset();
+    }
+    std::atomic_store(&g_miner_work, std::shared_ptr<const CMinerWork>());
+    {
+        LOCK(cs_miner_solutions);
+        g_miner_solutions.clear();
+    }
+    g_miner_threads = 0;
+    g_miner_hashes_per_sec = 0;
 
     if (nThreads == 0 || !fGenerate)
         return;
 
+    if (!coinbase_script) {
+        LogPrintf("RainMiner: no coinbase address, not mining\n");
+        return;
+    }
+
+    minerNotifications.reset(new CMinerNotifications());
+    RegisterValidationInterface(minerNotifications.get());
+
+    g_miner_threads = nThreads;
     minerThreads = new boost::thread_group();
+    minerThreads->create_thread(boost::bind(&RainMiner, coinbase_script));
     for (int i = 0; i < nThreads; i++)
-        minerThreads->create_thread(boost::bind(&RainMiner, boost::cref(coinbase_script)));
+        minerThreads->create_thread(boost::bind(&RainMinerWorker, i));
 }
@@ -219,8 +219,10 @@ void Stake(bool fStake, CWallet *pwallet, boost::thread_group*& stakeThread);
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
-extern double dHashesPerMin;
-extern int64_t nHPSTimerStart;
+/** Hashes per second of the internal miner, 0 when it is not running */
+double GetMinerHashesPerSec();
+/** Number of hashing threads of the internal miner, 0 when it is not running */
+int GetMinerThreads();
 bool CheckStake(const CBlock* pblock);
 
 #endif // RAIN_MINER_H
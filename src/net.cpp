@@ -38,6 +38,10 @@
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -1067,6 +1071,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
+    RegisterEvents(pnode);
 }
 
 void CConnman::DisconnectNodes()
@@ -1224,8 +1229,40 @@ bool CConnman::GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &s
     return !recv_set.empty() || !send_set.empty() || !error_set.empty();
 }
 
+#ifdef USE_EPOLL
+void CConnman::SocketEventsEpoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+{
+    // Sockets are registered once when they are created, the kernel drops them from the
+    // interest list when they are closed. Edge triggered events are remembered per node
+    // in SocketHandler until a recv or send would block.
+    struct epoll_event events[64];
+    int nEvents = epoll_wait(epollfd, events, 64, fSocketEventsPending ? 0 : SELECT_TIMEOUT_MILLISECONDS);
+
+    if (interruptNet) return;
+
+    if (nEvents < 0) {
+        if (errno != EINTR) {
+            LogPrintf("epoll_wait error %s\n", NetworkErrorString(errno));
+        }
+        return;
+    }
+
+    for (int i = 0; i < nEvents; i++) {
+        const struct epoll_event& e = events[i];
+        if (e.data.fd == wakeupPipe[0]) {
+            char buf[128];
+            while (read(wakeupPipe[0], buf, sizeof(buf)) > 0) {}
+            continue;
+        }
+        if (e.events & EPOLLIN)                 recv_set.insert(e.data.fd);
+        if (e.events & EPOLLOUT)                send_set.insert(e.data.fd);
+        if (e.events & (EPOLLERR|EPOLLHUP))     error_set.insert(e.data.fd);
+    }
+}
+#endif
+
 #ifdef USE_POLL
-void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+void CConnman::SocketEventsPoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
     if (!GenerateSelectSet(recv_select_set, send_select_set, error_select_set)) {
@@ -1267,7 +1304,7 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
     }
 }
 #else
-void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+void CConnman::SocketEventsSelect(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
     if (!GenerateSelectSet(recv_select_set, send_select_set, error_select_set)) {
@@ -1342,10 +1379,56 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
 }
 #endif
 
+void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+{
+    switch (socketEventsMode) {
+#ifdef USE_EPOLL
+        case SOCKETEVENTS_EPOLL:
+            SocketEventsEpoll(recv_set, send_set, error_set);
+            break;
+#endif
+#ifdef USE_POLL
+        case SOCKETEVENTS_POLL:
+            SocketEventsPoll(recv_set, send_set, error_set);
+            break;
+#else
+        case SOCKETEVENTS_SELECT:
+            SocketEventsSelect(recv_set, send_set, error_set);
+            break;
+#endif
+        default:
+            assert(false);
+    }
+}
+
+void CConnman::RegisterEvents(CNode *pnode)
+{
+#ifdef USE_EPOLL
+    if (socketEventsMode != SOCKETEVENTS_EPOLL) {
+        return;
+    }
+
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET) {
+        return;
+    }
+
+    // The socket is removed from the interest list when it is closed, there is no matching unregister
+    struct epoll_event e;
+    e.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    e.data.fd = pnode->hSocket;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, pnode->hSocket, &e) != 0) {
+        LogPrintf("Failed to add socket of peer=%d to epoll: %s\n", pnode->GetId(), NetworkErrorString(errno));
+        pnode->fDisconnect = true;
+    }
+#endif
+}
+
 void CConnman::SocketHandler()
 {
     std::set<SOCKET> recv_set, send_set, error_set;
     SocketEvents(recv_set, send_set, error_set);
+    fSocketEventsPending = false;
 
     if (interruptNet) return;
 
@@ -1389,6 +1472,17 @@ void CConnman::SocketHandler()
             sendSet = send_set.count(pnode->hSocket) > 0;
             errorSet = error_set.count(pnode->hSocket) > 0;
         }
+        if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+            // An edge is only reported once, keep reading and writing until the socket would block
+            pnode->fHasRecvData |= recvSet || errorSet;
+            pnode->fCanSendData |= sendSet;
+            recvSet = pnode->fHasRecvData && !pnode->fPauseRecv;
+            errorSet = false;
+            {
+                LOCK(pnode->cs_vSend);
+                sendSet = pnode->fCanSendData && !pnode->vSendMsg.empty();
+            }
+        }
         if (recvSet || errorSet)
         {
             // typical socket buffer is 8K-64K
@@ -1400,6 +1494,10 @@ void CConnman::SocketHandler()
                     continue;
                 nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
             }
+            if (nBytes < (int)sizeof(pchBuf)) {
+                // Drained the socket, wait for the next edge
+                pnode->fHasRecvData = false;
+            }
             if (nBytes > 0)
             {
                 bool notify = false;
@@ -1454,6 +1552,14 @@ void CConnman::SocketHandler()
             if (nBytes) {
                 RecordBytesSent(nBytes);
             }
+            if (!pnode->vSendMsg.empty()) {
+                // Send buffer is full, wait for the next edge
+                pnode->fCanSendData = false;
+            }
+        }
+
+        if (pnode->fHasRecvData && !pnode->fPauseRecv) {
+            fSocketEventsPending = true;
         }
 
         InactivityCheck(pnode);
@@ -1479,9 +1585,38 @@ void CConnman::WakeMessageHandler()
 {
     {
         std::lock_guard<std::mutex> lock(mutexMsgProc);
-        fMsgProcWake = true;
+        for (auto& handler : vMessageHandlerThreads)
+            handler->fWake = true;
+    }
+    condMsgProc.notify_all();
+}
+
+void CConnman::GetMessageHandlerStats(std::vector<CMessageHandlerStats>& vstats) const
+{
+    vstats.clear();
+    for (size_t i = 0; i < vMessageHandlerThreads.size(); i++) {
+        const MessageHandlerThread& handler = *vMessageHandlerThreads[i];
+        CMessageHandlerStats stats;
+        stats.nThread = i;
+        stats.nPeers = handler.nPeers;
+        stats.nQueueBytes = handler.nQueueBytes;
+        stats.nMessages = handler.nMessages;
+        stats.nAvgLatencyUsec = handler.nAvgLatencyUsec;
+        stats.nMaxLatencyUsec = handler.nMaxLatencyUsec;
+        vstats.push_back(stats);
     }
-    condMsgProc.notify_one();
+}
+
+void CConnman::WakeSocketHandler()
+{
+#ifdef USE_EPOLL
+    if (wakeupPipe[1] != -1) {
+        char buf{0};
+        if (write(wakeupPipe[1], &buf, sizeof(buf)) != 1) {
+            // The pipe is full, the socket handler is already going to wake up
+        }
+    }
+#endif
 }
 
 
@@ -2204,40 +2339,53 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
+    RegisterEvents(pnode);
 }
 
 void CConnman::OpenMasternodeConnection(const CAddress &addrConnect, bool probe) {
     OpenNetworkConnection(addrConnect, false, nullptr, nullptr, false, false, false, false, true, probe);
 }
 
-void CConnman::ThreadMessageHandler()
+void CConnman::ThreadMessageHandler(int nThread)
 {
-    int64_t nLastSendMessagesTimeMasternodes = 0;
+    MessageHandlerThread& handler = *vMessageHandlerThreads[nThread];
 
     while (!flagInterruptMsgProc)
     {
         std::vector<CNode*> vNodesCopy;
         {
             LOCK(cs_vNodes);
-            vNodesCopy = vNodes;
-            for (CNode* pnode : vNodesCopy) {
+            for (CNode* pnode : vNodes) {
+                if (pnode->GetId() % nMessageHandlerThreads != nThread)
+                    continue;
+                vNodesCopy.push_back(pnode);
                 pnode->AddRef();
             }
         }
 
         bool fMoreWork = false;
-
-        bool fSkipSendMessagesForMasternodes = true;
-        if (GetTimeMillis() - nLastSendMessagesTimeMasternodes >= 100) {
-            fSkipSendMessagesForMasternodes = false;
-            nLastSendMessagesTimeMasternodes = GetTimeMillis();
-        }
+        size_t nQueueBytes = 0;
 
         for (CNode* pnode : vNodesCopy)
         {
             if (pnode->fDisconnect)
                 continue;
 
+            int64_t nTimeReceived = 0;
+            {
+                LOCK(pnode->cs_vProcessMsg);
+                nQueueBytes += pnode->nProcessQueueSize;
+                if (!pnode->vProcessMsg.empty())
+                    nTimeReceived = pnode->vProcessMsg.front().nTime;
+            }
+            if (nTimeReceived != 0) {
+                int64_t nLatency = GetTimeMicros() - nTimeReceived;
+                handler.nAvgLatencyUsec = (handler.nAvgLatencyUsec * 63 + nLatency) / 64;
+                if (nLatency > handler.nMaxLatencyUsec)
+                    handler.nMaxLatencyUsec = nLatency;
+                handler.nMessages++;
+            }
+
             // Receive messages
             bool fMoreNodeWork = m_msgproc->ProcessMessages(pnode, flagInterruptMsgProc);
             fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
@@ -2253,6 +2401,9 @@ void CConnman::ThreadMessageHandler()
                 return;
         }
 
+        handler.nPeers = vNodesCopy.size();
+        handler.nQueueBytes = nQueueBytes;
+
         {
             LOCK(cs_vNodes);
             for (CNode* pnode : vNodesCopy)
@@ -2261,9 +2412,9 @@ void CConnman::ThreadMessageHandler()
 
         WAIT_LOCK(mutexMsgProc, lock);
         if (!fMoreWork) {
-            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this] { return fMsgProcWake; });
+            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [&handler] { return handler.fWake; });
         }
-        fMsgProcWake = false;
+        handler.fWake = false;
     }
 }
 
@@ -2479,6 +2630,41 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         return false;
     }
 
+#ifdef USE_EPOLL
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        epollfd = epoll_create1(EPOLL_CLOEXEC);
+        bool fOk = epollfd != -1 && pipe(wakeupPipe) == 0;
+        for (int i = 0; fOk && i < 2; i++) {
+            int flags = fcntl(wakeupPipe[i], F_GETFL, 0);
+            fOk = fcntl(wakeupPipe[i], F_SETFL, flags | O_NONBLOCK) != -1;
+        }
+
+        // Listen sockets and the wakeup pipe stay level triggered
+        std::vector<int> vFds{wakeupPipe[0]};
+        for (const ListenSocket& hListenSocket : vhListenSocket) {
+            vFds.push_back(hListenSocket.socket);
+        }
+        for (int fd : vFds) {
+            if (!fOk)
+                break;
+            struct epoll_event e;
+            e.events = EPOLLIN;
+            e.data.fd = fd;
+            fOk = epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &e) == 0;
+        }
+
+        if (!fOk) {
+            LogPrintf("Failed to set up epoll: %s\n", NetworkErrorString(errno));
+            if (clientInterface) {
+                clientInterface->ThreadSafeMessageBox(
+                    _("Failed to set up socket events, try -socketevents=poll.").translated,
+                    "", CClientUIInterface::MSG_ERROR);
+            }
+            return false;
+        }
+    }
+#endif
+
     for (const auto& strDest : connOptions.vSeedNodes) {
         AddOneShot(strDest);
     }
@@ -2522,7 +2708,11 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 
     {
         LOCK(mutexMsgProc);
-        fMsgProcWake = false;
+        vMessageHandlerThreads.clear();
+        for (int i = 0; i < nMessageHandlerThreads; i++) {
+            vMessageHandlerThreads.emplace_back(new MessageHandlerThread());
+            vMessageHandlerThreads.back()->strName = i == 0 ? "msghand" : strprintf("msghand.%d", i);
+        }
     }
 
     // Send and receive from sockets, accept connections
@@ -2551,7 +2741,10 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     threadOpenMasternodeConnections = std::thread(&TraceThread<std::function<void()> >, "mncon", std::function<void()>(std::bind(&CConnman::ThreadOpenMasternodeConnections, this)));
 
     // Process messages
-    threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    for (int i = 0; i < nMessageHandlerThreads; i++) {
+        MessageHandlerThread& handler = *vMessageHandlerThreads[i];
+        handler.thread = std::thread(&TraceThread<std::function<void()> >, handler.strName.c_str(), std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this, i)));
+    }
 
     // Dump network addresses
     scheduler.scheduleEvery([this] { DumpAddresses(); }, DUMP_PEERS_INTERVAL);
@@ -2583,6 +2776,7 @@ void CConnman::Interrupt()
     condMsgProc.notify_all();
 
     interruptNet();
+    WakeSocketHandler();
     InterruptSocks5(true);
 
     if (semOutbound) {
@@ -2600,8 +2794,10 @@ void CConnman::Interrupt()
 
 void CConnman::Stop()
 {
-    if (threadMessageHandler.joinable())
-        threadMessageHandler.join();
+    for (auto& handler : vMessageHandlerThreads) {
+        if (handler->thread.joinable())
+            handler->thread.join();
+    }
     if (threadOpenMasternodeConnections.joinable())
         threadOpenMasternodeConnections.join();
     if (threadOpenConnections.joinable())
@@ -2637,6 +2833,15 @@ void CConnman::Stop()
     vNodes.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
+
+#ifdef USE_EPOLL
+    for (int* pfd : {&epollfd, &wakeupPipe[0], &wakeupPipe[1]}) {
+        if (*pfd != -1) {
+            close(*pfd);
+            *pfd = -1;
+        }
+    }
+#endif
     semOutbound.reset();
     semAddnode.reset();
     semMasternodeOutbound.reset();
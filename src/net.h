@@ -104,6 +104,15 @@ static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** -socketevents default */
+#ifdef USE_POLL
+static const std::string DEFAULT_SOCKETEVENTS = "poll";
+#else
+static const std::string DEFAULT_SOCKETEVENTS = "select";
+#endif
+/** -msghandthreads default, peers are split over this many message handler threads */
+static const int DEFAULT_MSGHAND_THREADS = 1;
+static const int MAX_MSGHAND_THREADS = 16;
 
 /** peercoin: Number of consecutive PoS headers are allowed from a single peer. Used to prevent out of memory attack. */
 static const int32_t MAX_CONSECUTIVE_POS_HEADERS = 20000;
@@ -119,6 +128,7 @@ struct AddedNodeInfo
 };
 
 class CNodeStats;
+struct CMessageHandlerStats;
 class CClientUIInterface;
 
 struct CSerializedNetMsg
@@ -177,7 +187,12 @@ public:
         bool m_use_addrman_outgoing = true;
         std::vector<std::string> m_specified_outgoing;
         std::vector<std::string> m_added_nodes;
+#ifdef USE_POLL
+        SocketEventsMode socketEventsMode = SOCKETEVENTS_POLL;
+#else
         SocketEventsMode socketEventsMode = SOCKETEVENTS_SELECT;
+#endif
+        int nMessageHandlerThreads = DEFAULT_MSGHAND_THREADS;
     };
 
     void Init(const Options& connOptions) {
@@ -207,6 +222,7 @@ public:
             vAddedNodes = connOptions.m_added_nodes;
         }
         socketEventsMode = connOptions.socketEventsMode;
+        nMessageHandlerThreads = std::max(1, std::min(connOptions.nMessageHandlerThreads, MAX_MSGHAND_THREADS));
     }
 
     CConnman(uint64_t seed0, uint64_t seed1);
@@ -468,6 +484,9 @@ public:
     unsigned int GetReceiveFloodSize() const;
 
     void WakeMessageHandler();
+    void GetMessageHandlerStats(std::vector<CMessageHandlerStats>& vstats) const;
+    /** Interrupt the socket handler waiting for events, only does something in epoll mode */
+    void WakeSocketHandler();
 
     /** Attempts to obfuscate tx time through exponentially distributed emitting.
         Works assuming that a single interval is used.
@@ -492,13 +511,22 @@ private:
     void AddOneShot(const std::string& strDest);
     void ProcessOneShot();
     void ThreadOpenConnections(std::vector<std::string> connect);
-    void ThreadMessageHandler();
+    void ThreadMessageHandler(int nThread);
     void AcceptConnection(const ListenSocket& hListenSocket);
     void DisconnectNodes();
     void NotifyNumConnectionsChanged();
     void InactivityCheck(CNode *pnode);
     bool GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
     void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#ifdef USE_POLL
+    void SocketEventsPoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#else
+    void SocketEventsSelect(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#endif
+#ifdef USE_EPOLL
+    void SocketEventsEpoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#endif
+    void RegisterEvents(CNode* pnode);
     void SocketHandler();
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
@@ -607,8 +635,26 @@ private:
     /** SipHasher seeds for deterministic randomness */
     const uint64_t nSeed0, nSeed1;
 
-    /** flag for waking the message processor. */
-    bool fMsgProcWake;
+    /**
+     * Message handler threads, a peer is always handled by thread (id % nMessageHandlerThreads)
+     * so its messages are processed in order. PeerLogicValidation serializes everything but
+     * the extension messages (LLMQ, governance, smsg) that have their own locking.
+     */
+    struct MessageHandlerThread
+    {
+        std::string strName;
+        std::thread thread;
+        /** flag for waking the message processor, protected by mutexMsgProc */
+        bool fWake{false};
+
+        std::atomic<size_t> nPeers{0};
+        std::atomic<size_t> nQueueBytes{0};
+        std::atomic<uint64_t> nMessages{0};
+        std::atomic<int64_t> nAvgLatencyUsec{0};
+        std::atomic<int64_t> nMaxLatencyUsec{0};
+    };
+    int nMessageHandlerThreads{DEFAULT_MSGHAND_THREADS};
+    std::vector<std::unique_ptr<MessageHandlerThread>> vMessageHandlerThreads;
 
     std::condition_variable condMsgProc;
     Mutex mutexMsgProc;
@@ -617,6 +663,14 @@ private:
     CThreadInterrupt interruptNet;
 
     SocketEventsMode socketEventsMode;
+#ifdef USE_EPOLL
+    /** epoll instance with every socket registered once, -1 if not in epoll mode */
+    int epollfd{-1};
+    /** Written to by WakeSocketHandler, read end is registered with epollfd */
+    int wakeupPipe[2]{-1, -1};
+#endif
+    /** A node was left with received data to read in the last SocketHandler run, don't wait for new events */
+    bool fSocketEventsPending{false};
 
     /** Protected by cs_vNodes */
     std::unordered_map<NodeId, CNode*> mapReceivableNodes GUARDED_BY(cs_vNodes);
@@ -630,7 +684,6 @@ private:
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
     std::thread threadOpenMasternodeConnections;
-    std::thread threadMessageHandler;
 
     /** flag for deciding to connect to an extra outbound peer,
      *  in excess of m_max_outbound_full_relay
@@ -734,6 +787,18 @@ extern std::map<CNetAddr, int32_t> mapPoSTemperature;
 extern const std::string NET_MESSAGE_COMMAND_OTHER;
 typedef std::map<std::string, uint64_t> mapMsgCmdSize; //command, total bytes
 
+struct CMessageHandlerStats
+{
+    int nThread;
+    size_t nPeers;
+    /** Bytes of received messages waiting for this thread */
+    size_t nQueueBytes;
+    uint64_t nMessages;
+    /** How long the next message of a peer waited when the thread got to it, moving average and max */
+    int64_t nAvgLatencyUsec;
+    int64_t nMaxLatencyUsec;
+};
+
 class CNodeStats
 {
 public:
@@ -830,6 +895,7 @@ public:
         ignoreUntil     = 0;
         nWakeCounter    = 0;
         nPeerId         = 0;
+        nVersion        = 1;
         fEnabled        = false;
     };
 
@@ -840,6 +906,7 @@ public:
     int64_t                     ignoreUntil;
     uint32_t                    nWakeCounter;
     uint32_t                    nPeerId;
+    uint32_t                    nVersion;       // highest smsg version the peer accepts, from smsgPong
     bool                        fEnabled;
 
 };
@@ -918,6 +985,10 @@ public:
     const uint64_t nKeyedNetGroup;
     std::atomic_bool fPauseRecv{false};
     std::atomic_bool fPauseSend{false};
+    // An edge triggered event is only reported once, the socket handler remembers it here
+    // until a recv or send would block. Only used in epoll mode, by the socket handler thread.
+    bool fHasRecvData{false};
+    bool fCanSendData{false};
 
 protected:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
@@ -36,6 +36,7 @@
 #include <util/validation.h>
 #include <unordered_limitedmap.h>
 #include <memory>
+#include <set>
 
 #include <spork.h>
 #include <governance/governance.h>
@@ -114,6 +115,11 @@ struct COrphanTx {
     size_t list_pos;
 };
 RecursiveMutex g_cs_orphans;
+/**
+ * Held by the message handler threads while processing anything but the extension messages
+ * in IsParallelMessage, net_processing state is not safe to use from more than one of them.
+ */
+static RecursiveMutex g_cs_msgproc;
 std::map<uint256, COrphanTx> mapOrphanTransactions GUARDED_BY(g_cs_orphans);
 
 void EraseOrphansFor(NodeId peer);
@@ -3823,6 +3829,23 @@ bool PeerLogicValidation::SendRejectsAndCheckIfBanned(CNode* pnode, bool enable_
     return false;
 }
 
+/**
+ * LLMQ and governance messages go to managers that do their own locking, -msghandthreads
+ * lets them run on all message handler threads at once so a big batch of them from one peer
+ * doesn't hold up everyone else. smsg messages stay under g_cs_msgproc: SecureMsgReceiveData
+ * takes cs_main while holding cs_smsg, and SendMessages takes them the other way around.
+ */
+static bool IsParallelMessage(const std::string& strCommand)
+{
+    static const std::set<std::string> setParallelMessages = {
+        NetMsgType::QSIGSESANN, NetMsgType::QSIGSHARESINV, NetMsgType::QGETSIGSHARES, NetMsgType::QBSIGSHARES,
+        NetMsgType::QSIGSHARE, NetMsgType::QSIGREC, NetMsgType::QCONTRIB, NetMsgType::QCOMPLAINT,
+        NetMsgType::QJUSTIFICATION, NetMsgType::QPCOMMITMENT,
+        NetMsgType::MNGOVERNANCESYNC, NetMsgType::MNGOVERNANCEOBJECT, NetMsgType::MNGOVERNANCEOBJECTVOTE,
+    };
+    return setParallelMessages.count(strCommand) != 0;
+}
+
 bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
 {
     const CChainParams& chainparams = Params();
@@ -3836,11 +3859,14 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     //
     bool fMoreWork = false;
 
-    if (!pfrom->vRecvGetData.empty())
+    if (!pfrom->vRecvGetData.empty()) {
+        LOCK(g_cs_msgproc);
         ProcessGetData(pfrom, chainparams, connman, interruptMsgProc);
+    }
 
     if (!pfrom->orphan_work_set.empty()) {
         std::list<CTransactionRef> removed_txn;
+        LOCK(g_cs_msgproc);
         LOCK2(cs_main, g_cs_orphans);
         ProcessOrphanTx(connman, pfrom->orphan_work_set, removed_txn);
         for (const CTransactionRef& removedTx : removed_txn) {
@@ -3861,6 +3887,7 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         return false;
 
     std::list<CNetMessage> msgs;
+    bool fResumeRecv = false;
     {
         LOCK(pfrom->cs_vProcessMsg);
         if (pfrom->vProcessMsg.empty())
@@ -3868,9 +3895,15 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         // Just take one message
         msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
         pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
-        pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize();
+        bool fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize();
+        fResumeRecv = pfrom->fPauseRecv && !fPauseRecv;
+        pfrom->fPauseRecv = fPauseRecv;
         fMoreWork = !pfrom->vProcessMsg.empty();
     }
+    if (fResumeRecv) {
+        // In epoll mode the socket handler won't see another edge for data it left in the socket
+        connman->WakeSocketHandler();
+    }
     CNetMessage& msg(msgs.front());
 
     msg.SetVersion(pfrom->GetRecvVersion());
@@ -3922,7 +3955,12 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     bool fRet = false;
     try
     {
-        fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc, m_enable_bip61);
+        if (IsParallelMessage(strCommand)) {
+            fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc, m_enable_bip61);
+        } else {
+            LOCK(g_cs_msgproc);
+            fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc, m_enable_bip61);
+        }
         if (interruptMsgProc)
             return false;
         if (!pfrom->vRecvGetData.empty())
@@ -4124,6 +4162,7 @@ public:
 
 bool PeerLogicValidation::SendMessages(CNode* pto)
 {
+    LOCK(g_cs_msgproc);
     const Consensus::Params& consensusParams = Params().GetConsensus();
     {
         // Don't send anything until the version handshake is complete
@@ -44,26 +44,25 @@ uint256 ComputeStakeModifier(const CBlockIndex* pindexPrev, const uint256& kerne
     return Hash(ss.begin(), ss.end());
 }
 
-bool CheckStakeKernelHash(const CBlockIndex* pindexPrev, unsigned int nBits, const CTransactionRef& txPrev, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProof, bool fPrintProofOfStake)
+bool CheckStakeKernelHash(const CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeTxPrev, CAmount nValueIn, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProof, bool fPrintProofOfStake)
 {
-    if (nTimeTx < txPrev->nTime)  // Transaction timestamp violation
-        return error(" %s, nTime violation on coinstake %s", __func__, txPrev->GetHash().ToString());
+    if (nTimeTx < nTimeTxPrev)  // Transaction timestamp violation
+        return error(" %s, nTime violation on coinstake %s", __func__, prevout.hash.ToString());
 
-    if (txPrev->nTime + Params().GetConsensus().nStakeMinAge > nTimeTx) // Min age requirement
-        return error(" %s, min age violation on coinstake %s", __func__, txPrev->GetHash().ToString());
+    if (nTimeTxPrev + Params().GetConsensus().nStakeMinAge > nTimeTx) // Min age requirement
+        return error(" %s, min age violation on coinstake %s", __func__, prevout.hash.ToString());
 
     arith_uint256 bnTarget = arith_uint256().SetCompact(nBits);
-    int64_t nValueIn = txPrev->vout[prevout.n].nValue.GetAmount();
-    arith_uint256 bnWeight = arith_uint256(nValueIn) * GetWeight((int64_t)txPrev->nTime, (int64_t)nTimeTx) / COIN / (24 * 60 * 60);
+    arith_uint256 bnWeight = arith_uint256(nValueIn) * GetWeight((int64_t)nTimeTxPrev, (int64_t)nTimeTx) / COIN / (24 * 60 * 60);
 
     CDataStream ss(SER_GETHASH, 0);
-    ss << pindexPrev->nStakeModifier << txPrev->nTime << prevout.hash << prevout.n << nTimeTx;
+    ss << pindexPrev->nStakeModifier << nTimeTxPrev << prevout.hash << prevout.n << nTimeTx;
     hashProof = Hash(ss.begin(), ss.end());
  
     if (fPrintProofOfStake)
     {
         LogPrintf("%s : nStakeModifier=%s, txPrev.nTime=%u, txPrev.vout.hash=%s, txPrev.vout.n=%u, nTime=%u, hashProofOfStake=%s, targetProofOfStake=%s\n", __func__, pindexPrev->nStakeModifier.GetHex().c_str(),
-            txPrev->nTime, prevout.hash.ToString(), prevout.n, nTimeTx, hashProof.ToString(), (bnWeight * bnTarget).ToString());
+            nTimeTxPrev, prevout.hash.ToString(), prevout.n, nTimeTx, hashProof.ToString(), (bnWeight * bnTarget).ToString());
     }
 
     // We need to convert type so it can be compared to target
@@ -76,6 +75,11 @@ bool CheckStakeKernelHash(const CBlockIndex* pindexPrev, unsigned int nBits, con
     return true;
 }
 
+bool CheckStakeKernelHash(const CBlockIndex* pindexPrev, unsigned int nBits, const CTransactionRef& txPrev, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProof, bool fPrintProofOfStake)
+{
+    return CheckStakeKernelHash(pindexPrev, nBits, txPrev->nTime, txPrev->vout[prevout.n].nValue.GetAmount(), prevout, nTimeTx, hashProof, fPrintProofOfStake);
+}
+
 bool CheckKernel(unsigned int nBits, uint32_t nTime, const COutPoint& prevout)
 {
     CBlockIndex* pindexPrev = ::ChainActive().Tip();
@@ -113,24 +117,25 @@ bool CheckKernel(unsigned int nBits, uint32_t nTime, const COutPoint& prevout)
     return CheckStakeKernelHash(pindexPrev, nBits, txPrev, prevout, nTime, hashProof, gArgs.GetBoolArg("-debug", false));
 }
 
-// Check kernel hash target and coinstake signature
-bool CheckProofOfStake(CBlockIndex* pindexPrev, const CTransactionRef& tx, unsigned int nBits, uint256& hashProof, CCoinsViewCache& view)
+// Find the coin spent by the kernel of a block building on pindexPrev
+static bool GetKernelCoin(CBlockIndex* pindexPrev, const COutPoint& prevout, CCoinsViewCache& view, Coin& coin)
 {
-    if (!tx->IsCoinStake())
-        return error("CheckProofOfStake() :  called on non-coinstake %s ", tx->vin[0].prevout.hash.ToString());
+    if (view.GetCoin(prevout, coin))
+        return true;
 
-    // Kernel (input 0) must match the stake hash target (nBits)
-    const CTxIn& txin = tx->vin[0];
+    // The kernel may have been spent on the main chain after the fork point of pindexPrev
+    if (GetSpentCoinFromMainChain(pindexPrev, prevout, &coin))
+        return true;
 
+    // Blocks that are accepted ahead of the tip may stake an output that is not
+    // in the coins view yet, use the transaction index for those if available
     if (!g_txindex)
-        return error("%s: transaction index is not enabled ", __func__);
+        return false;
 
-    // Get transaction index for the previous transaction
     CDiskTxPos postx;
-    if (!pblocktree->ReadTxIndex(txin.prevout.hash, postx))
-        return error("%s: transaction index not available ", __func__);
+    if (!pblocktree->ReadTxIndex(prevout.hash, postx))
+        return false;
 
-    // Read txPrev and header of its block
     CBlockHeader header;
     CTransactionRef txPrev;
     {
@@ -140,25 +145,52 @@ bool CheckProofOfStake(CBlockIndex* pindexPrev, const CTransactionRef& tx, unsig
             fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
             file >> txPrev;
         } catch (std::exception &e) {
-            return error("%s() : deserialize or I/O error in CheckProofOfStake()", __PRETTY_FUNCTION__);
+            return error("%s() : deserialize or I/O error", __func__);
         }
-        if (txPrev->GetHash() != txin.prevout.hash)
-            return error("%s() : txid mismatch in CheckProofOfStake()", __PRETTY_FUNCTION__);
     }
+    if (txPrev->GetHash() != prevout.hash || prevout.n >= txPrev->vout.size())
+        return error("%s() : txid mismatch", __func__);
+
+    coin = Coin(txPrev->vout[prevout.n], 0, txPrev->IsCoinBase(), txPrev->IsCoinStake(), txPrev->nTime);
+    return true;
+}
+
+// Check kernel hash target and coinstake signature
+// The kernel input is taken from the coins view, which has everything the kernel
+// and the signature depend on (txPrev nTime and the spent output)
+bool CheckProofOfStake(CBlockIndex* pindexPrev, const CTransactionRef& tx, unsigned int nBits, uint256& hashProof, CCoinsViewCache& view, bool fCheckSignature)
+{
+    if (!tx->IsCoinStake())
+        return error("CheckProofOfStake() :  called on non-coinstake %s ", tx->vin[0].prevout.hash.ToString());
+
+    // Kernel (input 0) must match the stake hash target (nBits)
+    const CTxIn& txin = tx->vin[0];
+
+    Coin coinPrev;
+    if (!GetKernelCoin(pindexPrev, txin.prevout, view, coinPrev))
+        return error("%s: kernel input %s not found", __func__, txin.prevout.ToString());
+
+    // The kernel hash is cheap, check it before the signature
+    if (!CheckStakeKernelHash(pindexPrev, nBits, coinPrev.nTime, coinPrev.out.nValue.GetAmount(), txin.prevout, tx->nTime, hashProof, gArgs.GetBoolArg("-debug", false)))
+        return false;
+
+    if (!fCheckSignature)
+        return true;
 
     // Verify signature
     {
         unsigned int nIn = 0;
-        const CTxOut& prevOut = txPrev->vout[tx->vin[nIn].prevout.n];
+        const CTxOut& prevOut = coinPrev.out;
         const CScriptWitness* pScriptWitness = (tx->witness.vtxinwit.size() > nIn ? &tx->witness.vtxinwit[nIn].scriptWitness : nullptr);
-        TransactionSignatureChecker checker(&(*tx), nIn, prevOut.nValue, PrecomputedTransactionData(*tx));
+        PrecomputedTransactionData txdata(*tx);
+        TransactionSignatureChecker checker(&(*tx), nIn, prevOut.nValue, txdata);
         ScriptError serror = SCRIPT_ERR_OK;
 
         if (!VerifyScript(tx->vin[nIn].scriptSig, prevOut.scriptPubKey, pScriptWitness, SCRIPT_VERIFY_P2SH, checker, &serror))
             return error(" VerifyScript failed on coinstake %s %s", tx->GetHash().ToString(), ScriptErrorString(serror));
     }
 
-    return CheckStakeKernelHash(pindexPrev, nBits, txPrev, txin.prevout, tx->nTime, hashProof, gArgs.GetBoolArg("-debug", false));
+    return true;
 }
 
 
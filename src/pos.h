@@ -4,7 +4,9 @@
 #ifndef RAIN_POS_H
 #define RAIN_POS_H
 
-
+#include <amount.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
 
 class CBlock;
 class CBlockIndex;
@@ -13,16 +15,35 @@ class CBlockIndex;
 // Supposed to be 2^n-1
 static const uint32_t STAKE_TIMESTAMP_MASK = 15;
 
+// Kernel input data a staker keeps in memory for each of its candidate outputs,
+// so that kernel attempts do not need to read txPrev back from the block files
+struct CStakeCandidate
+{
+    uint32_t nTimeTxPrev{0};    // nTime of the transaction that created the output
+    CAmount nValue{0};          // value of the output
+    int64_t nBlockTime{0};      // time of the block that confirmed the output
+    CScript scriptPubKey;
+};
+
+// Get time weight of a stake input, capped at nStakeMaxAge
+int64_t GetWeight(int64_t nIntervalBeginning, int64_t nIntervalEnd);
+
 // Compute the hash modifier for proof-of-stake
 uint256 ComputeStakeModifier(const CBlockIndex* pindexPrev, const uint256& kernel);
 
 // Check whether stake kernel meets hash target
 // Sets hashProofOfStake on success return
-bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBlockHeader& blockFrom, unsigned int nTxPrevOffset, const CTransactionRef& txPrev, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProofOfStake, bool fPrintProofOfStake);
+bool CheckStakeKernelHash(const CBlockIndex* pindexPrev, unsigned int nBits, const CTransactionRef& txPrev, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProofOfStake, bool fPrintProofOfStake);
+
+// Same as above, but only takes the txPrev fields the kernel depends on
+// Does no disk access, used by the stake miner's candidate cache
+bool CheckStakeKernelHash(const CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeTxPrev, CAmount nValueIn, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProofOfStake, bool fPrintProofOfStake);
 
 // Check kernel hash target and coinstake signature
 // Sets hashProofOfStake on success return
-bool CheckProofOfStake(CBlockIndex* pindexPrev, const CTransactionRef& tx, unsigned int nBits, uint256& hashProofOfStake, CCoinsViewCache& view);
+// fCheckSignature can be false only if the caller verifies the kernel input script itself,
+// e.g. ConnectBlock() where it is part of the coinstake's script checks
+bool CheckProofOfStake(CBlockIndex* pindexPrev, const CTransactionRef& tx, unsigned int nBits, uint256& hashProofOfStake, CCoinsViewCache& view, bool fCheckSignature = true);
 // Check whether the coinstake timestamp meets protocol
 bool CheckCoinStakeTimestamp(uint32_t nTimeBlock, uint32_t nTimeTx);
 
@@ -6,6 +6,7 @@
 #include <primitives/block.h>
 #include <groestl.h>
 #include <hash.h>
+#include <streams.h>
 #include <tinyformat.h>
 #include <crypto/common.h>
 #include <util/strencodings.h>
@@ -29,6 +30,13 @@ uint256 CBlockHeader::GetHash() const
     return SerializeHash(*this);
 }
 
+CSHA256DNonce CBlockHeader::GetNonceHasher() const
+{
+    std::vector<unsigned char> vch;
+    CVectorWriter(SER_GETHASH, PROTOCOL_VERSION, vch, 0, *this);
+    return CSHA256DNonce(vch.data(), vch.size(), NONCE_OFFSET);
+}
+
 std::string CBlockHeader::ToString() const
 {
     std::stringstream s;
@@ -6,6 +6,7 @@
 #ifndef RAIN_PRIMITIVES_BLOCK_H
 #define RAIN_PRIMITIVES_BLOCK_H
 
+#include <crypto/sha256.h>
 #include <primitives/transaction.h>
 #include <serialize.h>
 #include <uint256.h>
@@ -20,6 +21,9 @@
 class CBlockHeader
 {
 public:
+    // offset of nNonce in the serialized header
+    static const size_t NONCE_OFFSET = 4 + 32 + 32 + 4 + 4 + 4;
+
     // header
     int32_t nVersion;
     uint256 hashPrevBlock;
@@ -72,6 +76,9 @@ public:
     uint256 GetHash() const;
     uint256 GetGroestlHash() const;
 
+    // GetHash() for a range of nonces, the part of the header before nNonce is only hashed once
+    CSHA256DNonce GetNonceHasher() const;
+
     uint256 GetHashWithoutSign() const;
 
     int64_t GetBlockTime() const
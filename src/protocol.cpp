@@ -51,6 +51,7 @@ const char *SMSGPING = "smsgPing";
 const char *SMSGPONG = "smsgPong";
 const char *SMSGDISABLED = "smsgDisabled";
 const char *SMSGSHOW = "smsgShow";
+const char *SMSGSHOWDIFF = "smsgShowDiff";
 const char *SMSGMATCH = "smsgMatch";
 const char *SMSGHAVE = "smsgHave";
 const char *SMSGWANT = "smsgWant";
@@ -132,6 +133,7 @@ const static std::string allNetMessageTypes[] = {
     NetMsgType::SMSGPONG,
     NetMsgType::SMSGDISABLED,
     NetMsgType::SMSGSHOW,
+    NetMsgType::SMSGSHOWDIFF,
     NetMsgType::SMSGMATCH,
     NetMsgType::SMSGHAVE,
     NetMsgType::SMSGWANT,
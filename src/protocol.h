@@ -245,6 +245,7 @@ extern const char *SMSGPING;
 extern const char *SMSGPONG;
 extern const char *SMSGDISABLED;
 extern const char *SMSGSHOW;
+extern const char *SMSGSHOWDIFF;
 extern const char *SMSGMATCH;
 extern const char *SMSGHAVE;
 extern const char *SMSGWANT;
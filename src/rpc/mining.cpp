@@ -11,6 +11,7 @@
 #include <consensus/params.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <kernelscanner.h>
 #include <key_io.h>
 #include <miner.h>
 #include <net.h>
@@ -145,7 +146,7 @@ UniValue setgenerate(const JSONRPCRequest& request)
     if(nGenProcLimit == 0)
         fGenerate = false;
 
-    std::shared_ptr<CTxDestination> coinbase_script;
+    std::shared_ptr<CTxDestination> coinbase_script = std::make_shared<CTxDestination>();
     std::string stringerror;
     if(!pwallet->GetNewDestination(OutputType::LEGACY,"mining", *coinbase_script, stringerror, "mining"))
         throw JSONRPCError(RPC_WALLET_KEYPOOL_RAN_OUT, stringerror);
@@ -271,6 +272,9 @@ static UniValue getmininginfo(const JSONRPCRequest& request)
                     "  \"currentblocksize\": nnn, (numeric, optional) The block weight of the last assembled block (only present if a block was ever assembled)\n"
                     "  \"currentblocktx\": nnn,     (numeric, optional) The number of block transactions of the last assembled block (only present if a block was ever assembled)\n"
                     "  \"difficulty\": xxx.xxxxx    (numeric) The current difficulty\n"
+                    "  \"generate\": true|false     (boolean) If the internal miner is running\n"
+                    "  \"genproclimit\": n          (numeric) The number of internal miner hashing threads\n"
+                    "  \"hashespersec\": nnn,       (numeric) The hashes per second of the internal miner\n"
                     "  \"networkhashps\": nnn,      (numeric) The network hashes per second\n"
                     "  \"pooledtx\": n              (numeric) The size of the mempool\n"
                     "  \"chain\": \"xxxx\",           (string) current network name as defined in BIP70 (main, test, regtest)\n"
@@ -316,6 +320,9 @@ static UniValue getmininginfo(const JSONRPCRequest& request)
     obj.pushKV("netmhashps",       GetPoWMHashPS());
     obj.pushKV("netstakeweight",   GetPoSKernelPS());
 
+    obj.pushKV("generate",         GetMinerThreads() > 0);
+    obj.pushKV("genproclimit",     GetMinerThreads());
+    obj.pushKV("hashespersec",     GetMinerHashesPerSec());
     obj.pushKV("networkhashps",    getnetworkhashps(request));
     obj.pushKV("pooledtx",         (uint64_t)mempool.size());
 
@@ -371,6 +378,11 @@ static UniValue getstakinginfo(const JSONRPCRequest& request)
 
     obj.pushKV("expectedtime", (uint64_t)nExpectedTime);
 
+    if (g_kernel_scanner) {
+        obj.pushKV("kernelhashps", g_kernel_scanner->GetHashesPerSecond());
+        obj.pushKV("kernelhashes", g_kernel_scanner->GetTotalHashes());
+    }
+
     return obj;
 }
 
@@ -3,6 +3,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <clientversion.h>
 #include <crypto/ripemd160.h>
 #include <key_io.h>
 #include <httpserver.h>
@@ -17,6 +18,7 @@
 #include <txmempool.h>
 #include <masternode/masternode-sync.h>
 #include <spork.h>
+#include <streams.h>
 #include <validation.h>
 
 #ifdef ENABLE_WALLET
@@ -591,6 +593,88 @@ bool timestampSort(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
     return a.second.time < b.second.time;
 }
 
+static const int MAX_ADDRESS_INDEX_PAGE = 10000;
+
+/**
+ * Page size and the key to continue from of a paged address index query, from the "limit" and
+ * "cursor" params. Returns false if the query isn't paged.
+ */
+template<typename Key>
+static bool getAddressPageFromParams(const UniValue& params, size_t& nLimit, Key& next)
+{
+    nLimit = 0;
+    next.SetNull();
+    if (!params[0].isObject())
+        return false;
+
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    UniValue cursorValue = find_value(params[0].get_obj(), "cursor");
+    if (limitValue.isNull()) {
+        if (!cursorValue.isNull())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "cursor requires limit");
+        return false;
+    }
+
+    int limit = limitValue.get_int();
+    if (limit <= 0 || limit > MAX_ADDRESS_INDEX_PAGE)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("limit is expected to be between 1 and %d", MAX_ADDRESS_INDEX_PAGE));
+    nLimit = limit;
+
+    if (!cursorValue.isNull()) {
+        std::vector<unsigned char> data = ParseHexV(cursorValue, "cursor");
+        try {
+            CDataStream ssKey(data, SER_DISK, CLIENT_VERSION);
+            ssKey >> next;
+            if (!ssKey.empty() || next.hashBytes.IsNull())
+                throw std::ios_base::failure("trailing data");
+        } catch (const std::exception&) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+    }
+    return true;
+}
+
+template<typename Key>
+static std::string getAddressPageCursor(const Key& next)
+{
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ssKey << next;
+    return HexStr(ssKey.begin(), ssKey.end());
+}
+
+/**
+ * Read up to nLimit entries of the addresses, in the order they were given, starting at next.
+ * read(hash, type, nLimit, next) reads the entries of one address. next is set to the entry
+ * the next page starts at, or null if there are no more.
+ */
+template<typename Key, typename Entry, typename ReadFn>
+static void readAddressPage(const std::vector<std::pair<uint160, int> >& addresses, size_t nLimit, Key& next,
+                            std::vector<Entry>& entries, ReadFn read)
+{
+    auto it = addresses.begin();
+    if (!next.hashBytes.IsNull()) {
+        while (it != addresses.end() && (it->first != next.hashBytes || it->second != (int)next.type))
+            it++;
+        if (it == addresses.end())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "cursor does not belong to the addresses");
+    }
+
+    for (; it != addresses.end(); it++) {
+        if (entries.size() >= nLimit) {
+            // -- the page ends between two addresses, continue at the first entry of the next
+            next.SetNull();
+            next.type = it->second;
+            next.hashBytes = it->first;
+            return;
+        }
+        if (!read(it->first, it->second, nLimit - entries.size(), next)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+        if (!next.hashBytes.IsNull())
+            return;
+    }
+}
+
 UniValue getaddressmempool(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -675,6 +759,8 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
             "      \"address\"  (string) The base58check encoded address\n"
             "      ,...\n"
             "    ]\n"
+            "  \"limit\" (number, optional) Return at most this many outputs, ordered by address and txid\n"
+            "  \"cursor\" (string, optional) The cursor returned by the previous page\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -687,6 +773,11 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
             "    \"height\"  (number) The block height\n"
             "  }\n"
             "]\n"
+            "\nResult (with limit):\n"
+            "{\n"
+            "  \"utxos\"  (array) The outputs, as above\n"
+            "  \"cursor\"  (string) Pass to get the next page, absent on the last page\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
             + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
@@ -701,13 +792,24 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
     std::string assetName="";
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressUnspent((*it).first, (*it).second, assetName, unspentOutputs)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    size_t nLimit;
+    CAddressUnspentKey next;
+    bool fPaged = getAddressPageFromParams(request.params, nLimit, next);
+
+    if (fPaged) {
+        readAddressPage(addresses, nLimit, next, unspentOutputs,
+            [&](const uint160& hash, int type, size_t nRemaining, CAddressUnspentKey& key) {
+                return GetAddressUnspent(hash, type, assetName, unspentOutputs, nRemaining, &key);
+            });
+    } else {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (!GetAddressUnspent((*it).first, (*it).second, assetName, unspentOutputs)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
         }
-    }
 
-    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+        std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+    }
 
     UniValue result(UniValue::VARR);
 
@@ -727,6 +829,14 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
         result.push_back(output);
     }
 
+    if (fPaged) {
+        UniValue page(UniValue::VOBJ);
+        page.pushKV("utxos", result);
+        if (!next.hashBytes.IsNull())
+            page.pushKV("cursor", getAddressPageCursor(next));
+        return page;
+    }
+
     return result;
 }
 
@@ -745,6 +855,8 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Return at most this many changes\n"
+            "  \"cursor\" (string, optional) The cursor returned by the previous page\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -757,6 +869,11 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "    \"address\"  (string) The base58check encoded address\n"
             "  }\n"
             "]\n"
+            "\nResult (with limit):\n"
+            "{\n"
+            "  \"deltas\"  (array) The changes, as above\n"
+            "  \"cursor\"  (string) Pass to get the next page, absent on the last page\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
             + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
@@ -786,15 +903,25 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
     std::string assetName="";
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
+    if (start <= 0 || end <= 0) {
+        start = 0;
+        end = 0;
+    }
+
+    size_t nLimit;
+    CAddressIndexKey next;
+    bool fPaged = getAddressPageFromParams(request.params, nLimit, next);
+
+    if (fPaged) {
+        readAddressPage(addresses, nLimit, next, addressIndex,
+            [&](const uint160& hash, int type, size_t nRemaining, CAddressIndexKey& key) {
+                return GetAddressIndex(hash, type, assetName, addressIndex, start, end, nRemaining, &key);
+            });
+    } else {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
             if (!GetAddressIndex((*it).first, (*it).second, assetName, addressIndex, start, end)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second,assetName, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
         }
     }
 
@@ -816,6 +943,14 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         result.push_back(delta);
     }
 
+    if (fPaged) {
+        UniValue page(UniValue::VOBJ);
+        page.pushKV("deltas", result);
+        if (!next.hashBytes.IsNull())
+            page.pushKV("cursor", getAddressPageCursor(next));
+        return page;
+    }
+
     return result;
 }
 
@@ -849,23 +984,13 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::string assetName="";
-
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, assetName, addressIndex)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
-    }
-
     CAmount balance = 0;
     CAmount received = 0;
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        if (it->second > 0) {
-            received += it->second;
+    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        if (!GetAddressBalance((*it).first, (*it).second, balance, received)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
-        balance += it->second;
     }
 
     UniValue result(UniValue::VOBJ);
@@ -891,12 +1016,20 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Read at most this many index entries, txids are ordered by\n"
+            "           address and not sorted by height across addresses\n"
+            "  \"cursor\" (string, optional) The cursor returned by the previous page\n"
             "}\n"
             "\nResult:\n"
             "[\n"
             "  \"transactionid\"  (string) The transaction id\n"
             "  ,...\n"
             "]\n"
+            "\nResult (with limit):\n"
+            "{\n"
+            "  \"txids\"  (array) The transaction ids, as above\n"
+            "  \"cursor\"  (string) Pass to get the next page, absent on the last page\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
             + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
@@ -922,13 +1055,23 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
     std::string assetName="";
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, assetName,  addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, assetName, addressIndex)) {
+    if (start <= 0 || end <= 0) {
+        start = 0;
+        end = 0;
+    }
+
+    size_t nLimit;
+    CAddressIndexKey next;
+    bool fPaged = getAddressPageFromParams(request.params, nLimit, next);
+
+    if (fPaged) {
+        readAddressPage(addresses, nLimit, next, addressIndex,
+            [&](const uint160& hash, int type, size_t nRemaining, CAddressIndexKey& key) {
+                return GetAddressIndex(hash, type, assetName, addressIndex, start, end, nRemaining, &key);
+            });
+    } else {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (!GetAddressIndex((*it).first, (*it).second, assetName, addressIndex, start, end)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
         }
@@ -941,7 +1084,7 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
         int height = it->first.blockHeight;
         std::string txid = it->first.txhash.GetHex();
 
-        if (addresses.size() > 1) {
+        if (addresses.size() > 1 && !fPaged) {
             txids.insert(std::make_pair(height, txid));
         } else {
             if (txids.insert(std::make_pair(height, txid)).second) {
@@ -950,12 +1093,20 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
         }
     }
 
-    if (addresses.size() > 1) {
+    if (addresses.size() > 1 && !fPaged) {
         for (std::set<std::pair<int, std::string> >::const_iterator it=txids.begin(); it!=txids.end(); it++) {
             result.push_back(it->second);
         }
     }
 
+    if (fPaged) {
+        UniValue page(UniValue::VOBJ);
+        page.pushKV("txids", result);
+        if (!next.hashBytes.IsNull())
+            page.pushKV("cursor", getAddressPageCursor(next));
+        return page;
+    }
+
     return result;
 
 }
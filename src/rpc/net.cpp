@@ -478,7 +478,18 @@ static UniValue getnetworkinfo(const JSONRPCRequest& request)
             "    \"score\": xxx                         (numeric) relative score\n"
             "  }\n"
             "  ,...\n"
-            "  ]\n"
+            "  ],\n"
+            "  \"messagehandlers\": [                   (array) message handler threads, see -msghandthreads\n"
+            "  {\n"
+            "    \"thread\": n,                       (numeric) thread number\n"
+            "    \"peers\": n,                        (numeric) number of peers handled by the thread\n"
+            "    \"queuebytes\": n,                   (numeric) bytes of received messages waiting to be processed\n"
+            "    \"messages\": n,                     (numeric) messages the thread got to since start\n"
+            "    \"avglatency\": n,                   (numeric) moving average of how long a message waited, in microseconds\n"
+            "    \"maxlatency\": n                    (numeric) longest a message waited since start, in microseconds\n"
+            "  }\n"
+            "  ,...\n"
+            "  ],\n"
             "  \"warnings\": \"...\"                    (string) any network and blockchain warnings\n"
             "}\n"
                 },
@@ -520,6 +531,22 @@ static UniValue getnetworkinfo(const JSONRPCRequest& request)
         }
     }
     obj.pushKV("localaddresses", localAddresses);
+    if (g_connman) {
+        std::vector<CMessageHandlerStats> vstats;
+        g_connman->GetMessageHandlerStats(vstats);
+        UniValue messageHandlers(UniValue::VARR);
+        for (const CMessageHandlerStats& stats : vstats) {
+            UniValue rec(UniValue::VOBJ);
+            rec.pushKV("thread", stats.nThread);
+            rec.pushKV("peers", (uint64_t)stats.nPeers);
+            rec.pushKV("queuebytes", (uint64_t)stats.nQueueBytes);
+            rec.pushKV("messages", stats.nMessages);
+            rec.pushKV("avglatency", stats.nAvgLatencyUsec);
+            rec.pushKV("maxlatency", stats.nMaxLatencyUsec);
+            messageHandlers.push_back(rec);
+        }
+        obj.pushKV("messagehandlers", messageHandlers);
+    }
     obj.pushKV("warnings",       GetWarnings("statusbar"));
     return obj;
 }
@@ -1124,6 +1124,52 @@ UniValue protx_diff(const JSONRPCRequest& request)
     return ret;
 }
 
+void protx_cacheinfo_help()
+{
+    throw std::runtime_error(
+            "protx cacheinfo\n"
+            "\nReturns statistics about the cache of masternode lists and list diffs.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"lists\": n,               (numeric) Number of cached lists\n"
+            "  \"diffs\": n,               (numeric) Number of cached diffs\n"
+            "  \"usage\": n,               (numeric) Estimated memory usage in bytes\n"
+            "  \"maxusage\": n,            (numeric) Memory budget in bytes (see -mnlistcache)\n"
+            "  \"listhits\": n,            (numeric) Lists found in the cache\n"
+            "  \"listmisses\": n,          (numeric) Lists built from a snapshot and diffs\n"
+            "  \"diffhits\": n,            (numeric) Diffs found in the cache\n"
+            "  \"diffmisses\": n,          (numeric) Diffs read from disk\n"
+            "  \"diffsapplied\": n,        (numeric) Diffs applied while building lists\n"
+            "  \"evictions\": n            (numeric) Lists and diffs evicted to stay below the budget\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("protx", "cacheinfo")
+            + HelpExampleRpc("protx", "\"cacheinfo\"")
+    );
+}
+
+UniValue protx_cacheinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1) {
+        protx_cacheinfo_help();
+    }
+
+    CDeterministicMNCacheStats stats = deterministicMNManager->GetCacheStats();
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("lists", (uint64_t)stats.nLists);
+    ret.pushKV("diffs", (uint64_t)stats.nDiffs);
+    ret.pushKV("usage", (uint64_t)stats.nUsage);
+    ret.pushKV("maxusage", (uint64_t)stats.nMaxUsage);
+    ret.pushKV("listhits", stats.nListHits);
+    ret.pushKV("listmisses", stats.nListMisses);
+    ret.pushKV("diffhits", stats.nDiffHits);
+    ret.pushKV("diffmisses", stats.nDiffMisses);
+    ret.pushKV("diffsapplied", stats.nDiffsApplied);
+    ret.pushKV("evictions", stats.nEvictions);
+    return ret;
+}
+
 [[ noreturn ]] void protx_help()
 {
     throw std::runtime_error(
@@ -1147,6 +1193,7 @@ UniValue protx_diff(const JSONRPCRequest& request)
             "  revoke            - Create and send ProUpRevTx to network\n"
 #endif
             "  diff              - Calculate a diff and a proof between two masternode lists\n"
+            "  cacheinfo         - Return statistics about the masternode list cache\n"
     );
 }
 
@@ -1180,6 +1227,8 @@ UniValue protx(const JSONRPCRequest& request)
         return protx_info(request);
     } else if (command == "diff") {
         return protx_diff(request);
+    } else if (command == "cacheinfo") {
+        return protx_cacheinfo(request);
     } else {
         protx_help();
     }
@@ -9,6 +9,7 @@
 #include <rpc/rawtransaction_util.h>
 #include <outputtype.h>
 #include <smessage/smessage.h>
+#include <smessage/smsgstore.h>
 #include <util/strencodings.h>
 #include <util/system.h>
 #include <util/time.h>
@@ -771,47 +772,26 @@ UniValue smsgbuckets(const JSONRPCRequest& request)
 
             for (it = smsgBuckets.begin(); it != smsgBuckets.end(); ++it)
             {
-                std::set<SecMsgToken>& tokenSet = it->second.setTokens;
-
-                std::string sBucket = boost::lexical_cast<std::string>(it->first);
-                std::string sFile = sBucket + "_01.dat";
-
                 nBuckets++;
-                nMessages += tokenSet.size();
+                nMessages += it->second.nMessages;
 
                 UniValue objM(UniValue::VOBJ);
                 objM.pushKV("bucket", (uint64_t) it->first);
                 objM.pushKV("time", GetTimeString(it->first));
-                objM.pushKV("no. messages", (uint64_t)tokenSet.size());
-                objM.pushKV("hash", (uint64_t) it->second.hash);
+                objM.pushKV("no. messages", (uint64_t) it->second.nMessages);
+                objM.pushKV("hash", (uint64_t) it->second.GetHash(SMSG_VERSION_LEGACY));
+                objM.pushKV("set hash", strprintf("%016x", it->second.nSetHash));
                 objM.pushKV("last changed", GetTimeString(it->second.timeChanged));
-
-                boost::filesystem::path fullPath = GetDataDir() / "smsgStore" / sFile;
-
-
-                if (!boost::filesystem::exists(fullPath))
-                {
-                    // -- If there is a file for an empty bucket something is wrong.
-                    if (tokenSet.size() == 0)
-                        objM.pushKV("file size", "Empty bucket.");
-                    else
-                        objM.pushKV("file size, error", "File not found.");
-                } else
-                {
-                    try {
-
-                        uint64_t nFBytes = 0;
-                        nFBytes = boost::filesystem::file_size(fullPath);
-                        nBytes += nFBytes;
-                        objM.pushKV("file size", nFBytes);
-                    } catch (const boost::filesystem::filesystem_error& ex)
-                    {
-                        objM.pushKV("file size, error", ex.what());
-                    };
-                };
+                objM.pushKV("segment", (uint64_t) SecMsgSegmentStore::SegmentOf(it->first));
+                objM.pushKV("tokens loaded", it->second.fTokensLoaded);
 
                 result.push_back(objM);
             };
+
+            if (smsgSegments) {
+                for (int64_t segment : smsgSegments->GetSegments())
+                    nBytes += smsgSegments->GetSegmentSize(segment);
+            }
         }; // LOCK(cs_smsg);
 
         UniValue objM(UniValue::VOBJ);
@@ -825,20 +805,11 @@ UniValue smsgbuckets(const JSONRPCRequest& request)
     else if (mode == "dump") {
         {
             LOCK(cs_smsg);
-            std::map<int64_t, SecMsgBucket>::iterator it;
-            it = smsgBuckets.begin();
-
-            for (it = smsgBuckets.begin(); it != smsgBuckets.end(); ++it) {
-                std::string sFile = boost::lexical_cast<std::string>(it->first) + "_01.dat";
 
-                try {
-                    boost::filesystem::path fullPath = GetDataDir() / "smsgStore" / sFile;
-                    boost::filesystem::remove(fullPath);
-                }
-                catch (const boost::filesystem::filesystem_error& ex) {
-                    //objM.pushKV("file size, error", ex.what()));
-                    printf("Error removing bucket file %s.\n", ex.what());
-                }
+            if (smsgSegments) {
+                std::set<int64_t> setSegments = smsgSegments->GetSegments();
+                for (int64_t segment : setSegments)
+                    smsgSegments->RemoveSegment(segment);
             }
             smsgBuckets.clear();
         } // LOCK(cs_smsg);
@@ -849,6 +820,34 @@ UniValue smsgbuckets(const JSONRPCRequest& request)
     return smsgbuckets(request);
 };
 
+UniValue smsgsendqueue(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "smsgsendqueue\n"
+            "Show the state of the queue of outgoing secure messages.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"threads\": n,        (numeric) workers processing the queue, 0 if done on the smsg thread\n"
+            "  \"queued\": n,         (numeric) messages waiting in the queue\n"
+            "  \"processing\": n,     (numeric) messages taken from the queue and not done yet\n"
+            "  \"processed\": n       (numeric) messages processed since secure messaging was enabled\n"
+            "}\n");
+
+    if (!fSecMsgEnabled)
+        throw JSONRPCError(RPC_METHOD_NOT_FOUND, "Secure messaging is disabled.");
+
+    SecMsgSendQueueStats stats;
+    SecureMsgGetSendQueueStats(stats);
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("threads", stats.nThreads);
+    result.pushKV("queued", (uint64_t) stats.nQueued);
+    result.pushKV("processing", (uint64_t) stats.nProcessing);
+    result.pushKV("processed", stats.nProcessed);
+    return result;
+};
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
@@ -866,6 +865,7 @@ static const CRPCCommand commands[] =
     { "messaging",             "smsgscanchain",        &smsgscanchain,            {"hexdata","dummy"} },
     { "messaging",             "smsgsend",             &smsgsend,             {"height"} },
     { "messaging",             "smsgsendanon",         &smsgsendanon,             {"height"} },
+    { "messaging",             "smsgsendqueue",        &smsgsendqueue,            {} },
 };
 // clang-format on
 
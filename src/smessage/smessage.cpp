@@ -13,6 +13,13 @@ Notes:
         -smsgscanchain      Scan the block chain for public key addresses on startup
 
 
+    Message Store
+        Messages are appended to one segment per SMSG_SEGMENT_LEN, see SecMsgSegmentStore
+        Buckets older than SMSG_HOT_TIME only keep their count and hash in memory, their
+        tokens are read from the segment index when needed and dropped again when idle
+        Bucket files (_01.dat) from older versions are moved into segments on startup
+
+
     Wallet Locked
         A copy of each incoming message is stored in bucket files ending in _wl.dat
         wl (wallet locked) bucket files are deleted if they expire, like normal buckets
@@ -34,12 +41,17 @@ Notes:
 #include <map>
 #include <stdexcept>
 #include <sstream>
+#include <unordered_map>
+#include <future>
 #include <errno.h>
 
 #include <secp256k1.h>
+#include "crypto/common.h"
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 
+#include <ctpl.h>
+
 #include <boost/atomic.hpp>
 #include <boost/thread.hpp>
 #include <boost/filesystem.hpp>
@@ -57,6 +69,8 @@ Notes:
 #include "rpc/protocol.h"
 #include "dbwrapper.h"
 #include "smessage/lz4.h"
+#include "smessage/smsgsketch.h"
+#include "smessage/smsgstore.h"
 #include "smessage/xxhash.h"
 #include "validation.h"
 //#include "xxhash/xxhash.c"
@@ -121,6 +135,21 @@ RecursiveMutex cs_smsgThreads;
 
 leveldb::DB *smsgDB = NULL;
 
+// -- workers for the send queue, messages are scanned for owned addresses in parallel
+static std::unique_ptr<ctpl::thread_pool> smsgSendPool;
+static boost::atomic_uint nSendProcessing(0);
+static boost::atomic<uint64_t> nSendProcessed(0);
+
+// -- positions in smsgAddresses by recipient tag, rebuilt when smsgAddresses changes
+static std::unordered_multimap<uint16_t, size_t> mapAddressTags;
+static bool fAddressTagsDirty = true;
+
+static void SecureMsgAddressesChanged()
+{
+    LOCK(cs_smsg);
+    fAddressTagsDirty = true;
+}
+
 
 namespace fs = boost::filesystem;
 
@@ -135,19 +164,87 @@ void SecMsgBucket::hashBucket()
     std::set<SecMsgToken>::iterator it;
 
     void* state = XXH32_init(1);
+    void* stateLegacy = XXH32_init(1);
 
+    nTagged = 0;
     for (it = setTokens.begin(); it != setTokens.end(); ++it)
     {
         XXH32_update(state, it->sample, 8);
+        if (it->version >= SMSG_VERSION_TAGGED)
+            nTagged++;
+        else
+            XXH32_update(stateLegacy, it->sample, 8);
     }
 
     hash = XXH32_digest(state);
+    hashLegacy = XXH32_digest(stateLegacy);
+    fHashDirty = false;
+
+    nSetHash = 0;
+    for (it = setTokens.begin(); it != setTokens.end(); ++it)
+        nSetHash += SecMsgTokenHash(*it);
+    nMessages = setTokens.size();
 
     if (LogInstance().WillLogCategory(BCLog::SMSG))
         LogPrintf("Hashed %d messages, hash %u\n", (int) setTokens.size(), hash);
 }
 
 
+bool SecMsgBucket::AddToken(const SecMsgToken& token)
+{
+    if (!setTokens.insert(token).second)
+        return false;
+
+    // -- the ordered hash is only needed by old peers, don't walk the whole set for every message
+    timeChanged = GetTime();
+    fHashDirty  = true;
+    nSetHash   += SecMsgTokenHash(token);
+    nMessages   = setTokens.size();
+    if (token.version >= SMSG_VERSION_TAGGED)
+        nTagged++;
+    return true;
+}
+
+uint32_t SecMsgBucket::GetHash(uint32_t nPeerVersion)
+{
+    if (nPeerVersion >= SMSG_PROTOCOL_RECONCILE)
+        return (uint32_t) (nSetHash ^ (nSetHash >> 32));
+
+    if (fHashDirty && fTokensLoaded) {
+        int64_t timeChangedSave = timeChanged;
+        hashBucket();
+        timeChanged = timeChangedSave;
+    }
+    return nPeerVersion < SMSG_VERSION_TAGGED ? hashLegacy : hash;
+}
+
+uint32_t SecMsgBucket::GetMessageCount(uint32_t nPeerVersion) const
+{
+    return nPeerVersion < SMSG_VERSION_TAGGED ? nMessages - nTagged : nMessages;
+}
+
+static bool SecureMsgBucketIsHot(int64_t time, int64_t now)
+{
+    return time + SMSG_BUCKET_LEN > now - SMSG_HOT_TIME;
+}
+
+static std::set<SecMsgToken>& SecureMsgGetTokens(int64_t time, SecMsgBucket& bkt)
+{
+    // -- must lock cs_smsg before calling
+    if (!bkt.fTokensLoaded) {
+        std::map<int64_t, std::set<SecMsgToken> > mapTokens;
+        if (smsgSegments
+            && smsgSegments->ReadTokens(SecMsgSegmentStore::SegmentOf(time), mapTokens, time))
+            bkt.setTokens.swap(mapTokens[time]);
+        bkt.fTokensLoaded = true;
+
+        if (LogInstance().WillLogCategory(BCLog::SMSG))
+            LogPrintf("Loaded %d tokens for bucket %d.\n", (int) bkt.setTokens.size(), (int) time);
+    }
+    bkt.nLastUsed = GetTime();
+    return bkt.setTokens;
+}
+
 bool SecMsgDB::Open(const char* pszMode)
 {
     if (smsgDB)
@@ -540,6 +637,56 @@ bool SecMsgDB::EraseSmesg(unsigned char* chKey)
 }
 
 
+static void SecureMsgProcessSendQueue(const std::vector<SecMsgStored>& vQueued)
+{
+    /*
+        Messages taken from the send queue db, add them to the buckets and check if any
+        were sent to this node.
+        Store is cheap and done in order, the scan does trial decryption and runs on the send pool.
+    */
+
+    std::vector<const SecMsgStored*> vStored;
+    {
+        LOCK(cs_smsg);
+        for (const auto& smsgStored : vQueued) {
+            SecureMessageHeader smsg(&smsgStored.vchMessage[0]);
+            if (SecureMsgStore(smsg, &smsgStored.vchMessage[SMSG_HDR_LEN]) != 0) {
+                LogPrintf("SecMsgPow: Could not place message in buckets, message removed.\n");
+                nSendProcessing--;
+                nSendProcessed++;
+                continue;
+            }
+            vStored.push_back(&smsgStored);
+        }
+    }
+
+    // -- test if message was sent to self
+    auto scan = [](const SecMsgStored* pStored) {
+        // -- secure messaging is being disabled, drop the rest of the batch
+        if (fSecMsgEnabled) {
+            SecureMessageHeader smsg(&pStored->vchMessage[0]);
+            if (SecureMsgScanMessage(smsg, &pStored->vchMessage[SMSG_HDR_LEN], true) != 0) {
+                // message recipient is not this node (or failed)
+            }
+        }
+        nSendProcessing--;
+        nSendProcessed++;
+    };
+
+    if (!smsgSendPool || smsgSendPool->size() == 0) {
+        for (const SecMsgStored* pStored : vStored)
+            scan(pStored);
+        return;
+    }
+
+    std::vector<std::future<void> > vFutures;
+    vFutures.reserve(vStored.size());
+    for (const SecMsgStored* pStored : vStored)
+        vFutures.emplace_back(smsgSendPool->push([pStored, &scan](int) { scan(pStored); }));
+    for (auto& f : vFutures)
+        f.wait();
+}
+
 static boost::atomic_uint nThreadCount(0);
 void ThreadSecureMsg(void* parg)
 {
@@ -563,30 +710,18 @@ const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
         {
             LOCK(cs_smsg);
 
-            for (std::map<int64_t, SecMsgBucket>::iterator it(smsgBuckets.begin()); it != smsgBuckets.end(); it++) {
+            for (std::map<int64_t, SecMsgBucket>::iterator it(smsgBuckets.begin()); it != smsgBuckets.end(); ) {
                 //if (LogInstance().WillLogCategory(BCLog::SMSG))
                 //    LogPrintf("Checking bucket %"PRId64", size %"PRIszu" \n", it->first, it->second.setTokens.size());
                 if (it->first < cutoffTime) {
                     if (LogInstance().WillLogCategory(BCLog::SMSG))
                         LogPrintf("Removing bucket %d\n", (int) it->first);
 
-                    std::string fileName = boost::lexical_cast<std::string>(it->first);
-
-                    fs::path fullPath = GetDataDir() / "smsgStore" / (fileName + "_01.dat");
-                    if (fs::exists(fullPath)) {
-                        try {
-                            fs::remove(fullPath);
-                        }
-                        catch (const fs::filesystem_error& ex) {
-                            LogPrintf("Error removing bucket file %s.\n", ex.what());
-                        }
-                    }
-                    else {
-                        LogPrintf("Path %s does not exist\n", fullPath.string().c_str());
-                    }
+                    // -- the messages are removed with their segment, below
 
                     // -- look for a wl file, it stores incoming messages when wallet is locked
-                    fullPath = GetDataDir() / "smsgStore" / (fileName + "_01_wl.dat");
+                    std::string fileName = boost::lexical_cast<std::string>(it->first);
+                    fs::path fullPath = GetDataDir() / "smsgStore" / (fileName + "_01_wl.dat");
                     if (fs::exists(fullPath)) {
                         try {
                             fs::remove(fullPath);
@@ -596,7 +731,8 @@ const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
                         }
                     }
 
-                    smsgBuckets.erase(it);
+                    it = smsgBuckets.erase(it);
+                    continue;
                 }
                 else if (it->second.nLockCount > 0) { // -- tick down nLockCount, so will eventually expire if peer never sends data
                     it->second.nLockCount--;
@@ -627,7 +763,27 @@ const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
                         });
                         it->second.nLockPeerId = 0;
                     } // if (it->second.nLockCount == 0)
+                }
+                else if (it->second.fTokensLoaded
+                    && !SecureMsgBucketIsHot(it->first, now)
+                    && now - it->second.nLastUsed > SMSG_TOKENS_IDLE) {
+                    // -- old bucket nobody asked for in a while, keep only count and hash
+                    if (it->second.fHashDirty)
+                        it->second.GetHash(SMSG_VERSION_LEGACY);
+                    std::set<SecMsgToken>().swap(it->second.setTokens);
+                    it->second.fTokensLoaded = false;
                 } // ! if (it->first < cutoffTime)
+                ++it;
+            }
+
+            // -- drop segments once every bucket in them has expired
+            if (smsgSegments) {
+                std::set<int64_t> setSegments = smsgSegments->GetSegments();
+                for (int64_t segment : setSegments) {
+                    if (segment + SMSG_SEGMENT_LEN > cutoffTime)
+                        break;
+                    smsgSegments->RemoveSegment(segment);
+                }
             }
         } // LOCK(cs_smsg);
 
@@ -643,39 +799,29 @@ const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
             // -- fifo (smallest key first)
             it = dbOutbox.pdb->NewIterator(leveldb::ReadOptions());
         }
-        // -- break up lock, SecureMsgSetHash will take long
+        // -- break up lock, scanning the queued messages will take long
 
+        std::vector<SecMsgStored> vQueued;
         for (;;)
         {
             {
                 LOCK(cs_smsgDB);
-                if (!dbOutbox.NextSmesg(it, sPrefix, chKey, smsgStored))
+                if (!fSecMsgEnabled || !dbOutbox.NextSmesg(it, sPrefix, chKey, smsgStored))
                     break;
-            }
-
-            SecureMessageHeader smsg(&smsgStored.vchMessage[0]);
-            const unsigned char* pPayload = &smsgStored.vchMessage[SMSG_HDR_LEN];
 
-            // -- message is removed here, no matter what
-            {
-                LOCK(cs_smsgDB);
+                // -- message is removed here, no matter what
                 dbOutbox.EraseSmesg(chKey);
             }
 
-            // -- add to message store
-            {
-                LOCK(cs_smsg);
-                if (SecureMsgStore(smsg, pPayload, true) != 0) {
-                    LogPrintf("SecMsgPow: Could not place message in buckets, message removed.\n");
-                    continue;
-                }
-            }
-
-            // -- test if message was sent to self
-            if (SecureMsgScanMessage(smsg, pPayload, true) != 0) {
-                // message recipient is not this node (or failed)
+            nSendProcessing++;
+            vQueued.push_back(smsgStored);
+            if (vQueued.size() >= SMSG_SEND_BATCH) {
+                SecureMsgProcessSendQueue(vQueued);
+                vQueued.clear();
             }
         }
+        if (!vQueued.empty())
+            SecureMsgProcessSendQueue(vQueued);
 
         {
             LOCK(cs_smsg);
@@ -697,18 +843,71 @@ const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
 }
 
 
+static bool SecureMsgMigrateBucketFile(const fs::path& path)
+{
+    /*
+        Move the messages of a bucket file from an older version into the segment store.
+        Tokens are a set, messages appended twice by an interrupted migration are only counted once.
+    */
+
+    FILE *fp;
+    if (!(fp = fopen(path.string().c_str(), "rb"))) {
+        LogPrintf("Error opening file: %s (%d)\n", strerror(errno), __LINE__);
+        return false;
+    }
+
+    SecureMessage smsg;
+    for (;;) {
+        if (fread(smsg.Header(), sizeof(unsigned char), SMSG_HDR_LEN, fp) != (size_t)SMSG_HDR_LEN) {
+            if (!feof(fp)) {
+                LogPrintf("fread header failed\n");
+            }
+            break;
+        }
+
+        if (smsg.nPayload > SMSG_MAX_MSG_WORST) {
+            LogPrintf("Invalid payload size %u in %s.\n", smsg.nPayload, path.string().c_str());
+            break;
+        }
+
+        smsg.vchPayload.resize(smsg.nPayload);
+        if (fread(smsg.vchPayload.data(), sizeof(unsigned char), smsg.nPayload, fp) != smsg.nPayload) {
+            LogPrintf("fread data failed: %s\n", strerror(errno));
+            break;
+        }
+
+        SecMsgToken token(smsg.timestamp, smsg.vchPayload.data(), smsg.nPayload, 0, smsg.nVersion);
+        if (!smsgSegments->Append(*smsg.Header(), smsg.vchPayload.data(), token)) {
+            fclose(fp);
+            return false;
+        }
+    }
+
+    fclose(fp);
+
+    try {
+        fs::remove(path);
+    } catch (const fs::filesystem_error& ex) {
+        LogPrintf("Error removing bucket file %s - %s\n", path.string().c_str(), ex.what());
+        return false;
+    }
+    return true;
+}
+
 int SecureMsgBuildBucketSet()
 {
     /*
-        Build the bucket set by scanning the files in the smsgStore dir.
+        Build the bucket set from the segments in the smsgStore dir.
 
         smsgBuckets should be empty
+        must lock cs_smsg before calling
     */
 
     if (LogInstance().WillLogCategory(BCLog::SMSG))
         LogPrintf("SecureMsgBuildBucketSet()\n");
 
     int64_t  now            = GetTime();
+    int64_t  cutoffTime     = now - SMSG_RETENTION;
     uint32_t nFiles         = 0;
     uint32_t nMessages      = 0;
 
@@ -725,37 +924,32 @@ int SecureMsgBuildBucketSet()
         }
     }
 
+    smsgSegments.reset(new SecMsgSegmentStore(pathSmsgDir));
+
+    // -- bucket files from older versions
+    std::vector<fs::path> vBucketFiles;
     for (fs::directory_iterator itd(pathSmsgDir) ; itd != itend ; ++itd) {
         if (!fs::is_regular_file(itd->status()))
             continue;
 
-        std::string fileType = (*itd).path().extension().string();
-
-        if (fileType.compare(".dat") != 0)
-            continue;
-
         std::string fileName = (*itd).path().filename().string();
+        if (boost::algorithm::ends_with(fileName, "_01.dat"))
+            vBucketFiles.push_back((*itd).path());
+    }
 
-
-        if (LogInstance().WillLogCategory(BCLog::SMSG))
-            LogPrintf("Processing file: %s.\n", fileName.c_str());
-
-        nFiles++;
-
-        // TODO files must be split if > 2GB
-        // time_noFile.dat
-        size_t sep = fileName.find_first_of("_");
-        if (sep == std::string::npos)
+    for (const fs::path& path : vBucketFiles) {
+        std::string fileName = path.filename().string();
+        int64_t fileTime;
+        try {
+            fileTime = boost::lexical_cast<int64_t>(fileName.substr(0, fileName.find_first_of("_")));
+        } catch (const boost::bad_lexical_cast&) {
             continue;
+        }
 
-        std::string stime = fileName.substr(0, sep);
-
-        int64_t fileTime = boost::lexical_cast<int64_t>(stime);
-
-        if (fileTime < now - SMSG_RETENTION) {
+        if (fileTime < cutoffTime) {
             LogPrintf("Dropping file %s, expired.\n", fileName.c_str());
             try {
-                fs::remove((*itd).path());
+                fs::remove(path);
             }
             catch (const fs::filesystem_error& ex) {
                 LogPrintf("Error removing bucket file %s, %s.\n", fileName.c_str(), ex.what());
@@ -763,62 +957,84 @@ int SecureMsgBuildBucketSet()
             continue;
         }
 
-        if (boost::algorithm::ends_with(fileName, "_wl.dat")) {
-            if (LogInstance().WillLogCategory(BCLog::SMSG))
-                LogPrintf("Skipping wallet locked file: %s.\n", fileName.c_str());
-            continue;
-        }
+        LogPrintf("Moving bucket file %s to the segment store.\n", fileName.c_str());
+        if (!SecureMsgMigrateBucketFile(path))
+            return 1;
+    }
 
-        SecureMessageHeader smsg;
-        std::set<SecMsgToken>& tokenSet = smsgBuckets[fileTime].setTokens;
+    if (!smsgSegments->Open()) {
+        LogPrintf("Could not open message store.\n");
+        return 1;
+    }
 
-        {
-            LOCK(cs_smsg);
-            FILE *fp;
+    std::set<int64_t> setSegments = smsgSegments->GetSegments();
+    for (int64_t segment : setSegments) {
+        if (segment + SMSG_SEGMENT_LEN <= cutoffTime) {
+            LogPrintf("Dropping segment %d, expired.\n", (int) segment);
+            smsgSegments->RemoveSegment(segment);
+            continue;
+        }
 
-            if (!(fp = fopen((*itd).path().string().c_str(), "rb"))) {
-                LogPrintf("Error opening file: %s (%d)\n", strerror(errno), __LINE__);
-                continue;
-            }
+        nFiles++;
 
-            for (;;) {
-                long int ofs = ftell(fp);
-                SecMsgToken token;
-                token.offset = ofs;
-                if (fread(&smsg, sizeof(unsigned char), SMSG_HDR_LEN, fp) != (size_t)SMSG_HDR_LEN) {
-                    if (!feof(fp)) {
-                        LogPrintf("fread header failed\n");
-                    }
-                    break;
-                }
-                token.timestamp = smsg.timestamp;
-                if (smsg.nPayload < 8)
+        // -- old segments don't change, their summary is enough until a peer asks for the tokens
+        bool fHot = SecureMsgBucketIsHot(segment + SMSG_SEGMENT_LEN - SMSG_BUCKET_LEN, now);
+        std::vector<SecMsgBucketSummary> vSummary;
+        if (!fHot && smsgSegments->ReadSummary(segment, vSummary)) {
+            for (const auto& summary : vSummary) {
+                if (summary.time < cutoffTime)
                     continue;
+                SecMsgBucket& bkt = smsgBuckets[summary.time];
+                bkt.timeChanged     = now;
+                bkt.nMessages       = summary.nMessages;
+                bkt.nTagged         = summary.nTagged;
+                bkt.hash            = summary.hash;
+                bkt.hashLegacy      = summary.hashLegacy;
+                bkt.nSetHash        = summary.nSetHash;
+                bkt.fTokensLoaded   = false;
+                nMessages += summary.nMessages;
+            }
+            continue;
+        }
 
-                if (fread(token.sample, sizeof(unsigned char), 8, fp) != 8) {
-                    LogPrintf("fread data failed: %s\n", strerror(errno));
-                    break;
-                }
+        std::map<int64_t, std::set<SecMsgToken> > mapTokens;
+        if (!smsgSegments->ReadTokens(segment, mapTokens))
+            continue;
 
-                if (fseek(fp, smsg.nPayload-8, SEEK_CUR) != 0) {
-                    LogPrintf("fseek, strerror: %s.\n", strerror(errno));
-                    break;
-                }
+        for (auto& mi : mapTokens) {
+            SecMsgBucket bkt;
+            bkt.setTokens.swap(mi.second);
+            bkt.hashBucket();
+
+            SecMsgBucketSummary summary;
+            summary.time        = mi.first;
+            summary.nMessages   = bkt.nMessages;
+            summary.nTagged     = bkt.nTagged;
+            summary.hash        = bkt.hash;
+            summary.hashLegacy  = bkt.hashLegacy;
+            summary.nSetHash    = bkt.nSetHash;
+            vSummary.push_back(summary);
+
+            if (mi.first < cutoffTime)
+                continue;
 
-                tokenSet.insert(token);
+            if (!SecureMsgBucketIsHot(mi.first, now)) {
+                std::set<SecMsgToken>().swap(bkt.setTokens);
+                bkt.fTokensLoaded = false;
             }
+            nMessages += bkt.nMessages;
 
-            fclose(fp);
-        }
-        smsgBuckets[fileTime].hashBucket();
+            if (LogInstance().WillLogCategory(BCLog::SMSG))
+                LogPrintf("Bucket %d contains %u messages.\n", (int) mi.first, bkt.nMessages);
 
-        nMessages += tokenSet.size();
+            smsgBuckets[mi.first] = std::move(bkt);
+        }
 
-        if (LogInstance().WillLogCategory(BCLog::SMSG))
-            LogPrintf("Bucket %d contains %d messages.\n", (int) fileTime, (int) tokenSet.size());
+        if (!fHot)
+            smsgSegments->WriteSummary(segment, vSummary);
     }
 
-    LogPrintf("Processed %u files, loaded %d buckets containing %u messages.\n", nFiles, (int) smsgBuckets.size(), nMessages);
+    LogPrintf("Processed %u segments, loaded %d buckets containing %u messages.\n", nFiles, (int) smsgBuckets.size(), nMessages);
 
     return 0;
 }
@@ -872,6 +1088,7 @@ int SecureMsgAddWalletAddresses()
         smsgAddresses.push_back(SecMsgAddress(address, recvEnabled, recvAnon));
         nAdded++;
     }
+    SecureMsgAddressesChanged();
 
     if (LogInstance().WillLogCategory(BCLog::SMSG))
         LogPrintf("Added %u addresses to whitelist.\n", nAdded);
@@ -942,6 +1159,7 @@ int SecureMsgReadIni()
         }
     }
 
+    SecureMsgAddressesChanged();
     LogPrintf("Loaded %d addresses.\n", (int) smsgAddresses.size());
 
     fclose(fp);
@@ -1050,6 +1268,7 @@ bool SecureMsgEnable() {
         fSecMsgEnabled = true;
 
         smsgAddresses.clear(); // should be empty already
+        SecureMsgAddressesChanged();
         if (SecureMsgReadIni() != 0)
             LogPrintf("Failed to read smsg.ini\n");
 
@@ -1069,6 +1288,16 @@ bool SecureMsgEnable() {
     } // LOCK(cs_smsg);
 
     // -- start threads
+    // -smsgsendthreads=0 means autodetect, a single worker scans on the smsg thread itself
+    int nSendThreads = gArgs.GetArg("-smsgsendthreads", DEFAULT_SMSG_SEND_THREADS);
+    if (nSendThreads <= 0)
+        nSendThreads += GetNumCores();
+    nSendThreads = std::min(nSendThreads, MAX_SMSG_SEND_THREADS);
+    nSendProcessed = 0;
+    smsgSendPool.reset(new ctpl::thread_pool(nSendThreads > 1 ? nSendThreads : 0));
+    if (nSendThreads > 1)
+        RenameThreadPool(*smsgSendPool, "rain-smsg-send");
+
     secureMsgThread = boost::thread(&ThreadSecureMsg, (void*) NULL);
     if (secureMsgThread.get_id() == boost::this_thread::get_id()) {
         LogPrintf("SecureMsgEnable could not start threads, secure messaging disabled.\n");
@@ -1080,7 +1309,7 @@ bool SecureMsgEnable() {
     {
 		g_connman->ForEachNode([msgMaker](CNode* pnode) {
 			g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::SMSGPING));
-			g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::SMSGPONG));
+			g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::SMSGPONG, SMSG_PROTOCOL_VERSION));
 		});
     }
 
@@ -1110,6 +1339,7 @@ const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
             it->second.setTokens.clear();
         }
         smsgBuckets.clear();
+        smsgSegments.reset();
 
         // -- tell each smsg enabled peer that this node is disabling
         {
@@ -1125,6 +1355,7 @@ const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
             LogPrintf("Failed to save smsg.ini\n");
 
         smsgAddresses.clear();
+        SecureMsgAddressesChanged();
 
     } // LOCK(cs_smsg);
 
@@ -1132,6 +1363,12 @@ const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
     if (secureMsgThread.joinable())
         secureMsgThread.join();
 
+    // -- workers return early once fSecMsgEnabled is unset
+    if (smsgSendPool) {
+        smsgSendPool->stop(true);
+        smsgSendPool.reset();
+    }
+
     if (smsgDB) {
         LOCK(cs_smsgDB);
         delete smsgDB;
@@ -1144,6 +1381,70 @@ const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
 }
 
 
+template <typename Tokens>
+static void SecureMsgPushHave(CNode* pfrom, int64_t time, const Tokens& tokens)
+{
+    // -- must lock cs_smsg before calling
+    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+
+    // -- peers before SMSG_VERSION_TAGGED can't validate tagged messages, they must not want them
+    bool fLegacyPeer = pfrom->smsgData.nVersion < SMSG_VERSION_TAGGED;
+
+    std::vector<unsigned char> vchDataOut(8);
+    vchDataOut.reserve(8 + 16 * tokens.size());
+    memcpy(&vchDataOut[0], &time, 8);
+
+    for (const SecMsgToken& token : tokens)
+    {
+        if (fLegacyPeer && token.version >= SMSG_VERSION_TAGGED)
+            continue;
+
+        size_t nd = vchDataOut.size();
+        vchDataOut.resize(nd + 16);
+        memcpy(&vchDataOut[nd], &token.timestamp, 8);
+        memcpy(&vchDataOut[nd+8], &token.sample, 8);
+    }
+    g_connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SMSGHAVE, vchDataOut));
+}
+
+static bool SecureMsgPushShowDiff(CNode* pfrom, int64_t time, uint32_t nPeerMessages, SecMsgBucket& bkt)
+{
+    /*
+        Ask a peer for the tokens this node is missing from a bucket by sending a sketch of
+        the tokens this node has, instead of asking for the full token list with smsgShow.
+        Only if the peer knows smsgShowDiff and the sketch is smaller than the token list.
+
+        must lock cs_smsg before calling
+    */
+
+    if (pfrom->smsgData.nVersion < SMSG_PROTOCOL_RECONCILE)
+        return false;
+
+    // -- the counts only give a lower bound for the difference
+    uint32_t nDiff = nPeerMessages > bkt.nMessages ? nPeerMessages - bkt.nMessages : bkt.nMessages - nPeerMessages;
+    if (nDiff > SMSG_SKETCH_MAX_DIFF)
+        return false;
+
+    uint32_t nCells = SecMsgTokenSketch::CellsForDifference(nDiff + SMSG_SKETCH_DIFF_SLACK);
+    if ((uint64_t) nCells * SMSG_SKETCH_CELL_LEN >= (uint64_t) nPeerMessages * 16)
+        return false;
+
+    SecMsgTokenSketch sketch(nCells);
+    for (const SecMsgToken& token : SecureMsgGetTokens(time, bkt))
+        sketch.Insert(token);
+
+    std::vector<unsigned char> vchDataOut(8 + sketch.GetCells() * SMSG_SKETCH_CELL_LEN);
+    memcpy(&vchDataOut[0], &time, 8);
+    sketch.Serialize(&vchDataOut[8]);
+
+    if (LogInstance().WillLogCategory(BCLog::SMSG))
+        LogPrintf("Requesting difference of bucket %d, %u cells.\n", (int32_t) time, sketch.GetCells());
+
+    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    g_connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SMSGSHOWDIFF, vchDataOut));
+    return true;
+}
+
 bool SecureMsgReceiveData(CNode* pfrom, std::string strCommand, CDataStream& vRecv)
 {
     /*
@@ -1211,6 +1512,7 @@ bool SecureMsgReceiveData(CNode* pfrom, std::string strCommand, CDataStream& vRe
         vchDataOut.reserve(4 + 8 * nInvBuckets); // reserve max possible size
         vchDataOut.resize(4);
         uint32_t nShowBuckets = 0;
+        uint32_t nDiffBuckets = 0;              // buckets requested with smsgShowDiff
 
 
         unsigned char *p = &vchData[4];
@@ -1269,10 +1571,18 @@ bool SecureMsgReceiveData(CNode* pfrom, std::string strCommand, CDataStream& vRe
 
             // -- if this node has more than the peer node, peer node will pull from this
             //    if then peer node has more this node will pull fom peer
-            if (smsgBuckets[time].setTokens.size() < ncontent
-                || (smsgBuckets[time].setTokens.size() == ncontent
-                    && smsgBuckets[time].hash != hash)) // if same amount in buckets check hash
+            SecMsgBucket& bkt = smsgBuckets[time];
+            uint32_t nMessages = bkt.GetMessageCount(pfrom->smsgData.nVersion);
+            if (nMessages < ncontent
+                || (nMessages == ncontent
+                    && bkt.GetHash(pfrom->smsgData.nVersion) != hash)) // if same amount in buckets check hash
             {
+                if (SecureMsgPushShowDiff(pfrom, time, ncontent, bkt))
+                {
+                    nDiffBuckets++;
+                    continue;
+                }
+
                 if (LogInstance().WillLogCategory(BCLog::SMSG))
                     LogPrintf("Requesting contents of bucket %d.\n", (int32_t) time);
 
@@ -1290,7 +1600,7 @@ bool SecureMsgReceiveData(CNode* pfrom, std::string strCommand, CDataStream& vRe
         {
 			g_connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SMSGSHOW, vchDataOut));
         } else
-        if (nLocked < 1) // Don't report buckets as matched if any are locked
+        if (nLocked < 1 && nDiffBuckets < 1) // Don't report buckets as matched if any are locked or being compared
         {
             // -- peer has no buckets we want, don't send them again until something changes
             //    peer will still request buckets from this node if needed (< ncontent)
@@ -1320,9 +1630,7 @@ bool SecureMsgReceiveData(CNode* pfrom, std::string strCommand, CDataStream& vRe
             LogPrintf("smsgShow: peer wants to see content of %u buckets.\n", nBuckets);
 
         std::map<int64_t, SecMsgBucket>::iterator itb;
-        std::set<SecMsgToken>::iterator it;
 
-        std::vector<unsigned char> vchDataOut;
         int64_t time;
         unsigned char* pIn = &vchData[4];
         for (uint32_t i = 0; i < nBuckets; ++i, pIn += 8)
@@ -1337,24 +1645,63 @@ bool SecureMsgReceiveData(CNode* pfrom, std::string strCommand, CDataStream& vRe
                 continue;
             }
 
-            std::set<SecMsgToken>& tokenSet = (*itb).second.setTokens;
+            SecureMsgPushHave(pfrom, time, SecureMsgGetTokens(time, (*itb).second));
+        }
+    } else
+    if (strCommand == NetMsgType::SMSGSHOWDIFF)
+    {
+        // -- peer sent a sketch of its tokens in a bucket, reply with the tokens it doesn't have
+        std::vector<unsigned char> vchData;
+        vRecv >> vchData;
 
-            try { vchDataOut.resize(8 + 16 * tokenSet.size()); } catch (std::exception& e)
-            {
-                std::cout << "vchDataOut.resize " << (8 + 16 * tokenSet.size()) << " threw " << e.what() << std::endl;
-                continue;
-            }
-            memcpy(&vchDataOut[0], &time, 8);
+        if (vchData.size() < 8)
+            return false;
 
-            unsigned char* p = &vchDataOut[8];
-            for (it = tokenSet.begin(); it != tokenSet.end(); ++it)
-            {
-                memcpy(p, &it->timestamp, 8);
-                memcpy(p+8, &it->sample, 8);
+        int64_t time;
+        memcpy(&time, &vchData[0], 8);
 
-                p += 16;
-            }
-            g_connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SMSGHAVE, vchDataOut));
+        SecMsgTokenSketch sketchPeer(0);
+        if (!sketchPeer.Deserialize(&vchData[8], vchData.size() - 8))
+        {
+            LogPrintf("Peer sent invalid bucket sketch.\n");
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 1);
+            return false;
+        }
+
+        std::map<int64_t, SecMsgBucket>::iterator itb = smsgBuckets.find(time);
+        if (itb == smsgBuckets.end())
+        {
+            if (LogInstance().WillLogCategory(BCLog::SMSG))
+                LogPrintf("Don't have bucket %d.\n", (int32_t) time);
+            return false;
+        }
+
+        std::set<SecMsgToken>& tokenSet = SecureMsgGetTokens(time, itb->second);
+        SecMsgTokenSketch sketch(sketchPeer.GetCells());
+        for (const SecMsgToken& token : tokenSet)
+            sketch.Insert(token);
+        sketch.Subtract(sketchPeer);
+
+        std::vector<SecMsgToken> vOnlyThis, vOnlyPeer;
+        if (sketch.Decode(vOnlyThis, vOnlyPeer))
+        {
+            // -- a crafted sketch can decode to tokens this node doesn't have
+            std::vector<SecMsgToken> vHave;
+            for (const SecMsgToken& token : vOnlyThis)
+                if (tokenSet.count(token))
+                    vHave.push_back(token);
+
+            if (LogInstance().WillLogCategory(BCLog::SMSG))
+                LogPrintf("Bucket %d differs from peer by %u/%u messages.\n", (int32_t) time, (uint32_t) vHave.size(), (uint32_t) vOnlyPeer.size());
+
+            if (!vHave.empty())
+                SecureMsgPushHave(pfrom, time, vHave);
+        } else
+        {
+            if (LogInstance().WillLogCategory(BCLog::SMSG))
+                LogPrintf("Could not decode difference of bucket %d, sending all tokens.\n", (int32_t) time);
+            SecureMsgPushHave(pfrom, time, tokenSet);
         }
 
 
@@ -1404,7 +1751,7 @@ bool SecureMsgReceiveData(CNode* pfrom, std::string strCommand, CDataStream& vRe
         vchDataOut.resize(8);
         memcpy(&vchDataOut[0], &vchData[0], 8);
 
-        std::set<SecMsgToken>& tokenSet = smsgBuckets[time].setTokens;
+        std::set<SecMsgToken>& tokenSet = SecureMsgGetTokens(time, smsgBuckets[time]);
         std::set<SecMsgToken>::iterator it;
         SecMsgToken token;
         unsigned char* p = &vchData[8];
@@ -1471,7 +1818,7 @@ bool SecureMsgReceiveData(CNode* pfrom, std::string strCommand, CDataStream& vRe
             return false;
         }
 
-        std::set<SecMsgToken>& tokenSet = itb->second.setTokens;
+        std::set<SecMsgToken>& tokenSet = SecureMsgGetTokens(time, itb->second);
         std::set<SecMsgToken>::iterator it;
         SecMsgToken token;
         unsigned char* p = &vchData[8];
@@ -1486,6 +1833,13 @@ bool SecureMsgReceiveData(CNode* pfrom, std::string strCommand, CDataStream& vRe
                 if (LogInstance().WillLogCategory(BCLog::SMSG))
                     LogPrintf("Don't have wanted message %d.\n", (int32_t) token.timestamp);
             } else
+            if (it->version >= SMSG_VERSION_TAGGED && pfrom->smsgData.nVersion < SMSG_VERSION_TAGGED)
+            {
+                // -- peers that didn't advertise tagged messages can't validate them, they are not in the
+                //    counts, hashes or token lists sent to them either
+                if (LogInstance().WillLogCategory(BCLog::SMSG))
+                    LogPrintf("Not sending tagged message %d to legacy peer.\n", (int32_t) token.timestamp);
+            } else
             {
                 //LogPrintf("Have message at %"PRId64".\n", it->offset); // DEBUG
                 token.offset = it->offset;
@@ -1571,13 +1925,18 @@ bool SecureMsgReceiveData(CNode* pfrom, std::string strCommand, CDataStream& vRe
     if (strCommand == NetMsgType::SMSGPING)
     {
         // -- smsgPing is the initial message, send reply
-        g_connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SMSGPONG));
+        //    Old nodes ignore the version, and send an empty smsgPong
+        g_connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SMSGPONG, SMSG_PROTOCOL_VERSION));
     } else
     if (strCommand == NetMsgType::SMSGPONG)
     {
         if (LogInstance().WillLogCategory(BCLog::SMSG))
              LogPrintf("Peer replied, secure messaging enabled.\n");
 
+        pfrom->smsgData.nVersion = SMSG_VERSION_LEGACY;
+        if (!vRecv.empty())
+            vRecv >> pfrom->smsgData.nVersion;
+
         pfrom->smsgData.fEnabled = true;
     } else
     if (strCommand == NetMsgType::SMSGDISABLED)
@@ -1690,14 +2049,14 @@ const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
             {
                 SecMsgBucket &bkt = it->second;
 
-                uint32_t nMessages = bkt.setTokens.size();
+                uint32_t nMessages = bkt.GetMessageCount(pto->smsgData.nVersion);
 
                 if (bkt.timeChanged < pto->smsgData.lastMatched     // peer has this bucket
-                    || nMessages < 1)                               // this bucket is empty
+                    || nMessages < 1)                               // this bucket is empty, or only has tagged messages for a legacy peer
                     continue;
 
 
-                uint32_t hash = bkt.hash;
+                uint32_t hash = bkt.GetHash(pto->smsgData.nVersion);
 
                 try { vchData.resize(vchData.size() + 16); } catch (std::exception& e)
                 {
@@ -2056,7 +2415,9 @@ int SecureMsgScanBuckets(std::string &error, bool fDecrypt)
 
         int64_t fileTime = boost::lexical_cast<int64_t>(stime);
 
-        if (fileTime < now - SMSG_RETENTION) {
+        // -- segments hold buckets of a whole day and are expired by ThreadSecureMsg
+        bool fSegment = boost::algorithm::ends_with(fileName, "_seg.dat");
+        if (!fSegment && fileTime < now - SMSG_RETENTION) {
             LogPrintf("Dropping file %s, expired.\n", fileName.c_str());
             try {
                 fs::remove((*itd).path());
@@ -2124,11 +2485,13 @@ int SecureMsgScanBuckets(std::string &error, bool fDecrypt)
             fclose(fp);
 
             // -- remove wl file when scanned
-            try {
-                fs::remove((*itd).path());
-            } catch (const boost::filesystem::filesystem_error& ex) {
-                LogPrintf("Error removing wl file %s - %s\n", fileName.c_str(), ex.what());
-                return 1;
+            if (fDecrypt) {
+                try {
+                    fs::remove((*itd).path());
+                } catch (const boost::filesystem::filesystem_error& ex) {
+                    LogPrintf("Error removing wl file %s - %s\n", fileName.c_str(), ex.what());
+                    return 1;
+                }
             }
         }
     }
@@ -2172,6 +2535,7 @@ int SecureMsgWalletKeyChanged(std::string sAddress, std::string sLabel, ChangeTy
             default:
                 break;
         }
+        SecureMsgAddressesChanged();
 
     } // LOCK(cs_smsg);
 
@@ -2216,14 +2580,46 @@ int SecureMsgScanMessage(const SecureMessageHeader &smsg, const unsigned char *p
 
     // -- Calculate hash of payload and enable verification of the HMAC
     SecureMessageHeader header((const unsigned char*) smsg.begin());
-    memcpy(header.hash, Hash(&pPayload[0], &pPayload[smsg.nPayload]).begin(), 32);
+    SecureMsgSetHash(header, pPayload);
 
     std::string addressTo;
     MessageData msg; // placeholder
     bool fOwnMessage = false;
 
-    for (std::vector<SecMsgAddress>::iterator it = smsgAddresses.begin(); it != smsgAddresses.end(); ++it)
+    // -- tagged messages only need to be tried with the addresses that have the tag,
+    //    legacy messages with every address
+    //    copy the candidates, trial decryption runs without cs_smsg so queued messages can be scanned in parallel
+    std::vector<SecMsgAddress> vCandidates;
     {
+        LOCK(cs_smsg);
+        if (smsg.nVersion >= SMSG_VERSION_TAGGED)
+        {
+            if (fAddressTagsDirty)
+            {
+                mapAddressTags.clear();
+                for (size_t i = 0; i < smsgAddresses.size(); ++i)
+                {
+                    CKeyID ckid = GetKeyForDestination(*pwallet, DecodeDestination(smsgAddresses[i].sAddress));
+                    if (!ckid.IsNull())
+                        mapAddressTags.emplace(SecureMsgRecipientTag(ckid), i);
+                }
+                fAddressTagsDirty = false;
+            }
+
+            auto range = mapAddressTags.equal_range(ReadLE16(smsg.reserved));
+            for (auto it = range.first; it != range.second; ++it)
+                vCandidates.push_back(smsgAddresses[it->second]);
+        } else
+        {
+            vCandidates = smsgAddresses;
+        }
+    } // LOCK(cs_smsg);
+
+    for (std::vector<SecMsgAddress>::iterator it = vCandidates.begin(); it != vCandidates.end(); ++it)
+    {
+        if (!fSecMsgEnabled)
+            return 1;
+
         if (!it->fReceiveEnabled)
             continue;
 
@@ -2304,6 +2700,36 @@ int SecureMsgScanMessage(const SecureMessageHeader &smsg, const unsigned char *p
     return 0;
 }
 
+void SecureMsgGetSendQueueStats(SecMsgSendQueueStats& stats)
+{
+    stats.nThreads      = smsgSendPool ? smsgSendPool->size() : 0;
+    stats.nQueued       = 0;
+    stats.nProcessing   = nSendProcessing;
+    stats.nProcessed    = nSendProcessed;
+
+    LOCK(cs_smsgDB);
+    SecMsgDB dbSendQueue;
+    if (!dbSendQueue.Open("cr"))
+        return;
+
+    std::string sPrefix("qm");
+    unsigned char chKey[18];
+    leveldb::Iterator* it = dbSendQueue.pdb->NewIterator(leveldb::ReadOptions());
+    while (dbSendQueue.NextSmesgKey(it, sPrefix, chKey))
+        stats.nQueued++;
+    delete it;
+}
+
+void SecureMsgSetHash(SecureMessageHeader& smsg, const unsigned char* pPayload)
+{
+    memcpy(smsg.hash, Hash(&pPayload[0], &pPayload[smsg.nPayload]).begin(), 32);
+}
+
+uint16_t SecureMsgRecipientTag(const CKeyID& ckid)
+{
+    return ReadLE16(ckid.begin());
+}
+
 int SecureMsgGetLocalKey(CKeyID& ckid, CPubKey& cpkOut)
 {
 	std::shared_ptr<CWallet> pwallet = GetWallet("default");
@@ -2450,50 +2876,8 @@ int SecureMsgRetrieve(SecMsgToken &token, SecureMessage &smsg)
 
     // -- has cs_smsg lock from SecureMsgReceiveData
 
-    fs::path pathSmsgDir = GetDataDir() / "smsgStore";
-
-    int64_t bucket = token.timestamp - (token.timestamp % SMSG_BUCKET_LEN);
-    std::string fileName = boost::lexical_cast<std::string>(bucket) + "_01.dat";
-    fs::path fullpath = pathSmsgDir / fileName;
-
-    //LogPrintf("bucket %"PRId64".\n", bucket);
-    //LogPrintf("bucket lld %lld.\n", bucket);
-    //LogPrintf("fileName %s.\n", fileName.c_str());
-
-    FILE *fp;
-    if (!(fp = fopen(fullpath.string().c_str(), "rb"))) {
-        LogPrintf("Error opening file: %s\nPath %s\n", strerror(errno), fullpath.string().c_str());
-        return 1;
-    }
-
-    if (fseek(fp, token.offset, SEEK_SET) != 0) {
-        LogPrintf("fseek, strerror: %s.\n", strerror(errno));
-        fclose(fp);
+    if (!smsgSegments || !smsgSegments->Read(token, smsg))
         return 1;
-    }
-
-    if (fread(smsg.Header(), sizeof(unsigned char), SMSG_HDR_LEN, fp) != (size_t)SMSG_HDR_LEN) {
-        LogPrintf("fread header failed: %s\n", strerror(errno));
-        fclose(fp);
-        return 1;
-    }
-
-    try {
-        smsg.vchPayload.resize(smsg.nPayload);
-    }
-    catch (std::exception& e) {
-        LogPrintf("SecureMsgRetrieve(): Could not resize vchPayload, %u, %s\n", smsg.nPayload, e.what());
-        return 1;
-    }
-
-    if (fread(&smsg.vchPayload[0], sizeof(unsigned char), smsg.nPayload, fp) != smsg.nPayload) {
-        LogPrintf("fread data failed: %s. Wanted %u bytes.\n", strerror(errno), smsg.nPayload);
-        fclose(fp);
-        return 1;
-    }
-
-
-    fclose(fp);
 
     return 0;
 }
@@ -2571,8 +2955,8 @@ int SecureMsgReceive(CNode* pfrom, std::vector<unsigned char>& vchData)
             continue;
         }
 
-        // -- store message, but don't hash bucket
-        if (SecureMsgStore(header, &vchData[n + SMSG_HDR_LEN], false) != 0) {
+        // -- store message
+        if (SecureMsgStore(header, &vchData[n + SMSG_HDR_LEN]) != 0) {
             // message dropped
             break; // continue?
         }
@@ -2594,7 +2978,6 @@ int SecureMsgReceive(CNode* pfrom, std::vector<unsigned char>& vchData)
 
     itb->second.nLockCount  = 0; // this node has received data from peer, release lock
     itb->second.nLockPeerId = 0;
-    itb->second.hashBucket();
 
     return 0;
 }
@@ -2658,7 +3041,7 @@ int SecureMsgStoreUnscanned(const SecureMessageHeader &header, const unsigned ch
 }
 
 
-int SecureMsgStore(const SecureMessageHeader &smsg, const unsigned char *pPayload, bool fUpdateBucket)
+int SecureMsgStore(const SecureMessageHeader &smsg, const unsigned char *pPayload)
 {
     if (LogInstance().WillLogCategory(BCLog::SMSG))
         LogPrintf("SecureMsgStore()\n");
@@ -2669,14 +3052,8 @@ int SecureMsgStore(const SecureMessageHeader &smsg, const unsigned char *pPayloa
     }
 
 
-    long int ofs;
-    fs::path pathSmsgDir;
-    try {
-        pathSmsgDir = GetDataDir() / "smsgStore";
-        fs::create_directory(pathSmsgDir);
-    }
-    catch (const boost::filesystem::filesystem_error& ex) {
-        LogPrintf("Error: Failed to create directory %s - %s\n", pathSmsgDir.string().c_str(), ex.what());
+    if (!smsgSegments) {
+        LogPrintf("Error: message store is not open.\n");
         return 1;
     }
 
@@ -2696,9 +3073,10 @@ int SecureMsgStore(const SecureMessageHeader &smsg, const unsigned char *pPayloa
         // -- must lock cs_smsg before calling
         //LOCK(cs_smsg);
 
-        SecMsgToken token(smsg.timestamp, pPayload, smsg.nPayload, 0);
+        SecMsgToken token(smsg.timestamp, pPayload, smsg.nPayload, 0, smsg.nVersion);
 
-        std::set<SecMsgToken>& tokenSet = smsgBuckets[bucket].setTokens;
+        SecMsgBucket& bkt = smsgBuckets[bucket];
+        std::set<SecMsgToken>& tokenSet = SecureMsgGetTokens(bucket, bkt);
         std::set<SecMsgToken>::iterator it;
         it = tokenSet.find(token);
         if (it != tokenSet.end())
@@ -2728,43 +3106,11 @@ int SecureMsgStore(const SecureMessageHeader &smsg, const unsigned char *pPayloa
             return 1;
         }
 
-        std::string fileName = boost::lexical_cast<std::string>(bucket) + "_01.dat";
-        fs::path fullpath = pathSmsgDir / fileName;
-
-        FILE *fp;
-        if (!(fp = fopen(fullpath.string().c_str(), "ab")))
-        {
-            LogPrintf("Error opening file: %s (%d)\n", strerror(errno), __LINE__);
-            return 1;
-        }
-
-        // -- on windows ftell will always return 0 after fopen(ab), call fseek to set.
-        if (fseek(fp, 0, SEEK_END) != 0)
-        {
-            LogPrintf("Error fseek failed: %s\n", strerror(errno));
+        if (!smsgSegments->Append(smsg, pPayload, token))
             return 1;
-        }
-
-
-        ofs = ftell(fp);
-
-        if (fwrite(&smsg, sizeof(unsigned char), SMSG_HDR_LEN, fp) != (size_t)SMSG_HDR_LEN
-            || fwrite(pPayload, sizeof(unsigned char), smsg.nPayload, fp) != smsg.nPayload)
-        {
-            LogPrintf("fwrite failed: %s\n", strerror(errno));
-            fclose(fp);
-            return 1;
-        }
-
-        fclose(fp);
-
-        token.offset = ofs;
 
         //LogPrintf("token.offset: %"PRId64"\n", token.offset); // DEBUG
-        tokenSet.insert(token);
-
-        if (fUpdateBucket)
-            smsgBuckets[bucket].hashBucket();
+        bkt.AddToken(token);
     }
 
     //if (LogInstance().WillLogCategory(BCLog::SMSG))
@@ -2772,9 +3118,9 @@ int SecureMsgStore(const SecureMessageHeader &smsg, const unsigned char *pPayloa
     return 0;
 }
 
-int SecureMsgStore(const SecureMessage& smsg, bool fUpdateBucket)
+int SecureMsgStore(const SecureMessage& smsg)
 {
-    return SecureMsgStore(smsg, &smsg.vchPayload[0], fUpdateBucket);
+    return SecureMsgStore(smsg, &smsg.vchPayload[0]);
 }
 
 int SecureMsgValidate(const SecureMessageHeader &smsg_header, size_t nPayload)
@@ -2792,7 +3138,7 @@ int SecureMsgValidate(const SecureMessageHeader &smsg_header, size_t nPayload)
         return 1;
     }
 
-    if (smsg_header.nVersion != 1)
+    if (smsg_header.nVersion != SMSG_VERSION_LEGACY && smsg_header.nVersion != SMSG_VERSION_TAGGED)
         return 4;
 
     if (smsg_header.nPayload > SMSG_MAX_MSG_WORST){
@@ -2804,6 +3150,29 @@ int SecureMsgValidate(const SecureMessageHeader &smsg_header, size_t nPayload)
 }
 
 
+static uint32_t SecureMsgGetSendVersion()
+{
+    // -- only send tagged messages if every direct smsg peer can relay them. Peers further away may
+    //    still be legacy: tagged messages are left out of the counts, hashes and token lists they get
+    //    in bucket sync, so they never receive one and a recipient running a legacy node can't read it
+    bool fTagged = false;
+    if (g_connman)
+    {
+        fTagged = true;
+        size_t nPeers = 0;
+        g_connman->ForEachNode([&](CNode* pnode) {
+            if (!pnode->smsgData.fEnabled)
+                return;
+            nPeers++;
+            if (pnode->smsgData.nVersion < SMSG_VERSION_TAGGED)
+                fTagged = false;
+        });
+        if (nPeers == 0)
+            fTagged = false;
+    }
+    return fTagged ? SMSG_VERSION_TAGGED : SMSG_VERSION_LEGACY;
+}
+
 int SecureMsgEncrypt(SecureMessage& smsg, std::string& addressFrom, std::string& addressTo, std::string& message)
 {
     /* Create a secure message
@@ -2842,8 +3211,9 @@ int SecureMsgEncrypt(SecureMessage& smsg, std::string& addressFrom, std::string&
         return 2;
     }
 
-    smsg.nVersion = 1;
+    smsg.nVersion = SecureMsgGetSendVersion();
     smsg.timestamp = GetTime();
+    memset(smsg.reserved, 0, sizeof(smsg.reserved));
 
 
     bool fSendAnonymous;
@@ -2882,6 +3252,9 @@ int SecureMsgEncrypt(SecureMessage& smsg, std::string& addressFrom, std::string&
         return 4;
     }
 
+    if (smsg.nVersion >= SMSG_VERSION_TAGGED)
+        WriteLE16(smsg.reserved, SecureMsgRecipientTag(ckidDest));
+
     // -- public key K is the destination address
     CPubKey cpkDestK;
     if (SecureMsgGetStoredKey(ckidDest, cpkDestK) != 0
@@ -3030,7 +3403,7 @@ int SecureMsgEncrypt(SecureMessage& smsg, std::string& addressFrom, std::string&
     smsg.nPayload = smsg.vchPayload.size();
 
     // -- calculate hash of encrypted payload
-    memcpy(smsg.hash, Hash(&smsg.vchPayload[0], &smsg.vchPayload[smsg.nPayload]).begin(), 32);
+    SecureMsgSetHash(smsg, &smsg.vchPayload[0]);
 
     // -- Calculate a 32 byte MAC with HMACSHA256, using key_m as salt
     //    Message authentication code of the header
@@ -3230,7 +3603,7 @@ int SecureMsgDecrypt(bool fTestOnly, const std::string& address, const SecureMes
     if (LogInstance().WillLogCategory(BCLog::SMSG))
         LogPrintf("SecureMsgDecrypt(), using %s, testonly %d.\n", address.c_str(), fTestOnly);
 
-    if (smsg.nVersion != 1) {
+    if (smsg.nVersion != SMSG_VERSION_LEGACY && smsg.nVersion != SMSG_VERSION_TAGGED) {
         LogPrintf("Unknown version number.\n");
         return 2;
     }
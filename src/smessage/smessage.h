@@ -27,11 +27,22 @@ typedef std::basic_string<char, std::char_traits<char>, secure_allocator<char> >
 const unsigned int SMSG_HDR_LEN         = 84;                // length of unencrypted header, 4 + 4 + 8 + 33 + 3 + 32
 const unsigned int SMSG_PL_HDR_LEN      = 4+33+1+65;         // length of encrypted header in payload
 
+const uint32_t SMSG_VERSION_LEGACY    = 1;
+const uint32_t SMSG_VERSION_TAGGED    = 2;                 // reserved[0..1] of the header carry the recipient tag
+
+// -- sent in smsgPong, the highest message version a peer accepts and the sync features it knows
+const uint32_t SMSG_PROTOCOL_RECONCILE = 3;                // incremental bucket hash in smsgInv, smsgShowDiff
+const uint32_t SMSG_PROTOCOL_VERSION   = SMSG_PROTOCOL_RECONCILE;
+
 const unsigned int SMSG_BUCKET_LEN      = 60 * 10;           // in seconds
 const unsigned int SMSG_RETENTION       = 60 * 60 * 24 * 90;      // in seconds
 const unsigned int SMSG_SEND_DELAY      = 2;                 // in seconds, SecureMsgSendData will delay this long between firing
 const unsigned int SMSG_THREAD_DELAY    = 5;
 
+const int DEFAULT_SMSG_SEND_THREADS     = 0;                 // 0 = auto
+const int MAX_SMSG_SEND_THREADS         = 16;
+const unsigned int SMSG_SEND_BATCH      = 64;                // queued messages taken from the send queue db at once
+
 const unsigned int SMSG_TIME_LEEWAY     = 60;
 const unsigned int SMSG_TIME_IGNORE     = 90;                // seconds that a peer is ignored for if they fail to deliver messages for a smsgWant
 
@@ -86,7 +97,7 @@ struct SecureMessageHeader {
     uint32_t        nPayload;
     int64_t         timestamp;
     unsigned char   cpkR[33];
-    unsigned char   reserved[3];
+    unsigned char   reserved[3];    // version 2: recipient tag (LE16) + 0
     unsigned char   mac[32];
 
     unsigned char   hash[32];
@@ -157,7 +168,7 @@ public:
 class SecMsgToken
 {
 public:
-    SecMsgToken(int64_t ts, const unsigned char* p, int np, long int o)
+    SecMsgToken(int64_t ts, const unsigned char* p, int np, long int o, uint32_t v)
     {
         timestamp = ts;
 
@@ -166,9 +177,10 @@ public:
         else
             memcpy(sample, p, 8);
         offset = o;
+        version = v;
     };
 
-    SecMsgToken() {};
+    SecMsgToken() : version(0) {};
 
     ~SecMsgToken() {};
 
@@ -183,6 +195,7 @@ public:
     int64_t                     timestamp;
     unsigned char               sample[8];    // a message hash
     int64_t                     offset;       // offset
+    uint32_t                    version;      // message version, 0 if the token didn't come from the store
 
 };
 
@@ -194,18 +207,42 @@ public:
     {
         timeChanged     = 0;
         hash            = 0;
+        hashLegacy      = 0;
+        fHashDirty      = false;
+        nSetHash        = 0;
+        nMessages       = 0;
+        nTagged         = 0;
         nLockCount      = 0;
         nLockPeerId     = 0;
+        fTokensLoaded   = true;
+        nLastUsed       = 0;
     };
     ~SecMsgBucket() {};
 
+    // Recompute hash and nSetHash from setTokens
     void hashBucket();
 
+    // Add a token to the loaded set, false if already present
+    bool AddToken(const SecMsgToken& token);
+
+    // Hash sent to a peer in smsgInv, peers before SMSG_PROTOCOL_RECONCILE only know the ordered hash
+    uint32_t GetHash(uint32_t nPeerVersion);
+
+    // Messages a peer can get from this bucket, peers before SMSG_VERSION_TAGGED never see tagged messages
+    uint32_t GetMessageCount(uint32_t nPeerVersion) const;
+
     int64_t                     timeChanged;
-    uint32_t                    hash;           // token set should get ordered the same on each node
+    uint32_t                    hash;           // token set should get ordered the same on each node, recomputed on demand if fHashDirty
+    uint32_t                    hashLegacy;     // ordered hash of the untagged tokens, sent to peers before SMSG_VERSION_TAGGED
+    bool                        fHashDirty;
+    uint64_t                    nSetHash;       // sum of SecMsgTokenHash() of all tokens, updated on insert
+    uint32_t                    nMessages;      // size of the token set
+    uint32_t                    nTagged;        // tokens of messages with version >= SMSG_VERSION_TAGGED
     uint32_t                    nLockCount;     // set when smsgWant first sent, unset at end of smsgMsg, ticks down in ThreadSecureMsg()
     uint32_t                    nLockPeerId;    // id of peer that bucket is locked for
-    std::set<SecMsgToken>       setTokens;
+    std::set<SecMsgToken>       setTokens;      // only valid if fTokensLoaded, use SecureMsgGetTokens()
+    bool                        fTokensLoaded;  // false if setTokens was dropped, reload from the segment index
+    int64_t                     nLastUsed;      // last time setTokens was needed
 
 };
 
@@ -344,6 +381,21 @@ int SecureMsgWalletKeyChanged(std::string sAddress, std::string sLabel, ChangeTy
 
 int SecureMsgScanMessage(const SecureMessageHeader &smsg, const unsigned char *pPayload, bool reportToGui);
 
+// Set smsg.hash to the hash of the payload, the mac covers it
+void SecureMsgSetHash(SecureMessageHeader& smsg, const unsigned char* pPayload);
+
+struct SecMsgSendQueueStats {
+    int         nThreads;       // send queue workers, 0 if the queue is processed on the smsg thread
+    uint32_t    nQueued;        // messages waiting in the send queue db
+    uint32_t    nProcessing;    // messages taken from the queue and not done yet
+    uint64_t    nProcessed;     // messages processed since secure messaging was enabled
+};
+void SecureMsgGetSendQueueStats(SecMsgSendQueueStats& stats);
+
+// Short public hint of the recipient key, lets a node find the owned address a message is for
+// without trying to decrypt it with every address. Only 16 bits, so many addresses share a tag.
+uint16_t SecureMsgRecipientTag(const CKeyID& ckid);
+
 int SecureMsgGetStoredKey(CKeyID& ckid, CPubKey& cpkOut);
 int SecureMsgGetLocalKey(CKeyID& ckid, CPubKey& cpkOut);
 int SecureMsgGetLocalPublicKey(std::string& strAddress, std::string& strPublicKey);
@@ -355,8 +407,8 @@ int SecureMsgRetrieve(SecMsgToken &token, SecureMessage &smsg);
 int SecureMsgReceive(CNode* pfrom, std::vector<unsigned char>& vchData);
 
 int SecureMsgStoreUnscanned(const SecureMessageHeader &smsg, const unsigned char *pPayload);
-int SecureMsgStore(const SecureMessageHeader &smsg, const unsigned char *pPayload, bool fUpdateBucket);
-int SecureMsgStore(const SecureMessage &smsg, bool fUpdateBucket);
+int SecureMsgStore(const SecureMessageHeader &smsg, const unsigned char *pPayload);
+int SecureMsgStore(const SecureMessage &smsg);
 
 
 int SecureMsgSend(std::string& addressFrom, std::string& addressTo, std::string& message, std::string& sError);
@@ -0,0 +1,160 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <smessage/smsgsketch.h>
+
+#include <crypto/common.h>
+#include <crypto/siphash.h>
+
+#include <algorithm>
+#include <string.h>
+
+// -- fixed keys, every node has to map a token to the same cells and set hash
+static const uint64_t SKETCH_INDEX_K0   = 0x736d7367536b6574ULL;
+static const uint64_t SKETCH_INDEX_K1   = 0x6368496e64657830ULL;
+static const uint64_t SKETCH_CHECK_K0   = 0x736d7367536b6574ULL;
+static const uint64_t SKETCH_CHECK_K1   = 0x6368436865636b30ULL;
+static const uint64_t SET_HASH_K0       = 0x736d736742756b74ULL;
+static const uint64_t SET_HASH_K1       = 0x5365744861736830ULL;
+
+static void TokenId(const SecMsgToken& token, unsigned char* id)
+{
+    WriteLE64(id, token.timestamp);
+    memcpy(id + 8, token.sample, 8);
+}
+
+static uint32_t IdCheck(const unsigned char* id)
+{
+    return (uint32_t) CSipHasher(SKETCH_CHECK_K0, SKETCH_CHECK_K1).Write(id, 16).Finalize();
+}
+
+uint64_t SecMsgTokenHash(const SecMsgToken& token)
+{
+    unsigned char id[16];
+    TokenId(token, id);
+    return CSipHasher(SET_HASH_K0, SET_HASH_K1).Write(id, 16).Finalize();
+}
+
+SecMsgTokenSketch::SecMsgTokenSketch(uint32_t nCells)
+{
+    nCells = std::max<uint32_t>(nCells, NUM_HASHES);
+    nCells += (NUM_HASHES - nCells % NUM_HASHES) % NUM_HASHES;
+    vCells.resize(nCells);
+    memset(vCells.data(), 0, vCells.size() * sizeof(Cell));
+}
+
+uint32_t SecMsgTokenSketch::CellsForDifference(uint32_t nDiff)
+{
+    // -- three hashes decode reliably with ~1.3 cells per difference for large sets,
+    //    small sets need relatively more
+    uint32_t nCells = nDiff + nDiff / 2 + 12;
+    nCells = std::max(nCells, SMSG_SKETCH_MIN_CELLS);
+    nCells = std::min(nCells, SMSG_SKETCH_MAX_CELLS);
+    return nCells + (NUM_HASHES - nCells % NUM_HASHES) % NUM_HASHES;
+}
+
+void SecMsgTokenSketch::Toggle(const unsigned char* id, uint32_t check, int32_t count)
+{
+    // -- one cell in each third of the table, so a token never hits the same cell twice
+    uint32_t nPart = vCells.size() / NUM_HASHES;
+    uint64_t h = CSipHasher(SKETCH_INDEX_K0, SKETCH_INDEX_K1).Write(id, 16).Finalize();
+    for (int i = 0; i < NUM_HASHES; ++i) {
+        Cell& cell = vCells[i * nPart + ((h >> (i * 21)) & 0x1fffff) % nPart];
+        cell.count += count;
+        for (int k = 0; k < 16; ++k)
+            cell.id[k] ^= id[k];
+        cell.check ^= check;
+    }
+}
+
+void SecMsgTokenSketch::Insert(const SecMsgToken& token)
+{
+    unsigned char id[16];
+    TokenId(token, id);
+    Toggle(id, IdCheck(id), 1);
+}
+
+bool SecMsgTokenSketch::Subtract(const SecMsgTokenSketch& other)
+{
+    if (other.vCells.size() != vCells.size())
+        return false;
+
+    for (size_t i = 0; i < vCells.size(); ++i) {
+        vCells[i].count -= other.vCells[i].count;
+        for (int k = 0; k < 16; ++k)
+            vCells[i].id[k] ^= other.vCells[i].id[k];
+        vCells[i].check ^= other.vCells[i].check;
+    }
+    return true;
+}
+
+bool SecMsgTokenSketch::Decode(std::vector<SecMsgToken>& vOnlyThis, std::vector<SecMsgToken>& vOnlyOther) const
+{
+    vOnlyThis.clear();
+    vOnlyOther.clear();
+
+    SecMsgTokenSketch work(*this);
+
+    // -- a token is decoded from a cell it is alone in, removing it may leave other cells with one token
+    size_t nMaxDecoded = vCells.size();
+    bool fProgress = true;
+    while (fProgress) {
+        fProgress = false;
+        for (const Cell& cell : work.vCells) {
+            if ((cell.count != 1 && cell.count != -1)
+                || IdCheck(cell.id) != cell.check)
+                continue;
+
+            if (vOnlyThis.size() + vOnlyOther.size() >= nMaxDecoded)
+                return false;
+
+            SecMsgToken token;
+            token.timestamp = ReadLE64(cell.id);
+            memcpy(token.sample, cell.id + 8, 8);
+            token.offset = 0;
+            (cell.count == 1 ? vOnlyThis : vOnlyOther).push_back(token);
+
+            unsigned char id[16];
+            memcpy(id, cell.id, 16);
+            work.Toggle(id, cell.check, -cell.count);
+            fProgress = true;
+        }
+    }
+
+    for (const Cell& cell : work.vCells) {
+        if (cell.count != 0 || cell.check != 0)
+            return false;
+    }
+    return true;
+}
+
+void SecMsgTokenSketch::Serialize(unsigned char* p) const
+{
+    for (const Cell& cell : vCells) {
+        WriteLE32(p, (uint32_t) cell.count);
+        memcpy(p + 4, cell.id, 16);
+        WriteLE32(p + 20, cell.check);
+        p += SMSG_SKETCH_CELL_LEN;
+    }
+}
+
+bool SecMsgTokenSketch::Deserialize(const unsigned char* p, size_t nLen)
+{
+    if (nLen % SMSG_SKETCH_CELL_LEN != 0)
+        return false;
+
+    size_t nCells = nLen / SMSG_SKETCH_CELL_LEN;
+    if (nCells < SMSG_SKETCH_MIN_CELLS || nCells > SMSG_SKETCH_MAX_CELLS
+        || nCells % NUM_HASHES != 0)
+        return false;
+
+    vCells.resize(nCells);
+    for (Cell& cell : vCells) {
+        cell.count = (int32_t) ReadLE32(p);
+        memcpy(cell.id, p + 4, 16);
+        cell.check = ReadLE32(p + 20);
+        p += SMSG_SKETCH_CELL_LEN;
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RAIN_SMESSAGE_SMSGSKETCH_H
+#define RAIN_SMESSAGE_SMSGSKETCH_H
+
+#include <smessage/smessage.h>
+
+#include <stdint.h>
+#include <vector>
+
+const uint32_t SMSG_SKETCH_CELL_LEN     = 4 + 16 + 4;   // count, token id (timestamp + sample), checksum
+const uint32_t SMSG_SKETCH_MIN_CELLS    = 24;
+const uint32_t SMSG_SKETCH_MAX_CELLS    = 3072;         // ~72KB, more differences are sent as a full token list
+const uint32_t SMSG_SKETCH_MAX_DIFF     = 2000;         // fits in SMSG_SKETCH_MAX_CELLS
+const uint32_t SMSG_SKETCH_DIFF_SLACK   = 8;            // differences expected on top of the difference in count
+
+// Hash of a single token, the bucket set hash is the sum of these over all tokens
+uint64_t SecMsgTokenHash(const SecMsgToken& token);
+
+/**
+ * Invertible Bloom lookup table over the tokens of a bucket.
+ *
+ * A node sends the sketch of its tokens, the peer subtracts it from the sketch of its own
+ * tokens and decodes the difference: the tokens only the peer has and the tokens only the
+ * sender has. The size only depends on the expected number of differences, not on the number
+ * of tokens in the bucket. Decoding fails if there are more differences than the sketch can
+ * hold, the peer then falls back to sending the full token list.
+ */
+class SecMsgTokenSketch
+{
+private:
+    struct Cell {
+        int32_t         count;
+        unsigned char   id[16];
+        uint32_t        check;
+    };
+    std::vector<Cell> vCells;
+
+    void Toggle(const unsigned char* id, uint32_t check, int32_t count);
+
+public:
+    static const int NUM_HASHES = 3;
+
+    // nCells is rounded up to a multiple of NUM_HASHES
+    explicit SecMsgTokenSketch(uint32_t nCells);
+
+    // Cells needed to decode about nDiff differences
+    static uint32_t CellsForDifference(uint32_t nDiff);
+
+    uint32_t GetCells() const { return vCells.size(); }
+
+    void Insert(const SecMsgToken& token);
+
+    // Remove the tokens of other, the sketches must have the same size
+    bool Subtract(const SecMsgTokenSketch& other);
+
+    // Tokens only in this sketch and only in the subtracted one, false if the difference could not be decoded
+    bool Decode(std::vector<SecMsgToken>& vOnlyThis, std::vector<SecMsgToken>& vOnlyOther) const;
+
+    void Serialize(unsigned char* p) const;
+    bool Deserialize(const unsigned char* p, size_t nLen);
+};
+
+#endif // RAIN_SMESSAGE_SMSGSKETCH_H
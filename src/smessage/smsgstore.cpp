@@ -0,0 +1,336 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <smessage/smsgstore.h>
+
+#include <logging.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <errno.h>
+
+std::unique_ptr<SecMsgSegmentStore> smsgSegments;
+
+static const size_t SMSG_INDEX_RECORD_LEN   = 8 + 8 + 8 + 4;            // timestamp, sample, offset, message version
+static const size_t SMSG_SUMMARY_RECORD_LEN = 8 + 4 + 4 + 8 + 4 + 4;    // bucket time, no. messages, hash, set hash, no. tagged, legacy hash
+
+SecMsgSegmentStore::SecMsgSegmentStore(const fs::path& path) :
+    pathDir(path), nAppendSegment(-1), fpData(nullptr), fpIndex(nullptr)
+{
+}
+
+SecMsgSegmentStore::~SecMsgSegmentStore()
+{
+    CloseAppend();
+}
+
+fs::path SecMsgSegmentStore::DataPath(int64_t segment) const
+{
+    return pathDir / (boost::lexical_cast<std::string>(segment) + "_seg.dat");
+}
+
+fs::path SecMsgSegmentStore::IndexPath(int64_t segment) const
+{
+    return pathDir / (boost::lexical_cast<std::string>(segment) + "_seg.idx");
+}
+
+fs::path SecMsgSegmentStore::SummaryPath(int64_t segment) const
+{
+    return pathDir / (boost::lexical_cast<std::string>(segment) + "_seg.sum");
+}
+
+bool SecMsgSegmentStore::Open()
+{
+    setSegments.clear();
+
+    try {
+        fs::create_directory(pathDir);
+        for (fs::directory_iterator itd(pathDir), itend; itd != itend; ++itd) {
+            if (!fs::is_regular_file(itd->status()))
+                continue;
+
+            std::string fileName = itd->path().filename().string();
+            if (!boost::algorithm::ends_with(fileName, "_seg.idx"))
+                continue;
+
+            int64_t segment;
+            try {
+                segment = boost::lexical_cast<int64_t>(fileName.substr(0, fileName.find('_')));
+            } catch (const boost::bad_lexical_cast&) {
+                LogPrintf("Unexpected file in message store: %s.\n", fileName.c_str());
+                continue;
+            }
+            setSegments.insert(segment);
+        }
+    } catch (const fs::filesystem_error& ex) {
+        LogPrintf("Error: could not read message store %s - %s\n", pathDir.string().c_str(), ex.what());
+        return false;
+    }
+
+    return true;
+}
+
+bool SecMsgSegmentStore::OpenAppend(int64_t segment)
+{
+    if (segment == nAppendSegment && fpData && fpIndex)
+        return true;
+
+    CloseAppend();
+
+    if (!(fpData = fsbridge::fopen(DataPath(segment), "ab"))
+        || !(fpIndex = fsbridge::fopen(IndexPath(segment), "ab"))) {
+        LogPrintf("Error opening segment %d: %s\n", (int) segment, strerror(errno));
+        CloseAppend();
+        return false;
+    }
+
+    nAppendSegment = segment;
+    setSegments.insert(segment);
+    return true;
+}
+
+void SecMsgSegmentStore::CloseAppend()
+{
+    if (fpData)
+        fclose(fpData);
+    if (fpIndex)
+        fclose(fpIndex);
+    fpData = nullptr;
+    fpIndex = nullptr;
+    nAppendSegment = -1;
+}
+
+bool SecMsgSegmentStore::Append(const SecureMessageHeader& header, const unsigned char* pPayload, SecMsgToken& token)
+{
+    if (!OpenAppend(SegmentOf(header.timestamp)))
+        return false;
+
+    // -- on windows ftell will always return 0 after fopen(ab), call fseek to set.
+    if (fseek(fpData, 0, SEEK_END) != 0) {
+        LogPrintf("Error fseek failed: %s\n", strerror(errno));
+        return false;
+    }
+    int64_t ofs = ftell(fpData);
+
+    if (fwrite(&header, sizeof(unsigned char), SMSG_HDR_LEN, fpData) != (size_t)SMSG_HDR_LEN
+        || fwrite(pPayload, sizeof(unsigned char), header.nPayload, fpData) != header.nPayload
+        || fflush(fpData) != 0) {
+        LogPrintf("fwrite failed: %s\n", strerror(errno));
+        CloseAppend();
+        return false;
+    }
+
+    // -- the index is written after the data, an index record never points past the end of the data
+    unsigned char record[SMSG_INDEX_RECORD_LEN];
+    memcpy(&record[0], &token.timestamp, 8);
+    memcpy(&record[8], token.sample, 8);
+    memcpy(&record[16], &ofs, 8);
+    memcpy(&record[24], &token.version, 4);
+    if (fwrite(record, sizeof(unsigned char), sizeof(record), fpIndex) != sizeof(record)
+        || fflush(fpIndex) != 0) {
+        LogPrintf("fwrite failed: %s\n", strerror(errno));
+        CloseAppend();
+        return false;
+    }
+
+    token.offset = ofs;
+    return true;
+}
+
+bool SecMsgSegmentStore::Read(const SecMsgToken& token, SecureMessage& smsg)
+{
+    fs::path fullpath = DataPath(SegmentOf(token.timestamp));
+
+    FILE *fp;
+    if (!(fp = fsbridge::fopen(fullpath, "rb"))) {
+        LogPrintf("Error opening file: %s\nPath %s\n", strerror(errno), fullpath.string().c_str());
+        return false;
+    }
+
+    if (fseek(fp, token.offset, SEEK_SET) != 0) {
+        LogPrintf("fseek, strerror: %s.\n", strerror(errno));
+        fclose(fp);
+        return false;
+    }
+
+    if (fread(smsg.Header(), sizeof(unsigned char), SMSG_HDR_LEN, fp) != (size_t)SMSG_HDR_LEN) {
+        LogPrintf("fread header failed: %s\n", strerror(errno));
+        fclose(fp);
+        return false;
+    }
+
+    if (smsg.nPayload > SMSG_MAX_MSG_WORST) {
+        LogPrintf("Message in segment has invalid payload size %u.\n", smsg.nPayload);
+        fclose(fp);
+        return false;
+    }
+
+    smsg.vchPayload.resize(smsg.nPayload);
+    if (fread(smsg.vchPayload.data(), sizeof(unsigned char), smsg.nPayload, fp) != smsg.nPayload) {
+        LogPrintf("fread data failed: %s. Wanted %u bytes.\n", strerror(errno), smsg.nPayload);
+        fclose(fp);
+        return false;
+    }
+
+    fclose(fp);
+    return true;
+}
+
+bool SecMsgSegmentStore::ReadTokens(int64_t segment, std::map<int64_t, std::set<SecMsgToken> >& mapTokens, int64_t nBucket)
+{
+    uint64_t nDataSize = GetSegmentSize(segment);
+
+    FILE *fp;
+    if (!(fp = fsbridge::fopen(IndexPath(segment), "rb"))) {
+        LogPrintf("Error opening segment index %d: %s\n", (int) segment, strerror(errno));
+        return false;
+    }
+
+    unsigned char record[SMSG_INDEX_RECORD_LEN];
+    while (fread(record, sizeof(unsigned char), sizeof(record), fp) == sizeof(record)) {
+        SecMsgToken token;
+        memcpy(&token.timestamp, &record[0], 8);
+        memcpy(token.sample, &record[8], 8);
+        memcpy(&token.offset, &record[16], 8);
+        memcpy(&token.version, &record[24], 4);
+
+        if (token.offset < 0 || (uint64_t) token.offset + SMSG_HDR_LEN > nDataSize) {
+            LogPrintf("Segment %d index points past the end of the data, ignoring.\n", (int) segment);
+            continue;
+        }
+
+        int64_t bucket = token.timestamp - (token.timestamp % SMSG_BUCKET_LEN);
+        if (nBucket != 0 && bucket != nBucket)
+            continue;
+
+        mapTokens[bucket].insert(token);
+    }
+
+    fclose(fp);
+    return true;
+}
+
+bool SecMsgSegmentStore::ReadSummary(int64_t segment, std::vector<SecMsgBucketSummary>& vSummary)
+{
+    vSummary.clear();
+
+    FILE *fp;
+    if (!(fp = fsbridge::fopen(SummaryPath(segment), "rb")))
+        return false;
+
+    uint64_t nIndexSize;
+    uint32_t nBuckets;
+    bool fOk = fread(&nIndexSize, sizeof(nIndexSize), 1, fp) == 1
+        && fread(&nBuckets, sizeof(nBuckets), 1, fp) == 1
+        && nBuckets <= SMSG_SEGMENT_LEN / SMSG_BUCKET_LEN;
+
+    // -- messages were added to the segment after the summary was written, or the summary has old records
+    if (fOk) {
+        try {
+            fOk = nIndexSize == fs::file_size(IndexPath(segment))
+                && fs::file_size(SummaryPath(segment)) == 8 + 4 + nBuckets * SMSG_SUMMARY_RECORD_LEN;
+        } catch (const fs::filesystem_error&) {
+            fOk = false;
+        }
+    }
+
+    for (uint32_t i = 0; fOk && i < nBuckets; ++i) {
+        unsigned char record[SMSG_SUMMARY_RECORD_LEN];
+        if (fread(record, sizeof(unsigned char), sizeof(record), fp) != sizeof(record)) {
+            fOk = false;
+            break;
+        }
+        SecMsgBucketSummary summary;
+        memcpy(&summary.time, &record[0], 8);
+        memcpy(&summary.nMessages, &record[8], 4);
+        memcpy(&summary.hash, &record[12], 4);
+        memcpy(&summary.nSetHash, &record[16], 8);
+        memcpy(&summary.nTagged, &record[24], 4);
+        memcpy(&summary.hashLegacy, &record[28], 4);
+        vSummary.push_back(summary);
+    }
+
+    fclose(fp);
+    if (!fOk)
+        vSummary.clear();
+    return fOk;
+}
+
+bool SecMsgSegmentStore::WriteSummary(int64_t segment, const std::vector<SecMsgBucketSummary>& vSummary)
+{
+    uint64_t nIndexSize;
+    try {
+        nIndexSize = fs::file_size(IndexPath(segment));
+    } catch (const fs::filesystem_error& ex) {
+        LogPrintf("Error: could not get size of segment index %d - %s\n", (int) segment, ex.what());
+        return false;
+    }
+
+    fs::path pathTmp = SummaryPath(segment);
+    pathTmp += ".new";
+
+    FILE *fp;
+    if (!(fp = fsbridge::fopen(pathTmp, "wb"))) {
+        LogPrintf("Error opening file: %s (%d)\n", strerror(errno), __LINE__);
+        return false;
+    }
+
+    uint32_t nBuckets = vSummary.size();
+    bool fOk = fwrite(&nIndexSize, sizeof(nIndexSize), 1, fp) == 1
+        && fwrite(&nBuckets, sizeof(nBuckets), 1, fp) == 1;
+
+    for (const auto& summary : vSummary) {
+        if (!fOk)
+            break;
+        unsigned char record[SMSG_SUMMARY_RECORD_LEN];
+        memcpy(&record[0], &summary.time, 8);
+        memcpy(&record[8], &summary.nMessages, 4);
+        memcpy(&record[12], &summary.hash, 4);
+        memcpy(&record[16], &summary.nSetHash, 8);
+        memcpy(&record[24], &summary.nTagged, 4);
+        memcpy(&record[28], &summary.hashLegacy, 4);
+        fOk = fwrite(record, sizeof(unsigned char), sizeof(record), fp) == sizeof(record);
+    }
+
+    fclose(fp);
+
+    try {
+        if (fOk)
+            fs::rename(pathTmp, SummaryPath(segment));
+        else
+            fs::remove(pathTmp);
+    } catch (const fs::filesystem_error& ex) {
+        LogPrintf("Error: could not write summary of segment %d - %s\n", (int) segment, ex.what());
+        return false;
+    }
+    return fOk;
+}
+
+uint64_t SecMsgSegmentStore::GetSegmentSize(int64_t segment) const
+{
+    try {
+        return fs::file_size(DataPath(segment));
+    } catch (const fs::filesystem_error&) {
+        return 0;
+    }
+}
+
+void SecMsgSegmentStore::RemoveSegment(int64_t segment)
+{
+    if (segment == nAppendSegment)
+        CloseAppend();
+
+    if (LogInstance().WillLogCategory(BCLog::SMSG))
+        LogPrintf("Removing segment %d\n", (int) segment);
+
+    for (const fs::path& path : {DataPath(segment), IndexPath(segment), SummaryPath(segment)}) {
+        try {
+            fs::remove(path);
+        } catch (const fs::filesystem_error& ex) {
+            LogPrintf("Error removing segment file %s.\n", ex.what());
+        }
+    }
+    setSegments.erase(segment);
+}
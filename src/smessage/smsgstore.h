@@ -0,0 +1,91 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RAIN_SMESSAGE_SMSGSTORE_H
+#define RAIN_SMESSAGE_SMSGSTORE_H
+
+#include <fs.h>
+#include <smessage/smessage.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+const int64_t SMSG_SEGMENT_LEN      = 60 * 60 * 24;      // in seconds, must be a multiple of SMSG_BUCKET_LEN
+const int64_t SMSG_HOT_TIME         = 60 * 60 * 24;      // buckets newer than this keep their tokens in memory
+const int64_t SMSG_TOKENS_IDLE      = 60 * 10;           // tokens of older buckets are dropped when unused for this long
+
+struct SecMsgBucketSummary {
+    int64_t     time;
+    uint32_t    nMessages;
+    uint32_t    hash;
+    uint64_t    nSetHash;
+    uint32_t    nTagged;
+    uint32_t    hashLegacy;
+};
+
+/**
+ * Append-only message log, split into one segment per SMSG_SEGMENT_LEN.
+ *
+ * A segment is three files in the smsgStore dir:
+ *   <start>_seg.dat  messages, header + payload, in the order they were received
+ *   <start>_seg.idx  fixed size token records (timestamp, sample, offset in .dat, message version)
+ *   <start>_seg.sum  count and hash of every bucket in the segment, valid while the
+ *                    .idx has the size recorded in it
+ *
+ * Startup reads the .sum of each segment, buckets only need their tokens (from the
+ * .idx) when a peer asks for them or a message is added. Expiring a segment removes
+ * its files.
+ *
+ * Not thread safe, cs_smsg must be held.
+ */
+class SecMsgSegmentStore
+{
+private:
+    fs::path pathDir;
+    std::set<int64_t> setSegments;
+
+    // -- files of the segment that was appended to last, kept open
+    int64_t nAppendSegment;
+    FILE* fpData;
+    FILE* fpIndex;
+
+    fs::path DataPath(int64_t segment) const;
+    fs::path IndexPath(int64_t segment) const;
+    fs::path SummaryPath(int64_t segment) const;
+
+    bool OpenAppend(int64_t segment);
+    void CloseAppend();
+
+public:
+    explicit SecMsgSegmentStore(const fs::path& path);
+    ~SecMsgSegmentStore();
+
+    static int64_t SegmentOf(int64_t time) { return time - (time % SMSG_SEGMENT_LEN); }
+
+    // Find the segments in the store dir
+    bool Open();
+
+    const std::set<int64_t>& GetSegments() const { return setSegments; }
+
+    // Append a message to the segment of its timestamp, sets token.offset
+    bool Append(const SecureMessageHeader& header, const unsigned char* pPayload, SecMsgToken& token);
+
+    // Read the message a token points to
+    bool Read(const SecMsgToken& token, SecureMessage& smsg);
+
+    // Tokens of all buckets in a segment, or of a single bucket if nBucket != 0
+    bool ReadTokens(int64_t segment, std::map<int64_t, std::set<SecMsgToken> >& mapTokens, int64_t nBucket = 0);
+
+    bool ReadSummary(int64_t segment, std::vector<SecMsgBucketSummary>& vSummary);
+    bool WriteSummary(int64_t segment, const std::vector<SecMsgBucketSummary>& vSummary);
+
+    uint64_t GetSegmentSize(int64_t segment) const;
+    void RemoveSegment(int64_t segment);
+};
+
+extern std::unique_ptr<SecMsgSegmentStore> smsgSegments;
+
+#endif // RAIN_SMESSAGE_SMSGSTORE_H
@@ -102,21 +102,25 @@ struct CSpentIndexTxInfo
     std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare> mSpentInfo;
 };
 
+/**
+ * The address index keys hold the asset as a fixed width id, see
+ * CBlockTreeDB::GetAddressIndexAssetId. 0 is an output without an explicit asset.
+ */
 struct CAddressUnspentKey {
     unsigned int type;
     uint160 hashBytes;
-    std::string asset;
+    uint32_t asset;
     uint256 txhash;
     size_t index;
 
     size_t GetSerializeSize(int nType, int nVersion) const {
-        return 57;
+        return 61;
     }
     template<typename Stream>
     void Serialize(Stream& s) const {
         ser_writedata8(s, type);
         hashBytes.Serialize(s);
-        ::Serialize(s, asset);
+        ser_writedata32be(s, asset);
         txhash.Serialize(s);
         ser_writedata32(s, index);
     }
@@ -124,15 +128,15 @@ struct CAddressUnspentKey {
     void Unserialize(Stream& s) {
         type = ser_readdata8(s);
         hashBytes.Unserialize(s);
-        ::Unserialize(s, asset);
+        asset = ser_readdata32be(s);
         txhash.Unserialize(s);
         index = ser_readdata32(s);
     }
 
-    CAddressUnspentKey(unsigned int addressType, uint160 addressHash, std::string assetName, uint256 txid, size_t indexValue) {
+    CAddressUnspentKey(unsigned int addressType, uint160 addressHash, uint32_t assetId, uint256 txid, size_t indexValue) {
         type = addressType;
         hashBytes = addressHash;
-        asset = assetName;
+        asset = assetId;
         txhash = txid;
         index = indexValue;
     }
@@ -144,7 +148,7 @@ struct CAddressUnspentKey {
     void SetNull() {
         type = 0;
         hashBytes.SetNull();
-        asset.clear();
+        asset = 0;
         txhash.SetNull();
         index = 0;
     }
@@ -188,7 +192,7 @@ struct CAddressUnspentValue {
 struct CAddressIndexKey {
     unsigned int type;
     uint160 hashBytes;
-    std::string asset;
+    uint32_t asset;
     int blockHeight;
     unsigned int txindex;
     uint256 txhash;
@@ -196,13 +200,13 @@ struct CAddressIndexKey {
     bool spending;
 
     size_t GetSerializeSize(int nType, int nVersion) const {
-        return 66 + asset.size();
+        return 70;
     }
     template<typename Stream>
     void Serialize(Stream& s) const {
         ser_writedata8(s, type);
         hashBytes.Serialize(s);
-        ::Serialize(s, asset);
+        ser_writedata32be(s, asset);
         // Heights are stored big-endian for key sorting in LevelDB
         ser_writedata32be(s, blockHeight);
         ser_writedata32be(s, txindex);
@@ -215,7 +219,7 @@ struct CAddressIndexKey {
     void Unserialize(Stream& s) {
         type = ser_readdata8(s);
         hashBytes.Unserialize(s);
-        ::Unserialize(s, asset);
+        asset = ser_readdata32be(s);
         blockHeight = ser_readdata32be(s);
         txindex = ser_readdata32be(s);
         txhash.Unserialize(s);
@@ -224,11 +228,11 @@ struct CAddressIndexKey {
         spending = f;
     }
 
-    CAddressIndexKey(unsigned int addressType, uint160 addressHash, std::string assetName, int height, int blockindex,
+    CAddressIndexKey(unsigned int addressType, uint160 addressHash, uint32_t assetId, int height, int blockindex,
                      uint256 txid, size_t indexValue, bool isSpending) {
         type = addressType;
         hashBytes = addressHash;
-        asset = assetName;
+        asset = assetId;
         blockHeight = height;
         txindex = blockindex;
         txhash = txid;
@@ -243,7 +247,7 @@ struct CAddressIndexKey {
     void SetNull() {
         type = 0;
         hashBytes.SetNull();
-        asset.clear();
+        asset = 0;
         blockHeight = 0;
         txindex = 0;
         txhash.SetNull();
@@ -289,28 +293,28 @@ struct CAddressIndexIteratorKey {
 struct CAddressIndexIteratorAssetKey {
     unsigned int type;
     uint160 hashBytes;
-    std::string asset;
+    uint32_t asset;
 
-    size_t GetSerializeSize() const {
-        return 21 + asset.size();
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 25;
     }
     template<typename Stream>
     void Serialize(Stream& s) const {
         ser_writedata8(s, type);
         hashBytes.Serialize(s);
-        ::Serialize(s, asset);
+        ser_writedata32be(s, asset);
     }
     template<typename Stream>
     void Unserialize(Stream& s) {
         type = ser_readdata8(s);
         hashBytes.Unserialize(s);
-        ::Unserialize(s, asset);
+        asset = ser_readdata32be(s);
     }
 
-    CAddressIndexIteratorAssetKey(unsigned int addressType, uint160 addressHash, std::string assetName) {
+    CAddressIndexIteratorAssetKey(unsigned int addressType, uint160 addressHash, uint32_t assetId) {
         type = addressType;
         hashBytes = addressHash;
-        asset = assetName;
+        asset = assetId;
     }
 
     CAddressIndexIteratorAssetKey() {
@@ -320,38 +324,38 @@ struct CAddressIndexIteratorAssetKey {
     void SetNull() {
         type = 0;
         hashBytes.SetNull();
-        asset.clear();
+        asset = 0;
     }
 };
 
 struct CAddressIndexIteratorHeightKey {
     unsigned int type;
     uint160 hashBytes;
-    std::string asset;
+    uint32_t asset;
     int blockHeight;
 
     size_t GetSerializeSize(int nType, int nVersion) const {
-        return 25;
+        return 29;
     }
     template<typename Stream>
     void Serialize(Stream& s) const {
         ser_writedata8(s, type);
         hashBytes.Serialize(s);
-        ::Serialize(s, asset);
+        ser_writedata32be(s, asset);
         ser_writedata32be(s, blockHeight);
     }
     template<typename Stream>
     void Unserialize(Stream& s) {
         type = ser_readdata8(s);
         hashBytes.Unserialize(s);
-        ::Unserialize(s, asset);
+        asset = ser_readdata32be(s);
         blockHeight = ser_readdata32be(s);
     }
 
-    CAddressIndexIteratorHeightKey(unsigned int addressType, uint160 addressHash, std::string assetName, int height) {
+    CAddressIndexIteratorHeightKey(unsigned int addressType, uint160 addressHash, uint32_t assetId, int height) {
         type = addressType;
         hashBytes = addressHash;
-        asset = assetName;
+        asset = assetId;
         blockHeight = height;
     }
 
@@ -362,9 +366,47 @@ struct CAddressIndexIteratorHeightKey {
     void SetNull() {
         type = 0;
         hashBytes.SetNull();
-        asset.clear();
+        asset = 0;
         blockHeight = 0;
     }
 };
 
+struct CAddressIndexIteratorAssetKeyCompare
+{
+    bool operator()(const CAddressIndexIteratorAssetKey& a, const CAddressIndexIteratorAssetKey& b) const {
+        if (a.type != b.type)
+            return a.type < b.type;
+        if (a.hashBytes != b.hashBytes)
+            return a.hashBytes < b.hashBytes;
+        return a.asset < b.asset;
+    }
+};
+
+/** Running totals of the address index entries of an address and asset */
+struct CAddressBalanceValue {
+    CAmount balance;
+    CAmount received;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(balance);
+        READWRITE(received);
+    }
+
+    CAddressBalanceValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = 0;
+        received = 0;
+    }
+
+    bool IsNull() const {
+        return balance == 0 && received == 0;
+    }
+};
+
 #endif // RAIN_SPENTINDEX_H
@@ -0,0 +1,192 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <test/setup_common.h>
+#include <txdb.h>
+#include <util/strencodings.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(addressindex_tests, BasicTestingSetup)
+
+// Address index key with the asset name, as written before asset ids
+struct LegacyAddressIndexKey {
+    CAddressIndexKey key;
+    std::string asset;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, key.type);
+        key.hashBytes.Serialize(s);
+        ::Serialize(s, asset);
+        ser_writedata32be(s, key.blockHeight);
+        ser_writedata32be(s, key.txindex);
+        key.txhash.Serialize(s);
+        ser_writedata32(s, key.index);
+        ser_writedata8(s, key.spending);
+    }
+};
+
+static void CheckBalance(CBlockTreeDB& db, const uint160& hash, CAmount nBalance, CAmount nReceived)
+{
+    std::vector<std::pair<CAddressIndexIteratorAssetKey, CAddressBalanceValue> > balances;
+    BOOST_CHECK(db.ReadAddressBalances(hash, 1, balances));
+
+    CAmount balance = 0, received = 0;
+    for (const auto& it : balances) {
+        balance += it.second.balance;
+        received += it.second.received;
+    }
+    BOOST_CHECK_EQUAL(balance, nBalance);
+    BOOST_CHECK_EQUAL(received, nReceived);
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_balance_connect_disconnect)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint160 hash = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+    uint160 other = uint160(ParseHex("1102030405060708090a0b0c0d0e0f1011121314"));
+    uint256 txid1 = InsecureRand256(), txid2 = InsecureRand256();
+    uint32_t token = db.GetAddressIndexAssetId("TOKEN");
+
+    // Block 1 pays the address twice, in two assets
+    std::vector<std::pair<CAddressIndexKey, CAmount> > block1;
+    block1.push_back(std::make_pair(CAddressIndexKey(1, hash, 0, 1, 0, txid1, 0, false), 50 * COIN));
+    block1.push_back(std::make_pair(CAddressIndexKey(1, hash, token, 1, 0, txid1, 1, false), 7 * COIN));
+    block1.push_back(std::make_pair(CAddressIndexKey(1, other, 0, 1, 0, txid1, 2, false), 1 * COIN));
+    BOOST_CHECK(db.WriteAddressIndex(block1));
+    CheckBalance(db, hash, 57 * COIN, 57 * COIN);
+    CheckBalance(db, other, 1 * COIN, 1 * COIN);
+
+    // Block 2 spends the first output and sends change back
+    std::vector<std::pair<CAddressIndexKey, CAmount> > block2;
+    block2.push_back(std::make_pair(CAddressIndexKey(1, hash, 0, 2, 1, txid2, 0, true), -50 * COIN));
+    block2.push_back(std::make_pair(CAddressIndexKey(1, hash, 0, 2, 1, txid2, 0, false), 20 * COIN));
+    BOOST_CHECK(db.WriteAddressIndex(block2));
+    CheckBalance(db, hash, 27 * COIN, 77 * COIN);
+
+    // Connecting a block again (replay after an unclean shutdown) doesn't count it twice
+    BOOST_CHECK(db.WriteAddressIndex(block2));
+    CheckBalance(db, hash, 27 * COIN, 77 * COIN);
+
+    // Disconnecting takes back what was written even if the undo values differ
+    std::vector<std::pair<CAddressIndexKey, CAmount> > undo2 = block2;
+    undo2[1].second = 0;
+    BOOST_CHECK(db.EraseAddressIndex(undo2));
+    CheckBalance(db, hash, 57 * COIN, 57 * COIN);
+
+    // The balance matches a rebuild from the address index
+    BOOST_CHECK(db.WriteAddressIndex(block2));
+    std::vector<std::pair<CAddressIndexKey, CAmount> > entries;
+    BOOST_CHECK(db.ReadAddressIndex(hash, 1, "", entries));
+    CAmount balance = 0, received = 0;
+    for (const auto& it : entries) {
+        balance += it.second;
+        if (it.second > 0)
+            received += it.second;
+    }
+    CheckBalance(db, hash, balance, received);
+
+    BOOST_CHECK(db.EraseAddressIndex(block2));
+    BOOST_CHECK(db.EraseAddressIndex(block1));
+    CheckBalance(db, hash, 0, 0);
+    CheckBalance(db, other, 0, 0);
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_paged_range)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint160 hash = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+    uint160 other = uint160(ParseHex("1102030405060708090a0b0c0d0e0f1011121314"));
+    uint32_t token = db.GetAddressIndexAssetId("TOKEN");
+
+    // Two assets with entries at heights 1..10 each, and another address
+    std::vector<std::pair<CAddressIndexKey, CAmount> > entries;
+    for (int height = 1; height <= 10; height++) {
+        entries.push_back(std::make_pair(CAddressIndexKey(1, hash, 0, height, 0, InsecureRand256(), 0, false), height));
+        entries.push_back(std::make_pair(CAddressIndexKey(1, hash, token, height, 0, InsecureRand256(), 0, false), height));
+        entries.push_back(std::make_pair(CAddressIndexKey(1, other, 0, height, 0, InsecureRand256(), 0, false), height));
+    }
+    BOOST_CHECK(db.WriteAddressIndex(entries));
+
+    // The height range applies to every asset
+    std::vector<std::pair<CAddressIndexKey, CAmount> > range;
+    BOOST_CHECK(db.ReadAddressIndex(hash, 1, "", range, 3, 5));
+    BOOST_CHECK_EQUAL(range.size(), 6U);
+    for (const auto& it : range) {
+        BOOST_CHECK(it.first.hashBytes == hash);
+        BOOST_CHECK(it.first.blockHeight >= 3 && it.first.blockHeight <= 5);
+    }
+
+    // Reading in pages returns the same entries
+    std::vector<std::pair<CAddressIndexKey, CAmount> > paged;
+    CAddressIndexKey next;
+    int nPages = 0;
+    do {
+        size_t nBefore = paged.size();
+        BOOST_CHECK(db.ReadAddressIndex(hash, 1, "", paged, 3, 5, 4, &next));
+        BOOST_CHECK(paged.size() - nBefore <= 4);
+        nPages++;
+    } while (!next.hashBytes.IsNull() && nPages < 10);
+    BOOST_CHECK_EQUAL(nPages, 2);
+    BOOST_CHECK_EQUAL(paged.size(), range.size());
+    for (size_t i = 0; i < paged.size() && i < range.size(); i++) {
+        BOOST_CHECK(paged[i].first.txhash == range[i].first.txhash);
+    }
+
+    // Unbounded read of the whole address
+    std::vector<std::pair<CAddressIndexKey, CAmount> > all;
+    BOOST_CHECK(db.ReadAddressIndex(hash, 1, "", all));
+    BOOST_CHECK_EQUAL(all.size(), 20U);
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_asset_ids)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint160 hash = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+
+    BOOST_CHECK_EQUAL(db.GetAddressIndexAssetId(""), 0U);
+    uint32_t token = db.GetAddressIndexAssetId("TOKEN");
+    uint32_t other = db.GetAddressIndexAssetId("OTHER");
+    BOOST_CHECK(token != 0 && other != 0 && token != other);
+    BOOST_CHECK_EQUAL(db.GetAddressIndexAssetId("TOKEN"), token);
+    // New ids are written with the next batch of index keys, not on their own
+    BOOST_CHECK(!db.Exists(std::make_pair('N', std::string("TOKEN"))));
+
+    // Entries written with the asset name in the key are moved to the asset id
+    uint256 txid = InsecureRand256();
+    db.Write(std::make_pair('a', LegacyAddressIndexKey{CAddressIndexKey(1, hash, 0, 5, 1, txid, 0, false), ""}), CAmount(3 * COIN));
+    db.Write(std::make_pair('a', LegacyAddressIndexKey{CAddressIndexKey(1, hash, 0, 6, 1, txid, 1, false), "NEWTOKEN"}), CAmount(4 * COIN));
+    db.Write(std::make_pair('a', LegacyAddressIndexKey{CAddressIndexKey(1, hash, 0, 7, 1, txid, 2, false), "TOKEN"}), CAmount(5 * COIN));
+    BOOST_CHECK(db.UpgradeAddressIndex());
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > entries;
+    BOOST_CHECK(db.ReadAddressIndex(hash, 1, "", entries));
+    BOOST_CHECK_EQUAL(entries.size(), 3U);
+    uint32_t newtoken = db.GetAddressIndexAssetId("NEWTOKEN");
+    BOOST_CHECK(newtoken != token && newtoken != other);
+    BOOST_CHECK(db.Exists(std::make_pair('N', std::string("TOKEN"))));
+    BOOST_CHECK(db.Exists(std::make_pair('N', std::string("NEWTOKEN"))));
+    for (const auto& it : entries) {
+        BOOST_CHECK(it.first.txhash == txid);
+        if (it.first.blockHeight == 5) {
+            BOOST_CHECK_EQUAL(it.first.asset, 0U);
+            BOOST_CHECK_EQUAL(it.second, 3 * COIN);
+        } else if (it.first.blockHeight == 6) {
+            BOOST_CHECK_EQUAL(it.first.asset, newtoken);
+            BOOST_CHECK_EQUAL(it.second, 4 * COIN);
+        } else {
+            BOOST_CHECK_EQUAL(it.first.asset, token);
+            BOOST_CHECK_EQUAL(it.second, 5 * COIN);
+        }
+    }
+
+    // Nothing is left in the old format
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek('a');
+    std::pair<char, uint160> key;
+    BOOST_CHECK(!pcursor->Valid() || !pcursor->GetKey(key) || key.first != 'a');
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -77,9 +77,9 @@ static void AddMessage(std::vector<Message>& vec, uint32_t sourceId, uint32_t ms
     vec.emplace_back(m);
 }
 
-static void Verify(std::vector<Message>& vec, bool secureVerification, bool perMessageFallback)
+static void Verify(std::vector<Message>& vec, bool secureVerification, bool perMessageFallback, CBLSWorker* worker = nullptr)
 {
-    CBLSBatchVerifier<uint32_t, uint32_t> batchVerifier(secureVerification, perMessageFallback);
+    CBLSBatchVerifier<uint32_t, uint32_t> batchVerifier(secureVerification, perMessageFallback, 0, worker);
 
     std::set<uint32_t> expectedBadMessages;
     std::set<uint32_t> expectedBadSources;
@@ -101,14 +101,25 @@ static void Verify(std::vector<Message>& vec, bool secureVerification, bool perM
     } else {
         BOOST_CHECK(batchVerifier.badMessages.empty());
     }
+
+    if (worker) {
+        // the chunks verified on the worker pool must find exactly what a serial verification finds
+        CBLSBatchVerifier<uint32_t, uint32_t> serialVerifier(secureVerification, perMessageFallback);
+        for (auto& m : vec) {
+            serialVerifier.PushMessage(m.sourceId, m.msgId, m.msgHash, m.sig, m.pk);
+        }
+        serialVerifier.Verify();
+        BOOST_CHECK(batchVerifier.badSources == serialVerifier.badSources);
+        BOOST_CHECK(batchVerifier.badMessages == serialVerifier.badMessages);
+    }
 }
 
-static void Verify(std::vector<Message>& vec)
+static void Verify(std::vector<Message>& vec, CBLSWorker* worker = nullptr)
 {
-    Verify(vec, false, false);
-    Verify(vec, true, false);
-    Verify(vec, false, true);
-    Verify(vec, true, true);
+    Verify(vec, false, false, worker);
+    Verify(vec, true, false, worker);
+    Verify(vec, false, true, worker);
+    Verify(vec, true, true, worker);
 }
 
 BOOST_AUTO_TEST_CASE(batch_verifier_tests)
@@ -154,4 +165,44 @@ BOOST_AUTO_TEST_CASE(batch_verifier_tests)
     Verify(msgs);
 }
 
+BOOST_AUTO_TEST_CASE(batch_verifier_parallel_tests)
+{
+    CBLSWorker worker;
+    worker.Start();
+
+    // 300 messages are verified in 4 chunks of 75 messages: 0-74, 75-149, 150-224 and 225-299
+    std::vector<Message> msgs;
+    uint32_t msgId = 1;
+    // one source with 100 messages, split across the first two chunks
+    for (int i = 0; i < 100; i++, msgId++) {
+        AddMessage(msgs, 1, msgId, msgId, true);
+    }
+    // 25 sources with 8 messages each
+    for (uint32_t sourceId = 2; sourceId <= 26; sourceId++) {
+        for (int i = 0; i < 8; i++, msgId++) {
+            AddMessage(msgs, sourceId, msgId, msgId, true);
+        }
+    }
+    Verify(msgs, &worker);
+
+    // an invalid message in the second chunk from the source split across two chunks
+    msgs[90].valid = false;
+    msgs[90].sig = msgs[91].sig;
+    Verify(msgs, &worker);
+
+    // and one in the first chunk
+    msgs[10].valid = false;
+    msgs[10].sig = msgs[11].sig;
+    Verify(msgs, &worker);
+
+    // invalid messages of sources in the third and fourth chunk, at messages 164 and 263
+    msgs[164].valid = false;
+    msgs[164].sig = msgs[165].sig;
+    msgs[263].valid = false;
+    msgs[263].sig = msgs[262].sig;
+    Verify(msgs, &worker);
+
+    worker.Stop();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
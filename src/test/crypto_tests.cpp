@@ -5,6 +5,7 @@
 #include <crypto/aes.h>
 #include <crypto/chacha20.h>
 #include <crypto/chacha_poly_aead.h>
+#include <crypto/common.h>
 #include <crypto/poly1305.h>
 #include <crypto/hkdf_sha256_32.h>
 #include <crypto/hmac_sha256.h>
@@ -749,4 +750,40 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(sha256_64)
+{
+    for (int i = 0; i <= 32; ++i) {
+        unsigned char in[64 * 32];
+        unsigned char out1[32 * 32], out2[32 * 32];
+        for (int j = 0; j < 64 * i; ++j) {
+            in[j] = InsecureRandBits(8);
+        }
+        for (int j = 0; j < i; ++j) {
+            CSHA256().Write(in + 64 * j, 64).Finalize(out1 + 32 * j);
+        }
+        SHA256_64(out2, in, i);
+        BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sha256d_nonce)
+{
+    for (size_t len : {84, 121, 185, 300}) {
+        for (size_t pos : {0, 61, 80}) {
+            std::vector<unsigned char> in(len);
+            for (size_t j = 0; j < len; ++j) {
+                in[j] = InsecureRandBits(8);
+            }
+            uint32_t nonce = 0xfffffff8; // wraps around
+            unsigned char out1[32], out2[32 * 21];
+            CSHA256DNonce(in.data(), len, pos).Hash(out2, nonce, 21);
+            for (int j = 0; j < 21; ++j) {
+                WriteLE32(in.data() + pos, nonce + j);
+                CHash256().Write(in.data(), len).Finalize(out1);
+                BOOST_CHECK(memcmp(out1, out2 + 32 * j, 32) == 0);
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,80 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cuckoofilter.h>
+#include <saltedhasher.h>
+#include <test/setup_common.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(cuckoofilter_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(cuckoofilter_no_false_negatives)
+{
+    SeedInsecureRand(true);
+    cuckoo_filter<uint256, StaticSaltedHasher> filter(100000);
+
+    std::vector<uint256> inserted;
+    while (!filter.full()) {
+        inserted.emplace_back(InsecureRand256());
+        filter.insert(inserted.back());
+    }
+    // fills up to well above 90%
+    BOOST_CHECK(inserted.size() > filter.capacity() * 9 / 10);
+    BOOST_CHECK_EQUAL(filter.size(), inserted.size());
+    for (const auto& h : inserted) {
+        BOOST_CHECK(filter.contains(h));
+    }
+
+    size_t falsePositives = 0;
+    for (int i = 0; i < 100000; i++) {
+        falsePositives += filter.contains(InsecureRand256());
+    }
+    BOOST_CHECK(falsePositives < 100);
+}
+
+BOOST_AUTO_TEST_CASE(cuckoofilter_erase)
+{
+    SeedInsecureRand(true);
+    cuckoo_filter<uint256, StaticSaltedHasher> filter(10000);
+
+    std::vector<uint256> inserted;
+    while (!filter.full()) {
+        inserted.emplace_back(InsecureRand256());
+        filter.insert(inserted.back());
+    }
+
+    // erasing makes room for the element which could not be placed
+    for (size_t i = 0; i < inserted.size(); i += 2) {
+        filter.erase(inserted[i]);
+    }
+    BOOST_CHECK(!filter.full());
+    for (size_t i = 1; i < inserted.size(); i += 2) {
+        BOOST_CHECK(filter.contains(inserted[i]));
+    }
+    BOOST_CHECK(filter.insert(InsecureRand256()));
+}
+
+BOOST_AUTO_TEST_CASE(cuckoofilter_overflow)
+{
+    SeedInsecureRand(true);
+    cuckoo_filter<uint256, StaticSaltedHasher> filter(1000);
+
+    while (filter.insert(InsecureRand256())) {
+    }
+    BOOST_CHECK(filter.full());
+
+    // once an element had to be dropped, everything is reported as a possible member
+    BOOST_CHECK(!filter.insert(InsecureRand256()));
+    BOOST_CHECK(filter.contains(InsecureRand256()));
+
+    filter.clear();
+    BOOST_CHECK(!filter.full());
+    BOOST_CHECK_EQUAL(filter.size(), 0U);
+    BOOST_CHECK(!filter.contains(InsecureRand256()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
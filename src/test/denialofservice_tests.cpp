@@ -6,8 +6,10 @@
 
 #include <banman.h>
 #include <chainparams.h>
+#include <hash.h>
 #include <net.h>
 #include <net_processing.h>
+#include <netmessagemaker.h>
 #include <script/sign.h>
 #include <script/signingprovider.h>
 #include <script/standard.h>
@@ -20,6 +22,7 @@
 #include <test/setup_common.h>
 
 #include <stdint.h>
+#include <thread>
 
 #include <boost/test/unit_test.hpp>
 
@@ -447,4 +450,75 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
     BOOST_CHECK(mapOrphanTransactions.empty());
 }
 
+// Queue a message on a peer as if the socket handler had received it
+static void ReceiveMessage(CNode& node, const CSerializedNetMsg& ser)
+{
+    CMessageHeader hdr(Params().MessageStart(), ser.command.c_str(), ser.data.size());
+    uint256 hash = Hash(ser.data.begin(), ser.data.end());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    CDataStream ssHeader(SER_NETWORK, INIT_PROTO_VERSION);
+    ssHeader << hdr;
+
+    CNetMessage msg(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+    msg.readHeader(ssHeader.data(), ssHeader.size());
+    msg.readData((const char*)ser.data.data(), ser.data.size());
+
+    LOCK(node.cs_vProcessMsg);
+    node.nProcessQueueSize += msg.vRecv.size() + CMessageHeader::HEADER_SIZE;
+    node.vProcessMsg.push_back(std::move(msg));
+}
+
+// Run SendMessages on one message handler thread while another processes smsg messages for a
+// different peer. SendMessages takes cs_main and then cs_smsg, a too short smsgInv is punished
+// with cs_smsg held, so the two must not run at the same time.
+BOOST_AUTO_TEST_CASE(smsg_message_handler_threads)
+{
+    auto connman = MakeUnique<CConnman>(0x1337, 0x1337);
+    auto peerLogic = MakeUnique<PeerLogicValidation>(connman.get(), nullptr, scheduler, false);
+    const int ITERATIONS = 1000;
+
+    CAddress addr1(ip(0xa0b0c001), NODE_NONE);
+    CNode dummyNode1(id++, NODE_NETWORK, 0, INVALID_SOCKET, addr1, 0, 0, CAddress(), "", /*fInboundIn=*/ true);
+    dummyNode1.SetSendVersion(PROTOCOL_VERSION);
+    peerLogic->InitializeNode(&dummyNode1);
+    dummyNode1.nVersion = PROTOCOL_VERSION;
+    dummyNode1.fSuccessfullyConnected = true;
+    dummyNode1.smsgData.fEnabled = true;
+
+    CAddress addr2(ip(0xa0b0c002), NODE_NONE);
+    CNode dummyNode2(id++, NODE_NETWORK, 0, INVALID_SOCKET, addr2, 1, 1, CAddress(), "", /*fInboundIn=*/ true);
+    dummyNode2.SetSendVersion(PROTOCOL_VERSION);
+    peerLogic->InitializeNode(&dummyNode2);
+    dummyNode2.nVersion = PROTOCOL_VERSION;
+    dummyNode2.fSuccessfullyConnected = true;
+
+    std::thread sendThread([&] {
+        for (int i = 0; i < ITERATIONS; i++) {
+            // Due for a bucket inventory, so SecureMsgSendData takes cs_smsg every time
+            dummyNode1.smsgData.lastSeen = 1;
+            LOCK(dummyNode1.cs_sendProcessing);
+            peerLogic->SendMessages(&dummyNode1);
+        }
+    });
+    std::thread processThread([&] {
+        std::atomic<bool> interruptDummy(false);
+        const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+        for (int i = 0; i < ITERATIONS; i++) {
+            ReceiveMessage(dummyNode2, msgMaker.Make(NetMsgType::SMSGINV, std::vector<unsigned char>(1)));
+            peerLogic->ProcessMessages(&dummyNode2, interruptDummy);
+        }
+    });
+    sendThread.join();
+    processThread.join();
+
+    {
+        LOCK(dummyNode2.cs_vProcessMsg);
+        BOOST_CHECK(dummyNode2.vProcessMsg.empty());
+    }
+
+    bool dummy;
+    peerLogic->FinalizeNode(dummyNode1.GetId(), dummy);
+    peerLogic->FinalizeNode(dummyNode2.GetId(), dummy);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
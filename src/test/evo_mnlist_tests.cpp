@@ -0,0 +1,125 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bls/bls.h>
+#include <evo/deterministicmns.h>
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <functional>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(evo_mnlist_tests, BasicTestingSetup)
+
+static CDeterministicMNCPtr CreateMN(uint64_t internalId, const uint256& proTxHash, int nRegisteredHeight, const CBLSPublicKey& pubKeyOperator)
+{
+    auto dmn = std::make_shared<CDeterministicMN>(internalId);
+    dmn->proTxHash = proTxHash;
+    dmn->collateralOutpoint = COutPoint(InsecureRand256(), 0);
+    dmn->nOperatorReward = 0;
+    auto state = std::make_shared<CDeterministicMNState>();
+    state->nRegisteredHeight = nRegisteredHeight;
+    state->keyIDOwner = CKeyID(uint160(g_insecure_rand_ctx.randbytes(20)));
+    state->pubKeyOperator.Set(pubKeyOperator);
+    dmn->pdmnState = state;
+    return dmn;
+}
+
+BOOST_AUTO_TEST_CASE(mnlist_operator_key_lookup)
+{
+    CDeterministicMNList mnList(uint256(), 1, 0);
+    std::vector<CBLSSecretKey> operatorKeys(3);
+    std::vector<uint256> proTxHashes;
+    for (size_t i = 0; i < operatorKeys.size(); i++) {
+        operatorKeys[i].MakeNewKey();
+        proTxHashes.emplace_back(InsecureRand256());
+        mnList.AddMN(CreateMN(i, proTxHashes[i], 1, operatorKeys[i].GetPublicKey()));
+    }
+
+    for (size_t i = 0; i < operatorKeys.size(); i++) {
+        auto dmn = mnList.GetMNByOperatorKey(operatorKeys[i].GetPublicKey());
+        BOOST_REQUIRE(dmn != nullptr);
+        BOOST_CHECK(dmn->proTxHash == proTxHashes[i]);
+    }
+    CBLSSecretKey unknownKey;
+    unknownKey.MakeNewKey();
+    BOOST_CHECK(mnList.GetMNByOperatorKey(unknownKey.GetPublicKey()) == nullptr);
+    BOOST_CHECK(mnList.GetMNByOperatorKey(CBLSPublicKey()) == nullptr);
+
+    // the lookup follows a changed operator key, copies of the list keep the old one
+    CDeterministicMNList oldList = mnList;
+    auto newState = std::make_shared<CDeterministicMNState>(*mnList.GetMN(proTxHashes[0])->pdmnState);
+    newState->pubKeyOperator.Set(unknownKey.GetPublicKey());
+    mnList.UpdateMN(proTxHashes[0], newState);
+    BOOST_CHECK(mnList.GetMNByOperatorKey(operatorKeys[0].GetPublicKey()) == nullptr);
+    BOOST_REQUIRE(mnList.GetMNByOperatorKey(unknownKey.GetPublicKey()) != nullptr);
+    BOOST_CHECK(mnList.GetMNByOperatorKey(unknownKey.GetPublicKey())->proTxHash == proTxHashes[0]);
+    BOOST_REQUIRE(oldList.GetMNByOperatorKey(operatorKeys[0].GetPublicKey()) != nullptr);
+    BOOST_CHECK(oldList.GetMNByOperatorKey(operatorKeys[0].GetPublicKey())->proTxHash == proTxHashes[0]);
+    BOOST_CHECK(oldList.GetMNByOperatorKey(unknownKey.GetPublicKey()) == nullptr);
+
+    mnList.RemoveMN(proTxHashes[1]);
+    BOOST_CHECK(mnList.GetMNByOperatorKey(operatorKeys[1].GetPublicKey()) == nullptr);
+    BOOST_CHECK(mnList.GetMNByOperatorKey(operatorKeys[2].GetPublicKey()) != nullptr);
+}
+
+static std::vector<uint256> GetProjectedPayeeHashes(const CDeterministicMNList& mnList, int nCount)
+{
+    std::vector<uint256> result;
+    for (const auto& dmn : mnList.GetProjectedMNPayees(nCount)) {
+        result.emplace_back(dmn->proTxHash);
+    }
+    return result;
+}
+
+static void UpdateState(CDeterministicMNList& mnList, const uint256& proTxHash, const std::function<void(CDeterministicMNState&)>& func)
+{
+    auto newState = std::make_shared<CDeterministicMNState>(*mnList.GetMN(proTxHash)->pdmnState);
+    func(*newState);
+    mnList.UpdateMN(proTxHash, newState);
+}
+
+BOOST_AUTO_TEST_CASE(mnlist_payee_queue)
+{
+    CDeterministicMNList mnList(uint256(), 50, 0);
+    uint256 mn1 = uint256S("01"), mn2 = uint256S("02"), mn3 = uint256S("03"), mn4 = uint256S("04");
+
+    // the queue is ordered by registration height, ties by proTxHash
+    mnList.AddMN(CreateMN(0, mn4, 10, CBLSPublicKey()));
+    mnList.AddMN(CreateMN(1, mn3, 20, CBLSPublicKey()));
+    mnList.AddMN(CreateMN(2, mn2, 20, CBLSPublicKey()));
+    mnList.AddMN(CreateMN(3, mn1, 30, CBLSPublicKey()));
+    BOOST_REQUIRE(mnList.GetMNPayee() != nullptr);
+    BOOST_CHECK(mnList.GetMNPayee()->proTxHash == mn4);
+    BOOST_CHECK(GetProjectedPayeeHashes(mnList, 10) == std::vector<uint256>({mn4, mn2, mn3, mn1}));
+    BOOST_CHECK(GetProjectedPayeeHashes(mnList, 2) == std::vector<uint256>({mn4, mn2}));
+    BOOST_CHECK(GetProjectedPayeeHashes(mnList, -1).empty());
+
+    // a paid MN moves to the end, copies of the list keep the old order
+    CDeterministicMNList oldList = mnList;
+    UpdateState(mnList, mn4, [](CDeterministicMNState& state) { state.nLastPaidHeight = 40; });
+    BOOST_CHECK(mnList.GetMNPayee()->proTxHash == mn2);
+    BOOST_CHECK(GetProjectedPayeeHashes(mnList, 10) == std::vector<uint256>({mn2, mn3, mn1, mn4}));
+    BOOST_CHECK(GetProjectedPayeeHashes(oldList, 10) == std::vector<uint256>({mn4, mn2, mn3, mn1}));
+
+    // banned MNs leave the queue and come back at their revival height
+    UpdateState(mnList, mn3, [](CDeterministicMNState& state) { state.nPoSeBanHeight = 41; });
+    BOOST_CHECK(GetProjectedPayeeHashes(mnList, 10) == std::vector<uint256>({mn2, mn1, mn4}));
+    UpdateState(mnList, mn3, [](CDeterministicMNState& state) {
+        state.nPoSeBanHeight = -1;
+        state.nPoSeRevivedHeight = 35;
+    });
+    BOOST_CHECK(GetProjectedPayeeHashes(mnList, 10) == std::vector<uint256>({mn2, mn1, mn3, mn4}));
+
+    // state changes which don't touch the queue position keep the order
+    UpdateState(mnList, mn1, [](CDeterministicMNState& state) { state.nPoSePenalty = 10; });
+    BOOST_CHECK(GetProjectedPayeeHashes(mnList, 10) == std::vector<uint256>({mn2, mn1, mn3, mn4}));
+
+    mnList.RemoveMN(mn2);
+    BOOST_CHECK(mnList.GetMNPayee()->proTxHash == mn1);
+    BOOST_CHECK(GetProjectedPayeeHashes(mnList, 10) == std::vector<uint256>({mn1, mn3, mn4}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,184 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <evo/deterministicmns.h>
+#include <evo/evodb.h>
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(evo_mnlistcache_tests, BasicTestingSetup)
+
+// A chain of block indexes with an in-memory evoDB. Every list has one masternode, so a list in the cache always
+// uses more memory than an empty diff
+struct MNListChain
+{
+    CEvoDB evoDb;
+    std::vector<uint256> hashes;
+    std::vector<CBlockIndex> blocks;
+
+    MNListChain(int nBlocks, bool fSnapshotEveryBlock) : evoDb(1 << 20, true, true), hashes(nBlocks), blocks(nBlocks)
+    {
+        for (int i = 0; i < nBlocks; i++) {
+            hashes[i] = InsecureRand256();
+            blocks[i].phashBlock = &hashes[i];
+            blocks[i].nHeight = i;
+            blocks[i].pprev = i > 0 ? &blocks[i - 1] : nullptr;
+
+            if (i == 0 || fSnapshotEveryBlock) {
+                evoDb.Write(std::make_pair(DB_LIST_SNAPSHOT, hashes[i]), CreateList(hashes[i], i));
+            } else {
+                evoDb.Write(std::make_pair(DB_LIST_DIFF, hashes[i]), CDeterministicMNListDiff());
+            }
+        }
+    }
+
+    static CDeterministicMNList CreateList(const uint256& blockHash, int nHeight)
+    {
+        CDeterministicMNList mnList(blockHash, nHeight, 0);
+        auto dmn = std::make_shared<CDeterministicMN>(0);
+        dmn->proTxHash = uint256S("01");
+        dmn->collateralOutpoint = COutPoint(uint256S("02"), 0);
+        dmn->nOperatorReward = 0;
+        auto state = std::make_shared<CDeterministicMNState>();
+        state->keyIDOwner = CKeyID(uint160(std::vector<unsigned char>(20, 3)));
+        dmn->pdmnState = state;
+        mnList.AddMN(dmn);
+        return mnList;
+    }
+
+    // memory usage of a cached list and of a cached empty diff
+    void GetUsage(size_t& nListUsage, size_t& nDiffUsage)
+    {
+        CDeterministicMNManager manager(evoDb, DEFAULT_MNLIST_SNAPSHOT_PERIOD, 1 << 30);
+        manager.GetListForBlock(&blocks[0]);
+        nListUsage = manager.GetCacheStats().nUsage;
+        manager.GetListForBlock(&blocks[1]);
+        nDiffUsage = manager.GetCacheStats().nUsage - 2 * nListUsage;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(mnlist_cache_evicts_lists)
+{
+    MNListChain chain(30, true);
+    size_t nListUsage, nDiffUsage;
+    chain.GetUsage(nListUsage, nDiffUsage);
+    BOOST_REQUIRE(nListUsage > 0);
+    BOOST_CHECK_EQUAL(nDiffUsage, 0U);
+
+    // room for 20 lists, trimming goes down to 18
+    CDeterministicMNManager manager(chain.evoDb, DEFAULT_MNLIST_SNAPSHOT_PERIOD, 20 * nListUsage);
+    for (int i = 0; i < 20; i++) {
+        BOOST_CHECK(manager.GetListForBlock(&chain.blocks[i]).GetBlockHash() == chain.hashes[i]);
+    }
+    auto stats = manager.GetCacheStats();
+    BOOST_CHECK_EQUAL(stats.nLists, 20U);
+    BOOST_CHECK_EQUAL(stats.nUsage, 20 * nListUsage);
+    BOOST_CHECK_EQUAL(stats.nMaxUsage, 20 * nListUsage);
+    BOOST_CHECK_EQUAL(stats.nEvictions, 0U);
+
+    // the first list is used again, so the three after it are the least recently used ones
+    manager.GetListForBlock(&chain.blocks[0]);
+    manager.GetListForBlock(&chain.blocks[20]);
+    stats = manager.GetCacheStats();
+    BOOST_CHECK_EQUAL(stats.nLists, 18U);
+    BOOST_CHECK_EQUAL(stats.nDiffs, 0U);
+    BOOST_CHECK_EQUAL(stats.nUsage, 18 * nListUsage);
+    BOOST_CHECK_EQUAL(stats.nEvictions, 3U);
+    BOOST_CHECK_EQUAL(stats.nListHits, 1U);
+    BOOST_CHECK_EQUAL(stats.nListMisses, 21U);
+
+    for (int i : {0, 4, 19, 20}) {
+        manager.GetListForBlock(&chain.blocks[i]);
+    }
+    BOOST_CHECK_EQUAL(manager.GetCacheStats().nListHits, 5U);
+    BOOST_CHECK_EQUAL(manager.GetCacheStats().nListMisses, 21U);
+    for (int i : {1, 2}) {
+        BOOST_CHECK(manager.GetListForBlock(&chain.blocks[i]).GetBlockHash() == chain.hashes[i]);
+    }
+    stats = manager.GetCacheStats();
+    BOOST_CHECK_EQUAL(stats.nListHits, 5U);
+    BOOST_CHECK_EQUAL(stats.nListMisses, 23U);
+    BOOST_CHECK_EQUAL(stats.nLists, 20U);
+    BOOST_CHECK_EQUAL(stats.nEvictions, 3U);
+}
+
+BOOST_AUTO_TEST_CASE(mnlist_cache_evicts_lists_and_diffs)
+{
+    MNListChain chain(30, false);
+    size_t nListUsage, nDiffUsage;
+    chain.GetUsage(nListUsage, nDiffUsage);
+    BOOST_REQUIRE(nDiffUsage > 0);
+    BOOST_REQUIRE(nDiffUsage < nListUsage);
+    size_t nPairUsage = nListUsage + nDiffUsage;
+
+    // every lookup of the next block reads its diff, uses the list before it and caches the new list. The least
+    // recently used entries are then: diff 1, list 0, diff 2, list 1, diff 3, list 2, ...
+    CDeterministicMNManager manager(chain.evoDb, DEFAULT_MNLIST_SNAPSHOT_PERIOD, 20 * nPairUsage);
+    for (int i = 1; i < 20; i++) {
+        BOOST_CHECK(manager.GetListForBlock(&chain.blocks[i]).GetBlockHash() == chain.hashes[i]);
+    }
+    auto stats = manager.GetCacheStats();
+    BOOST_CHECK_EQUAL(stats.nLists, 20U);
+    BOOST_CHECK_EQUAL(stats.nDiffs, 19U);
+    BOOST_CHECK_EQUAL(stats.nUsage, 20 * nListUsage + 19 * nDiffUsage);
+    BOOST_CHECK_EQUAL(stats.nEvictions, 0U);
+
+    // 20 lists and 20 diffs exceed the budget, trimming to 18 pairs evicts the oldest three pairs
+    manager.GetListForBlock(&chain.blocks[20]);
+    stats = manager.GetCacheStats();
+    BOOST_CHECK_EQUAL(stats.nLists, 18U);
+    BOOST_CHECK_EQUAL(stats.nDiffs, 17U);
+    BOOST_CHECK_EQUAL(stats.nUsage, 18 * nListUsage + 17 * nDiffUsage);
+    BOOST_CHECK_EQUAL(stats.nEvictions, 6U);
+    BOOST_CHECK_EQUAL(stats.nListMisses, 20U);
+    BOOST_CHECK_EQUAL(stats.nDiffMisses, 20U);
+    BOOST_CHECK_EQUAL(stats.nDiffHits, 0U);
+    BOOST_CHECK_EQUAL(stats.nDiffsApplied, 20U);
+
+    // list 3 survived, list 2 has to be rebuilt from the snapshot with the diffs of blocks 1 and 2
+    manager.GetListForBlock(&chain.blocks[3]);
+    BOOST_CHECK_EQUAL(manager.GetCacheStats().nListHits, 1U);
+    BOOST_CHECK(manager.GetListForBlock(&chain.blocks[2]).GetBlockHash() == chain.hashes[2]);
+    stats = manager.GetCacheStats();
+    BOOST_CHECK_EQUAL(stats.nListMisses, 21U);
+    BOOST_CHECK_EQUAL(stats.nDiffMisses, 22U);
+    BOOST_CHECK_EQUAL(stats.nDiffsApplied, 22U);
+    BOOST_CHECK_EQUAL(stats.nLists, 20U);
+    BOOST_CHECK_EQUAL(stats.nDiffs, 19U);
+    BOOST_CHECK_EQUAL(stats.nEvictions, 6U);
+}
+
+BOOST_AUTO_TEST_CASE(mnlist_cache_keeps_tip_and_quorum_lists)
+{
+    MNListChain chain(30, true);
+    size_t nListUsage, nDiffUsage;
+    chain.GetUsage(nListUsage, nDiffUsage);
+
+    CDeterministicMNManager manager(chain.evoDb, DEFAULT_MNLIST_SNAPSHOT_PERIOD, 20 * nListUsage);
+    manager.UpdatedBlockTip(&chain.blocks[25]);
+
+    // list 0 is the list of an alive quorum and list 25 the tip, both are older than any other list
+    manager.GetListForBlock(&chain.blocks[0]);
+    manager.GetListForBlock(&chain.blocks[25]);
+    for (int i = 1; i < 20; i++) {
+        manager.GetListForBlock(&chain.blocks[i]);
+    }
+    auto stats = manager.GetCacheStats();
+    BOOST_CHECK_EQUAL(stats.nLists, 18U);
+    BOOST_CHECK_EQUAL(stats.nUsage, 18 * nListUsage);
+    BOOST_CHECK_EQUAL(stats.nEvictions, 3U);
+
+    for (int i : {0, 25, 4}) {
+        manager.GetListForBlock(&chain.blocks[i]);
+    }
+    BOOST_CHECK_EQUAL(manager.GetCacheStats().nListHits, 3U);
+    manager.GetListForBlock(&chain.blocks[1]);
+    BOOST_CHECK_EQUAL(manager.GetCacheStats().nListHits, 3U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,192 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <governance/governance.h>
+#include <governance/governance-db.h>
+#include <test/setup_common.h>
+#include <util/strencodings.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governance_db_tests, BasicTestingSetup)
+
+static CGovernanceObject CreateProposal(int64_t nTime)
+{
+    std::string strData = strprintf("{\"type\":%d,\"name\":\"proposal-%d\"}", GOVERNANCE_OBJECT_PROPOSAL, nTime);
+    return CGovernanceObject(uint256(), 1, nTime, InsecureRand256(), HexStr(strData));
+}
+
+static CGovernanceVote CreateVote(const COutPoint& outpoint, const uint256& nParentHash, int64_t nTime)
+{
+    CGovernanceVote vote(outpoint, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES);
+    vote.SetTime(nTime);
+    return vote;
+}
+
+BOOST_AUTO_TEST_CASE(governance_db_objects_and_votes)
+{
+    CGovernanceDb db(1 << 20, true);
+    BOOST_CHECK(db.IsEmpty());
+
+    CGovernanceObject govobj = CreateProposal(1000);
+    uint256 nHash = govobj.GetHash();
+    db.WriteObject(govobj);
+
+    std::map<uint256, CGovernanceObject> mapObjects;
+    db.ReadObjects(mapObjects);
+    BOOST_CHECK_EQUAL(mapObjects.size(), 1U);
+    BOOST_CHECK(mapObjects.count(nHash));
+    BOOST_CHECK_EQUAL(mapObjects.at(nHash).GetObjectType(), GOVERNANCE_OBJECT_PROPOSAL);
+    BOOST_CHECK(!mapObjects.at(nHash).AreVotesLoaded());
+
+    COutPoint outpoint1(InsecureRand256(), 0), outpoint2(InsecureRand256(), 1);
+    CGovernanceVote vote1 = CreateVote(outpoint1, nHash, 1100);
+    CGovernanceVote vote2 = CreateVote(outpoint2, nHash, 1200);
+    db.WriteVote(vote1, 1100, {});
+    db.WriteVote(vote2, 1200, {});
+
+    CGovernanceVote voteRead;
+    BOOST_CHECK(db.HasVote(vote1.GetHash()));
+    BOOST_CHECK(db.ReadVote(vote1.GetHash(), voteRead));
+    BOOST_CHECK(voteRead.GetHash() == vote1.GetHash());
+
+    std::vector<vote_time_pair_t> vecVotes;
+    db.ReadObjectVotes(nHash, vecVotes);
+    BOOST_CHECK_EQUAL(vecVotes.size(), 2U);
+    std::vector<uint256> vecVoteHashes;
+    db.ReadObjectVoteHashes(nHash, vecVoteHashes);
+    BOOST_CHECK_EQUAL(vecVoteHashes.size(), 2U);
+
+    // a newer vote of the same masternode for the same signal replaces the old one
+    CGovernanceVote vote3 = CreateVote(outpoint1, nHash, 1300);
+    CGovernanceObjectVoteFile fileVotes;
+    fileVotes.AddVote(vote1);
+    std::set<uint256> setReplaced = fileVotes.AddVote(vote3);
+    BOOST_CHECK(setReplaced == std::set<uint256>{vote1.GetHash()});
+    db.WriteVote(vote3, 1300, setReplaced);
+    BOOST_CHECK(!db.HasVote(vote1.GetHash()));
+    BOOST_CHECK(!db.ReadVote(vote1.GetHash(), voteRead));
+    BOOST_CHECK(db.HasVote(vote3.GetHash()));
+    vecVoteHashes.clear();
+    db.ReadObjectVoteHashes(nHash, vecVoteHashes);
+    BOOST_CHECK_EQUAL(vecVoteHashes.size(), 2U);
+
+    db.EraseVotes(nHash, {vote2.GetHash()});
+    BOOST_CHECK(!db.HasVote(vote2.GetHash()));
+    BOOST_CHECK(db.HasVote(vote3.GetHash()));
+
+    // erasing the object takes its votes with it
+    db.EraseObject(nHash);
+    mapObjects.clear();
+    db.ReadObjects(mapObjects);
+    BOOST_CHECK(mapObjects.empty());
+    BOOST_CHECK(!db.HasVote(vote3.GetHash()));
+    vecVotes.clear();
+    db.ReadObjectVotes(nHash, vecVotes);
+    BOOST_CHECK(vecVotes.empty());
+
+    db.WriteErasedObject(nHash, 5000);
+    std::map<uint256, int64_t> mapErased;
+    db.ReadErasedObjects(mapErased);
+    BOOST_CHECK(mapErased == (std::map<uint256, int64_t>{{nHash, 5000}}));
+    db.EraseErasedObject(nHash);
+    mapErased.clear();
+    db.ReadErasedObjects(mapErased);
+    BOOST_CHECK(mapErased.empty());
+
+    uint256 blockHash = InsecureRand256(), blockHashRead;
+    BOOST_CHECK(!db.ReadVotingKeysBlock(blockHashRead));
+    db.WriteVotingKeysBlock(blockHash);
+    BOOST_CHECK(db.ReadVotingKeysBlock(blockHashRead));
+    BOOST_CHECK(blockHashRead == blockHash);
+}
+
+BOOST_AUTO_TEST_CASE(governance_db_load)
+{
+    governanceDb.reset(new CGovernanceDb(1 << 20, true));
+
+    CGovernanceObject govobj = CreateProposal(1000);
+    uint256 nHash = govobj.GetHash();
+    governanceDb->WriteObject(govobj);
+    std::vector<CGovernanceVote> vecVotes;
+    for (int i = 0; i < 3; i++) {
+        vecVotes.emplace_back(CreateVote(COutPoint(InsecureRand256(), i), nHash, 1100 + i));
+        governanceDb->WriteVote(vecVotes.back(), 1100 + i, {});
+    }
+    uint256 nErasedHash = InsecureRand256();
+    governanceDb->WriteErasedObject(nErasedHash, 5000);
+
+    CGovernanceManager govman;
+    govman.LoadFromDb();
+    govman.InitOnLoad();
+
+    CGovernanceObject* pGovobj = govman.FindGovernanceObject(nHash);
+    BOOST_REQUIRE(pGovobj != nullptr);
+    BOOST_CHECK(!govman.HaveObjectForHash(nErasedHash));
+    BOOST_CHECK_EQUAL(govman.ToJson()["erased"].get_int(), 1);
+
+    // the votes are indexed and counted without being read
+    BOOST_CHECK_EQUAL(govman.GetVoteCount(), 3);
+    BOOST_CHECK_EQUAL(govman.ToJson()["votes"].get_int(), 3);
+    BOOST_CHECK(!pGovobj->AreVotesLoaded());
+
+    // and read the first time they are needed
+    BOOST_CHECK(govman.HaveVoteForHash(vecVotes[0].GetHash()));
+    BOOST_CHECK(pGovobj->AreVotesLoaded());
+    BOOST_CHECK_EQUAL(pGovobj->GetVoteFile().GetVotes().size(), 3U);
+    for (const auto& vote : vecVotes) {
+        BOOST_CHECK(pGovobj->GetVoteFile().HasVote(vote.GetHash()));
+    }
+
+    governanceDb.reset();
+}
+
+BOOST_AUTO_TEST_CASE(governance_dat_import)
+{
+    governanceDb.reset(new CGovernanceDb(1 << 20, true));
+
+    CGovernanceObject govobj = CreateProposal(1000);
+    uint256 nHash = govobj.GetHash();
+    governanceDb->WriteObject(govobj);
+    std::vector<CGovernanceVote> vecVotes;
+    for (int i = 0; i < 3; i++) {
+        vecVotes.emplace_back(CreateVote(COutPoint(InsecureRand256(), i), nHash, 1100 + i));
+        governanceDb->WriteVote(vecVotes.back(), 1100 + i, {});
+    }
+
+    // serialize the manager the way governance.dat was written
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    {
+        CGovernanceManager govman;
+        govman.LoadFromDb();
+        BOOST_REQUIRE(govman.FindGovernanceObject(nHash) != nullptr);
+        BOOST_CHECK_EQUAL(govman.FindGovernanceObject(nHash)->GetVoteFile().GetVotes().size(), 3U);
+        ss << govman;
+    }
+
+    // import it into an empty db
+    governanceDb.reset(new CGovernanceDb(1 << 20, true));
+    BOOST_CHECK(governanceDb->IsEmpty());
+    {
+        CGovernanceManager govman;
+        ss >> govman;
+        govman.WriteToDb();
+    }
+    BOOST_CHECK(!governanceDb->IsEmpty());
+
+    CGovernanceManager govman;
+    govman.LoadFromDb();
+    govman.InitOnLoad();
+    CGovernanceObject* pGovobj = govman.FindGovernanceObject(nHash);
+    BOOST_REQUIRE(pGovobj != nullptr);
+    BOOST_CHECK_EQUAL(govman.GetVoteCount(), 3);
+    for (const auto& vote : vecVotes) {
+        BOOST_CHECK(governanceDb->HasVote(vote.GetHash()));
+        BOOST_CHECK(pGovobj->GetVoteFile().HasVote(vote.GetHash()));
+    }
+
+    governanceDb.reset();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
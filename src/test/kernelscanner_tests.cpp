@@ -0,0 +1,90 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <kernelscanner.h>
+#include <pos.h>
+
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(kernelscanner_tests, BasicTestingSetup)
+
+static const uint32_t SCAN_TIME_END = 1600000000;
+static const uint32_t SCAN_WINDOW = 60;
+
+static std::vector<CKernelScanner::Input> RandomInputs(size_t count)
+{
+    std::vector<CKernelScanner::Input> vInputs(count);
+    for (auto& input : vInputs) {
+        input.first = COutPoint(InsecureRand256(), InsecureRandRange(8));
+        input.second.nTimeTxPrev = SCAN_TIME_END - 40 * 24 * 60 * 60 + InsecureRandRange(40 * 24 * 60 * 60);
+        input.second.nBlockTime = input.second.nTimeTxPrev + InsecureRandRange(120);
+        input.second.nValue = (1 + InsecureRandRange(100)) * COIN;
+    }
+    return vInputs;
+}
+
+BOOST_AUTO_TEST_CASE(kernelscanner_matches_checkstakekernelhash)
+{
+    CBlockIndex index;
+    index.nStakeModifier = InsecureRand256();
+
+    // Low enough target that most timestamps are rejected
+    const unsigned int nBits = 0x1f00ffff;
+    CKernelScanner scanner;
+
+    for (const auto& input : RandomInputs(200)) {
+        size_t nIndex;
+        uint32_t nTime;
+        uint256 hashProof;
+        bool found = scanner.Scan(&index, nBits, {input}, SCAN_TIME_END - SCAN_WINDOW + 1, SCAN_TIME_END, nIndex, nTime, hashProof);
+
+        // The scan is latest timestamp first, so everything after the kernel must fail
+        uint32_t nTimeFail = found ? nTime + 1 : SCAN_TIME_END - SCAN_WINDOW + 1;
+        for (uint32_t t = nTimeFail; t <= SCAN_TIME_END; t++) {
+            if (t < input.second.nBlockTime + Params().GetConsensus().nStakeMinAge)
+                continue; // not mature, rejected by CheckKernel()
+            uint256 hashCheck;
+            BOOST_CHECK(!CheckStakeKernelHash(&index, nBits, input.second.nTimeTxPrev, input.second.nValue, input.first, t, hashCheck, false));
+        }
+        if (found) {
+            uint256 hashCheck;
+            BOOST_CHECK_EQUAL(nIndex, 0U);
+            BOOST_CHECK(CheckStakeKernelHash(&index, nBits, input.second.nTimeTxPrev, input.second.nValue, input.first, nTime, hashCheck, false));
+            BOOST_CHECK(hashCheck == hashProof);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(kernelscanner_parallel)
+{
+    CBlockIndex index;
+    index.nStakeModifier = InsecureRand256();
+
+    const unsigned int nBits = 0x1f00ffff;
+    std::vector<CKernelScanner::Input> vInputs = RandomInputs(1000);
+
+    CKernelScanner serialScanner;
+    CKernelScanner parallelScanner;
+    parallelScanner.Start(4);
+
+    size_t nIndex1, nIndex2;
+    uint32_t nTime1, nTime2;
+    uint256 hash1, hash2;
+    bool found1 = serialScanner.Scan(&index, nBits, vInputs, SCAN_TIME_END - SCAN_WINDOW + 1, SCAN_TIME_END, nIndex1, nTime1, hash1);
+    bool found2 = parallelScanner.Scan(&index, nBits, vInputs, SCAN_TIME_END - SCAN_WINDOW + 1, SCAN_TIME_END, nIndex2, nTime2, hash2);
+
+    // Both return the kernel with the lowest input index
+    BOOST_CHECK_EQUAL(found1, found2);
+    if (found1) {
+        BOOST_CHECK_EQUAL(nIndex1, nIndex2);
+        BOOST_CHECK_EQUAL(nTime1, nTime2);
+        BOOST_CHECK(hash1 == hash2);
+    }
+    BOOST_CHECK(parallelScanner.GetTotalHashes() > 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
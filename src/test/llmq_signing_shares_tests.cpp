@@ -0,0 +1,159 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <llmq/quorums_signing_shares.h>
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <map>
+#include <set>
+
+using namespace llmq;
+
+BOOST_FIXTURE_TEST_SUITE(llmq_signing_shares_tests, BasicTestingSetup)
+
+// Checks that the session holds exactly the expected entries, both through lookups and through iteration
+static void CheckSession(SigShareSession<int>& session, const std::map<uint16_t, int>& expected)
+{
+    BOOST_CHECK_EQUAL(session.size(), expected.size());
+    BOOST_CHECK_EQUAL(session.empty(), expected.empty());
+
+    std::map<uint16_t, int> iterated;
+    for (const auto& p : session) {
+        BOOST_CHECK(iterated.emplace(p.first, p.second).second);
+    }
+    BOOST_CHECK(iterated == expected);
+
+    for (uint16_t i = 0; i < 64; i++) {
+        auto it = expected.find(i);
+        BOOST_CHECK_EQUAL(session.Has(i), it != expected.end());
+        int* v = session.Get(i);
+        if (it != expected.end()) {
+            BOOST_REQUIRE(v != nullptr);
+            BOOST_CHECK_EQUAL(*v, it->second);
+        } else {
+            BOOST_CHECK(v == nullptr);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sig_share_session_add_erase)
+{
+    SigShareSession<int> session;
+    std::map<uint16_t, int> expected;
+    CheckSession(session, expected);
+
+    // out of order members, the index array grows to the largest one
+    for (uint16_t member : {7, 2, 11, 0, 5}) {
+        BOOST_CHECK(session.Add(member, member * 10));
+        expected.emplace(member, member * 10);
+    }
+    CheckSession(session, expected);
+
+    // members are only added once
+    BOOST_CHECK(!session.Add(7, 1));
+    BOOST_CHECK(!session.Add(0, 1));
+    CheckSession(session, expected);
+
+    // erasing a member in the middle moves the last entry into its slot
+    session.Erase(2);
+    expected.erase(2);
+    CheckSession(session, expected);
+
+    // erasing the last entry doesn't move anything
+    uint16_t last = (session.end() - 1)->first;
+    session.Erase(last);
+    expected.erase(last);
+    CheckSession(session, expected);
+
+    // unknown members, including ones beyond the index array, are ignored
+    session.Erase(2);
+    session.Erase(1000);
+    CheckSession(session, expected);
+
+    // a member can be added again after it was erased
+    BOOST_CHECK(session.Add(2, 42));
+    expected.emplace(2, 42);
+    CheckSession(session, expected);
+
+    for (auto it = expected.begin(); it != expected.end(); it = expected.erase(it)) {
+        session.Erase(it->first);
+    }
+    CheckSession(session, expected);
+}
+
+BOOST_AUTO_TEST_CASE(sig_share_session_erase_if)
+{
+    SigShareSession<int> session;
+    std::map<uint16_t, int> expected;
+    for (uint16_t member : {19, 3, 8, 0, 14, 1, 6, 11, 4, 17, 2, 9}) {
+        session.Add(member, member * 10);
+        expected.emplace(member, member * 10);
+    }
+
+    uint256 signHash = InsecureRand256();
+    SigShareKey k(signHash, 0);
+
+    // every entry is visited exactly once, even though erasing moves the last entry into the erased slot
+    std::multiset<uint16_t> visited;
+    session.EraseIf([&](const SigShareKey& k2, const int& v) {
+        BOOST_CHECK(k2.first == signHash);
+        BOOST_CHECK_EQUAL(v, k2.second * 10);
+        visited.emplace(k2.second);
+        return k2.second % 2 == 0;
+    }, k);
+    std::multiset<uint16_t> allMembers;
+    for (const auto& p : expected) {
+        allMembers.emplace(p.first);
+    }
+    BOOST_CHECK(visited == allMembers);
+
+    for (auto it = expected.begin(); it != expected.end(); ) {
+        it = it->first % 2 == 0 ? expected.erase(it) : std::next(it);
+    }
+    CheckSession(session, expected);
+
+    // only the entry which is last in the array when it is visited gets erased, that ends the iteration
+    uint16_t last = (session.end() - 1)->first;
+    visited.clear();
+    session.EraseIf([&](const SigShareKey& k2, const int& v) {
+        visited.emplace(k2.second);
+        return k2.second == (session.end() - 1)->first;
+    }, k);
+    BOOST_CHECK_EQUAL(visited.size(), expected.size());
+    expected.erase(last);
+    CheckSession(session, expected);
+
+    session.EraseIf([](const SigShareKey& k2, const int& v) { return true; }, k);
+    expected.clear();
+    CheckSession(session, expected);
+}
+
+BOOST_AUTO_TEST_CASE(sig_share_map_erase_if)
+{
+    SigShareMap<int> map;
+    uint256 signHash1 = InsecureRand256(), signHash2 = InsecureRand256();
+    for (uint16_t member : {4, 1, 9}) {
+        BOOST_CHECK(map.Add(SigShareKey(signHash1, member), member));
+        BOOST_CHECK(map.Add(SigShareKey(signHash2, member), member));
+    }
+    BOOST_CHECK(!map.Add(SigShareKey(signHash1, 4), 0));
+    BOOST_CHECK_EQUAL(map.Size(), 6U);
+
+    // sessions that become empty are dropped
+    map.EraseIf([&](const SigShareKey& k, const int& v) { return k.first == signHash1 || v == 1; });
+    BOOST_CHECK_EQUAL(map.Size(), 2U);
+    BOOST_CHECK(map.GetAllForSignHash(signHash1) == nullptr);
+    BOOST_CHECK_EQUAL(map.CountForSignHash(signHash2), 2U);
+    BOOST_CHECK(!map.Has(SigShareKey(signHash2, 1)));
+    BOOST_REQUIRE(map.Get(SigShareKey(signHash2, 9)) != nullptr);
+    BOOST_CHECK_EQUAL(*map.Get(SigShareKey(signHash2, 9)), 9);
+
+    map.Erase(SigShareKey(signHash2, 4));
+    map.Erase(SigShareKey(signHash2, 9));
+    BOOST_CHECK(map.Empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
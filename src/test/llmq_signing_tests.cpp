@@ -0,0 +1,176 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <llmq/quorums_signing.h>
+#include <llmq/quorums_utils.h>
+#include <compat/endian.h>
+#include <dbwrapper.h>
+#include <test/setup_common.h>
+#include <util/time.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace llmq;
+
+BOOST_FIXTURE_TEST_SUITE(llmq_signing_tests, BasicTestingSetup)
+
+static const int64_t BUCKET_TIME = 60 * 60;
+static const int64_t START_TIME = 444444 * BUCKET_TIME;
+
+static CRecoveredSig CreateRecoveredSig()
+{
+    CRecoveredSig recSig;
+    recSig.llmqType = Consensus::LLMQ_50_60;
+    recSig.quorumHash = InsecureRand256();
+    recSig.id = InsecureRand256();
+    recSig.msgHash = InsecureRand256();
+    recSig.UpdateHash();
+    return recSig;
+}
+
+static size_t CountBucketRows(CDBWrapper& db, uint32_t bucket)
+{
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    auto start = std::make_tuple(std::string("rs_b"), (uint32_t)htobe32(bucket), (uint8_t)0, uint256());
+    pcursor->Seek(start);
+    size_t cnt = 0;
+    while (pcursor->Valid()) {
+        decltype(start) k;
+        if (!pcursor->GetKey(k) || std::get<0>(k) != "rs_b" || std::get<1>(k) != std::get<1>(start)) {
+            break;
+        }
+        cnt++;
+        pcursor->Next();
+    }
+    return cnt;
+}
+
+BOOST_AUTO_TEST_CASE(recovered_sigs_db_convert)
+{
+    SetMockTime(START_TIME);
+    CDBWrapper db(GetDataDir() / "llmq_convert", 1 << 20, true);
+
+    // rows of a recovered sig, a truncated recovered sig and a vote in the layout before buckets
+    CRecoveredSig recSig = CreateRecoveredSig();
+    uint32_t sigTime = START_TIME - BUCKET_TIME;
+    db.Write(std::make_tuple(std::string("rs_r"), recSig.llmqType, recSig.id), recSig);
+    db.Write(std::make_tuple(std::string("rs_r"), recSig.llmqType, recSig.id, recSig.msgHash), sigTime);
+    db.Write(std::make_tuple(std::string("rs_h"), recSig.GetHash()), std::make_pair(recSig.llmqType, recSig.id));
+    db.Write(std::make_tuple(std::string("rs_s"), CLLMQUtils::BuildSignHash(recSig)), (uint8_t)1);
+    db.Write(std::make_tuple(std::string("rs_t"), (uint32_t)htobe32(sigTime), recSig.llmqType, recSig.id), (uint8_t)1);
+
+    CRecoveredSig truncatedSig = CreateRecoveredSig();
+    db.Write(std::make_tuple(std::string("rs_h"), truncatedSig.GetHash()), std::make_pair(truncatedSig.llmqType, truncatedSig.id));
+
+    uint256 voteId = InsecureRand256(), voteMsgHash = InsecureRand256();
+    db.Write(std::make_tuple(std::string("rs_v"), Consensus::LLMQ_50_60, voteId), voteMsgHash);
+    db.Write(std::make_tuple(std::string("rs_vt"), (uint32_t)htobe32(sigTime), Consensus::LLMQ_50_60, voteId), (uint8_t)1);
+
+    CRecoveredSigsDb rsdb(db);
+
+    BOOST_CHECK(rsdb.HasRecoveredSig(recSig.llmqType, recSig.id, recSig.msgHash));
+    BOOST_CHECK(!rsdb.HasRecoveredSig(recSig.llmqType, recSig.id, InsecureRand256()));
+    BOOST_CHECK(rsdb.HasRecoveredSigForId(recSig.llmqType, recSig.id));
+    BOOST_CHECK(rsdb.HasRecoveredSigForSession(CLLMQUtils::BuildSignHash(recSig)));
+    BOOST_CHECK(rsdb.HasRecoveredSigForHash(recSig.GetHash()));
+    CRecoveredSig recSigRead;
+    BOOST_CHECK(rsdb.GetRecoveredSigByHash(recSig.GetHash(), recSigRead));
+    BOOST_CHECK(recSigRead.GetHash() == recSig.GetHash());
+    BOOST_CHECK(rsdb.GetRecoveredSigById(recSig.llmqType, recSig.id, recSigRead));
+    BOOST_CHECK(recSigRead.quorumHash == recSig.quorumHash);
+
+    // the truncated sig is only known by its hash
+    BOOST_CHECK(rsdb.HasRecoveredSigForHash(truncatedSig.GetHash()));
+    BOOST_CHECK(!rsdb.GetRecoveredSigByHash(truncatedSig.GetHash(), recSigRead));
+    BOOST_CHECK(!rsdb.HasRecoveredSigForId(truncatedSig.llmqType, truncatedSig.id));
+
+    uint256 msgHashRead;
+    BOOST_CHECK(rsdb.HasVotedOnId(Consensus::LLMQ_50_60, voteId));
+    BOOST_CHECK(rsdb.GetVoteForId(Consensus::LLMQ_50_60, voteId, msgHashRead));
+    BOOST_CHECK(msgHashRead == voteMsgHash);
+
+    // the sig and the vote went into the bucket of their time, the truncated sig into the current one
+    BOOST_CHECK_EQUAL(CountBucketRows(db, sigTime / BUCKET_TIME), 5U);
+    BOOST_CHECK_EQUAL(CountBucketRows(db, START_TIME / BUCKET_TIME), 1U);
+
+    // and the old layout is gone
+    for (const char* prefix : {"rs_r", "rs_h", "rs_s", "rs_t", "rs_v", "rs_vt"}) {
+        std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+        pcursor->Seek(std::make_tuple(std::string(prefix)));
+        std::tuple<std::string> k;
+        BOOST_CHECK(!pcursor->Valid() || !pcursor->GetKey(k) || std::get<0>(k) != prefix);
+    }
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(recovered_sigs_db_truncate)
+{
+    SetMockTime(START_TIME);
+    CDBWrapper db(GetDataDir() / "llmq_truncate", 1 << 20, true);
+    CRecoveredSigsDb rsdb(db);
+
+    CRecoveredSig recSig1 = CreateRecoveredSig();
+    CRecoveredSig recSig2 = CreateRecoveredSig();
+    rsdb.WriteRecoveredSig(recSig1);
+    rsdb.WriteRecoveredSig(recSig2);
+
+    rsdb.TruncateRecoveredSig(recSig1.llmqType, recSig1.id);
+    BOOST_CHECK(rsdb.HasRecoveredSigForHash(recSig1.GetHash()));
+    BOOST_CHECK(!rsdb.HasRecoveredSigForId(recSig1.llmqType, recSig1.id));
+    BOOST_CHECK(!rsdb.HasRecoveredSig(recSig1.llmqType, recSig1.id, recSig1.msgHash));
+    BOOST_CHECK(!rsdb.HasRecoveredSigForSession(CLLMQUtils::BuildSignHash(recSig1)));
+    CRecoveredSig recSigRead;
+    BOOST_CHECK(!rsdb.GetRecoveredSigByHash(recSig1.GetHash(), recSigRead));
+
+    rsdb.RemoveRecoveredSig(recSig2.llmqType, recSig2.id);
+    BOOST_CHECK(!rsdb.HasRecoveredSigForHash(recSig2.GetHash()));
+    BOOST_CHECK(!rsdb.HasRecoveredSigForId(recSig2.llmqType, recSig2.id));
+
+    BOOST_CHECK_EQUAL(CountBucketRows(db, START_TIME / BUCKET_TIME), 1U);
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(recovered_sigs_db_cleanup)
+{
+    const int64_t maxAge = 2 * BUCKET_TIME;
+
+    SetMockTime(START_TIME);
+    CDBWrapper db(GetDataDir() / "llmq_cleanup", 1 << 20, true);
+    CRecoveredSigsDb rsdb(db);
+
+    CRecoveredSig oldSig = CreateRecoveredSig();
+    uint256 oldVoteId = InsecureRand256();
+    rsdb.WriteRecoveredSig(oldSig);
+    rsdb.WriteVoteForId(Consensus::LLMQ_50_60, oldVoteId, InsecureRand256());
+
+    // enough sigs for the filter of the newer bucket to outgrow its initial capacity
+    SetMockTime(START_TIME + 3 * BUCKET_TIME);
+    std::vector<CRecoveredSig> newSigs;
+    for (int i = 0; i < 1500; i++) {
+        newSigs.emplace_back(CreateRecoveredSig());
+        rsdb.WriteRecoveredSig(newSigs.back());
+    }
+    for (const auto& recSig : newSigs) {
+        BOOST_CHECK(rsdb.HasRecoveredSigForId(recSig.llmqType, recSig.id));
+        BOOST_CHECK(rsdb.HasRecoveredSigForHash(recSig.GetHash()));
+    }
+
+    // only the bucket which is completely older than maxAge is dropped
+    rsdb.CleanupOldRecoveredSigs(maxAge);
+    BOOST_CHECK(!rsdb.HasRecoveredSigForId(oldSig.llmqType, oldSig.id));
+    BOOST_CHECK(!rsdb.HasRecoveredSigForHash(oldSig.GetHash()));
+    BOOST_CHECK(!rsdb.HasVotedOnId(Consensus::LLMQ_50_60, oldVoteId));
+    BOOST_CHECK_EQUAL(CountBucketRows(db, START_TIME / BUCKET_TIME), 0U);
+
+    BOOST_CHECK_EQUAL(CountBucketRows(db, (START_TIME + 3 * BUCKET_TIME) / BUCKET_TIME), newSigs.size() * 4);
+    for (const auto& recSig : newSigs) {
+        BOOST_CHECK(rsdb.HasRecoveredSigForId(recSig.llmqType, recSig.id));
+    }
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
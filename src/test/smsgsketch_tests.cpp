@@ -0,0 +1,121 @@
+// Copyright (c) 2020 The Rain Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <smessage/smsgsketch.h>
+
+#include <test/setup_common.h>
+
+#include <algorithm>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(smsgsketch_tests, BasicTestingSetup)
+
+static SecMsgToken RandomToken()
+{
+    SecMsgToken token;
+    token.timestamp = 1600000000 + InsecureRandRange(600);
+    uint64_t sample = InsecureRandBits(64);
+    memcpy(token.sample, &sample, 8);
+    token.offset = 0;
+    return token;
+}
+
+static bool SameTokens(std::vector<SecMsgToken> a, std::vector<SecMsgToken> b)
+{
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i] < b[i] || b[i] < a[i])
+            return false;
+    }
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE(smsgsketch_decode_difference)
+{
+    std::vector<SecMsgToken> vShared, vOnlyA, vOnlyB;
+    for (int i = 0; i < 1000; i++)
+        vShared.push_back(RandomToken());
+    for (int i = 0; i < 20; i++)
+        vOnlyA.push_back(RandomToken());
+    for (int i = 0; i < 5; i++)
+        vOnlyB.push_back(RandomToken());
+
+    uint32_t nCells = SecMsgTokenSketch::CellsForDifference(vOnlyA.size() + vOnlyB.size());
+    SecMsgTokenSketch sketchA(nCells), sketchB(nCells);
+    uint64_t nSetHashA = 0, nSetHashB = 0;
+    for (const auto& token : vShared) {
+        sketchA.Insert(token);
+        sketchB.Insert(token);
+        nSetHashA += SecMsgTokenHash(token);
+        nSetHashB += SecMsgTokenHash(token);
+    }
+    for (const auto& token : vOnlyA) {
+        sketchA.Insert(token);
+        nSetHashA += SecMsgTokenHash(token);
+    }
+    for (const auto& token : vOnlyB) {
+        sketchB.Insert(token);
+        nSetHashB += SecMsgTokenHash(token);
+    }
+    BOOST_CHECK(nSetHashA != nSetHashB);
+
+    // The sketch goes over the wire
+    std::vector<unsigned char> vchData(sketchB.GetCells() * SMSG_SKETCH_CELL_LEN);
+    sketchB.Serialize(vchData.data());
+    SecMsgTokenSketch sketchPeer(0);
+    BOOST_CHECK(sketchPeer.Deserialize(vchData.data(), vchData.size()));
+
+    BOOST_CHECK(sketchA.Subtract(sketchPeer));
+    std::vector<SecMsgToken> vDecodedA, vDecodedB;
+    BOOST_CHECK(sketchA.Decode(vDecodedA, vDecodedB));
+    BOOST_CHECK(SameTokens(vDecodedA, vOnlyA));
+    BOOST_CHECK(SameTokens(vDecodedB, vOnlyB));
+}
+
+BOOST_AUTO_TEST_CASE(smsgsketch_too_many_differences)
+{
+    SecMsgTokenSketch sketchA(SMSG_SKETCH_MIN_CELLS), sketchB(SMSG_SKETCH_MIN_CELLS);
+    for (int i = 0; i < 200; i++)
+        sketchA.Insert(RandomToken());
+
+    BOOST_CHECK(sketchA.Subtract(sketchB));
+    std::vector<SecMsgToken> vDecodedA, vDecodedB;
+    BOOST_CHECK(!sketchA.Decode(vDecodedA, vDecodedB));
+
+    // Sketches of different sizes can't be compared
+    SecMsgTokenSketch sketchC(SMSG_SKETCH_MIN_CELLS * 2);
+    BOOST_CHECK(!sketchA.Subtract(sketchC));
+}
+
+BOOST_AUTO_TEST_CASE(smsgbucket_legacy_peer_view)
+{
+    SecMsgBucket bkt, bktLegacy;
+    for (int i = 0; i < 50; i++) {
+        SecMsgToken token = RandomToken();
+        token.version = i % 3 == 0 ? SMSG_VERSION_TAGGED : SMSG_VERSION_LEGACY;
+        BOOST_CHECK(bkt.AddToken(token));
+        if (token.version == SMSG_VERSION_LEGACY)
+            bktLegacy.AddToken(token);
+    }
+    BOOST_CHECK_EQUAL(bkt.nTagged, 17U);
+
+    // a legacy peer sees the bucket as if it only had the untagged messages
+    BOOST_CHECK_EQUAL(bkt.GetMessageCount(SMSG_VERSION_LEGACY), 33U);
+    BOOST_CHECK_EQUAL(bkt.GetHash(SMSG_VERSION_LEGACY), bktLegacy.GetHash(SMSG_VERSION_TAGGED));
+    BOOST_CHECK_EQUAL(bkt.GetMessageCount(SMSG_VERSION_TAGGED), 50U);
+    BOOST_CHECK(bkt.GetHash(SMSG_VERSION_TAGGED) != bktLegacy.GetHash(SMSG_VERSION_TAGGED));
+    BOOST_CHECK_EQUAL(bkt.GetMessageCount(SMSG_PROTOCOL_RECONCILE), 50U);
+
+    // rehashing from the token set gives the same counts as adding tokens one by one
+    uint32_t nTagged = bkt.nTagged, hashLegacy = bkt.hashLegacy;
+    bkt.hashBucket();
+    BOOST_CHECK_EQUAL(bkt.nTagged, nTagged);
+    BOOST_CHECK_EQUAL(bkt.hashLegacy, hashLegacy);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
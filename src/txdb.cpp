@@ -18,6 +18,8 @@
 #include <index/txindex.h>
 
 #include <stdint.h>
+#include <algorithm>
+#include <limits>
 
 #include <boost/thread.hpp>
 
@@ -25,8 +27,10 @@ static const char DB_COIN = 'C';
 static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
-static const char DB_ADDRESSINDEX = 'a';
-static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_ADDRESSINDEX = 'd';
+static const char DB_ADDRESSUNSPENTINDEX = 'U';
+static const char DB_ADDRESSBALANCEINDEX = 'V';
+static const char DB_ADDRESSINDEX_ASSETID = 'N';
 static const char DB_TIMESTAMPINDEX = 's';
 static const char DB_BLOCKHASHINDEX = 'z';
 static const char DB_SPENTINDEX = 'p';
@@ -63,6 +67,49 @@ struct CoinEntry {
     }
 };
 
+/**
+ * Address index key of the old format: type, address, asset name and the rest of the key,
+ * which is the same in both formats. Only read from a CDataStream.
+ */
+struct LegacyAddressAssetKey {
+    unsigned int type;
+    uint160 hashBytes;
+    std::string asset;
+    std::vector<unsigned char> tail;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        ::Serialize(s, asset);
+        s.write((const char*)tail.data(), tail.size());
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        ::Unserialize(s, asset);
+        tail.assign(s.begin(), s.end());
+        s.ignore(tail.size());
+    }
+};
+
+/** The same key with the asset id in place of the name */
+struct AddressAssetIdKey {
+    const LegacyAddressAssetKey& legacy;
+    uint32_t asset;
+
+    AddressAssetIdKey(const LegacyAddressAssetKey& legacyIn, uint32_t assetIn) : legacy(legacyIn), asset(assetIn) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, legacy.type);
+        legacy.hashBytes.Serialize(s);
+        ser_writedata32be(s, asset);
+        s.write((const char*)legacy.tail.data(), legacy.tail.size());
+    }
+};
+
 }
 
 CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true)
@@ -158,7 +205,7 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(gArgs.IsArgSet("-blocksdir") ? GetDataDir() / "blocks" / "index" : GetBlocksDir() / "index", nCacheSize, fMemory, fWipe) {
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(fMemory ? "" : (gArgs.IsArgSet("-blocksdir") ? GetDataDir() / "blocks" / "index" : GetBlocksDir() / "index"), nCacheSize, fMemory, fWipe) {
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -286,23 +333,37 @@ bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddres
             batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
         }
     }
-    return WriteBatch(batch);
+    return WriteAddressIndexBatch(batch);
 }
 
 bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::string assetName,
-                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
+                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                                           size_t nLimit, CAddressUnspentKey *pnext) {
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
-    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    if (pnext && !pnext->hashBytes.IsNull()) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, *pnext));
+    } else {
+        pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+    if (pnext)
+        pnext->SetNull();
 
+    size_t nRead = 0;
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
         std::pair<char,CAddressUnspentKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash) {
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.type == (unsigned int)type && key.second.hashBytes == addressHash) {
+            if (nLimit > 0 && nRead == nLimit) {
+                if (pnext)
+                    *pnext = key.second;
+                break;
+            }
             CAddressUnspentValue nValue;
             if (pcursor->GetValue(nValue)) {
                 unspentOutputs.push_back(std::make_pair(key.second, nValue));
+                nRead++;
                 pcursor->Next();
             } else {
                 return error("failed to get address unspent value");
@@ -315,42 +376,282 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::s
     return true;
 }
 
+typedef std::map<CAddressIndexIteratorAssetKey, CAddressBalanceValue, CAddressIndexIteratorAssetKeyCompare> CAddressBalanceDeltas;
+
+static void AddAddressBalanceDelta(CAddressBalanceDeltas& deltas, const CAddressIndexKey& key, CAmount nValue, int nSign)
+{
+    CAddressBalanceValue& delta = deltas[CAddressIndexIteratorAssetKey(key.type, key.hashBytes, key.asset)];
+    delta.balance += nSign * nValue;
+    if (nValue > 0)
+        delta.received += nSign * nValue;
+}
+
+static void WriteAddressBalanceDeltas(CDBWrapper& db, CDBBatch& batch, const CAddressBalanceDeltas& deltas)
+{
+    for (const auto& it : deltas) {
+        CAddressBalanceValue value;
+        db.Read(std::make_pair(DB_ADDRESSBALANCEINDEX, it.first), value);
+        value.balance += it.second.balance;
+        value.received += it.second.received;
+        if (value.IsNull())
+            batch.Erase(std::make_pair(DB_ADDRESSBALANCEINDEX, it.first));
+        else
+            batch.Write(std::make_pair(DB_ADDRESSBALANCEINDEX, it.first), value);
+    }
+}
+
 bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+    CAddressBalanceDeltas deltas;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        // A block connected again after an unclean shutdown rewrites its entries, count them once
+        CAmount nOldValue;
+        if (Read(std::make_pair(DB_ADDRESSINDEX, it->first), nOldValue))
+            AddAddressBalanceDelta(deltas, it->first, nOldValue, -1);
+        AddAddressBalanceDelta(deltas, it->first, it->second, 1);
         batch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
-    return WriteBatch(batch);
+    }
+    WriteAddressBalanceDeltas(*this, batch, deltas);
+    return WriteAddressIndexBatch(batch);
 }
 
 bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+    CAddressBalanceDeltas deltas;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        // Take back what was written, not the value recomputed from the undo data
+        CAmount nOldValue;
+        if (Read(std::make_pair(DB_ADDRESSINDEX, it->first), nOldValue))
+            AddAddressBalanceDelta(deltas, it->first, nOldValue, -1);
         batch.Erase(std::make_pair(DB_ADDRESSINDEX, it->first));
-    return WriteBatch(batch);
+    }
+    WriteAddressBalanceDeltas(*this, batch, deltas);
+    return WriteAddressIndexBatch(batch);
+}
+
+bool CBlockTreeDB::ReadAddressBalances(uint160 addressHash, int type,
+                                       std::vector<std::pair<CAddressIndexIteratorAssetKey, CAddressBalanceValue> > &balances) {
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_ADDRESSBALANCEINDEX, CAddressIndexIteratorKey(type, addressHash)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressIndexIteratorAssetKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSBALANCEINDEX && key.second.type == (unsigned int)type && key.second.hashBytes == addressHash) {
+            CAddressBalanceValue value;
+            if (pcursor->GetValue(value)) {
+                balances.push_back(std::make_pair(key.second, value));
+                pcursor->Next();
+            } else {
+                return error("failed to get address balance value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::BuildAddressBalanceIndex() {
+    bool fBuilt = false;
+    if (ReadFlag("addressbalanceindex", fBuilt) && fBuilt)
+        return true;
+
+    LogPrintf("Building address balance index...\n");
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(DB_ADDRESSINDEX);
+
+    // -- the address index is sorted by address and asset, the entries of a balance are adjacent
+    CDBBatch batch(*this);
+    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    CAddressIndexIteratorAssetKey current;
+    CAddressBalanceValue value;
+    size_t nBalances = 0;
+    bool fDone = false;
+    while (!fDone) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressIndexKey> key;
+        fDone = !pcursor->Valid() || !pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX;
+
+        if (fDone || key.second.type != current.type || key.second.hashBytes != current.hashBytes || key.second.asset != current.asset) {
+            if (!value.IsNull()) {
+                batch.Write(std::make_pair(DB_ADDRESSBALANCEINDEX, current), value);
+                nBalances++;
+            }
+            if (batch.SizeEstimate() > batch_size) {
+                if (!WriteBatch(batch))
+                    return error("%s: failed to write address balances", __func__);
+                batch.Clear();
+            }
+            if (fDone)
+                break;
+            current = CAddressIndexIteratorAssetKey(key.second.type, key.second.hashBytes, key.second.asset);
+            value.SetNull();
+        }
+
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("failed to get address index value");
+        value.balance += nValue;
+        if (nValue > 0)
+            value.received += nValue;
+        pcursor->Next();
+    }
+
+    batch.Write(std::make_pair(DB_FLAG, std::string("addressbalanceindex")), '1');
+    if (!WriteBatch(batch, true))
+        return error("%s: failed to write address balances", __func__);
+
+    LogPrintf("Built address balance index, %u balances\n", nBalances);
+    return true;
+}
+
+uint32_t CBlockTreeDB::GetAddressIndexAssetId(const std::string &assetName) {
+    if (assetName.empty())
+        return 0;
+
+    LOCK(cs_asset_ids);
+    if (nNextAssetId == 0) {
+        nNextAssetId = 1;
+        std::unique_ptr<CDBIterator> pcursor(NewIterator());
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX_ASSETID, std::string()));
+        while (pcursor->Valid()) {
+            std::pair<char,std::string> key;
+            uint32_t id;
+            if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX_ASSETID || !pcursor->GetValue(id))
+                break;
+            mapAssetIds.emplace(key.second, id);
+            nNextAssetId = std::max(nNextAssetId, id + 1);
+            pcursor->Next();
+        }
+    }
+
+    auto it = mapAssetIds.find(assetName);
+    if (it != mapAssetIds.end())
+        return it->second;
+
+    // -- written with the next batch of index keys, see WriteAddressIndexBatch. An id taken for a
+    //    block that is only checked or fails validation is never written. Ids are never reused.
+    uint32_t id = nNextAssetId++;
+    mapAssetIds.emplace(assetName, id);
+    mapPendingAssetIds.emplace(assetName, id);
+    return id;
+}
+
+bool CBlockTreeDB::WriteAddressIndexBatch(CDBBatch &batch) {
+    LOCK(cs_asset_ids);
+    for (const auto& it : mapPendingAssetIds)
+        batch.Write(std::make_pair(DB_ADDRESSINDEX_ASSETID, it.first), it.second);
+    if (!WriteBatch(batch))
+        return false;
+    mapPendingAssetIds.clear();
+    return true;
+}
+
+template<typename Value>
+static bool UpgradeAddressIndexKeys(CBlockTreeDB& db, char chLegacy, char chKey, size_t& nUpgraded)
+{
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(chLegacy);
+
+    CDBBatch batch(db);
+    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        if (ShutdownRequested())
+            break;
+
+        std::pair<char,LegacyAddressAssetKey> key;
+        if (!pcursor->GetKey(key) || key.first != chLegacy)
+            break;
+        Value value;
+        if (!pcursor->GetValue(value))
+            return error("%s: failed to get address index value", __func__);
+
+        // -- both keys in one batch, an interrupted upgrade continues with the keys left
+        batch.Write(std::make_pair(chKey, AddressAssetIdKey(key.second, db.GetAddressIndexAssetId(key.second.asset))), value);
+        batch.Erase(key);
+        nUpgraded++;
+        if (batch.SizeEstimate() > batch_size) {
+            if (!db.WriteAddressIndexBatch(batch))
+                return error("%s: failed to write address index", __func__);
+            batch.Clear();
+        }
+        pcursor->Next();
+    }
+    if (!db.WriteAddressIndexBatch(batch))
+        return error("%s: failed to write address index", __func__);
+
+    db.CompactRange(chLegacy, (char)(chLegacy + 1));
+    return true;
+}
+
+bool CBlockTreeDB::UpgradeAddressIndex() {
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    bool fLegacy = false;
+    for (char ch : {DB_ADDRESSINDEX_LEGACY, DB_ADDRESSUNSPENTINDEX_LEGACY}) {
+        pcursor->Seek(ch);
+        std::pair<char,LegacyAddressAssetKey> key;
+        if (pcursor->Valid() && pcursor->GetKey(key) && key.first == ch)
+            fLegacy = true;
+    }
+    if (!fLegacy)
+        return true;
+
+    LogPrintf("Upgrading address index to asset ids...\n");
+    uiInterface.ShowProgress(_("Upgrading address index").translated, 0, true);
+
+    size_t nUpgraded = 0;
+    bool fOk = UpgradeAddressIndexKeys<CAmount>(*this, DB_ADDRESSINDEX_LEGACY, DB_ADDRESSINDEX, nUpgraded)
+        && UpgradeAddressIndexKeys<CAddressUnspentValue>(*this, DB_ADDRESSUNSPENTINDEX_LEGACY, DB_ADDRESSUNSPENTINDEX, nUpgraded);
+
+    uiInterface.ShowProgress("", 100, false);
+    LogPrintf("Upgraded %u address index entries%s\n", nUpgraded, ShutdownRequested() ? " (interrupted)" : "");
+    return fOk && !ShutdownRequested();
 }
 
 bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
                                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
+                                    int start, int end, size_t nLimit, CAddressIndexKey *pnext) {
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
-    if (start > 0 && end > 0) {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, assetName, start)));
+    if (pnext && !pnext->hashBytes.IsNull()) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, *pnext));
     } else {
         pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
     }
+    if (pnext)
+        pnext->SetNull();
 
+    size_t nRead = 0;
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
         std::pair<char,CAddressIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.hashBytes == addressHash) {
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.type == (unsigned int)type && key.second.hashBytes == addressHash) {
+            // -- entries are sorted by height within each asset, skip to the range of the asset
+            //    or past the end of it instead of reading the entries outside the range
+            if (start > 0 && key.second.blockHeight < start) {
+                pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, key.second.asset, start)));
+                continue;
+            }
             if (end > 0 && key.second.blockHeight > end) {
+                pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, key.second.asset, std::numeric_limits<int>::max())));
+                continue;
+            }
+            if (nLimit > 0 && nRead == nLimit) {
+                if (pnext)
+                    *pnext = key.second;
                 break;
             }
             CAmount nValue;
             if (pcursor->GetValue(nValue)) {
                 addressIndex.push_back(std::make_pair(key.second, nValue));
+                nRead++;
                 pcursor->Next();
             } else {
                 return error("failed to get address index value");
@@ -10,6 +10,7 @@
 #include <dbwrapper.h>
 #include <primitives/block.h>
 #include <spentindex.h>
+#include <sync.h>
 #include <timestampindex.h>
 #include <chainparams.h>
 
@@ -44,6 +45,9 @@ static const int64_t nMaxTxIndexCache = 1024;
 static const int64_t max_filter_index_cache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! Prefixes of the address indexes with the asset name in the key, moved by UpgradeAddressIndex
+static const char DB_ADDRESSINDEX_LEGACY = 'a';
+static const char DB_ADDRESSUNSPENTINDEX_LEGACY = 'u';
 
 /** CCoinsView backed by the coin database (chainstate/) */
 class CCoinsViewDB final : public CCoinsView
@@ -107,13 +111,29 @@ public:
     bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
     bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
     bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
+    //! Read at most nLimit (0 for all) unspent outputs of an address, starting at *pnext if it is set.
+    //! *pnext is set to the output to continue from, or null when all were read.
     bool ReadAddressUnspentIndex(uint160 addressHash, int type, std::string assetName,
-                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect,
+                                 size_t nLimit = 0, CAddressUnspentKey *pnext = nullptr);
     bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
+    //! Read at most nLimit (0 for all) entries of an address with a height in [start, end] (0 for no
+    //! bound), starting at *pnext if it is set. *pnext is set to the entry to continue from, or null
+    //! when all were read.
     bool ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                          int start = 0, int end = 0);
+                          int start = 0, int end = 0, size_t nLimit = 0, CAddressIndexKey *pnext = nullptr);
+    bool ReadAddressBalances(uint160 addressHash, int type,
+                             std::vector<std::pair<CAddressIndexIteratorAssetKey, CAddressBalanceValue> > &balances);
+    //! Fill the address balance index from the address index, if it was not built before
+    bool BuildAddressBalanceIndex();
+    //! Id of an asset name in the address index keys, a new name gets the next free id. 0 is the empty name.
+    uint32_t GetAddressIndexAssetId(const std::string &assetName);
+    //! Write a batch of address index keys, together with the asset ids which were not written yet
+    bool WriteAddressIndexBatch(CDBBatch &batch);
+    //! Move address index entries with the asset name in the key to keys with the asset id
+    bool UpgradeAddressIndex();
     bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &vect);
     bool WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts);
@@ -122,6 +142,12 @@ public:
     bool ReadFlag(const std::string &name, bool &fValue);
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
 
+private:
+    CCriticalSection cs_asset_ids;
+    std::map<std::string, uint32_t> mapAssetIds GUARDED_BY(cs_asset_ids);
+    //! Ids which were handed out but are not in the DB yet
+    std::map<std::string, uint32_t> mapPendingAssetIds GUARDED_BY(cs_asset_ids);
+    uint32_t nNextAssetId GUARDED_BY(cs_asset_ids) = 0;
 };
 
 #endif // RAIN_TXDB_H
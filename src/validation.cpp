@@ -29,6 +29,7 @@
 #include <primitives/transaction.h>
 #include <random.h>
 #include <reverse_iterator.h>
+#include <saltedhasher.h>
 #include <script/script.h>
 #include <script/sigcache.h>
 #include <script/standard.h>
@@ -40,6 +41,7 @@
 #include <ui_interface.h>
 #include <uint256.h>
 #include <undo.h>
+#include <unordered_lru_cache.h>
 #include <util/moneystr.h>
 #include <util/rbf.h>
 #include <util/strencodings.h>
@@ -1011,24 +1013,43 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
 }
 
 bool GetAddressIndex(uint160 addressHash, int type, std::string assetName,
-                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end)
+                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end,
+                     size_t nLimit, CAddressIndexKey *pnext)
 {
     if (!g_txindex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, assetName, addressIndex, start, end))
+    if (!pblocktree->ReadAddressIndex(addressHash, type, assetName, addressIndex, start, end, nLimit, pnext))
         return error("unable to get txids for address");
 
     return true;
 }
 
+bool GetAddressBalance(uint160 addressHash, int type, CAmount &balance, CAmount &received)
+{
+    if (!g_txindex)
+        return error("address index not enabled");
+
+    std::vector<std::pair<CAddressIndexIteratorAssetKey, CAddressBalanceValue> > balances;
+    if (!pblocktree->ReadAddressBalances(addressHash, type, balances))
+        return error("unable to get balance for address");
+
+    for (const auto& it : balances) {
+        balance += it.second.balance;
+        received += it.second.received;
+    }
+
+    return true;
+}
+
 bool GetAddressUnspent(uint160 addressHash, int type, std::string assetName,
-                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
+                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                       size_t nLimit, CAddressUnspentKey *pnext)
 {
     if (!g_txindex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, assetName, unspentOutputs))
+    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, assetName, unspentOutputs, nLimit, pnext))
         return error("unable to get txids for address");
 
     return true;
@@ -1681,31 +1702,31 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
             uint160 hashBytes;
             for (unsigned int k = tx.vout.size(); k-- > 0;) {
                 const CTxOut &out = tx.vout[k];
-                std::string assetName ="";
+                uint32_t assetId = 0;
                 if (out.nAsset.IsExplicit())
-                    assetName = out.nAsset.GetAsset().getName();
+                    assetId = pblocktree->GetAddressIndexAssetId(out.nAsset.GetAsset().getName());
                 if (out.scriptPubKey.IsPayToScriptHash()) {
                     std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
 
                     // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), assetName, pindex->nHeight, i, hash, k, false), out.nValue.GetAmount()));
+                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), assetId, pindex->nHeight, i, hash, k, false), out.nValue.GetAmount()));
 
                     // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), assetName, hash, k), CAddressUnspentValue()));
+                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), assetId, hash, k), CAddressUnspentValue()));
 
                 } else if (out.scriptPubKey.IsPayToPubkeyHash()) {
                     std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
 
                     // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), assetName, pindex->nHeight, i, hash, k, false), out.nValue.GetAmount()));
+                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), assetId, pindex->nHeight, i, hash, k, false), out.nValue.GetAmount()));
 
                     // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), assetName, hash, k), CAddressUnspentValue()));
+                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), assetId, hash, k), CAddressUnspentValue()));
 
                 } else if (out.scriptPubKey.IsPayToPubkey()) {
                     uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, assetName, pindex->nHeight, i, hash, k, false), out.nValue.GetAmount()));
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, assetName, hash, k), CAddressUnspentValue()));
+                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, assetId, pindex->nHeight, i, hash, k, false), out.nValue.GetAmount()));
+                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, assetId, hash, k), CAddressUnspentValue()));
                 } else {
                     continue;
                 }
@@ -1752,33 +1773,37 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
                     const Coin &coin = view.AccessCoin(tx.vin[j].prevout);
                     const CTxOut &prevout = coin.out;
 
-                    std::string assetName ="";
+                    uint32_t assetId = 0;
                     if (prevout.nAsset.IsExplicit())
-                        assetName = prevout.nAsset.GetAsset().getName();
+                        assetId = pblocktree->GetAddressIndexAssetId(prevout.nAsset.GetAsset().getName());
 
                     if (prevout.scriptPubKey.IsPayToScriptHash()) {
                         std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22);
 
                         // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), assetName, pindex->nHeight, i, hash, j, true), prevout.nValue.GetAmount() * -1));
+                        addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), assetId, pindex->nHeight, i, hash, j, true), prevout.nValue.GetAmount() * -1));
 
                         // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), assetName, input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue.GetAmount(), prevout.scriptPubKey, undoHeight)));
+                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), assetId, input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue.GetAmount(), prevout.scriptPubKey, undoHeight)));
 
 
                     } else if (prevout.scriptPubKey.IsPayToPubkeyHash()) {
                         std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23);
 
                         // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), assetName, pindex->nHeight, i, hash, j, true), prevout.nValue.GetAmount() * -1));
+                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), assetId, pindex->nHeight, i, hash, j, true), prevout.nValue.GetAmount() * -1));
 
                         // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), assetName, input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue.GetAmount(), prevout.scriptPubKey, undoHeight)));
+                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), assetId, input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue.GetAmount(), prevout.scriptPubKey, undoHeight)));
 
                     } else if (prevout.scriptPubKey.IsPayToPubkey()) {
                         uint160 hashBytes(Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1));
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, assetName, pindex->nHeight, i, hash, j, false), prevout.nValue.GetAmount()));
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, assetName, hash, j), CAddressUnspentValue()));
+
+                        // undo spending activity
+                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, assetId, pindex->nHeight, i, hash, j, true), prevout.nValue.GetAmount() * -1));
+
+                        // restore unspent index
+                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, assetId, input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue.GetAmount(), prevout.scriptPubKey, undoHeight)));
                     } else {
                         continue;
                     }
@@ -1979,13 +2004,35 @@ static int64_t nTimeTotal = 0;
 static int64_t nBlocksTotal = 0;
 
 
+/**
+ * hashProof of blocks whose proof-of-stake (kernel and coinstake signature) has been fully verified.
+ * Both only depend on data committed to by the block hash, so a block that is checked again
+ * (AcceptBlock() then ConnectBlock(), reorgs, re-announced blocks) can skip the check.
+ */
+static const size_t MAX_STAKE_PROOF_CACHE_SIZE = 50000;
+static unordered_lru_cache<uint256, uint256, StaticSaltedHasher, MAX_STAKE_PROOF_CACHE_SIZE> stakeProofCache GUARDED_BY(cs_main);
+
+static bool CheckBlockProofOfStake(const CBlock& block, CBlockIndex* pindex, uint256& hashProof, CCoinsViewCache& view, bool fCheckSignature) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    if (stakeProofCache.get(pindex->GetBlockHash(), hashProof))
+        return true;
+
+    if (!CheckProofOfStake(pindex->pprev, block.vtx[1], block.nBits, hashProof, view, fCheckSignature))
+        return false;
+
+    if (fCheckSignature)
+        stakeProofCache.insert(pindex->GetBlockHash(), hashProof);
+    return true;
+}
+
 // These checks can only be done when all previous block have been added.
-bool StakeContextualBlockChecks(const CBlock& block, CValidationState& state, CBlockIndex* pindex, bool fJustCheck)
+// With fCheckSignature = false the caller has to verify the script of the kernel input.
+bool StakeContextualBlockChecks(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, bool fJustCheck, bool fCheckSignature = true)
 {
     uint256 hashProof;
 
-    CCoinsViewCache view(pcoinsTip.get());
-    if (block.IsProofOfStake() && !CheckProofOfStake(pindex->pprev, block.vtx[1], block.nBits, hashProof, view))
+    if (block.IsProofOfStake() && !CheckBlockProofOfStake(block, pindex, hashProof, view, fCheckSignature))
         return false;
 
     if (fJustCheck)
@@ -2097,7 +2144,9 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     uint256 hashPrevBlock = pindex->pprev == nullptr ? uint256() : pindex->pprev->GetBlockHash();
     assert(hashPrevBlock == view.GetBestBlock());
 
-    if (!StakeContextualBlockChecks(block, state, pindex, fJustCheck))
+    // The kernel input is spent by the coinstake, so its script is verified by the
+    // script check queue together with all other inputs of the block
+    if (!StakeContextualBlockChecks(block, state, pindex, view, fJustCheck, false))
         return false;
 
     const Consensus::Params& consensusParams = chainparams.GetConsensus();
@@ -2363,9 +2412,9 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                     const Coin& coin = view.AccessCoin(tx.vin[j].prevout);
                     const CTxOut &prevout = coin.out;
 
-                    std::string assetName ="";
+                    uint32_t assetId = 0;
                     if (prevout.nAsset.IsExplicit())
-                        assetName = prevout.nAsset.GetAsset().getName();
+                        assetId = pblocktree->GetAddressIndexAssetId(prevout.nAsset.GetAsset().getName());
 
                     uint160 hashBytes;
                     int addressType = 0;
@@ -2386,10 +2435,10 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
                     if (g_txindex && addressType > 0) {
                         // record spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, assetName, pindex->nHeight, i, txhash, j, true), prevout.nValue.GetAmount() * -1));
+                        addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, assetId, pindex->nHeight, i, txhash, j, true), prevout.nValue.GetAmount() * -1));
 
                         // remove address from unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, assetName, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
+                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, assetId, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
                     }
 
                     if (g_txindex) {
@@ -2437,32 +2486,32 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
             for (unsigned int k = 0; k < tx.vout.size(); k++) {
                 const CTxOut &out = tx.vout[k];
 
-                std::string assetName ="";
+                uint32_t assetId = 0;
                 if (out.nAsset.IsExplicit())
-                    assetName = out.nAsset.GetAsset().getName();
+                    assetId = pblocktree->GetAddressIndexAssetId(out.nAsset.GetAsset().getName());
 
                 if (out.scriptPubKey.IsPayToScriptHash()) {
                     std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
 
                     // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), assetName, pindex->nHeight, i, txhash, k, false), out.nValue.GetAmount()));
+                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), assetId, pindex->nHeight, i, txhash, k, false), out.nValue.GetAmount()));
 
                     // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), assetName, txhash, k), CAddressUnspentValue(out.nValue.GetAmount(), out.scriptPubKey, pindex->nHeight)));
+                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), assetId, txhash, k), CAddressUnspentValue(out.nValue.GetAmount(), out.scriptPubKey, pindex->nHeight)));
 
                 } else if (out.scriptPubKey.IsPayToPubkeyHash()) {
                     std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
 
                     // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), assetName, pindex->nHeight, i, txhash, k, false), out.nValue.IsExplicit() ? out.nValue.GetAmount(): 0));
+                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), assetId, pindex->nHeight, i, txhash, k, false), out.nValue.IsExplicit() ? out.nValue.GetAmount(): 0));
 
                     // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), assetName, txhash, k), CAddressUnspentValue(out.nValue.IsExplicit() ? out.nValue.GetAmount(): 0, out.scriptPubKey, pindex->nHeight)));
+                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), assetId, txhash, k), CAddressUnspentValue(out.nValue.IsExplicit() ? out.nValue.GetAmount(): 0, out.scriptPubKey, pindex->nHeight)));
 
                 } else if (out.scriptPubKey.IsPayToPubkey()) {
                     uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, assetName, pindex->nHeight, i, txhash, k, false), out.nValue.GetAmount()));
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, assetName, txhash, k), CAddressUnspentValue(out.nValue.GetAmount(), out.scriptPubKey, pindex->nHeight)));
+                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, assetId, pindex->nHeight, i, txhash, k, false), out.nValue.GetAmount()));
+                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, assetId, txhash, k), CAddressUnspentValue(out.nValue.GetAmount(), out.scriptPubKey, pindex->nHeight)));
                 } else {
                     continue;
                 }
@@ -2526,6 +2575,8 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
     if (!control.Wait())
         return state.Invalid(ValidationInvalidReason::CONSENSUS, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
+    if (block.IsProofOfStake() && fScriptChecks && !fJustCheck)
+        stakeProofCache.insert(pindex->GetBlockHash(), pindex->hashProof);
     int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2;
     LogPrint(BCLog::BENCHMARK, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs (%.2fms/blk)]\n", nInputs - 1, MILLI * (nTime4 - nTime2), nInputs <= 1 ? 0 : MILLI * (nTime4 - nTime2) / (nInputs-1), nTimeVerify * MICRO, nTimeVerify * MILLI / nBlocksTotal);
 
@@ -4089,7 +4140,7 @@ bool CChainState::UpdateHashProof(const CBlock& block, CValidationState& state,
 {
     uint256 hashProof;
     // Verify hash target and signature of coinstake tx
-    if (block.IsProofOfStake() && !CheckProofOfStake(pindex->pprev, block.vtx[1], block.nBits, hashProof, view))
+    if (block.IsProofOfStake() && !CheckBlockProofOfStake(block, pindex, hashProof, view, true))
         return error("UpdateHashProof() : check proof-of-stake failed for block %s", block.GetHash().ToString());
 
     // PoW is checked in CheckBlock()
@@ -4335,7 +4386,8 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
     }
 
     // peercoin: check PoS
-    if (block.IsProofOfStake() && !StakeContextualBlockChecks(block, state, pindex, false)) {
+    CCoinsViewCache viewTip(pcoinsTip.get());
+    if (block.IsProofOfStake() && !StakeContextualBlockChecks(block, state, pindex, viewTip, false)) {
         pindex->nStatus |= BLOCK_FAILED_VALID;
         setDirtyBlockIndex.insert(pindex);
         return error(" %s: %s proof of stake is incorrect", __func__, FormatStateMessage(state));
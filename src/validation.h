@@ -389,9 +389,12 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
 bool HashOnchainActive(const uint256 &hash);
 bool GetAddressIndex(uint160 addressHash, int type, std::string assetName,
                      std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                     int start = 0, int end = 0);
+                     int start = 0, int end = 0, size_t nLimit = 0, CAddressIndexKey *pnext = nullptr);
+/** Add the balance and total received of an address, over all assets, from the address balance index */
+bool GetAddressBalance(uint160 addressHash, int type, CAmount &balance, CAmount &received);
 bool GetAddressUnspent(uint160 addressHash, int type, std::string assetName,
-                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                       size_t nLimit = 0, CAddressUnspentKey *pnext = nullptr);
 /** Initializes the script-execution cache */
 void InitScriptExecutionCache();
 
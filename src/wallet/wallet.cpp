@@ -1652,6 +1652,7 @@ void CWallet::TransactionAddedToMempool(const CTransactionRef& ptx, int64_t nAcc
     auto locked_chain = chain().lock();
     LOCK(cs_wallet);
     SyncTransaction(ptx, CWalletTx::Status::UNCONFIRMED, {} /* block hash */, 0 /* position in block */);
+    UpdateStakeCandidates(*ptx, {} /* block hash */, 0 /* block time */);
 
     auto it = mapWallet.find(ptx->GetHash());
     if (it != mapWallet.end()) {
@@ -1674,6 +1675,7 @@ void CWallet::BlockConnected(const CBlock& block, const std::vector<CTransaction
 
     for (size_t i = 0; i < block.vtx.size(); i++) {
         SyncTransaction(block.vtx[i], CWalletTx::Status::CONFIRMED, block_hash, i);
+        UpdateStakeCandidates(*block.vtx[i], block_hash, block.GetBlockTime());
         TransactionRemovedFromMempool(block.vtx[i]);
     }
     for (const CTransactionRef& ptx : vtxConflicted) {
@@ -1695,6 +1697,7 @@ void CWallet::BlockDisconnected(const CBlock& block, const CBlockIndex* pindexDi
     for (const CTransactionRef& ptx : block.vtx) {
         posInBlock = ptx->IsCoinStake() ? -1 : 0;
         SyncTransaction(ptx, CWalletTx::Status::UNCONFIRMED, {} /* block hash */, posInBlock /* position in block */);
+        UpdateStakeCandidates(*ptx, {} /* block hash */, 0 /* block time */);
     }
 }
 
@@ -7123,10 +7126,94 @@ bool CWallet::SelectCoinsForStaking(CAmountMap& mapTargetValue, unsigned int nSp
     return true;
 }
 
+bool CWallet::AddStakeCandidate(const CWalletTx& wtx, unsigned int n, int64_t nBlockTime)
+{
+    AssertLockHeld(cs_wallet);
+    if (n >= wtx.tx->vout.size())
+        return false;
+
+    const CTxOut& txout = wtx.tx->vout[n];
+    if (!txout.nValue.IsExplicit() || IsMine(txout) == ISMINE_NO)
+        return false;
+
+    CStakeCandidate& candidate = m_stake_candidates[COutPoint(wtx.GetHash(), n)];
+    candidate.nTimeTxPrev = wtx.tx->nTime;
+    candidate.nValue = txout.nValue.GetAmount();
+    candidate.nBlockTime = nBlockTime;
+    candidate.scriptPubKey = txout.scriptPubKey;
+    return true;
+}
+
+void CWallet::LoadStakeCandidates(interfaces::Chain::Lock& locked_chain)
+{
+    AssertLockHeld(cs_wallet);
+    m_stake_candidates.clear();
+
+    for (const auto& entry : mapWallet) {
+        const CWalletTx& wtx = entry.second;
+        if (wtx.m_confirm.status != CWalletTx::CONFIRMED)
+            continue;
+        Optional<int> height = locked_chain.getBlockHeight(wtx.m_confirm.hashBlock);
+        if (!height)
+            continue;
+        int64_t nBlockTime = locked_chain.getBlockTime(*height);
+        for (unsigned int n = 0; n < wtx.tx->vout.size(); n++) {
+            if (!IsSpent(locked_chain, entry.first, n))
+                AddStakeCandidate(wtx, n, nBlockTime);
+        }
+    }
+
+    m_stake_candidates_loaded = true;
+    LogPrint(BCLog::COINSTAKE, "%s: loaded %u stake candidates\n", __func__, m_stake_candidates.size());
+}
+
+void CWallet::UpdateStakeCandidates(const CTransaction& tx, const uint256& block_hash, int64_t nBlockTime)
+{
+    AssertLockHeld(cs_wallet);
+    if (!m_stake_candidates_loaded)
+        return;
+
+    // Spent outputs can never be a kernel again
+    for (const CTxIn& txin : tx.vin)
+        m_stake_candidates.erase(txin.prevout);
+
+    const uint256& hash = tx.GetHash();
+    auto it = mapWallet.find(hash);
+    for (unsigned int n = 0; n < tx.vout.size(); n++) {
+        if (block_hash.IsNull() || it == mapWallet.end()) {
+            // Unconfirmed or disconnected outputs are not mature for staking
+            m_stake_candidates.erase(COutPoint(hash, n));
+        } else {
+            AddStakeCandidate(it->second, n, nBlockTime);
+        }
+    }
+}
+
+bool CWallet::GetStakeCandidate(interfaces::Chain::Lock& locked_chain, const COutPoint& prevout, CStakeCandidate& candidate)
+{
+    AssertLockHeld(cs_wallet);
+    if (!m_stake_candidates_loaded)
+        LoadStakeCandidates(locked_chain);
+
+    auto it = m_stake_candidates.find(prevout);
+    if (it == m_stake_candidates.end()) {
+        // Not cached, e.g. an output that became unspent again after a reorg
+        auto mi = mapWallet.find(prevout.hash);
+        if (mi == mapWallet.end() || mi->second.m_confirm.status != CWalletTx::CONFIRMED)
+            return false;
+        Optional<int> height = locked_chain.getBlockHeight(mi->second.m_confirm.hashBlock);
+        if (!height || !AddStakeCandidate(mi->second, prevout.n, locked_chain.getBlockTime(*height)))
+            return false;
+        it = m_stake_candidates.find(prevout);
+    }
+
+    candidate = it->second;
+    return true;
+}
+
 bool CWallet::CreateCoinStake(unsigned int nBits, CMutableTransaction& txNew, COutPoint& headerPrevout, std::vector<CTxOut>& voutMasternodePaymentsRet, std::vector<CTxOut>& voutSuperblockPaymentsRet)
 {
     const Consensus::Params& params = Params().GetConsensus();
-    LOCK(cs_wallet);
 
     txNew.vin.clear();
     txNew.vout.clear();
@@ -7136,119 +7223,155 @@ bool CWallet::CreateCoinStake(unsigned int nBits, CMutableTransaction& txNew, CO
     scriptEmpty.clear();
     txNew.vout.push_back(CTxOut(CAsset(), 0, scriptEmpty));
 
-    // Choose coins to use
-    CCoinControl temp;
-    CAmountMap mapBalance = GetAvailableBalance(temp);
-    CAmount m_reserve_balance = gArgs.GetArg("-reserve-balance", DEFAULT_RESERVE_BALANCE);
-    CAmountMap map_reserve_balance = populateMap(m_reserve_balance);
+    CAmountMap mapBalance;
+    CAmountMap map_reserve_balance;
+    std::vector<COutPoint> vSelectedCoins;
+    // Kernel input data of the selected coins, copied so the kernel search can run without cs_main and cs_wallet
+    std::vector<std::pair<COutPoint, CStakeCandidate>> vStakeInputs;
+    const CBlockIndex* pindexPrev;
+    const uint32_t nSearchTimeEnd = txNew.nTime;
+    int64_t nSearchTimeBegin;
+    {
+        LOCK(cs_wallet);
 
-    if (mapBalance <= map_reserve_balance)
-        return false;
+        // Choose coins to use
+        CCoinControl temp;
+        mapBalance = GetAvailableBalance(temp);
+        CAmount m_reserve_balance = gArgs.GetArg("-reserve-balance", DEFAULT_RESERVE_BALANCE);
+        map_reserve_balance = populateMap(m_reserve_balance);
 
-    std::vector<const CWalletTx*> vwtxPrev;
+        if (mapBalance <= map_reserve_balance)
+            return false;
 
-    std::set<std::pair<const CWalletTx*,unsigned int> > setCoins;
-    CAmountMap mapValueIn;
+        std::set<std::pair<const CWalletTx*,unsigned int> > setCoins;
+        CAmountMap mapValueIn;
 
-    // Select coins with suitable depth
-    auto locked_chain = m_chain->lock();
-    CAmountMap mapTargetValue;
-    mapBalance -= map_reserve_balance;
-    mapTargetValue = mapBalance;
+        // Select coins with suitable depth
+        auto locked_chain = m_chain->lock();
+        CAmountMap mapTargetValue;
+        mapBalance -= map_reserve_balance;
+        mapTargetValue = mapBalance;
 
-    for (auto it = mapTargetValue.cbegin(); it != mapTargetValue.cend() /* not hoisted */; /* no increment */)
-    {
-        if (it->second < 1)
+        for (auto it = mapTargetValue.cbegin(); it != mapTargetValue.cend() /* not hoisted */; /* no increment */)
         {
-            it = mapTargetValue.erase(it);    // or "it = m.erase(it)" since C++11
+            if (it->second < 1)
+            {
+                it = mapTargetValue.erase(it);    // or "it = m.erase(it)" since C++11
+            }
+            else
+            {
+                ++it;
+            }
         }
-        else
+
+        if (!SelectCoinsForStaking(mapTargetValue, txNew.nTime, setCoins, mapValueIn))
+            return false;
+
+        if (setCoins.empty())
+            return false;
+
+        // Gather the kernel input data of all selected coins from the stake-candidate cache
+        for(const auto& pcoin : setCoins)
         {
-            ++it;
+            COutPoint prevout(pcoin.first->GetHash(), pcoin.second);
+            vSelectedCoins.emplace_back(prevout);
+            CStakeCandidate candidate;
+            if (!GetStakeCandidate(*locked_chain, prevout, candidate))
+                continue;
+            vStakeInputs.emplace_back(prevout, candidate);
         }
+
+        // Search backward in time from the given txNew timestamp, at most
+        // nMaxStakeSearchInterval seconds and not past the previous search
+        static const int64_t nMaxStakeSearchInterval = 60;
+        pindexPrev = locked_chain->currentTip();
+        nSearchTimeBegin = std::max<int64_t>(nSearchTimeEnd - nMaxStakeSearchInterval + 1, m_last_coin_stake_search_interval + 1);
+        nSearchTimeBegin = std::max<int64_t>(nSearchTimeBegin, pindexPrev->GetMedianTimePast() + 1);
+        nSearchTimeBegin = std::min<int64_t>(nSearchTimeBegin, nSearchTimeEnd);
+        m_last_coin_stake_search_interval = nSearchTimeEnd;
     }
 
-    if (!SelectCoinsForStaking(mapTargetValue, txNew.nTime, setCoins, mapValueIn))
+    boost::this_thread::interruption_point();
+    size_t nKernelIndex;
+    uint32_t nKernelTime;
+    bool fKernelFound = m_chain->findKernel(pindexPrev, nBits, vStakeInputs, nSearchTimeBegin, nSearchTimeEnd, nKernelIndex, nKernelTime);
+
+    if (!fKernelFound) {
+        if (gArgs.GetBoolArg("-debug", false)){
+            LogPrintf("NO KERNEL FOUND \n");
+        }
         return false;
+    }
 
-    if (setCoins.empty())
+    LOCK(cs_wallet);
+    auto locked_chain = m_chain->lock();
+
+    // The kernel is only good on top of the block it was searched for, and the coins may have been spent during the search
+    if (locked_chain->currentTip() != pindexPrev)
         return false;
+    std::set<std::pair<const CWalletTx*,unsigned int> > setCoins;
+    for (const COutPoint& prevout : vSelectedCoins)
+    {
+        auto mi = mapWallet.find(prevout.hash);
+        if (mi != mapWallet.end() && !IsSpent(*locked_chain, prevout.hash, prevout.n))
+            setCoins.emplace(&mi->second, prevout.n);
+    }
 
+    std::vector<const CWalletTx*> vwtxPrev;
     CAmountMap nCredit;
     CScript scriptPubKeyKernel;
     CAsset asset;
 
-    for(const auto& pcoin : setCoins)
     {
-        bool fKernelFound = false;
-        boost::this_thread::interruption_point();
-        // Search backward in time from the given txNew timestamp
-        // Search nSearchInterval seconds back up to nMaxStakeSearchInterval
-        COutPoint prevoutStake = COutPoint(pcoin.first->GetHash(), pcoin.second);
-        static int nMaxStakeSearchInterval = 60;
-        static int nSearchInterval = txNew.nTime - m_last_coin_stake_search_interval;
-
-        for (unsigned int n=0; n<std::min(nSearchInterval,nMaxStakeSearchInterval) && !fKernelFound; n++)
+        COutPoint prevoutStake = vStakeInputs[nKernelIndex].first;
+        auto mi = mapWallet.find(prevoutStake.hash);
+        if (mi == mapWallet.end() || IsSpent(*locked_chain, prevoutStake.hash, prevoutStake.n))
+            return false;
+        const std::pair<const CWalletTx*, unsigned int> pcoin(&mi->second, prevoutStake.n);
+        txNew.nTime = nKernelTime;
+
+        // Found a kernel
+        LogPrint(BCLog::COINSTAKE, "CreateCoinStake : kernel found \n");
+        std::vector<valtype> vSolutions;
+        txnouttype whichType;
+        CScript scriptPubKeyOut;
+        scriptPubKeyKernel = pcoin.first->tx->vout[pcoin.second].scriptPubKey;
+        if (!Solver(scriptPubKeyKernel, whichType, vSolutions))
         {
-            if (locked_chain->checkKernel(nBits, txNew.nTime, prevoutStake))
-            {
-                // Found a kernel
-                LogPrint(BCLog::COINSTAKE, "CreateCoinStake : kernel found \n");
-                std::vector<valtype> vSolutions;
-                txnouttype whichType;
-                CScript scriptPubKeyOut;
-                scriptPubKeyKernel = pcoin.first->tx->vout[pcoin.second].scriptPubKey;
-                if (!Solver(scriptPubKeyKernel, whichType, vSolutions))
-                {
-                    LogPrint(BCLog::COINSTAKE, "CreateCoinStake : failed to parse kernel \n");
-                    break;
-                }
-                LogPrint(BCLog::COINSTAKE, "CreateCoinStake : parsed kernel type=%d \n", whichType);
-                if (whichType != TX_PUBKEY && whichType != TX_PUBKEYHASH && whichType != TX_WITNESS_V0_KEYHASH)
-                {
-                    LogPrint(BCLog::COINSTAKE, "CreateCoinStake : no support for kernel type=%d\n", whichType);
-                    break;  // only support pay to public key and pay to address
-                }
-                if (whichType == TX_PUBKEYHASH || whichType == TX_WITNESS_V0_KEYHASH) // pay to address type or witness keyhash
-                {
-                    // convert to pay to public key type
-                    CKey key;
-                    if (!GetKey(CKeyID(uint160(vSolutions[0])), key))
-                    {
-                        LogPrint(BCLog::COINSTAKE, "CreateCoinStake : failed to get key for kernel type=%d\n", whichType);
-                        break;  // unable to find corresponding public key
-                    }
-                    scriptPubKeyOut << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
-                }
-                    else
-                        scriptPubKeyOut = scriptPubKeyKernel;
-
-                CAmount amnt = pcoin.first->tx->vout[pcoin.second].nValue.GetAmount();
-                asset = pcoin.first->tx->vout[pcoin.second].nAsset.GetAsset();
-                CAmountMap tmp {{asset,amnt}};
-                txNew.vin.push_back(CTxIn(pcoin.first->GetHash(), pcoin.second));
-                nCredit += tmp;
-                vwtxPrev.push_back(pcoin.first);
-                txNew.vout.push_back(CTxOut(asset, 0, scriptPubKeyOut));
-                LogPrint(BCLog::COINSTAKE, "CreateCoinStake : added kernel type=%d, Amount=%d, Asset=%s\n", whichType, nCredit, asset.getName());
-                fKernelFound = true;
-                break;
-            }
+            LogPrint(BCLog::COINSTAKE, "CreateCoinStake : failed to parse kernel \n");
+            return false;
         }
-        if (fKernelFound){
-            headerPrevout = prevoutStake;
-            break; // if kernel is found stop searching
+        LogPrint(BCLog::COINSTAKE, "CreateCoinStake : parsed kernel type=%d \n", whichType);
+        if (whichType != TX_PUBKEY && whichType != TX_PUBKEYHASH && whichType != TX_WITNESS_V0_KEYHASH)
+        {
+            LogPrint(BCLog::COINSTAKE, "CreateCoinStake : no support for kernel type=%d\n", whichType);
+            return false;  // only support pay to public key and pay to address
         }
-        if((!fKernelFound)){
-            if (gArgs.GetBoolArg("-debug", false)){
-                LogPrintf("NO KERNEL FOUND \n");
+        if (whichType == TX_PUBKEYHASH || whichType == TX_WITNESS_V0_KEYHASH) // pay to address type or witness keyhash
+        {
+            // convert to pay to public key type
+            CKey key;
+            if (!GetKey(CKeyID(uint160(vSolutions[0])), key))
+            {
+                LogPrint(BCLog::COINSTAKE, "CreateCoinStake : failed to get key for kernel type=%d\n", whichType);
+                return false;  // unable to find corresponding public key
             }
-            return false;
+            scriptPubKeyOut << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
         }
+        else
+            scriptPubKeyOut = scriptPubKeyKernel;
+
+        CAmount amnt = pcoin.first->tx->vout[pcoin.second].nValue.GetAmount();
+        asset = pcoin.first->tx->vout[pcoin.second].nAsset.GetAsset();
+        CAmountMap tmp {{asset,amnt}};
+        txNew.vin.push_back(CTxIn(pcoin.first->GetHash(), pcoin.second));
+        nCredit += tmp;
+        vwtxPrev.push_back(pcoin.first);
+        txNew.vout.push_back(CTxOut(asset, 0, scriptPubKeyOut));
+        LogPrint(BCLog::COINSTAKE, "CreateCoinStake : added kernel type=%d, Amount=%d, Asset=%s\n", whichType, nCredit, asset.getName());
+        headerPrevout = prevoutStake;
     }
 
-    m_last_coin_stake_search_interval = txNew.nTime;
-
     if (nCredit > (mapBalance - map_reserve_balance))
         return false;
 
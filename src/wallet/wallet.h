@@ -12,6 +12,7 @@
 #include <outputtype.h>
 #include <policy/feerate.h>
 #include <policy/policy.h>
+#include <pos.h>
 #include <script/sign.h>
 #include <streams.h>
 #include <tinyformat.h>
@@ -983,6 +984,20 @@ private:
     void AddToSpends(const uint256& wtxid) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     void RemoveFromSpends(const uint256& wtxid) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
+    /**
+     * Stake-candidate cache: kernel input data (txPrev nTime, value, block time,
+     * scriptPubKey) for our confirmed outputs, so CreateCoinStake can check
+     * kernels without reading transactions back from disk. Built once from
+     * mapWallet on first use and kept up to date from the validation interface
+     * callbacks. Missing entries are filled lazily from mapWallet.
+     */
+    std::map<COutPoint, CStakeCandidate> m_stake_candidates GUARDED_BY(cs_wallet);
+    bool m_stake_candidates_loaded GUARDED_BY(cs_wallet){false};
+    bool AddStakeCandidate(const CWalletTx& wtx, unsigned int n, int64_t nBlockTime) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    void LoadStakeCandidates(interfaces::Chain::Lock& locked_chain) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    void UpdateStakeCandidates(const CTransaction& tx, const uint256& block_hash, int64_t nBlockTime) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    bool GetStakeCandidate(interfaces::Chain::Lock& locked_chain, const COutPoint& prevout, CStakeCandidate& candidate) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     /**
      * Add a transaction to the wallet, or update it.  pIndex and posInBlock should
      * be set when the transaction was known to be included in a block.  When